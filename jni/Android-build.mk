@@ -13,6 +13,10 @@ TARGET_PLATFORM := android-5
 	
 USE_OPENGL_ES_1_1 := true
 
+# run the headless benchmarks/verifications of the bench files during Demo::onInit,
+# the benchmarks are only compiled in with it
+USE_BENCHMARK := false
+
 ifeq ($(USE_OPENGL_ES_1_1), true)
     OPENGLES_LIB  := -lGLESv1_CM
 	OPENGLES_DEF  := -DUSE_OPENGL_ES_1_1
@@ -23,10 +27,14 @@ endif
 
 LOCAL_CFLAGS := -Wno-write-strings $(OPENGLES_DEF)
 
+ifeq ($(USE_BENCHMARK), true)
+LOCAL_CFLAGS += -DUSE_BENCHMARK
+endif
+
 LOCAL_SHARED_LIBRARIES := Cal3DNative
 
 LOCAL_LDLIBS := \
-    -llog $(OPENGLES_LIB)
+    -llog -lEGL $(OPENGLES_LIB)
 	
 ifeq ($(TARGET_ARCH_ABI),x86)
 LOCAL_CFLAGS += -fno-stack-protector 
@@ -50,7 +58,48 @@ LOCAL_SRC_FILES :=  src/Base/ARGameProgram.cpp	\
 					program/model.cpp	 \
 					program/menu.cpp	\
 					program/demo.cpp	\
-					program/tga.cpp
+					program/tga.cpp	\
+					program/skinning.cpp	\
+					program/skinstream.cpp	\
+					program/coremodeldata.cpp	\
+					program/tracksampler.cpp	\
+					program/animmixer.cpp	\
+					program/packedanimation.cpp	\
+					program/compressedanimation.cpp	\
+					program/keyframereducer.cpp	\
+					program/mappedsource.cpp	\
+					program/assetloader.cpp	\
+					program/bulkstreamsource.cpp	\
+					program/fastloader.cpp	\
+					program/asyncloader.cpp	\
+					program/coremodelcache.cpp	\
+					program/threadpool.cpp	\
+					program/crowd.cpp	\
+					program/modelpipeline.cpp	\
+					program/hardwareskinning.cpp	\
+					program/flatskeleton.cpp	\
+					program/poseblender.cpp	\
+					program/posecache.cpp	\
+					program/bakedanimation.cpp	\
+					program/animationlod.cpp
+
+ifeq ($(USE_BENCHMARK), true)
+LOCAL_SRC_FILES += program/bench.cpp
+LOCAL_SRC_FILES += program/bench_animation.cpp
+LOCAL_SRC_FILES += program/bench_loading.cpp
+LOCAL_SRC_FILES += program/bench_pipeline.cpp
+LOCAL_SRC_FILES += program/bench_skinning.cpp
+endif
+
+# NEON is optional on armeabi-v7a, the kernel is selected at runtime
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_CFLAGS += -DHAVE_NEON
+LOCAL_SRC_FILES += program/poseblender_neon.cpp.neon
+LOCAL_SRC_FILES += program/skinning_neon.cpp.neon
+LOCAL_STATIC_LIBRARIES := cpufeatures
+endif
 				
 LOCAL_ARM_MODE := arm
 include $(BUILD_SHARED_LIBRARY)
+
+$(call import-module,android/cpufeatures)
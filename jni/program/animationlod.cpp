@@ -0,0 +1,158 @@
+//----------------------------------------------------------------------------//
+// animationlod.cpp                                                           //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "animationlod.h"
+#include <float.h>
+
+//----------------------------------------------------------------------------//
+// Static member variables initialization                                     //
+//----------------------------------------------------------------------------//
+
+bool AnimationLod::m_bEnabled = false;
+
+// fractions of the viewport height
+float AnimationLod::m_minScreenSize[AnimationLod::LEVEL_COUNT] = { 0.25f, 0.1f, 0.0f };
+
+//----------------------------------------------------------------------------//
+// Get the level of detail of a model with a given size on screen             //
+//----------------------------------------------------------------------------//
+
+AnimationLod::Level AnimationLod::getLevel(float screenSize)
+{
+  int level;
+  for(level = LEVEL_FULL; level < LEVEL_COUNT - 1; level++)
+  {
+    if(screenSize >= m_minScreenSize[level]) break;
+  }
+
+  return (Level)level;
+}
+
+//----------------------------------------------------------------------------//
+// Get the name of a level of detail                                          //
+//----------------------------------------------------------------------------//
+
+const char *AnimationLod::getLevelName(Level level)
+{
+  switch(level)
+  {
+    case LEVEL_FULL:
+      return "full";
+    case LEVEL_HALF:
+      return "half";
+    case LEVEL_QUARTER:
+      return "quarter";
+    default:
+      return "unknown";
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Get the smallest size on screen a level of detail is used for              //
+//----------------------------------------------------------------------------//
+
+float AnimationLod::getMinScreenSize(Level level)
+{
+  return m_minScreenSize[level];
+}
+
+//----------------------------------------------------------------------------//
+// Get the height of a model on screen as a fraction of the viewport height,  //
+// from the bounding box of its skeleton; the projection scale is the near    //
+// plane distance divided by the top of the frustum at the near plane         //
+//----------------------------------------------------------------------------//
+
+float AnimationLod::getScreenSize(CalModel *pModel, float distance, float projectionScale)
+{
+  if(distance <= 0.0f) return FLT_MAX;
+
+  CalVector point[8];
+  pModel->getBoundingBox().computePoints(point);
+
+  CalVector minPoint;
+  minPoint = point[0];
+  CalVector maxPoint;
+  maxPoint = point[0];
+
+  int pointId;
+  for(pointId = 1; pointId < 8; pointId++)
+  {
+    if(point[pointId].x < minPoint.x) minPoint.x = point[pointId].x;
+    if(point[pointId].y < minPoint.y) minPoint.y = point[pointId].y;
+    if(point[pointId].z < minPoint.z) minPoint.z = point[pointId].z;
+    if(point[pointId].x > maxPoint.x) maxPoint.x = point[pointId].x;
+    if(point[pointId].y > maxPoint.y) maxPoint.y = point[pointId].y;
+    if(point[pointId].z > maxPoint.z) maxPoint.z = point[pointId].z;
+  }
+
+  // the bounding sphere covers the box in any orientation
+  float radius;
+  radius = 0.5f * (maxPoint - minPoint).length();
+
+  return radius * projectionScale / distance;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of frames between two updates of a level of detail          //
+//----------------------------------------------------------------------------//
+
+int AnimationLod::getUpdateInterval(Level level)
+{
+  switch(level)
+  {
+    case LEVEL_HALF:
+      return 2;
+    case LEVEL_QUARTER:
+      return 4;
+    default:
+      return 1;
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Check if a level of detail leaves the detail bones out                     //
+//----------------------------------------------------------------------------//
+
+bool AnimationLod::isDetailSkipped(Level level)
+{
+  return level == LEVEL_QUARTER;
+}
+
+//----------------------------------------------------------------------------//
+// Check if the models pick their level of detail from their size on screen   //
+//----------------------------------------------------------------------------//
+
+bool AnimationLod::isEnabled()
+{
+  return m_bEnabled;
+}
+
+//----------------------------------------------------------------------------//
+// Enable or disable the animation level of detail                            //
+//----------------------------------------------------------------------------//
+
+void AnimationLod::setEnabled(bool bEnabled)
+{
+  m_bEnabled = bEnabled;
+}
+
+//----------------------------------------------------------------------------//
+// Set the smallest size on screen a level of detail is used for              //
+//----------------------------------------------------------------------------//
+
+void AnimationLod::setMinScreenSize(Level level, float minScreenSize)
+{
+  m_minScreenSize[level] = minScreenSize;
+}
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,59 @@
+//----------------------------------------------------------------------------//
+// animationlod.h                                                             //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef ANIMATIONLOD_H
+#define ANIMATIONLOD_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+// picks the animation level of detail of a model from its size on screen,
+// small models are animated and skinned every 2nd or 4th frame with their
+// skinned output interpolated in between, the smallest ones also leave the
+// detail bones like fingers and ponytails out
+class AnimationLod
+{
+// misc
+public:
+  enum Level
+  {
+    LEVEL_FULL = 0,
+    LEVEL_HALF,
+    LEVEL_QUARTER,
+    LEVEL_COUNT
+  };
+
+// member variables
+protected:
+  static bool m_bEnabled;
+  static float m_minScreenSize[LEVEL_COUNT];
+
+// member functions
+public:
+  static Level getLevel(float screenSize);
+  static const char *getLevelName(Level level);
+  static float getMinScreenSize(Level level);
+  static float getScreenSize(CalModel *pModel, float distance, float projectionScale);
+  static int getUpdateInterval(Level level);
+  static bool isDetailSkipped(Level level);
+  static bool isEnabled();
+  static void setEnabled(bool bEnabled);
+  static void setMinScreenSize(Level level, float minScreenSize);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,657 @@
+//----------------------------------------------------------------------------//
+// animmixer.cpp                                                              //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "animmixer.h"
+#include "coremodeldata.h"
+#include "packedanimation.h"
+#include "bakedanimation.h"
+#include "compressedanimation.h"
+#include "flatskeleton.h"
+#include "posecache.h"
+#include "cal3d/coretrack.h"
+
+//----------------------------------------------------------------------------//
+// Static member variables initialization                                     //
+//----------------------------------------------------------------------------//
+
+int AnimMixer::m_updateCount = 0;
+int AnimMixer::m_skippedUpdateCount = 0;
+int AnimMixer::m_boneCount = 0;
+int AnimMixer::m_calculatedBoneCount = 0;
+int AnimMixer::m_skippedTrackCount = 0;
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+AnimMixer::AnimMixer(CalModel *pModel)
+  : CalMixer(pModel)
+{
+  m_blendMode = PoseBlender::MODE_CORRECTED_NLERP;
+  m_bIncremental = true;
+  m_bDetailSkipped = false;
+  m_bValid = false;
+  m_lastCalculatedBoneCount = 0;
+  m_pFlatSkeleton = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+AnimMixer::~AnimMixer()
+{
+}
+
+//----------------------------------------------------------------------------//
+// Sample all tracks of an animation into the animation pose and blend it     //
+// into the layer pose; with the pose cache enabled the time is quantized and //
+// the pose is shared with all models playing the same core animation         //
+//----------------------------------------------------------------------------//
+
+void AnimMixer::blendAnimation(CalAnimation *pAnimation, float time)
+{
+  float *pAnimationPose = &m_vectorAnimationPose[0];
+
+  if(PoseCache::isEnabled())
+  {
+    CalCoreAnimation *pCoreAnimation;
+    pCoreAnimation = pAnimation->getCoreAnimation();
+
+    int timeKey;
+    timeKey = PoseCache::getTimeKey(time);
+
+    // the cached poses hold a weight of 1 for the sampled bones, the weight
+    // of the animation is applied to the copy
+    if(!PoseCache::get(pCoreAnimation, timeKey, m_blendMode, pAnimationPose, (int)m_vectorAnimationPose.size()))
+    {
+      float sampleTime;
+      sampleTime = PoseCache::getTime(timeKey);
+      if(sampleTime > pCoreAnimation->getDuration()) sampleTime = pCoreAnimation->getDuration();
+
+      PoseBlender::clear(pAnimationPose, getBlockCount());
+      sampleAnimation(pAnimation, sampleTime, 1.0f, pAnimationPose);
+      PoseCache::insert(pCoreAnimation, timeKey, m_blendMode, pAnimationPose, (int)m_vectorAnimationPose.size());
+    }
+
+    PoseBlender::setWeight(pAnimationPose, getBlockCount(), pAnimation->getWeight());
+  }
+  else
+  {
+    PoseBlender::clear(pAnimationPose, getBlockCount());
+    sampleAnimation(pAnimation, time, pAnimation->getWeight(), pAnimationPose);
+  }
+
+  PoseBlender::blend(&m_vectorLayerPose[0], pAnimationPose, getBlockCount(), m_blendMode);
+}
+
+//----------------------------------------------------------------------------//
+// Calculate the absolute state of the bones whose relative state changed     //
+// since the last update, and of all bones below them; with a flat skeleton   //
+// set the states go there and the bones of cal3d are left untouched          //
+//----------------------------------------------------------------------------//
+
+void AnimMixer::calculateState(CalSkeleton *pSkeleton)
+{
+  std::vector<CalBone *>& vectorBone = pSkeleton->getVectorBone();
+
+  int boneCount;
+  boneCount = (int)vectorBone.size();
+
+  // without a valid last state every bone is dirty
+  bool bValid;
+  bValid = m_bIncremental && m_bValid;
+
+  int calculatedBoneCount;
+  calculatedBoneCount = 0;
+
+  const std::vector<bool> *pVectorSkippedBone;
+  pVectorSkippedBone = getSkippedBones();
+
+  // the bones are visited parents first, so the dirty flag of the parent is
+  // already known for each bone
+  int orderId;
+  for(orderId = 0; orderId < boneCount; orderId++)
+  {
+    int boneId;
+    boneId = m_vectorBoneId[orderId];
+
+    CalBone *pBone;
+    pBone = vectorBone[boneId];
+
+    CalCoreBone *pCoreBone;
+    pCoreBone = pBone->getCoreBone();
+
+    CalVector translation;
+    CalQuaternion rotation;
+    float weight;
+    PoseBlender::getState(&m_vectorPose[0], boneId, translation, rotation, weight);
+
+    // bones without animation fall back to the core state, like in
+    // CalBone::calculateState
+    if(weight == 0.0f)
+    {
+      translation = pCoreBone->getTranslation();
+      rotation = pCoreBone->getRotation();
+    }
+
+    // skipped bones keep the relative state of their last update, even if
+    // the cache sampled them, and only move with their parent
+    if((pVectorSkippedBone != 0) && (*pVectorSkippedBone)[boneId] && m_bValid)
+    {
+      translation = m_vectorTranslation[boneId];
+      rotation = m_vectorRotation[boneId];
+      weight = 1.0f;
+    }
+
+    int parentId;
+    parentId = pCoreBone->getParentId();
+
+    bool bDirty;
+    bDirty = !bValid || ((parentId != -1) && m_vectorDirty[parentId]) || (translation != m_vectorTranslation[boneId]) || (rotation != m_vectorRotation[boneId]);
+
+    m_vectorDirty[boneId] = bDirty;
+    if(!bDirty) continue;
+
+    m_vectorTranslation[boneId] = translation;
+    m_vectorRotation[boneId] = rotation;
+
+    if(m_pFlatSkeleton != 0)
+    {
+      // bones without animation already hold the core state here
+      m_pFlatSkeleton->setState(boneId, translation, rotation);
+    }
+    else
+    {
+      // a single full weight state reproduces the blended state in the bone
+      pBone->clearState();
+      if(weight != 0.0f)
+      {
+        pBone->blendState(1.0f, translation, rotation);
+        pBone->lockState();
+      }
+    }
+
+    calculatedBoneCount++;
+  }
+
+  if(m_pFlatSkeleton != 0)
+  {
+    // the linear pass is cheap enough to always cover the whole skeleton
+    if(calculatedBoneCount > 0) m_pFlatSkeleton->calculateState();
+  }
+  else if(calculatedBoneCount == boneCount)
+  {
+    pSkeleton->calculateState();
+  }
+  else if(calculatedBoneCount > 0)
+  {
+    // CalBone::calculateState continues with all child bones, so only the
+    // top-most dirty bones are started, the clean subtrees keep their state
+    for(orderId = 0; orderId < boneCount; orderId++)
+    {
+      int boneId;
+      boneId = m_vectorBoneId[orderId];
+      if(!m_vectorDirty[boneId]) continue;
+
+      CalBone *pBone;
+      pBone = vectorBone[boneId];
+
+      int parentId;
+      parentId = pBone->getCoreBone()->getParentId();
+      if((parentId == -1) || !m_vectorDirty[parentId]) pBone->calculateState();
+
+      // the skeleton only recalculates its bounding boxes after a full
+      // CalSkeleton::calculateState, so refresh the ones of the moved bones
+      if(pBone->getCoreBone()->isBoundingBoxPrecomputed()) pBone->calculateBoundingBox();
+    }
+  }
+
+  m_bValid = true;
+  m_lastCalculatedBoneCount = calculatedBoneCount;
+
+  m_updateCount++;
+  if(calculatedBoneCount == 0) m_skippedUpdateCount++;
+  m_boneCount += boneCount;
+  m_calculatedBoneCount += calculatedBoneCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the track samplers of an animation, creating them on first use         //
+//----------------------------------------------------------------------------//
+
+AnimMixer::AnimationSampler& AnimMixer::getAnimationSampler(CalAnimation *pAnimation)
+{
+  AnimationSampler& animationSampler = m_mapAnimationSampler[pAnimation];
+  animationSampler.bActive = true;
+
+  // a new animation may reuse the address of a removed one, so check that the
+  // samplers still belong to the same core animation
+  CalCoreAnimation *pCoreAnimation;
+  pCoreAnimation = pAnimation->getCoreAnimation();
+
+  if(animationSampler.pCoreAnimation != pCoreAnimation)
+  {
+    animationSampler.pCoreAnimation = pCoreAnimation;
+
+    CoreModelData *pCoreModelData;
+    pCoreModelData = CoreModelData::get(m_pModel->getCoreModel());
+    animationSampler.pBakedAnimation = (pCoreModelData != 0) ? pCoreModelData->getBakedAnimation(pCoreAnimation) : 0;
+    animationSampler.pCompressedAnimation = (pCoreModelData != 0) ? pCoreModelData->getCompressedAnimation(pCoreAnimation) : 0;
+    animationSampler.pPackedAnimation = (pCoreModelData != 0) ? pCoreModelData->getPackedAnimation(pCoreAnimation) : 0;
+
+    if(animationSampler.pCompressedAnimation != 0)
+    {
+      animationSampler.vectorTrackSampler.assign(animationSampler.pCompressedAnimation->getTrackCount(), TrackSampler());
+    }
+    else if(animationSampler.pPackedAnimation != 0)
+    {
+      animationSampler.vectorTrackSampler.assign(animationSampler.pPackedAnimation->getTrackCount(), TrackSampler());
+    }
+    else
+    {
+      animationSampler.vectorTrackSampler.clear();
+    }
+  }
+
+  return animationSampler;
+}
+
+//----------------------------------------------------------------------------//
+// Get how the rotations of the animations are interpolated                   //
+//----------------------------------------------------------------------------//
+
+PoseBlender::Mode AnimMixer::getBlendMode()
+{
+  return m_blendMode;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of blocks of the poses                                      //
+//----------------------------------------------------------------------------//
+
+int AnimMixer::getBlockCount()
+{
+  return PoseBlender::getBlockCount(m_vectorBoneId.size());
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bones of all updates                                     //
+//----------------------------------------------------------------------------//
+
+int AnimMixer::getBoneCount()
+{
+  return m_boneCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bones recalculated by all updates                        //
+//----------------------------------------------------------------------------//
+
+int AnimMixer::getCalculatedBoneCount()
+{
+  return m_calculatedBoneCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the flat skeleton that takes the bone states, 0 if there is none       //
+//----------------------------------------------------------------------------//
+
+FlatSkeleton *AnimMixer::getFlatSkeleton()
+{
+  return m_pFlatSkeleton;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bones recalculated by the last update of this mixer      //
+//----------------------------------------------------------------------------//
+
+int AnimMixer::getLastCalculatedBoneCount()
+{
+  return m_lastCalculatedBoneCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the bones the updates leave out by core bone id, 0 if all bones are    //
+// updated                                                                    //
+//----------------------------------------------------------------------------//
+
+const std::vector<bool> *AnimMixer::getSkippedBones()
+{
+  if(!m_bDetailSkipped) return 0;
+
+  CoreModelData *pCoreModelData;
+  pCoreModelData = CoreModelData::get(m_pModel->getCoreModel());
+  if((pCoreModelData == 0) || (pCoreModelData->getDetailBones().size() != m_vectorBoneId.size())) return 0;
+
+  return &pCoreModelData->getDetailBones();
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of tracks the updates did not sample                        //
+//----------------------------------------------------------------------------//
+
+int AnimMixer::getSkippedTrackCount()
+{
+  return m_skippedTrackCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of updates that left the whole skeleton untouched           //
+//----------------------------------------------------------------------------//
+
+int AnimMixer::getSkippedUpdateCount()
+{
+  return m_skippedUpdateCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of skeleton updates                                         //
+//----------------------------------------------------------------------------//
+
+int AnimMixer::getUpdateCount()
+{
+  return m_updateCount;
+}
+
+//----------------------------------------------------------------------------//
+// Size the bone states for a skeleton and sort its bones parents first       //
+//----------------------------------------------------------------------------//
+
+void AnimMixer::initBoneStates(CalSkeleton *pSkeleton)
+{
+  int boneCount;
+  boneCount = (int)pSkeleton->getVectorBone().size();
+
+  m_vectorPose.assign(PoseBlender::getPoseSize(boneCount), 0.0f);
+  m_vectorLayerPose.assign(PoseBlender::getPoseSize(boneCount), 0.0f);
+  m_vectorAnimationPose.assign(PoseBlender::getPoseSize(boneCount), 0.0f);
+  m_vectorTranslation.assign(boneCount, CalVector());
+  m_vectorRotation.assign(boneCount, CalQuaternion());
+  m_vectorDirty.assign(boneCount, true);
+
+  m_vectorBoneId.clear();
+  m_vectorBoneId.reserve(boneCount);
+
+  CalCoreSkeleton *pCoreSkeleton;
+  pCoreSkeleton = pSkeleton->getCoreSkeleton();
+
+  std::vector<int>& vectorRootCoreBoneId = pCoreSkeleton->getVectorRootCoreBoneId();
+  m_vectorBoneId.insert(m_vectorBoneId.end(), vectorRootCoreBoneId.begin(), vectorRootCoreBoneId.end());
+
+  // every bone appends its children, so each parent stays before them
+  int orderId;
+  for(orderId = 0; orderId < (int)m_vectorBoneId.size(); orderId++)
+  {
+    std::list<int>& listChildId = pCoreSkeleton->getCoreBone(m_vectorBoneId[orderId])->getListChildId();
+    m_vectorBoneId.insert(m_vectorBoneId.end(), listChildId.begin(), listChildId.end());
+  }
+
+  m_bValid = false;
+}
+
+//----------------------------------------------------------------------------//
+// Recalculate the whole skeleton on the next update, needed after the bones  //
+// were changed outside of the mixer                                          //
+//----------------------------------------------------------------------------//
+
+void AnimMixer::invalidateState()
+{
+  m_bValid = false;
+}
+
+//----------------------------------------------------------------------------//
+// Check if the updates leave the detail bones out                            //
+//----------------------------------------------------------------------------//
+
+bool AnimMixer::isDetailSkipped()
+{
+  return m_bDetailSkipped;
+}
+
+//----------------------------------------------------------------------------//
+// Check if the updates only recalculate the changed bones                    //
+//----------------------------------------------------------------------------//
+
+bool AnimMixer::isIncremental()
+{
+  return m_bIncremental;
+}
+
+//----------------------------------------------------------------------------//
+// Reset the update counters                                                  //
+//----------------------------------------------------------------------------//
+
+void AnimMixer::resetCounters()
+{
+  m_updateCount = 0;
+  m_skippedUpdateCount = 0;
+  m_boneCount = 0;
+  m_calculatedBoneCount = 0;
+  m_skippedTrackCount = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Sample all tracks of an animation into a pose with a given weight          //
+//----------------------------------------------------------------------------//
+
+void AnimMixer::sampleAnimation(CalAnimation *pAnimation, float time, float weight, float *pPose)
+{
+  AnimationSampler& animationSampler = getAnimationSampler(pAnimation);
+
+  // baked animations interpolate between the two samples around the time,
+  // the track samplers are not needed; they sample all tracks in one pass,
+  // skipped bones are only left out by calculateState
+  if(animationSampler.pBakedAnimation != 0)
+  {
+    animationSampler.pBakedAnimation->getPose(time, weight, m_blendMode, pPose);
+    return;
+  }
+
+  // the tracks of skipped bones are not sampled, the poses shared through the
+  // cache have to stay complete
+  const std::vector<bool> *pVectorSkippedBone;
+  pVectorSkippedBone = PoseCache::isEnabled() ? 0 : getSkippedBones();
+
+  int trackId;
+
+  // compressed animations only decode the keyframes around the time
+  if(animationSampler.pCompressedAnimation != 0)
+  {
+    const CompressedAnimation& compressedAnimation = *animationSampler.pCompressedAnimation;
+
+    for(trackId = 0; trackId < compressedAnimation.getTrackCount(); trackId++)
+    {
+      if((pVectorSkippedBone != 0) && (*pVectorSkippedBone)[compressedAnimation.getCoreBoneId(trackId)])
+      {
+        m_skippedTrackCount++;
+        continue;
+      }
+
+      CalVector translation;
+      CalQuaternion rotation;
+      if(!animationSampler.vectorTrackSampler[trackId].getState(compressedAnimation, trackId, time, translation, rotation, m_blendMode)) continue;
+
+      PoseBlender::setState(pPose, compressedAnimation.getCoreBoneId(trackId), translation, rotation, weight);
+    }
+
+    return;
+  }
+
+  // animations without packed keyframes are sampled by cal3d, always with
+  // slerp
+  if(animationSampler.pPackedAnimation == 0)
+  {
+    std::list<CalCoreTrack *>& listCoreTrack = animationSampler.pCoreAnimation->getListCoreTrack();
+
+    std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+    for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+    {
+      if((pVectorSkippedBone != 0) && (*pVectorSkippedBone)[(*iteratorCoreTrack)->getCoreBoneId()])
+      {
+        m_skippedTrackCount++;
+        continue;
+      }
+
+      CalVector translation;
+      CalQuaternion rotation;
+      (*iteratorCoreTrack)->getState(time, translation, rotation);
+
+      PoseBlender::setState(pPose, (*iteratorCoreTrack)->getCoreBoneId(), translation, rotation, weight);
+    }
+
+    return;
+  }
+
+  const PackedAnimation& packedAnimation = *animationSampler.pPackedAnimation;
+
+  for(trackId = 0; trackId < packedAnimation.getTrackCount(); trackId++)
+  {
+    if((pVectorSkippedBone != 0) && (*pVectorSkippedBone)[packedAnimation.getCoreBoneId(trackId)])
+    {
+      m_skippedTrackCount++;
+      continue;
+    }
+
+    CalVector translation;
+    CalQuaternion rotation;
+    if(!animationSampler.vectorTrackSampler[trackId].getState(packedAnimation, trackId, time, translation, rotation, m_blendMode)) continue;
+
+    PoseBlender::setState(pPose, packedAnimation.getCoreBoneId(trackId), translation, rotation, weight);
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Set how the rotations of the animations are interpolated, the same mode is //
+// used between the keyframes of a track and between the animations           //
+//----------------------------------------------------------------------------//
+
+void AnimMixer::setBlendMode(PoseBlender::Mode mode)
+{
+  m_blendMode = mode;
+}
+
+//----------------------------------------------------------------------------//
+// Set if the updates leave the detail bones out, they keep their last        //
+// relative state and only follow their parents                               //
+//----------------------------------------------------------------------------//
+
+void AnimMixer::setDetailSkipped(bool bDetailSkipped)
+{
+  m_bDetailSkipped = bDetailSkipped;
+}
+
+//----------------------------------------------------------------------------//
+// Let the updates calculate the states in a flat skeleton instead of the     //
+// bones of cal3d, which then keep their last state; 0 goes back to the bones //
+//----------------------------------------------------------------------------//
+
+void AnimMixer::setFlatSkeleton(FlatSkeleton *pFlatSkeleton)
+{
+  if(pFlatSkeleton == m_pFlatSkeleton) return;
+
+  m_pFlatSkeleton = pFlatSkeleton;
+
+  // the new target has none of the states of the last updates
+  m_bValid = false;
+}
+
+//----------------------------------------------------------------------------//
+// Set if the updates only recalculate the changed bones                      //
+//----------------------------------------------------------------------------//
+
+void AnimMixer::setIncremental(bool bIncremental)
+{
+  m_bIncremental = bIncremental;
+}
+
+//----------------------------------------------------------------------------//
+// Update the skeleton, same weighting as CalMixer::updateSkeleton but the    //
+// packed keyframes are sampled through cached track samplers, whole poses    //
+// are blended and only the changed bones are recalculated                    //
+//----------------------------------------------------------------------------//
+
+void AnimMixer::updateSkeleton()
+{
+  CalSkeleton *pSkeleton;
+  pSkeleton = m_pModel->getSkeleton();
+  if((pSkeleton == 0) || pSkeleton->getVectorBone().empty()) return;
+
+  if(m_vectorBoneId.size() != pSkeleton->getVectorBone().size()) initBoneStates(pSkeleton);
+
+  // clear the poses
+  PoseBlender::clear(&m_vectorPose[0], getBlockCount());
+  PoseBlender::clear(&m_vectorLayerPose[0], getBlockCount());
+
+  // samplers of animations that are not blended this frame get released below
+  std::map<CalAnimation *, AnimationSampler>::iterator iteratorAnimationSampler;
+  for(iteratorAnimationSampler = m_mapAnimationSampler.begin(); iteratorAnimationSampler != m_mapAnimationSampler.end(); ++iteratorAnimationSampler)
+  {
+    iteratorAnimationSampler->second.bActive = false;
+  }
+
+  // blend all animation actions, they are locked before the cycles
+  std::list<CalAnimationAction *>::iterator iteratorAnimationAction;
+  for(iteratorAnimationAction = m_listAnimationAction.begin(); iteratorAnimationAction != m_listAnimationAction.end(); ++iteratorAnimationAction)
+  {
+    blendAnimation(*iteratorAnimationAction, (*iteratorAnimationAction)->getTime());
+  }
+
+  PoseBlender::lock(&m_vectorPose[0], &m_vectorLayerPose[0], getBlockCount(), m_blendMode);
+
+  // blend all animation cycles
+  std::list<CalAnimationCycle *>::iterator iteratorAnimationCycle;
+  for(iteratorAnimationCycle = m_listAnimationCycle.begin(); iteratorAnimationCycle != m_listAnimationCycle.end(); ++iteratorAnimationCycle)
+  {
+    // synchronized cycles run on the time of the mixer
+    float animationTime;
+    if((*iteratorAnimationCycle)->getState() == CalAnimation::STATE_SYNC)
+    {
+      if(m_animationDuration == 0.0f)
+      {
+        animationTime = 0.0f;
+      }
+      else
+      {
+        animationTime = m_animationTime * (*iteratorAnimationCycle)->getCoreAnimation()->getDuration() / m_animationDuration;
+      }
+    }
+    else
+    {
+      animationTime = (*iteratorAnimationCycle)->getTime();
+    }
+
+    blendAnimation(*iteratorAnimationCycle, animationTime);
+  }
+
+  PoseBlender::lock(&m_vectorPose[0], &m_vectorLayerPose[0], getBlockCount(), m_blendMode);
+
+  // calculate the final skeleton state
+  calculateState(pSkeleton);
+
+  // release the samplers of finished animations
+  iteratorAnimationSampler = m_mapAnimationSampler.begin();
+  while(iteratorAnimationSampler != m_mapAnimationSampler.end())
+  {
+    if(iteratorAnimationSampler->second.bActive)
+    {
+      ++iteratorAnimationSampler;
+    }
+    else
+    {
+      m_mapAnimationSampler.erase(iteratorAnimationSampler++);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,119 @@
+//----------------------------------------------------------------------------//
+// animmixer.h                                                                //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef ANIMMIXER_H
+#define ANIMMIXER_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+#include "tracksampler.h"
+#include "poseblender.h"
+
+//----------------------------------------------------------------------------//
+// Forward declarations                                                       //
+//----------------------------------------------------------------------------//
+
+class BakedAnimation;
+class CompressedAnimation;
+class FlatSkeleton;
+class PackedAnimation;
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+class AnimMixer : public CalMixer
+{
+// misc
+protected:
+  // the track samplers of one active animation, in core track list order
+  struct AnimationSampler
+  {
+    CalCoreAnimation *pCoreAnimation;
+    BakedAnimation *pBakedAnimation;
+    CompressedAnimation *pCompressedAnimation;
+    PackedAnimation *pPackedAnimation;
+    std::vector<TrackSampler> vectorTrackSampler;
+    bool bActive;
+
+    AnimationSampler() : pCoreAnimation(0), pBakedAnimation(0), pCompressedAnimation(0), pPackedAnimation(0), bActive(false) { }
+  };
+
+// member variables
+protected:
+  std::map<CalAnimation *, AnimationSampler> m_mapAnimationSampler;
+  // the relative states are blended outside of the bones, the same way as
+  // CalBone::blendState and CalBone::lockState do it, so they can be compared
+  // against the state of the last update before touching the bones; every
+  // animation is sampled into its own pose, blended into the layer pose of
+  // the actions or the cycles, which is locked into the final pose
+  std::vector<float> m_vectorPose;
+  std::vector<float> m_vectorLayerPose;
+  std::vector<float> m_vectorAnimationPose;
+  PoseBlender::Mode m_blendMode;
+  std::vector<int> m_vectorBoneId;
+  std::vector<CalVector> m_vectorTranslation;
+  std::vector<CalQuaternion> m_vectorRotation;
+  std::vector<bool> m_vectorDirty;
+  bool m_bIncremental;
+  bool m_bDetailSkipped;
+  bool m_bValid;
+  int m_lastCalculatedBoneCount;
+  // not owned, takes the states instead of the bones of cal3d if set
+  FlatSkeleton *m_pFlatSkeleton;
+
+  // statistics only, updates running on several threads may lose counts
+  static int m_updateCount;
+  static int m_skippedUpdateCount;
+  static int m_boneCount;
+  static int m_calculatedBoneCount;
+  static int m_skippedTrackCount;
+
+// constructors/destructor
+public:
+  AnimMixer(CalModel *pModel);
+  virtual ~AnimMixer();
+
+// member functions
+public:
+  PoseBlender::Mode getBlendMode();
+  FlatSkeleton *getFlatSkeleton();
+  int getLastCalculatedBoneCount();
+  void invalidateState();
+  bool isDetailSkipped();
+  bool isIncremental();
+  void setBlendMode(PoseBlender::Mode mode);
+  void setDetailSkipped(bool bDetailSkipped);
+  void setFlatSkeleton(FlatSkeleton *pFlatSkeleton);
+  void setIncremental(bool bIncremental);
+  virtual void updateSkeleton();
+
+  static int getBoneCount();
+  static int getCalculatedBoneCount();
+  static int getSkippedTrackCount();
+  static int getSkippedUpdateCount();
+  static int getUpdateCount();
+  static void resetCounters();
+
+protected:
+  void blendAnimation(CalAnimation *pAnimation, float time);
+  void calculateState(CalSkeleton *pSkeleton);
+  AnimationSampler& getAnimationSampler(CalAnimation *pAnimation);
+  int getBlockCount();
+  const std::vector<bool> *getSkippedBones();
+  void initBoneStates(CalSkeleton *pSkeleton);
+  void sampleAnimation(CalAnimation *pAnimation, float time, float weight, float *pPose);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
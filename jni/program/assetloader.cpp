@@ -0,0 +1,100 @@
+//----------------------------------------------------------------------------//
+// assetloader.cpp                                                            //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "assetloader.h"
+#include "mappedsource.h"
+#include "fastloader.h"
+#include <string.h>
+
+//----------------------------------------------------------------------------//
+// Check if a file is one of the binary cal3d formats                         //
+//----------------------------------------------------------------------------//
+
+bool AssetLoader::isBinaryFile(const std::string& strFilename)
+{
+  const char *pExtension = strrchr(strFilename.c_str(), '.');
+  if(pExtension == 0) return false;
+
+  return (stricmp(pExtension, ".csf") == 0) || (stricmp(pExtension, ".cmf") == 0) || (stricmp(pExtension, ".caf") == 0);
+}
+
+//----------------------------------------------------------------------------//
+// Load a core animation from a mapped file, same as                          //
+// CalCoreModel::loadCoreAnimation                                            //
+//----------------------------------------------------------------------------//
+
+int AssetLoader::loadCoreAnimation(CalCoreModel *pCoreModel, const std::string& strFilename)
+{
+  // xml files still go through the stream loader
+  if(!isBinaryFile(strFilename)) return pCoreModel->loadCoreAnimation(strFilename);
+
+  if(pCoreModel->getCoreSkeleton() == 0)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return -1;
+  }
+
+  MappedSource mappedSource;
+  if(!mappedSource.open(strFilename)) return -1;
+
+  CalCoreAnimationPtr pCoreAnimation;
+  pCoreAnimation = FastLoader::loadCoreAnimation(mappedSource);
+  if(!pCoreAnimation) return -1;
+
+  pCoreAnimation->setFilename(strFilename);
+
+  return pCoreModel->addCoreAnimation(pCoreAnimation.get());
+}
+
+//----------------------------------------------------------------------------//
+// Load a core mesh from a mapped file, same as CalCoreModel::loadCoreMesh    //
+//----------------------------------------------------------------------------//
+
+int AssetLoader::loadCoreMesh(CalCoreModel *pCoreModel, const std::string& strFilename)
+{
+  if(!isBinaryFile(strFilename)) return pCoreModel->loadCoreMesh(strFilename);
+
+  MappedSource mappedSource;
+  if(!mappedSource.open(strFilename)) return -1;
+
+  CalCoreMeshPtr pCoreMesh;
+  pCoreMesh = FastLoader::loadCoreMesh(mappedSource);
+  if(!pCoreMesh) return -1;
+
+  pCoreMesh->setFilename(strFilename);
+
+  return pCoreModel->addCoreMesh(pCoreMesh.get());
+}
+
+//----------------------------------------------------------------------------//
+// Load a core skeleton from a mapped file, same as                           //
+// CalCoreModel::loadCoreSkeleton                                             //
+//----------------------------------------------------------------------------//
+
+bool AssetLoader::loadCoreSkeleton(CalCoreModel *pCoreModel, const std::string& strFilename)
+{
+  if(!isBinaryFile(strFilename)) return pCoreModel->loadCoreSkeleton(strFilename);
+
+  MappedSource mappedSource;
+  if(!mappedSource.open(strFilename)) return false;
+
+  CalCoreSkeletonPtr pCoreSkeleton;
+  pCoreSkeleton = CalLoader::loadCoreSkeleton(mappedSource);
+  if(!pCoreSkeleton) return false;
+
+  pCoreModel->setCoreSkeleton(pCoreSkeleton.get());
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,35 @@
+//----------------------------------------------------------------------------//
+// assetloader.h                                                              //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+class AssetLoader
+{
+// member functions
+public:
+  static bool isBinaryFile(const std::string& strFilename);
+  static int loadCoreAnimation(CalCoreModel *pCoreModel, const std::string& strFilename);
+  static int loadCoreMesh(CalCoreModel *pCoreModel, const std::string& strFilename);
+  static bool loadCoreSkeleton(CalCoreModel *pCoreModel, const std::string& strFilename);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
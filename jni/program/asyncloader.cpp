@@ -0,0 +1,256 @@
+//----------------------------------------------------------------------------//
+// asyncloader.cpp                                                            //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "asyncloader.h"
+#include "model.h"
+#include "Utils.h"
+#include <unistd.h>
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+AsyncLoader::AsyncLoader()
+{
+  pthread_mutex_init(&m_mutex, 0);
+  m_nextJobId = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+AsyncLoader::~AsyncLoader()
+{
+  wait();
+  pthread_mutex_destroy(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Queue a model, must be called before the loader is started                 //
+//----------------------------------------------------------------------------//
+
+int AsyncLoader::addModel(Model *pModel, const std::string& strFilename)
+{
+  Job job;
+  job.pModel = pModel;
+  job.strFilename = strFilename;
+  job.state = STATE_QUEUED;
+
+  m_vectorJob.push_back(job);
+
+  return (int)m_vectorJob.size() - 1;
+}
+
+//----------------------------------------------------------------------------//
+// Get a worker count that suits the cpu                                      //
+//----------------------------------------------------------------------------//
+
+int AsyncLoader::getDefaultThreadCount()
+{
+  long cpuCount;
+  cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+  if(cpuCount < 1) return 1;
+  if(cpuCount > 4) return 4;
+
+  return (int)cpuCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of queued models                                            //
+//----------------------------------------------------------------------------//
+
+int AsyncLoader::getJobCount()
+{
+  return (int)m_vectorJob.size();
+}
+
+//----------------------------------------------------------------------------//
+// Get the model of a job                                                     //
+//----------------------------------------------------------------------------//
+
+Model *AsyncLoader::getModel(int jobId)
+{
+  return m_vectorJob[jobId].pModel;
+}
+
+//----------------------------------------------------------------------------//
+// Get the loading progress between 0 and 1, a loaded model that still waits  //
+// for its texture upload counts as half done                                 //
+//----------------------------------------------------------------------------//
+
+float AsyncLoader::getProgress()
+{
+  if(m_vectorJob.empty()) return 1.0f;
+
+  float progress;
+  progress = 0.0f;
+
+  pthread_mutex_lock(&m_mutex);
+
+  int jobId;
+  for(jobId = 0; jobId < (int)m_vectorJob.size(); jobId++)
+  {
+    if(m_vectorJob[jobId].state == STATE_LOADED) progress += 0.5f;
+    if((m_vectorJob[jobId].state == STATE_DONE) || (m_vectorJob[jobId].state == STATE_FAILED)) progress += 1.0f;
+  }
+
+  pthread_mutex_unlock(&m_mutex);
+
+  return progress / (float)m_vectorJob.size();
+}
+
+//----------------------------------------------------------------------------//
+// Get the state of a job                                                     //
+//----------------------------------------------------------------------------//
+
+int AsyncLoader::getState(int jobId)
+{
+  pthread_mutex_lock(&m_mutex);
+  int state;
+  state = m_vectorJob[jobId].state;
+  pthread_mutex_unlock(&m_mutex);
+
+  return state;
+}
+
+//----------------------------------------------------------------------------//
+// Check if all models are uploaded or failed                                 //
+//----------------------------------------------------------------------------//
+
+bool AsyncLoader::isFinished()
+{
+  bool bFinished;
+  bFinished = true;
+
+  pthread_mutex_lock(&m_mutex);
+
+  int jobId;
+  for(jobId = 0; jobId < (int)m_vectorJob.size(); jobId++)
+  {
+    if((m_vectorJob[jobId].state != STATE_DONE) && (m_vectorJob[jobId].state != STATE_FAILED)) bFinished = false;
+  }
+
+  pthread_mutex_unlock(&m_mutex);
+
+  return bFinished;
+}
+
+//----------------------------------------------------------------------------//
+// Upload the textures of all loaded models, called on the gl thread          //
+//----------------------------------------------------------------------------//
+
+void AsyncLoader::onUpdate()
+{
+  int jobId;
+  for(jobId = 0; jobId < (int)m_vectorJob.size(); jobId++)
+  {
+    if(getState(jobId) != STATE_LOADED) continue;
+
+    // the workers are done with this model, no lock needed for the upload
+    bool bUploaded;
+    bUploaded = m_vectorJob[jobId].pModel->onUpload();
+
+    pthread_mutex_lock(&m_mutex);
+    m_vectorJob[jobId].state = bUploaded ? STATE_DONE : STATE_FAILED;
+    pthread_mutex_unlock(&m_mutex);
+
+    LOG("Loaded '%s' (%d%%)", m_vectorJob[jobId].strFilename.c_str(), (int)(getProgress() * 100.0f));
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Load queued models until none are left, runs on the worker threads         //
+//----------------------------------------------------------------------------//
+
+void AsyncLoader::run()
+{
+  while(true)
+  {
+    pthread_mutex_lock(&m_mutex);
+
+    int jobId;
+    jobId = m_nextJobId;
+    if(jobId < (int)m_vectorJob.size())
+    {
+      m_nextJobId++;
+      m_vectorJob[jobId].state = STATE_LOADING;
+    }
+
+    pthread_mutex_unlock(&m_mutex);
+
+    if(jobId >= (int)m_vectorJob.size()) break;
+
+    bool bLoaded;
+    bLoaded = m_vectorJob[jobId].pModel->onLoad(m_vectorJob[jobId].strFilename);
+
+    pthread_mutex_lock(&m_mutex);
+    m_vectorJob[jobId].state = bLoaded ? STATE_LOADED : STATE_FAILED;
+    pthread_mutex_unlock(&m_mutex);
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Thread entry point                                                         //
+//----------------------------------------------------------------------------//
+
+void *AsyncLoader::runThread(void *pAsyncLoader)
+{
+  ((AsyncLoader *)pAsyncLoader)->run();
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------//
+// Start the worker threads                                                   //
+//----------------------------------------------------------------------------//
+
+bool AsyncLoader::start(int threadCount)
+{
+  if(threadCount > (int)m_vectorJob.size()) threadCount = (int)m_vectorJob.size();
+
+  int threadId;
+  for(threadId = 0; threadId < threadCount; threadId++)
+  {
+    pthread_t thread;
+    if(pthread_create(&thread, 0, runThread, this) != 0)
+    {
+      LOG("Failed to create loader thread #%d.", threadId);
+      break;
+    }
+
+    m_vectorThread.push_back(thread);
+  }
+
+  // without any worker the models are loaded right here
+  if(m_vectorThread.empty()) run();
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Wait until the workers have processed all queued models                    //
+//----------------------------------------------------------------------------//
+
+void AsyncLoader::wait()
+{
+  int threadId;
+  for(threadId = 0; threadId < (int)m_vectorThread.size(); threadId++)
+  {
+    pthread_join(m_vectorThread[threadId], 0);
+  }
+
+  m_vectorThread.clear();
+}
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,87 @@
+//----------------------------------------------------------------------------//
+// asyncloader.h                                                              //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef ASYNCLOADER_H
+#define ASYNCLOADER_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+#include <pthread.h>
+
+//----------------------------------------------------------------------------//
+// Forward declarations                                                       //
+//----------------------------------------------------------------------------//
+
+class Model;
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+// loads models on a pool of worker threads, only the texture upload is left
+// for the thread that owns the gl context
+class AsyncLoader
+{
+// misc
+public:
+  enum State
+  {
+    STATE_QUEUED = 0,
+    STATE_LOADING,
+    STATE_LOADED,
+    STATE_DONE,
+    STATE_FAILED
+  };
+
+protected:
+  struct Job
+  {
+    Model *pModel;
+    std::string strFilename;
+    int state;
+  };
+
+// member variables
+protected:
+  std::vector<Job> m_vectorJob;
+  std::vector<pthread_t> m_vectorThread;
+  pthread_mutex_t m_mutex;
+  int m_nextJobId;
+
+// constructors/destructor
+public:
+  AsyncLoader();
+  virtual ~AsyncLoader();
+
+// member functions
+public:
+  int addModel(Model *pModel, const std::string& strFilename);
+  int getJobCount();
+  Model *getModel(int jobId);
+  float getProgress();
+  int getState(int jobId);
+  bool isFinished();
+  void onUpdate();
+  bool start(int threadCount);
+  void wait();
+
+  static int getDefaultThreadCount();
+
+protected:
+  void run();
+
+  static void *runThread(void *pAsyncLoader);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
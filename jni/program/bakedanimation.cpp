@@ -0,0 +1,256 @@
+//----------------------------------------------------------------------------//
+// bakedanimation.cpp                                                         //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "bakedanimation.h"
+#include "cal3d/coretrack.h"
+#include <math.h>
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+BakedAnimation::BakedAnimation()
+{
+  m_duration = 0.0f;
+  m_sampleRate = 0.0f;
+  m_sampleCount = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+BakedAnimation::~BakedAnimation()
+{
+}
+
+//----------------------------------------------------------------------------//
+// Sample all tracks of a core animation at a fixed rate, the last sample is  //
+// taken at the duration so a cycle ends on its last keyframe                 //
+//----------------------------------------------------------------------------//
+
+bool BakedAnimation::create(CalCoreAnimation *pCoreAnimation, float sampleRate)
+{
+  if(sampleRate <= 0.0f) return false;
+
+  m_duration = pCoreAnimation->getDuration();
+  m_sampleRate = sampleRate;
+  // a duration that is a multiple of the sample interval must not get an
+  // extra sample from rounding
+  m_sampleCount = (int)ceil(m_duration * m_sampleRate - 1e-3f) + 1;
+
+  std::list<CalCoreTrack *>& listCoreTrack = pCoreAnimation->getListCoreTrack();
+
+  // tracks without keyframes have no state to bake
+  std::vector<CalCoreTrack *> vectorCoreTrack;
+
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+  {
+    if((*iteratorCoreTrack)->getCoreKeyframeCount() == 0) continue;
+    vectorCoreTrack.push_back(*iteratorCoreTrack);
+  }
+
+  int trackCount;
+  trackCount = (int)vectorCoreTrack.size();
+
+  m_vectorCoreBoneId.resize(trackCount);
+  m_vectorTranslation.resize(m_sampleCount * trackCount);
+  m_vectorRotation.resize(m_sampleCount * trackCount);
+
+  int trackId;
+  for(trackId = 0; trackId < trackCount; trackId++)
+  {
+    m_vectorCoreBoneId[trackId] = vectorCoreTrack[trackId]->getCoreBoneId();
+  }
+
+  // the samples are interpolated by cal3d itself
+  int sampleId;
+  for(sampleId = 0; sampleId < m_sampleCount; sampleId++)
+  {
+    float time;
+    time = sampleId / m_sampleRate;
+    if(time > m_duration) time = m_duration;
+
+    for(trackId = 0; trackId < trackCount; trackId++)
+    {
+      vectorCoreTrack[trackId]->getState(time, m_vectorTranslation[sampleId * trackCount + trackId], m_vectorRotation[sampleId * trackCount + trackId]);
+    }
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Get the core bone id of a track                                            //
+//----------------------------------------------------------------------------//
+
+int BakedAnimation::getCoreBoneId(int trackId) const
+{
+  return m_vectorCoreBoneId[trackId];
+}
+
+//----------------------------------------------------------------------------//
+// Get the duration of the animation                                          //
+//----------------------------------------------------------------------------//
+
+float BakedAnimation::getDuration() const
+{
+  return m_duration;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bytes used by the baked animation                        //
+//----------------------------------------------------------------------------//
+
+int BakedAnimation::getMemorySize() const
+{
+  return sizeof(BakedAnimation)
+    + m_vectorCoreBoneId.capacity() * sizeof(int)
+    + m_vectorTranslation.capacity() * sizeof(CalVector)
+    + m_vectorRotation.capacity() * sizeof(CalQuaternion);
+}
+
+//----------------------------------------------------------------------------//
+// Sample all tracks into a pose with a given weight, the sample index and    //
+// the blend factor are shared by all tracks                                  //
+//----------------------------------------------------------------------------//
+
+void BakedAnimation::getPose(float time, float weight, PoseBlender::Mode mode, float *pPose) const
+{
+  int trackCount;
+  trackCount = (int)m_vectorCoreBoneId.size();
+  if((trackCount == 0) || (m_sampleCount == 0)) return;
+
+  int sampleId;
+  float blendFactor;
+  getSampleId(time, sampleId, blendFactor);
+
+  const CalVector *pTranslation = &m_vectorTranslation[sampleId * trackCount];
+  const CalQuaternion *pRotation = &m_vectorRotation[sampleId * trackCount];
+
+  int trackId;
+  for(trackId = 0; trackId < trackCount; trackId++)
+  {
+    CalVector translation;
+    translation = pTranslation[trackId];
+    CalQuaternion rotation;
+    rotation = pRotation[trackId];
+
+    if(blendFactor > 0.0f)
+    {
+      translation.blend(blendFactor, pTranslation[trackCount + trackId]);
+      PoseBlender::blendRotation(rotation, blendFactor, pRotation[trackCount + trackId], mode);
+    }
+
+    PoseBlender::setState(pPose, m_vectorCoreBoneId[trackId], translation, rotation, weight);
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Get the sample before a time and the blend factor towards the next one,    //
+// times outside of the animation are clamped                                 //
+//----------------------------------------------------------------------------//
+
+void BakedAnimation::getSampleId(float time, int& sampleId, float& blendFactor) const
+{
+  float position;
+  position = time * m_sampleRate;
+
+  if(position <= 0.0f)
+  {
+    sampleId = 0;
+    blendFactor = 0.0f;
+    return;
+  }
+
+  sampleId = (int)position;
+  if(sampleId >= m_sampleCount - 1)
+  {
+    sampleId = m_sampleCount - 1;
+    blendFactor = 0.0f;
+    return;
+  }
+
+  // the last interval is shorter when the duration is no multiple of the
+  // sample interval
+  float nextTime;
+  nextTime = (sampleId + 1) / m_sampleRate;
+
+  if(nextTime > m_duration)
+  {
+    float sampleTime;
+    sampleTime = sampleId / m_sampleRate;
+
+    blendFactor = (m_duration > sampleTime) ? (time - sampleTime) / (m_duration - sampleTime) : 0.0f;
+    if(blendFactor > 1.0f) blendFactor = 1.0f;
+    return;
+  }
+
+  blendFactor = position - sampleId;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of samples of every track                                   //
+//----------------------------------------------------------------------------//
+
+int BakedAnimation::getSampleCount() const
+{
+  return m_sampleCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of samples per second                                       //
+//----------------------------------------------------------------------------//
+
+float BakedAnimation::getSampleRate() const
+{
+  return m_sampleRate;
+}
+
+//----------------------------------------------------------------------------//
+// Get the state of a track at a given time                                   //
+//----------------------------------------------------------------------------//
+
+bool BakedAnimation::getState(int trackId, float time, CalVector& translation, CalQuaternion& rotation, PoseBlender::Mode mode) const
+{
+  int trackCount;
+  trackCount = (int)m_vectorCoreBoneId.size();
+  if((trackId < 0) || (trackId >= trackCount) || (m_sampleCount == 0)) return false;
+
+  int sampleId;
+  float blendFactor;
+  getSampleId(time, sampleId, blendFactor);
+
+  translation = m_vectorTranslation[sampleId * trackCount + trackId];
+  rotation = m_vectorRotation[sampleId * trackCount + trackId];
+
+  if(blendFactor > 0.0f)
+  {
+    translation.blend(blendFactor, m_vectorTranslation[(sampleId + 1) * trackCount + trackId]);
+    PoseBlender::blendRotation(rotation, blendFactor, m_vectorRotation[(sampleId + 1) * trackCount + trackId], mode);
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of tracks                                                   //
+//----------------------------------------------------------------------------//
+
+int BakedAnimation::getTrackCount() const
+{
+  return (int)m_vectorCoreBoneId.size();
+}
+
+//----------------------------------------------------------------------------//
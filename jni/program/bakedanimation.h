@@ -0,0 +1,62 @@
+//----------------------------------------------------------------------------//
+// bakedanimation.h                                                           //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef BAKEDANIMATION_H
+#define BAKEDANIMATION_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+#include "poseblender.h"
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+// a core animation sampled at a fixed rate, the states of all tracks at one
+// sample time are next to each other; sampling is an index computation and
+// one interpolation between two samples, there is no keyframe search, at the
+// cost of one state per track and sample
+class BakedAnimation
+{
+// member variables
+protected:
+  float m_duration;
+  float m_sampleRate;
+  int m_sampleCount;
+  std::vector<int> m_vectorCoreBoneId;
+  std::vector<CalVector> m_vectorTranslation;
+  std::vector<CalQuaternion> m_vectorRotation;
+
+// constructors/destructor
+public:
+  BakedAnimation();
+  virtual ~BakedAnimation();
+
+// member functions
+public:
+  bool create(CalCoreAnimation *pCoreAnimation, float sampleRate);
+  int getCoreBoneId(int trackId) const;
+  float getDuration() const;
+  int getMemorySize() const;
+  void getPose(float time, float weight, PoseBlender::Mode mode, float *pPose) const;
+  int getSampleCount() const;
+  float getSampleRate() const;
+  bool getState(int trackId, float time, CalVector& translation, CalQuaternion& rotation, PoseBlender::Mode mode = PoseBlender::MODE_SLERP) const;
+  int getTrackCount() const;
+
+protected:
+  void getSampleId(float time, int& sampleId, float& blendFactor) const;
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,232 @@
+//----------------------------------------------------------------------------//
+// bench.cpp                                                                  //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "bench.h"
+#include "model.h"
+#include "modelpipeline.h"
+#include "Utils.h"
+#include <math.h>
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+Bench::Timer::Timer()
+{
+  m_startTime = Utils::getCurrentTime();
+}
+
+//----------------------------------------------------------------------------//
+// Get the milliseconds since the timer was started                           //
+//----------------------------------------------------------------------------//
+
+float Bench::Timer::getTime() const
+{
+  return Utils::getCurrentTime() - m_startTime;
+}
+
+//----------------------------------------------------------------------------//
+// Start the timer                                                            //
+//----------------------------------------------------------------------------//
+
+void Bench::Timer::start()
+{
+  m_startTime = Utils::getCurrentTime();
+}
+
+//----------------------------------------------------------------------------//
+// Run all benchmarks on the loaded demo models, the benchmarks of each       //
+// module live next to each other in their own bench file                     //
+//----------------------------------------------------------------------------//
+
+bool Bench::onInit(const std::string& strDatapath, std::vector<Model *>& vectorModel)
+{
+  bool bSuccess;
+  bSuccess = true;
+
+  if(!runLoadingBenchmarks(strDatapath, vectorModel)) bSuccess = false;
+  if(!runPipelineBenchmarks(vectorModel)) bSuccess = false;
+  if(!runSkinningBenchmarks(vectorModel)) bSuccess = false;
+  if(!runAnimationBenchmarks(vectorModel)) bSuccess = false;
+
+  LOG("Benchmarks %s.", bSuccess ? "passed" : "FAILED");
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Gather the skinned output of a pipeline independent of its vertex layout,  //
+// per submesh the vertex count, all positions, all normals and all texture   //
+// coordinates                                                                //
+//----------------------------------------------------------------------------//
+
+void Bench::readVertexStream(ModelPipeline *pModelPipeline, std::vector<float>& vectorVertex)
+{
+  vectorVertex.clear();
+
+  int stride;
+  stride = pModelPipeline->getVertexLayout().stride;
+
+  std::vector<CalMesh *>& vectorMesh = pModelPipeline->getModel()->getVectorMesh();
+
+  int meshId;
+  for(meshId = 0; meshId < (int)vectorMesh.size(); meshId++)
+  {
+    int submeshId;
+    for(submeshId = 0; submeshId < (int)vectorMesh[meshId]->getVectorSubmesh().size(); submeshId++)
+    {
+      int vertexCount;
+      vertexCount = pModelPipeline->getVertexCount(meshId, submeshId);
+      vectorVertex.push_back((float)vertexCount);
+
+      const char *pVertex;
+      pVertex = (const char *)pModelPipeline->getVertices(meshId, submeshId);
+      const char *pNormal;
+      pNormal = (const char *)pModelPipeline->getNormals(meshId, submeshId);
+      const char *pTextureCoordinate;
+      pTextureCoordinate = (const char *)pModelPipeline->getTextureCoordinates(meshId, submeshId);
+
+      int vertexId;
+      for(vertexId = 0; vertexId < vertexCount; vertexId++)
+      {
+        const float *pValue = (const float *)(pVertex + vertexId * ((stride == 0) ? 3 * sizeof(float) : stride));
+        vectorVertex.insert(vectorVertex.end(), pValue, pValue + 3);
+      }
+
+      for(vertexId = 0; vertexId < vertexCount; vertexId++)
+      {
+        const float *pValue = (const float *)(pNormal + vertexId * ((stride == 0) ? 3 * sizeof(float) : stride));
+        vectorVertex.insert(vectorVertex.end(), pValue, pValue + 3);
+      }
+
+      if(pTextureCoordinate == 0) continue;
+
+      for(vertexId = 0; vertexId < vertexCount; vertexId++)
+      {
+        const float *pValue = (const float *)(pTextureCoordinate + vertexId * ((stride == 0) ? 2 * sizeof(float) : stride));
+        vectorVertex.insert(vectorVertex.end(), pValue, pValue + 2);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Add data to a FNV-1a checksum                                              //
+//----------------------------------------------------------------------------//
+
+unsigned int Bench::addChecksum(unsigned int checksum, const void *pData, int length)
+{
+  const unsigned char *pByte = (const unsigned char *)pData;
+
+  int i;
+  for(i = 0; i < length; i++)
+  {
+    checksum = (checksum ^ pByte[i]) * 16777619u;
+  }
+
+  return checksum;
+}
+
+//----------------------------------------------------------------------------//
+// Add the skinned vertices and normals a pipeline returns to a checksum      //
+//----------------------------------------------------------------------------//
+
+unsigned int Bench::addChecksum(unsigned int checksum, ModelPipeline *pModelPipeline)
+{
+  std::vector<float> vectorVertex;
+  readVertexStream(pModelPipeline, vectorVertex);
+
+  if(vectorVertex.empty()) return checksum;
+
+  return addChecksum(checksum, &vectorVertex[0], vectorVertex.size() * sizeof(float));
+}
+
+//----------------------------------------------------------------------------//
+// Shut down and delete instances created by loadInstances                    //
+//----------------------------------------------------------------------------//
+
+void Bench::deleteInstances(std::vector<Model *>& vectorInstance)
+{
+  int instanceId;
+  for(instanceId = 0; instanceId < (int)vectorInstance.size(); instanceId++)
+  {
+    vectorInstance[instanceId]->onShutdown();
+    delete vectorInstance[instanceId];
+  }
+
+  vectorInstance.clear();
+}
+
+//----------------------------------------------------------------------------//
+// Get the largest difference between two arrays                              //
+//----------------------------------------------------------------------------//
+
+float Bench::getMaxError(const std::vector<float>& vectorValue, const std::vector<float>& vectorReference, int count)
+{
+  float maxError;
+  maxError = 0.0f;
+
+  int i;
+  for(i = 0; i < count; i++)
+  {
+    if(fabs(vectorValue[i] - vectorReference[i]) > maxError) maxError = fabs(vectorValue[i] - vectorReference[i]);
+  }
+
+  return maxError;
+}
+
+//----------------------------------------------------------------------------//
+// Get the word a benchmark reports its result with                           //
+//----------------------------------------------------------------------------//
+
+const char *Bench::getResultName(bool bPassed)
+{
+  return bPassed ? "ok" : "FAILED";
+}
+
+//----------------------------------------------------------------------------//
+// Get how many times faster a time is than a reference time                  //
+//----------------------------------------------------------------------------//
+
+float Bench::getSpeedup(float referenceTime, float time)
+{
+  return (time > 0.0f) ? referenceTime / time : 0.0f;
+}
+
+//----------------------------------------------------------------------------//
+// Load a number of instances of a demo model, stops at the first one that    //
+// fails, the instances loaded so far are kept for deleteInstances            //
+//----------------------------------------------------------------------------//
+
+bool Bench::loadInstances(Model *pModel, int instanceCount, std::vector<Model *>& vectorInstance)
+{
+  int instanceId;
+  for(instanceId = 0; instanceId < instanceCount; instanceId++)
+  {
+    Model *pInstance;
+    pInstance = new Model();
+    if(!pModel->getPath().empty()) pInstance->setPath(pModel->getPath());
+
+    if(!pInstance->onLoad(pModel->getFilename()))
+    {
+      delete pInstance;
+      return false;
+    }
+
+    vectorInstance.push_back(pInstance);
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,126 @@
+//----------------------------------------------------------------------------//
+// bench.h                                                                    //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef BENCH_H
+#define BENCH_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+
+//----------------------------------------------------------------------------//
+// Forward declarations                                                       //
+//----------------------------------------------------------------------------//
+
+class Model;
+class ModelPipeline;
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+// headless benchmarks that check every optimization against cal3d, the
+// benchmarks of a module live in its own bench_*.cpp file and share the
+// timing, reporting and instance helpers of bench.cpp
+class Bench
+{
+// misc
+protected:
+  enum LoadMode
+  {
+    LOAD_STREAM = 0,
+    LOAD_MAPPED,
+    LOAD_BULK_STREAM,
+    LOAD_BULK_MAPPED,
+    LOAD_MODE_COUNT
+  };
+
+  // the work of the update thread of the double buffer test
+  struct PipelineUpdate
+  {
+    ModelPipeline *pModelPipeline;
+    int frameCount;
+    float frameTime;
+  };
+
+  // measures the milliseconds since it was started, it starts on creation
+  class Timer
+  {
+  // member variables
+  protected:
+    float m_startTime;
+
+  // constructors/destructor
+  public:
+    Timer();
+
+  // member functions
+  public:
+    float getTime() const;
+    void start();
+  };
+
+// member functions
+public:
+  static bool onInit(const std::string& strDatapath, std::vector<Model *>& vectorModel);
+  static bool runAnimationBenchmarks(std::vector<Model *>& vectorModel);
+  static bool runAnimationLod(std::vector<Model *>& vectorModel);
+  static bool runAssetLoading(const std::string& strDatapath);
+  static bool runAsyncLoading(std::vector<Model *>& vectorModel);
+  static bool runBakedAnimation(Model *pModel, int modelId);
+  static bool runCompressedAnimation(Model *pModel, int modelId);
+  static bool runCoreModelCache(std::vector<Model *>& vectorModel);
+  static bool runCrowd(std::vector<Model *>& vectorModel);
+  static bool runDirtyBones(Model *pModel, int modelId);
+  static bool runDoubleBuffer(std::vector<Model *>& vectorModel);
+  static bool runDualQuaternion(Model *pModel, int modelId);
+  static bool runDualQuaternionTwist();
+  static bool runFlatSkeleton(Model *pModel, int modelId);
+  static bool runHardwareSkinning(Model *pModel, int modelId);
+  static bool runKeyframeReduction(Model *pModel, int modelId);
+  static bool runLoadingBenchmarks(const std::string& strDatapath, std::vector<Model *>& vectorModel);
+  static bool runModelPipeline(std::vector<Model *>& vectorModel);
+  static void runPackedAnimation(Model *pModel, int modelId);
+  static bool runPipelineBenchmarks(std::vector<Model *>& vectorModel);
+  static bool runPoseBlending(Model *pModel, int modelId);
+  static bool runPoseCache(Model *pModel, int modelId);
+  static void runRenderData(Model *pModel, int modelId);
+  static bool runRotationBlending();
+  static bool runSkinning(Model *pModel, int modelId);
+  static bool runSkinningBenchmarks(std::vector<Model *>& vectorModel);
+  static void runSkinStreamMemory(Model *pModel, int modelId);
+  static bool runTrackBlending(Model *pModel, int modelId);
+  static bool runTrackSampler(Model *pModel, int modelId);
+  static bool runVertexLayout(Model *pModel, int modelId);
+
+protected:
+  static unsigned int addChecksum(unsigned int checksum, const void *pData, int length);
+  static unsigned int addChecksum(unsigned int checksum, CalCoreAnimation *pCoreAnimation);
+  static unsigned int addChecksum(unsigned int checksum, CalCoreMesh *pCoreMesh);
+  static unsigned int addChecksum(unsigned int checksum, CalCoreSkeleton *pCoreSkeleton);
+  static unsigned int addChecksum(unsigned int checksum, ModelPipeline *pModelPipeline);
+  static void deleteInstances(std::vector<Model *>& vectorInstance);
+  static void findBinaryFiles(const std::string& strPath, std::vector<std::string>& vectorFilename);
+  static unsigned int getChecksum(Model *pModel);
+  static int getCoreAnimationId(CalCoreModel *pCoreModel, const std::string& strName);
+  static float getMaxError(const std::vector<float>& vectorValue, const std::vector<float>& vectorReference, int count);
+  static void getPaletteMatrices(CalHardwareModel *pHardwareModel, CalSkeleton *pSkeleton, int hardwareMeshId, float *pPaletteBuffer);
+  static const char *getResultName(bool bPassed);
+  static float getSpeedup(float referenceTime, float time);
+  static bool loadBinaryFile(const std::string& strFilename, int loadMode, unsigned int& checksum);
+  static bool loadInstances(Model *pModel, int instanceCount, std::vector<Model *>& vectorInstance);
+  static void readVertexStream(ModelPipeline *pModelPipeline, std::vector<float>& vectorVertex);
+  static void *runPipelineUpdate(void *pPipelineUpdate);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
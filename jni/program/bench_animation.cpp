@@ -0,0 +1,1558 @@
+//----------------------------------------------------------------------------//
+// bench_animation.cpp                                                        //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "bench.h"
+#include "model.h"
+#include "skinning.h"
+#include "coremodeldata.h"
+#include "tracksampler.h"
+#include "packedanimation.h"
+#include "compressedanimation.h"
+#include "bakedanimation.h"
+#include "keyframereducer.h"
+#include "animmixer.h"
+#include "flatskeleton.h"
+#include "poseblender.h"
+#include "posecache.h"
+#include "cal3d/coretrack.h"
+#include "cal3d/corekeyframe.h"
+#include "Utils.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <string.h>
+
+//----------------------------------------------------------------------------//
+// Run the animation benchmarks on the loaded demo models                     //
+//----------------------------------------------------------------------------//
+
+bool Bench::runAnimationBenchmarks(std::vector<Model *>& vectorModel)
+{
+  bool bSuccess;
+  bSuccess = true;
+
+  if(!runRotationBlending()) bSuccess = false;
+
+  unsigned int modelId;
+  for(modelId = 0; modelId < vectorModel.size(); modelId++)
+  {
+    // bring the model into an animated pose first
+    vectorModel[modelId]->onUpdate(0.25f);
+
+    runPackedAnimation(vectorModel[modelId], modelId);
+    if(!runKeyframeReduction(vectorModel[modelId], modelId)) bSuccess = false;
+    if(!runCompressedAnimation(vectorModel[modelId], modelId)) bSuccess = false;
+    if(!runTrackSampler(vectorModel[modelId], modelId)) bSuccess = false;
+    if(!runDirtyBones(vectorModel[modelId], modelId)) bSuccess = false;
+    if(!runFlatSkeleton(vectorModel[modelId], modelId)) bSuccess = false;
+    if(!runPoseBlending(vectorModel[modelId], modelId)) bSuccess = false;
+    if(!runTrackBlending(vectorModel[modelId], modelId)) bSuccess = false;
+    if(!runPoseCache(vectorModel[modelId], modelId)) bSuccess = false;
+    if(!runBakedAnimation(vectorModel[modelId], modelId)) bSuccess = false;
+  }
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Compare a crowd of instances walking with and without the shared pose      //
+// cache, in step, out of step and out of step with a small byte budget       //
+//----------------------------------------------------------------------------//
+
+bool Bench::runPoseCache(Model *pModel, int modelId)
+{
+  const int scenarioCount = 3;
+  const char *scenarioName[] = { "in step", "out of step", "out of step, small budget" };
+  const int instanceCount = 100;
+  const int frameCount = 30;
+  const float frameTime = 1.0f / 30.0f;
+  const float stepOffset = 0.01f;
+  const int smallBudgetPoseCount = 16;
+
+  CalCoreModel *pCoreModel;
+  pCoreModel = pModel->getCalModel()->getCoreModel();
+
+  int walkId;
+  walkId = getCoreAnimationId(pCoreModel, "_walk.caf");
+  if(walkId == -1) return true;
+
+  int boneCount;
+  boneCount = (int)pCoreModel->getCoreSkeleton()->getVectorCoreBone().size();
+
+  int poseByteSize;
+  poseByteSize = PoseBlender::getPoseSize(boneCount) * sizeof(float);
+
+  bool bPreviousEnabled;
+  bPreviousEnabled = PoseCache::isEnabled();
+  int previousByteBudget;
+  previousByteBudget = PoseCache::getByteBudget();
+
+  bool bSuccess;
+  bSuccess = true;
+
+  int scenarioId;
+  for(scenarioId = 0; scenarioId < scenarioCount; scenarioId++)
+  {
+    // the first pass samples every instance on its own and is the reference
+    std::vector<float> vectorBoneMatrix[2];
+    float time[2];
+
+    int pass;
+    for(pass = 0; pass < 2; pass++)
+    {
+      PoseCache::setEnabled(pass == 1);
+      PoseCache::setByteBudget((scenarioId == 2) ? smallBudgetPoseCount * poseByteSize : previousByteBudget);
+      PoseCache::resetCounters();
+
+      std::vector<CalModel *> vectorCalModel(instanceCount);
+
+      int instanceId;
+      for(instanceId = 0; instanceId < instanceCount; instanceId++)
+      {
+        vectorCalModel[instanceId] = new CalModel(pCoreModel);
+
+        AnimMixer *pMixer;
+        pMixer = new AnimMixer(vectorCalModel[instanceId]);
+        vectorCalModel[instanceId]->setAbstractMixer(pMixer);
+
+        pMixer->blendCycle(walkId, 1.0f, 0.0f);
+        pMixer->updateAnimation((scenarioId == 0) ? 0.0f : instanceId * stepOffset);
+      }
+
+      time[pass] = 0.0f;
+
+      int frameId;
+      for(frameId = 0; frameId < frameCount; frameId++)
+      {
+        for(instanceId = 0; instanceId < instanceCount; instanceId++)
+        {
+          vectorCalModel[instanceId]->getAbstractMixer()->updateAnimation(frameTime);
+        }
+
+        Timer timer;
+
+        for(instanceId = 0; instanceId < instanceCount; instanceId++)
+        {
+          vectorCalModel[instanceId]->getAbstractMixer()->updateSkeleton();
+        }
+
+        time[pass] += timer.getTime();
+      }
+
+      vectorBoneMatrix[pass].resize(instanceCount * boneCount * Skinning::BONE_MATRIX_SIZE);
+
+      for(instanceId = 0; instanceId < instanceCount; instanceId++)
+      {
+        Skinning::calculateBoneMatrices(vectorCalModel[instanceId]->getSkeleton(), &vectorBoneMatrix[pass][instanceId * boneCount * Skinning::BONE_MATRIX_SIZE]);
+        delete vectorCalModel[instanceId];
+      }
+    }
+
+    int lookupCount;
+    lookupCount = PoseCache::getHitCount() + PoseCache::getMissCount();
+
+    // the cached poses are sampled at quantized times, the instances in step
+    // have to share every pose and end up in the same state
+    float maxError;
+    maxError = getMaxError(vectorBoneMatrix[1], vectorBoneMatrix[0], (int)vectorBoneMatrix[0].size());
+
+    bool bMatch;
+    bMatch = (PoseCache::getByteSize() <= PoseCache::getByteBudget());
+
+    if(scenarioId == 0)
+    {
+      if(PoseCache::getMissCount() != frameCount) bMatch = false;
+
+      int instanceId;
+      for(instanceId = 1; instanceId < instanceCount; instanceId++)
+      {
+        int size;
+        size = boneCount * Skinning::BONE_MATRIX_SIZE;
+        if(memcmp(&vectorBoneMatrix[1][0], &vectorBoneMatrix[1][instanceId * size], size * sizeof(float)) != 0) bMatch = false;
+      }
+    }
+
+    if(!bMatch) bSuccess = false;
+
+    LOG("Model #%d pose cache '%s': %d instances, %d frames, uncached %.3f ms, cached %.3f ms (%.2fx), hit rate %.1f%% (%d of %d), %d evictions, %d poses, %d of %d bytes, max error %g %s", modelId,
+      scenarioName[scenarioId], instanceCount, frameCount, time[0], time[1], getSpeedup(time[0], time[1]), (lookupCount > 0) ? 100.0f * PoseCache::getHitCount() / lookupCount : 0.0f,
+      PoseCache::getHitCount(), lookupCount, PoseCache::getEvictionCount(), PoseCache::getEntryCount(), PoseCache::getByteSize(), PoseCache::getByteBudget(), maxError, getResultName(bMatch));
+  }
+
+  PoseCache::setEnabled(bPreviousEnabled);
+  PoseCache::setByteBudget(previousByteBudget);
+  PoseCache::resetCounters();
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Compare the rotation interpolation of all modes against slerp over all     //
+// angles between two rotations and check their published maximum errors      //
+//----------------------------------------------------------------------------//
+
+bool Bench::runRotationBlending()
+{
+  const int angleCount = 2000;
+  const int factorCount = 100;
+
+  // the dot product of the quaternions turns negative after half of the
+  // sweep, so the sign flip is covered as well
+  CalQuaternion rotation(0.5f, -0.5f, 0.5f, 0.5f);
+
+  CalVector axis(1.0f, 2.0f, 3.0f);
+  axis.normalize();
+
+  std::vector<CalQuaternion> vectorSourceRotation;
+  std::vector<float> vectorFactor;
+
+  int angleId;
+  for(angleId = 0; angleId <= angleCount; angleId++)
+  {
+    float angle;
+    angle = 3.14159265f * angleId / angleCount;
+
+    CalQuaternion sourceRotation(axis.x * sin(angle), axis.y * sin(angle), axis.z * sin(angle), cos(angle));
+    sourceRotation *= rotation;
+
+    int factorId;
+    for(factorId = 0; factorId <= factorCount; factorId++)
+    {
+      vectorSourceRotation.push_back(sourceRotation);
+      vectorFactor.push_back((float)factorId / factorCount);
+    }
+  }
+
+  int blendCount;
+  blendCount = (int)vectorFactor.size();
+
+  // the reference is CalQuaternion::blend itself
+  std::vector<CalQuaternion> vectorReference(blendCount, rotation);
+
+  Timer timer;
+
+  int blendId;
+  for(blendId = 0; blendId < blendCount; blendId++)
+  {
+    vectorReference[blendId].blend(vectorFactor[blendId], vectorSourceRotation[blendId]);
+  }
+
+  float referenceTime;
+  referenceTime = timer.getTime();
+
+  bool bSuccess;
+  bSuccess = true;
+
+  int mode;
+  for(mode = 0; mode < PoseBlender::MODE_COUNT; mode++)
+  {
+    std::vector<CalQuaternion> vectorRotation(blendCount, rotation);
+
+    timer.start();
+
+    for(blendId = 0; blendId < blendCount; blendId++)
+    {
+      PoseBlender::blendRotation(vectorRotation[blendId], vectorFactor[blendId], vectorSourceRotation[blendId], (PoseBlender::Mode)mode);
+    }
+
+    float time;
+    time = timer.getTime();
+
+    float maxError;
+    maxError = 0.0f;
+
+    for(blendId = 0; blendId < blendCount; blendId++)
+    {
+      float error;
+      error = KeyframeReducer::getRotationError(vectorRotation[blendId], vectorReference[blendId]);
+      if(error > maxError) maxError = error;
+    }
+
+    bool bMatch;
+    bMatch = (maxError <= PoseBlender::getMaxError((PoseBlender::Mode)mode));
+    if(!bMatch) bSuccess = false;
+
+    LOG("Rotation blending %s: %d blends, slerp %.3f ms, %.3f ms (%.2fx), max error %g rad, bound %g rad %s", PoseBlender::getModeName((PoseBlender::Mode)mode), blendCount,
+      referenceTime, time, getSpeedup(referenceTime, time), maxError, PoseBlender::getMaxError((PoseBlender::Mode)mode), getResultName(bMatch));
+  }
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Compare the track sampling of all modes against slerp over all the         //
+// animations of a model at 30 frames per second                              //
+//----------------------------------------------------------------------------//
+
+bool Bench::runTrackBlending(Model *pModel, int modelId)
+{
+  const float frameTime = 1.0f / 30.0f;
+
+  CalCoreModel *pCoreModel;
+  pCoreModel = pModel->getCalModel()->getCoreModel();
+
+  CoreModelData *pCoreModelData;
+  pCoreModelData = CoreModelData::get(pCoreModel);
+  if(pCoreModelData == 0) return true;
+
+  float time[PoseBlender::MODE_COUNT];
+  float maxError[PoseBlender::MODE_COUNT];
+
+  int mode;
+  for(mode = 0; mode < PoseBlender::MODE_COUNT; mode++)
+  {
+    time[mode] = 0.0f;
+    maxError[mode] = 0.0f;
+  }
+
+  int animationCount;
+  animationCount = 0;
+  int sampleCount;
+  sampleCount = 0;
+
+  int coreAnimationId;
+  for(coreAnimationId = 0; coreAnimationId < pCoreModel->getCoreAnimationCount(); coreAnimationId++)
+  {
+    CalCoreAnimation *pCoreAnimation;
+    pCoreAnimation = pCoreModel->getCoreAnimation(coreAnimationId);
+    if(pCoreAnimation->getDuration() <= 0.0f) continue;
+
+    PackedAnimation *pPackedAnimation;
+    pPackedAnimation = pCoreModelData->getPackedAnimation(pCoreAnimation);
+    if(pPackedAnimation == 0) continue;
+
+    int frameCount;
+    frameCount = (int)(pCoreAnimation->getDuration() / frameTime) + 1;
+    int trackCount;
+    trackCount = pPackedAnimation->getTrackCount();
+
+    // the samples of the slerp mode are the reference
+    std::vector<CalQuaternion> vectorReference(frameCount * trackCount);
+    std::vector<TrackSampler> vectorTrackSampler(trackCount);
+
+    int frameId;
+    int trackId;
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      for(trackId = 0; trackId < trackCount; trackId++)
+      {
+        CalVector translation;
+        vectorTrackSampler[trackId].getState(*pPackedAnimation, trackId, frameId * frameTime, translation, vectorReference[frameId * trackCount + trackId], PoseBlender::MODE_SLERP);
+      }
+    }
+
+    for(mode = 0; mode < PoseBlender::MODE_COUNT; mode++)
+    {
+      std::vector<CalQuaternion> vectorRotation(frameCount * trackCount);
+
+      for(trackId = 0; trackId < trackCount; trackId++)
+      {
+        vectorTrackSampler[trackId].reset();
+      }
+
+      Timer timer;
+
+      for(frameId = 0; frameId < frameCount; frameId++)
+      {
+        for(trackId = 0; trackId < trackCount; trackId++)
+        {
+          CalVector translation;
+          vectorTrackSampler[trackId].getState(*pPackedAnimation, trackId, frameId * frameTime, translation, vectorRotation[frameId * trackCount + trackId], (PoseBlender::Mode)mode);
+        }
+      }
+
+      time[mode] += timer.getTime();
+
+      int sampleId;
+      for(sampleId = 0; sampleId < frameCount * trackCount; sampleId++)
+      {
+        float error;
+        error = KeyframeReducer::getRotationError(vectorRotation[sampleId], vectorReference[sampleId]);
+        if(error > maxError[mode]) maxError[mode] = error;
+      }
+    }
+
+    animationCount++;
+    sampleCount += frameCount * trackCount;
+  }
+
+  bool bSuccess;
+  bSuccess = true;
+
+  for(mode = 0; mode < PoseBlender::MODE_COUNT; mode++)
+  {
+    bool bMatch;
+    bMatch = (maxError[mode] <= PoseBlender::getMaxError((PoseBlender::Mode)mode));
+    if(!bMatch) bSuccess = false;
+
+    LOG("Model #%d track blending %s: %d animations, %d samples, %.3f ms (%.2fx slerp), max error %g rad, bound %g rad %s", modelId, PoseBlender::getModeName((PoseBlender::Mode)mode),
+      animationCount, sampleCount, time[mode], getSpeedup(time[PoseBlender::MODE_SLERP], time[mode]), maxError[mode],
+      PoseBlender::getMaxError((PoseBlender::Mode)mode), getResultName(bMatch));
+  }
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Compare the cached keyframe lookups against CalCoreTrack::getState on the  //
+// walk cycle                                                                 //
+//----------------------------------------------------------------------------//
+
+bool Bench::runTrackSampler(Model *pModel, int modelId)
+{
+  const int frameCount = 10000;
+  const float frameTime = 1.0f / 60.0f;
+
+  CalCoreModel *pCoreModel;
+  pCoreModel = pModel->getCalModel()->getCoreModel();
+
+  CoreModelData *pCoreModelData;
+  pCoreModelData = CoreModelData::get(pCoreModel);
+  if(pCoreModelData == 0) return true;
+
+  bool bSuccess;
+  bSuccess = true;
+
+  int coreAnimationId;
+  for(coreAnimationId = 0; coreAnimationId < pCoreModel->getCoreAnimationCount(); coreAnimationId++)
+  {
+    CalCoreAnimation *pCoreAnimation;
+    pCoreAnimation = pCoreModel->getCoreAnimation(coreAnimationId);
+
+    const std::string& strFilename = pCoreAnimation->getFilename();
+    if(strFilename.find("_walk.caf") == std::string::npos) continue;
+    if(pCoreAnimation->getDuration() <= 0.0f) continue;
+
+    PackedAnimation *pPackedAnimation;
+    pPackedAnimation = pCoreModelData->getPackedAnimation(pCoreAnimation);
+    if(pPackedAnimation == 0) continue;
+
+    std::vector<CalCoreTrack *> vectorCoreTrack(pCoreAnimation->getListCoreTrack().begin(), pCoreAnimation->getListCoreTrack().end());
+    std::vector<TrackSampler> vectorTrackSampler(vectorCoreTrack.size());
+
+    // verify the sampler against cal3d first, a cycle wraps at its duration
+    float maxError;
+    maxError = 0.0f;
+
+    int frameId;
+    unsigned int trackId;
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      float time;
+      time = fmod(frameId * frameTime, pCoreAnimation->getDuration());
+
+      for(trackId = 0; trackId < vectorCoreTrack.size(); trackId++)
+      {
+        CalVector translationReference, translation;
+        CalQuaternion rotationReference, rotation;
+        vectorCoreTrack[trackId]->getState(time, translationReference, rotationReference);
+        vectorTrackSampler[trackId].getState(*pPackedAnimation, trackId, time, translation, rotation);
+
+        float error;
+        error = (translation - translationReference).length();
+        if(error > maxError) maxError = error;
+        error = fabs(rotation.x - rotationReference.x) + fabs(rotation.y - rotationReference.y) + fabs(rotation.z - rotationReference.z) + fabs(rotation.w - rotationReference.w);
+        if(error > maxError) maxError = error;
+      }
+    }
+
+    bool bMatch;
+    bMatch = (maxError == 0.0f);
+    if(!bMatch) bSuccess = false;
+
+    // time the binary search of cal3d
+    float checksum;
+    checksum = 0.0f;
+
+    Timer timer;
+
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      float time;
+      time = fmod(frameId * frameTime, pCoreAnimation->getDuration());
+
+      for(trackId = 0; trackId < vectorCoreTrack.size(); trackId++)
+      {
+        CalVector translation;
+        CalQuaternion rotation;
+        vectorCoreTrack[trackId]->getState(time, translation, rotation);
+        checksum += rotation.w;
+      }
+    }
+
+    float referenceTime;
+    referenceTime = timer.getTime();
+
+    // time the cached lookups
+    int trackSamplerId;
+    for(trackSamplerId = 0; trackSamplerId < (int)vectorTrackSampler.size(); trackSamplerId++)
+    {
+      vectorTrackSampler[trackSamplerId].reset();
+    }
+    TrackSampler::resetCounters();
+
+    timer.start();
+
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      float time;
+      time = fmod(frameId * frameTime, pCoreAnimation->getDuration());
+
+      for(trackId = 0; trackId < vectorCoreTrack.size(); trackId++)
+      {
+        CalVector translation;
+        CalQuaternion rotation;
+        vectorTrackSampler[trackId].getState(*pPackedAnimation, trackId, time, translation, rotation);
+        checksum -= rotation.w;
+      }
+    }
+
+    float time;
+    time = timer.getTime();
+
+    LOG("Model #%d track sampling '%s': %d tracks, %d frames, cal3d %.3f ms, cached %.3f ms (%.2fx), max error %g %s", modelId, strFilename.c_str(),
+      (int)vectorCoreTrack.size(), frameCount, referenceTime, time, getSpeedup(referenceTime, time), maxError, getResultName(bMatch));
+    LOG("Model #%d track sampling lookups: %d, cursor hits %d, neighbour hits %d, binary searches %d (checksum %g)", modelId,
+      TrackSampler::getLookupCount(), TrackSampler::getCursorHitCount(), TrackSampler::getNeighbourHitCount(), TrackSampler::getSearchCount(), checksum);
+  }
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Compare the incremental skeleton update against a full one, with an arm    //
+// waving over the idle cycle, the walk cycle and a paused walk cycle         //
+//----------------------------------------------------------------------------//
+
+bool Bench::runDirtyBones(Model *pModel, int modelId)
+{
+  const int scenarioCount = 3;
+  const char *scenarioName[] = { "wave over idle", "walk", "paused walk" };
+  const int frameCount = 100;
+  const float frameTime = 1.0f / 30.0f;
+
+  CalCoreModel *pCoreModel;
+  pCoreModel = pModel->getCalModel()->getCoreModel();
+
+  int idleId, waveId, walkId;
+  idleId = getCoreAnimationId(pCoreModel, "_idle.caf");
+  waveId = getCoreAnimationId(pCoreModel, "_wave.caf");
+  walkId = getCoreAnimationId(pCoreModel, "_walk.caf");
+  if((idleId == -1) || (waveId == -1) || (walkId == -1)) return true;
+
+  bool bSuccess;
+  bSuccess = true;
+
+  int scenarioId;
+  for(scenarioId = 0; scenarioId < scenarioCount; scenarioId++)
+  {
+    // the first model recalculates every bone and is the reference
+    CalModel *pCalModel[2];
+    AnimMixer *pMixer[2];
+
+    int calModelId;
+    for(calModelId = 0; calModelId < 2; calModelId++)
+    {
+      pCalModel[calModelId] = new CalModel(pCoreModel);
+      pMixer[calModelId] = new AnimMixer(pCalModel[calModelId]);
+      pMixer[calModelId]->setIncremental(calModelId == 1);
+      pCalModel[calModelId]->setAbstractMixer(pMixer[calModelId]);
+
+      if(scenarioId == 0)
+      {
+        pMixer[calModelId]->blendCycle(idleId, 1.0f, 0.0f);
+        pMixer[calModelId]->executeAction(waveId, 0.3f, 0.3f);
+      }
+      else
+      {
+        pMixer[calModelId]->blendCycle(walkId, 1.0f, 0.0f);
+      }
+    }
+
+    int boneCount;
+    boneCount = (int)pCalModel[0]->getSkeleton()->getVectorBone().size();
+
+    std::vector<float> vectorBoneMatrixReference(boneCount * Skinning::BONE_MATRIX_SIZE);
+    std::vector<float> vectorBoneMatrix(boneCount * Skinning::BONE_MATRIX_SIZE);
+
+    float maxError;
+    maxError = 0.0f;
+
+    float referenceTime, time;
+    referenceTime = 0.0f;
+    time = 0.0f;
+
+    int calculatedBoneCount;
+    calculatedBoneCount = 0;
+
+    int skippedFrameCount;
+    skippedFrameCount = 0;
+
+    int frameId;
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      // the paused cycle only moves on the first frame
+      float elapsedSeconds;
+      elapsedSeconds = ((scenarioId == 2) && (frameId > 0)) ? 0.0f : frameTime;
+
+      pMixer[0]->updateAnimation(elapsedSeconds);
+      pMixer[1]->updateAnimation(elapsedSeconds);
+
+      Timer timer;
+      pMixer[0]->updateSkeleton();
+      referenceTime += timer.getTime();
+
+      timer.start();
+      pMixer[1]->updateSkeleton();
+      time += timer.getTime();
+
+      Skinning::calculateBoneMatrices(pCalModel[0]->getSkeleton(), &vectorBoneMatrixReference[0]);
+      Skinning::calculateBoneMatrices(pCalModel[1]->getSkeleton(), &vectorBoneMatrix[0]);
+
+      float error;
+      error = getMaxError(vectorBoneMatrix, vectorBoneMatrixReference, (int)vectorBoneMatrix.size());
+      if(error > maxError) maxError = error;
+
+      calculatedBoneCount += pMixer[1]->getLastCalculatedBoneCount();
+      if(pMixer[1]->getLastCalculatedBoneCount() == 0) skippedFrameCount++;
+    }
+
+    // the clean bones keep the exact state of the frame they were calculated
+    bool bMatch;
+    bMatch = (maxError == 0.0f);
+    if(!bMatch) bSuccess = false;
+
+    LOG("Model #%d dirty bones '%s': %d bones, %d frames, %.1f bones recalculated per frame, %d frames skipped, full %.3f ms, incremental %.3f ms (%.2fx), max error %g %s", modelId, scenarioName[scenarioId],
+      boneCount, frameCount, (float)calculatedBoneCount / frameCount, skippedFrameCount, referenceTime, time, getSpeedup(referenceTime, time), maxError, getResultName(bMatch));
+
+    delete pCalModel[0];
+    delete pCalModel[1];
+  }
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Compare the sorted bone arrays against CalSkeleton::calculateState on many //
+// instances posed at different times of the walk cycle                       //
+//----------------------------------------------------------------------------//
+
+bool Bench::runFlatSkeleton(Model *pModel, int modelId)
+{
+  const int instanceCount = 1000;
+  const int frameCount = 10;
+
+  CalCoreModel *pCoreModel;
+  pCoreModel = pModel->getCalModel()->getCoreModel();
+
+  CalCoreSkeleton *pCoreSkeleton;
+  pCoreSkeleton = pCoreModel->getCoreSkeleton();
+
+  int walkId;
+  walkId = getCoreAnimationId(pCoreModel, "_walk.caf");
+
+  CalCoreAnimation *pCoreAnimation;
+  pCoreAnimation = (walkId != -1) ? pCoreModel->getCoreAnimation(walkId) : 0;
+
+  int boneCount;
+  boneCount = (int)pCoreSkeleton->getVectorCoreBone().size();
+
+  std::vector<CalSkeleton *> vectorSkeleton(instanceCount);
+  std::vector<FlatSkeleton> vectorFlatSkeleton(instanceCount);
+
+  std::vector<float> vectorBoneMatrixReference(boneCount * Skinning::BONE_MATRIX_SIZE);
+  std::vector<float> vectorBoneMatrix(boneCount * Skinning::BONE_MATRIX_SIZE);
+
+  bool bSuccess;
+  bSuccess = true;
+
+  float maxError, extent;
+  maxError = 0.0f;
+  extent = 0.0f;
+
+  // pose the cal3d skeletons and copy their relative states
+  int instanceId;
+  for(instanceId = 0; instanceId < instanceCount; instanceId++)
+  {
+    CalSkeleton *pSkeleton;
+    pSkeleton = new CalSkeleton(pCoreSkeleton);
+    vectorSkeleton[instanceId] = pSkeleton;
+
+    pSkeleton->clearState();
+
+    if(pCoreAnimation != 0)
+    {
+      float time;
+      time = fmod(instanceId * 0.037f, pCoreAnimation->getDuration());
+
+      std::list<CalCoreTrack *>& listCoreTrack = pCoreAnimation->getListCoreTrack();
+
+      std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+      for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+      {
+        CalVector translation;
+        CalQuaternion rotation;
+        (*iteratorCoreTrack)->getState(time, translation, rotation);
+
+        pSkeleton->getBone((*iteratorCoreTrack)->getCoreBoneId())->blendState(1.0f, translation, rotation);
+      }
+    }
+
+    pSkeleton->lockState();
+    pSkeleton->calculateState();
+
+    if(!vectorFlatSkeleton[instanceId].create(pCoreSkeleton))
+    {
+      bSuccess = false;
+      break;
+    }
+
+    vectorFlatSkeleton[instanceId].setState(pSkeleton);
+    vectorFlatSkeleton[instanceId].calculateState();
+
+    Skinning::calculateBoneMatrices(pSkeleton, &vectorBoneMatrixReference[0]);
+    vectorFlatSkeleton[instanceId].getBoneMatrices(&vectorBoneMatrix[0]);
+
+    float error;
+    error = getMaxError(vectorBoneMatrix, vectorBoneMatrixReference, (int)vectorBoneMatrix.size());
+    if(error > maxError) maxError = error;
+
+    int boneId;
+    for(boneId = 0; boneId < boneCount; boneId++)
+    {
+      int axis;
+      for(axis = 0; axis < 3; axis++)
+      {
+        if(fabs(vectorBoneMatrixReference[boneId * Skinning::BONE_MATRIX_SIZE + axis * 4 + 3]) > extent) extent = fabs(vectorBoneMatrixReference[boneId * Skinning::BONE_MATRIX_SIZE + axis * 4 + 3]);
+      }
+    }
+  }
+
+  if(bSuccess)
+  {
+    bool bMatch;
+    bMatch = (maxError <= 1e-5f * (extent + 1.0f));
+    if(!bMatch) bSuccess = false;
+
+    // the bone matrices are part of both updates, the flat skeleton writes
+    // them in its pass
+    float checksum;
+    checksum = 0.0f;
+
+    Timer timer;
+
+    int frameId;
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      for(instanceId = 0; instanceId < instanceCount; instanceId++)
+      {
+        vectorSkeleton[instanceId]->calculateState();
+        Skinning::calculateBoneMatrices(vectorSkeleton[instanceId], &vectorBoneMatrixReference[0]);
+        checksum += vectorBoneMatrixReference[3];
+      }
+    }
+
+    float referenceTime;
+    referenceTime = timer.getTime();
+
+    timer.start();
+
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      for(instanceId = 0; instanceId < instanceCount; instanceId++)
+      {
+        vectorFlatSkeleton[instanceId].calculateState();
+        vectorFlatSkeleton[instanceId].getBoneMatrices(&vectorBoneMatrix[0]);
+        checksum -= vectorBoneMatrix[3];
+      }
+    }
+
+    float time;
+    time = timer.getTime();
+
+    LOG("Model #%d flat skeleton: %d bones, %d instances, %d frames, cal3d %.3f ms, flat %.3f ms (%.2fx), %d bytes per instance, max error %g %s (checksum %g)", modelId,
+      boneCount, instanceCount, frameCount, referenceTime, time, getSpeedup(referenceTime, time), vectorFlatSkeleton[0].getByteSize(), maxError, getResultName(bMatch), checksum);
+  }
+
+  for(instanceId = 0; instanceId < instanceCount; instanceId++)
+  {
+    delete vectorSkeleton[instanceId];
+  }
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Compare blending whole poses against CalBone::blendState bone by bone,     //
+// with 1, 3 and 8 cycles blended at the same time                            //
+//----------------------------------------------------------------------------//
+
+bool Bench::runPoseBlending(Model *pModel, int modelId)
+{
+  const int testCount = 3;
+  const int cycleCount[] = { 1, 3, 8 };
+  const int frameCount = 10000;
+
+  CalCoreModel *pCoreModel;
+  pCoreModel = pModel->getCalModel()->getCoreModel();
+  if(pCoreModel->getCoreAnimationCount() == 0) return true;
+
+  CalCoreSkeleton *pCoreSkeleton;
+  pCoreSkeleton = pCoreModel->getCoreSkeleton();
+
+  int boneCount;
+  boneCount = (int)pCoreSkeleton->getVectorCoreBone().size();
+
+  int blockCount;
+  blockCount = PoseBlender::getBlockCount(boneCount);
+  int poseSize;
+  poseSize = PoseBlender::getPoseSize(boneCount);
+
+  // the reference skeleton is only blended, never calculated
+  CalSkeleton *pSkeleton;
+  pSkeleton = new CalSkeleton(pCoreSkeleton);
+
+  Skinning::Path previousPath;
+  previousPath = Skinning::getPath();
+
+  bool bSuccess;
+  bSuccess = true;
+
+  int testId;
+  for(testId = 0; testId < testCount; testId++)
+  {
+    // sample the cycles at different times, as poses and as track states
+    std::vector<float> vectorAnimationPose(cycleCount[testId] * poseSize);
+    std::vector<int> vectorBoneId;
+    std::vector<CalVector> vectorTranslation;
+    std::vector<CalQuaternion> vectorRotation;
+    std::vector<int> vectorFirstTrackId;
+
+    int cycleId;
+    for(cycleId = 0; cycleId < cycleCount[testId]; cycleId++)
+    {
+      CalCoreAnimation *pCoreAnimation;
+      pCoreAnimation = pCoreModel->getCoreAnimation(cycleId % pCoreModel->getCoreAnimationCount());
+
+      float time;
+      time = (pCoreAnimation->getDuration() > 0.0f) ? fmod(cycleId * 0.37f, pCoreAnimation->getDuration()) : 0.0f;
+
+      float *pAnimationPose = &vectorAnimationPose[cycleId * poseSize];
+      PoseBlender::clear(pAnimationPose, blockCount);
+
+      vectorFirstTrackId.push_back(vectorBoneId.size());
+
+      std::list<CalCoreTrack *>& listCoreTrack = pCoreAnimation->getListCoreTrack();
+
+      std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+      for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+      {
+        CalVector translation;
+        CalQuaternion rotation;
+        (*iteratorCoreTrack)->getState(time, translation, rotation);
+
+        PoseBlender::setState(pAnimationPose, (*iteratorCoreTrack)->getCoreBoneId(), translation, rotation, 1.0f);
+
+        vectorBoneId.push_back((*iteratorCoreTrack)->getCoreBoneId());
+        vectorTranslation.push_back(translation);
+        vectorRotation.push_back(rotation);
+      }
+    }
+
+    vectorFirstTrackId.push_back(vectorBoneId.size());
+
+    // time cal3d, one CalBone::blendState per track
+    Timer timer;
+
+    int frameId;
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      pSkeleton->clearState();
+
+      for(cycleId = 0; cycleId < cycleCount[testId]; cycleId++)
+      {
+        int trackId;
+        for(trackId = vectorFirstTrackId[cycleId]; trackId < vectorFirstTrackId[cycleId + 1]; trackId++)
+        {
+          pSkeleton->getBone(vectorBoneId[trackId])->blendState(1.0f, vectorTranslation[trackId], vectorRotation[trackId]);
+        }
+      }
+
+      pSkeleton->lockState();
+    }
+
+    float referenceTime;
+    referenceTime = timer.getTime();
+
+    std::vector<float> vectorPose(poseSize, 0.0f);
+    std::vector<float> vectorLayerPose(poseSize, 0.0f);
+    std::vector<float> vectorPoseScalar;
+
+    int mode;
+    for(mode = 0; mode < PoseBlender::MODE_COUNT; mode++)
+    {
+      int path;
+      for(path = Skinning::PATH_SCALAR; path < Skinning::PATH_COUNT; path++)
+      {
+        // slerp has no simd kernel
+        if((mode == PoseBlender::MODE_SLERP) && (path != Skinning::PATH_SCALAR)) continue;
+        if(!Skinning::setPath((Skinning::Path)path)) continue;
+
+        timer.start();
+
+        for(frameId = 0; frameId < frameCount; frameId++)
+        {
+          PoseBlender::clear(&vectorPose[0], blockCount);
+          PoseBlender::clear(&vectorLayerPose[0], blockCount);
+
+          for(cycleId = 0; cycleId < cycleCount[testId]; cycleId++)
+          {
+            PoseBlender::blend(&vectorLayerPose[0], &vectorAnimationPose[cycleId * poseSize], blockCount, (PoseBlender::Mode)mode);
+          }
+
+          PoseBlender::lock(&vectorPose[0], &vectorLayerPose[0], blockCount, (PoseBlender::Mode)mode);
+        }
+
+        float time;
+        time = timer.getTime();
+
+        if(path == Skinning::PATH_SCALAR) vectorPoseScalar = vectorPose;
+
+        // the error against cal3d, and of the simd kernels against the scalar
+        // one of the same mode
+        float maxTranslationError, maxRotationError, maxPathError;
+        maxTranslationError = 0.0f;
+        maxRotationError = 0.0f;
+        maxPathError = 0.0f;
+
+        int boneId;
+        for(boneId = 0; boneId < boneCount; boneId++)
+        {
+          CalVector translation;
+          CalQuaternion rotation;
+          float weight;
+          PoseBlender::getState(&vectorPose[0], boneId, translation, rotation, weight);
+          if(weight == 0.0f) continue;
+
+          CalBone *pBone;
+          pBone = pSkeleton->getBone(boneId);
+
+          float error;
+          error = (translation - pBone->getTranslation()).length() / (1.0f + pBone->getTranslation().length());
+          if(error > maxTranslationError) maxTranslationError = error;
+          error = KeyframeReducer::getRotationError(rotation, pBone->getRotation());
+          if(error > maxRotationError) maxRotationError = error;
+
+          if(mode != PoseBlender::MODE_SLERP)
+          {
+            CalVector translationScalar;
+            CalQuaternion rotationScalar;
+            PoseBlender::getState(&vectorPoseScalar[0], boneId, translationScalar, rotationScalar, weight);
+
+            error = (translation - translationScalar).length() / (1.0f + translationScalar.length());
+            if(error > maxPathError) maxPathError = error;
+            error = KeyframeReducer::getRotationError(rotation, rotationScalar);
+            if(error > maxPathError) maxPathError = error;
+          }
+        }
+
+        // slerp is the blending of cal3d, the approximations only have to agree
+        // across paths, their accuracy is checked by runRotationBlending
+        bool bMatch;
+        bMatch = (mode == PoseBlender::MODE_SLERP) ? ((maxTranslationError <= 1e-5f) && (maxRotationError <= 1e-5f)) : (maxPathError <= 1e-4f);
+        if(!bMatch) bSuccess = false;
+
+        LOG("Model #%d pose blending %d cycles %s %s: cal3d %.3f ms, poses %.3f ms (%.2fx), error translation %g rotation %g rad, path error %g %s", modelId, cycleCount[testId],
+          PoseBlender::getModeName((PoseBlender::Mode)mode), Skinning::getPathName((Skinning::Path)path), referenceTime, time, getSpeedup(referenceTime, time),
+          maxTranslationError, maxRotationError, maxPathError, getResultName(bMatch));
+      }
+    }
+  }
+
+  Skinning::setPath(previousPath);
+
+  delete pSkeleton;
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Compare loading and resident memory of the core animations against the     //
+// packed keyframes, with the keyframes of cal3d released like onInit does    //
+//----------------------------------------------------------------------------//
+
+void Bench::runPackedAnimation(Model *pModel, int modelId)
+{
+  CalCoreModel *pCoreModel;
+  pCoreModel = pModel->getCalModel()->getCoreModel();
+
+  int totalCoreAnimationSize;
+  totalCoreAnimationSize = 0;
+  int totalPackedAnimationSize;
+  totalPackedAnimationSize = 0;
+  float totalLoadTime;
+  totalLoadTime = 0.0f;
+  float totalPackTime;
+  totalPackTime = 0.0f;
+
+  int coreAnimationId;
+  for(coreAnimationId = 0; coreAnimationId < pCoreModel->getCoreAnimationCount(); coreAnimationId++)
+  {
+    CalCoreAnimation *pCoreAnimation;
+    pCoreAnimation = pCoreModel->getCoreAnimation(coreAnimationId);
+    if(pCoreAnimation == 0) continue;
+
+    // load the file again, the loaded animation is released with the pointer
+    Timer timer;
+
+    CalCoreAnimationPtr pLoadedAnimation;
+    pLoadedAnimation = CalLoader::loadCoreAnimation(pCoreAnimation->getFilename(), pCoreModel->getCoreSkeleton());
+    if(!pLoadedAnimation) continue;
+
+    float loadTime;
+    loadTime = timer.getTime();
+
+    int coreAnimationSize;
+    coreAnimationSize = PackedAnimation::getCoreAnimationMemorySize(pLoadedAnimation.get());
+
+    timer.start();
+
+    PackedAnimation packedAnimation;
+    packedAnimation.create(pLoadedAnimation.get());
+    CoreModelData::releaseKeyframes(pLoadedAnimation.get());
+
+    float packTime;
+    packTime = timer.getTime();
+
+    // the empty tracks stay resident next to the packed keyframes
+    int packedAnimationSize;
+    packedAnimationSize = packedAnimation.getMemorySize() + PackedAnimation::getCoreAnimationMemorySize(pLoadedAnimation.get());
+
+    LOG("Model #%d keyframes '%s': %d keyframes, load %.3f ms + pack %.3f ms, resident %d bytes -> %d bytes", modelId, pCoreAnimation->getFilename().c_str(),
+      packedAnimation.getKeyframeCount(), loadTime, packTime, coreAnimationSize, packedAnimationSize);
+
+    totalCoreAnimationSize += coreAnimationSize;
+    totalPackedAnimationSize += packedAnimationSize;
+    totalLoadTime += loadTime;
+    totalPackTime += packTime;
+  }
+
+  LOG("Model #%d keyframes total: load %.3f ms + pack %.3f ms, resident %d bytes -> %d bytes", modelId, totalLoadTime, totalPackTime, totalCoreAnimationSize, totalPackedAnimationSize);
+}
+
+//----------------------------------------------------------------------------//
+// Compress all animations, round trip them through the file format and       //
+// compare size, accuracy and sampling time against the packed keyframes      //
+//----------------------------------------------------------------------------//
+
+bool Bench::runCompressedAnimation(Model *pModel, int modelId)
+{
+  const float translationTolerance = 0.01f;
+  const float rotationTolerance = 0.001f;
+  const int frameCount = 10000;
+  const float frameTime = 1.0f / 60.0f;
+
+  CalCoreModel *pCoreModel;
+  pCoreModel = pModel->getCalModel()->getCoreModel();
+
+  CoreModelData *pCoreModelData;
+  pCoreModelData = CoreModelData::get(pCoreModel);
+  if(pCoreModelData == 0) return true;
+
+  bool bSuccess;
+  bSuccess = true;
+
+  int coreAnimationId;
+  for(coreAnimationId = 0; coreAnimationId < pCoreModel->getCoreAnimationCount(); coreAnimationId++)
+  {
+    CalCoreAnimation *pCoreAnimation;
+    pCoreAnimation = pCoreModel->getCoreAnimation(coreAnimationId);
+    if(pCoreAnimation == 0) continue;
+
+    PackedAnimation *pPackedAnimation;
+    pPackedAnimation = pCoreModelData->getPackedAnimation(pCoreAnimation);
+    if((pPackedAnimation == 0) || (pPackedAnimation->getDuration() <= 0.0f)) continue;
+
+    CompressedAnimation compressedAnimation;
+    compressedAnimation.create(pCoreAnimation, translationTolerance, rotationTolerance);
+
+    // write and read the compressed file, all samples must survive unchanged
+    std::stringstream stream;
+    compressedAnimation.save(stream);
+
+    int compressedFileSize;
+    compressedFileSize = (int)stream.str().size();
+
+    CompressedAnimation loadedAnimation;
+    bool bLoaded;
+    bLoaded = loadedAnimation.load(stream);
+
+    int fileSize;
+    fileSize = 0;
+    std::ifstream file;
+    file.open(pCoreAnimation->getFilename().c_str(), std::ios::in | std::ios::binary);
+    if(file)
+    {
+      file.seekg(0, std::ios::end);
+      fileSize = (int)file.tellg();
+    }
+
+    // sample all tracks like the mixer does
+    std::vector<TrackSampler> vectorPackedSampler(pPackedAnimation->getTrackCount());
+    std::vector<TrackSampler> vectorCompressedSampler(compressedAnimation.getTrackCount());
+    std::vector<TrackSampler> vectorLoadedSampler(loadedAnimation.getTrackCount());
+
+    float maxTranslationError;
+    maxTranslationError = 0.0f;
+    float maxRotationError;
+    maxRotationError = 0.0f;
+    bool bRoundTrip;
+    bRoundTrip = bLoaded && (loadedAnimation.getTrackCount() == pPackedAnimation->getTrackCount());
+
+    int frameId;
+    int trackId;
+    for(frameId = 0; bRoundTrip && (frameId < frameCount); frameId++)
+    {
+      float time;
+      time = fmod(frameId * frameTime, pPackedAnimation->getDuration());
+
+      for(trackId = 0; trackId < pPackedAnimation->getTrackCount(); trackId++)
+      {
+        CalVector translationReference, translation, translationLoaded;
+        CalQuaternion rotationReference, rotation, rotationLoaded;
+        if(!vectorPackedSampler[trackId].getState(*pPackedAnimation, trackId, time, translationReference, rotationReference)) continue;
+        vectorCompressedSampler[trackId].getState(compressedAnimation, trackId, time, translation, rotation);
+        vectorLoadedSampler[trackId].getState(loadedAnimation, trackId, time, translationLoaded, rotationLoaded);
+
+        if((translationLoaded != translation) || (rotationLoaded.x != rotation.x) || (rotationLoaded.y != rotation.y) || (rotationLoaded.z != rotation.z) || (rotationLoaded.w != rotation.w)) bRoundTrip = false;
+
+        float error;
+        error = (translation - translationReference).length();
+        if(error > maxTranslationError) maxTranslationError = error;
+        error = KeyframeReducer::getRotationError(rotation, rotationReference);
+        if(error > maxRotationError) maxRotationError = error;
+      }
+    }
+
+    bool bBound;
+    bBound = (compressedAnimation.getMaxTranslationError() <= translationTolerance) && (compressedAnimation.getMaxRotationError() <= rotationTolerance);
+    if(!bRoundTrip || !bBound) bSuccess = false;
+
+    // time the sampling of both representations
+    float checksum;
+    checksum = 0.0f;
+
+    Timer timer;
+
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      float time;
+      time = fmod(frameId * frameTime, pPackedAnimation->getDuration());
+
+      for(trackId = 0; trackId < pPackedAnimation->getTrackCount(); trackId++)
+      {
+        CalVector translation;
+        CalQuaternion rotation;
+        vectorPackedSampler[trackId].getState(*pPackedAnimation, trackId, time, translation, rotation);
+        checksum += rotation.w;
+      }
+    }
+
+    float packedTime;
+    packedTime = timer.getTime();
+
+    timer.start();
+
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      float time;
+      time = fmod(frameId * frameTime, pPackedAnimation->getDuration());
+
+      for(trackId = 0; trackId < compressedAnimation.getTrackCount(); trackId++)
+      {
+        CalVector translation;
+        CalQuaternion rotation;
+        vectorCompressedSampler[trackId].getState(compressedAnimation, trackId, time, translation, rotation);
+        checksum -= rotation.w;
+      }
+    }
+
+    float compressedTime;
+    compressedTime = timer.getTime();
+
+    LOG("Model #%d compression '%s': file %d -> %d bytes, memory %d -> %d bytes, channels constant %d quantized %d raw %d", modelId, pCoreAnimation->getFilename().c_str(),
+      fileSize, compressedFileSize, pPackedAnimation->getMemorySize(), compressedAnimation.getMemorySize(),
+      compressedAnimation.getChannelCount(CompressedAnimation::CHANNEL_CONSTANT), compressedAnimation.getChannelCount(CompressedAnimation::CHANNEL_QUANTIZED), compressedAnimation.getChannelCount(CompressedAnimation::CHANNEL_RAW));
+    LOG("Model #%d compression error keyframes %g/%g, samples %g/%g, sampling %.3f ms -> %.3f ms (checksum %g) %s", modelId,
+      compressedAnimation.getMaxTranslationError(), compressedAnimation.getMaxRotationError(), maxTranslationError, maxRotationError,
+      packedTime, compressedTime, checksum, getResultName(bRoundTrip && bBound));
+  }
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Bake all animations at a fixed rate and compare memory, accuracy and       //
+// sampling time against the packed keyframes                                 //
+//----------------------------------------------------------------------------//
+
+bool Bench::runBakedAnimation(Model *pModel, int modelId)
+{
+  const float sampleRate = 30.0f;
+  const int frameCount = 10000;
+  const float frameTime = 1.0f / 60.0f;
+  const float sampleTolerance = 1e-4f;
+
+  CalCoreModel *pCoreModel;
+  pCoreModel = pModel->getCalModel()->getCoreModel();
+
+  CoreModelData *pCoreModelData;
+  pCoreModelData = CoreModelData::get(pCoreModel);
+  if(pCoreModelData == 0) return true;
+
+  int boneCount;
+  boneCount = (int)pCoreModel->getCoreSkeleton()->getVectorCoreBone().size();
+
+  bool bSuccess;
+  bSuccess = true;
+
+  int totalCoreAnimationSize;
+  totalCoreAnimationSize = 0;
+  int totalPackedAnimationSize;
+  totalPackedAnimationSize = 0;
+  int totalBakedAnimationSize;
+  totalBakedAnimationSize = 0;
+
+  int coreAnimationId;
+  for(coreAnimationId = 0; coreAnimationId < pCoreModel->getCoreAnimationCount(); coreAnimationId++)
+  {
+    CalCoreAnimation *pCoreAnimation;
+    pCoreAnimation = pCoreModel->getCoreAnimation(coreAnimationId);
+    if(pCoreAnimation == 0) continue;
+
+    PackedAnimation *pPackedAnimation;
+    pPackedAnimation = pCoreModelData->getPackedAnimation(pCoreAnimation);
+    if((pPackedAnimation == 0) || (pPackedAnimation->getDuration() <= 0.0f)) continue;
+
+    Timer timer;
+
+    BakedAnimation bakedAnimation;
+    bakedAnimation.create(pCoreAnimation, sampleRate);
+
+    float bakeTime;
+    bakeTime = timer.getTime();
+
+    // the samples have to be the states cal3d interpolates at the sample times
+    float maxSampleError;
+    maxSampleError = 0.0f;
+
+    int sampleId;
+    int trackId;
+    for(sampleId = 0; sampleId < bakedAnimation.getSampleCount(); sampleId++)
+    {
+      float time;
+      time = std::min(sampleId / sampleRate, bakedAnimation.getDuration());
+
+      for(trackId = 0; trackId < bakedAnimation.getTrackCount(); trackId++)
+      {
+        CalVector translationReference, translation;
+        CalQuaternion rotationReference, rotation;
+        pCoreAnimation->getCoreTrack(bakedAnimation.getCoreBoneId(trackId))->getState(time, translationReference, rotationReference);
+        bakedAnimation.getState(trackId, time, translation, rotation);
+
+        float error;
+        error = (translation - translationReference).length();
+        if(error > maxSampleError) maxSampleError = error;
+        error = KeyframeReducer::getRotationError(rotation, rotationReference);
+        if(error > maxSampleError) maxSampleError = error;
+      }
+    }
+
+    // between the samples the baked animation interpolates linearly what the
+    // keyframes interpolate, the error is only reported; the whole pose has
+    // to match the single tracks
+    std::vector<TrackSampler> vectorPackedSampler(pPackedAnimation->getTrackCount());
+    std::vector<float> vectorPose(PoseBlender::getPoseSize(boneCount));
+    std::vector<float> vectorTrackPose(PoseBlender::getPoseSize(boneCount));
+
+    // both skip the tracks without keyframes, match them by core bone
+    std::vector<int> vectorBakedTrackId(pPackedAnimation->getTrackCount(), -1);
+    for(trackId = 0; trackId < pPackedAnimation->getTrackCount(); trackId++)
+    {
+      int bakedTrackId;
+      for(bakedTrackId = 0; bakedTrackId < bakedAnimation.getTrackCount(); bakedTrackId++)
+      {
+        if(bakedAnimation.getCoreBoneId(bakedTrackId) == pPackedAnimation->getCoreBoneId(trackId)) vectorBakedTrackId[trackId] = bakedTrackId;
+      }
+    }
+
+    float maxTranslationError;
+    maxTranslationError = 0.0f;
+    float maxRotationError;
+    maxRotationError = 0.0f;
+    bool bPose;
+    bPose = true;
+
+    int frameId;
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      float time;
+      time = fmod(frameId * frameTime, pPackedAnimation->getDuration());
+
+      for(trackId = 0; trackId < pPackedAnimation->getTrackCount(); trackId++)
+      {
+        CalVector translationReference, translation;
+        CalQuaternion rotationReference, rotation;
+        if(!vectorPackedSampler[trackId].getState(*pPackedAnimation, trackId, time, translationReference, rotationReference)) continue;
+
+        if(!bakedAnimation.getState(vectorBakedTrackId[trackId], time, translation, rotation)) continue;
+
+        float error;
+        error = (translation - translationReference).length();
+        if(error > maxTranslationError) maxTranslationError = error;
+        error = KeyframeReducer::getRotationError(rotation, rotationReference);
+        if(error > maxRotationError) maxRotationError = error;
+      }
+
+      // compare the poses on a subset of the frames only, they are slow
+      if((frameId % 100) != 0) continue;
+
+      PoseBlender::clear(&vectorPose[0], PoseBlender::getBlockCount(boneCount));
+      PoseBlender::clear(&vectorTrackPose[0], PoseBlender::getBlockCount(boneCount));
+
+      bakedAnimation.getPose(time, 1.0f, PoseBlender::MODE_SLERP, &vectorPose[0]);
+
+      for(trackId = 0; trackId < bakedAnimation.getTrackCount(); trackId++)
+      {
+        CalVector translation;
+        CalQuaternion rotation;
+        bakedAnimation.getState(trackId, time, translation, rotation);
+        PoseBlender::setState(&vectorTrackPose[0], bakedAnimation.getCoreBoneId(trackId), translation, rotation, 1.0f);
+      }
+
+      if(memcmp(&vectorPose[0], &vectorTrackPose[0], vectorPose.size() * sizeof(float)) != 0) bPose = false;
+    }
+
+    bool bMatch;
+    bMatch = (maxSampleError <= sampleTolerance) && bPose;
+    if(!bMatch) bSuccess = false;
+
+    // time the sampling of both representations, the mixer samples the baked
+    // animations as a whole pose
+    float checksum;
+    checksum = 0.0f;
+
+    timer.start();
+
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      float time;
+      time = fmod(frameId * frameTime, pPackedAnimation->getDuration());
+
+      for(trackId = 0; trackId < pPackedAnimation->getTrackCount(); trackId++)
+      {
+        CalVector translation;
+        CalQuaternion rotation;
+        vectorPackedSampler[trackId].getState(*pPackedAnimation, trackId, time, translation, rotation);
+        PoseBlender::setState(&vectorPose[0], pPackedAnimation->getCoreBoneId(trackId), translation, rotation, 1.0f);
+      }
+
+      checksum += vectorPose[0];
+    }
+
+    float packedTime;
+    packedTime = timer.getTime();
+
+    timer.start();
+
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      float time;
+      time = fmod(frameId * frameTime, pPackedAnimation->getDuration());
+
+      bakedAnimation.getPose(time, 1.0f, PoseBlender::MODE_SLERP, &vectorPose[0]);
+
+      checksum -= vectorPose[0];
+    }
+
+    float bakedTime;
+    bakedTime = timer.getTime();
+
+    int coreAnimationSize;
+    coreAnimationSize = PackedAnimation::getCoreAnimationMemorySize(pCoreAnimation);
+
+    LOG("Model #%d baked '%s': %d tracks, %d samples at %g Hz, bake %.3f ms, memory keyframes %d, packed %d, baked %d bytes", modelId, pCoreAnimation->getFilename().c_str(),
+      bakedAnimation.getTrackCount(), bakedAnimation.getSampleCount(), sampleRate, bakeTime, coreAnimationSize, pPackedAnimation->getMemorySize(), bakedAnimation.getMemorySize());
+    LOG("Model #%d baked error samples %g, frames %g/%g, sampling %.3f ms -> %.3f ms (%.2fx, checksum %g) %s", modelId,
+      maxSampleError, maxTranslationError, maxRotationError, packedTime, bakedTime, getSpeedup(packedTime, bakedTime), checksum, getResultName(bMatch));
+
+    totalCoreAnimationSize += coreAnimationSize;
+    totalPackedAnimationSize += pPackedAnimation->getMemorySize();
+    totalBakedAnimationSize += bakedAnimation.getMemorySize();
+  }
+
+  LOG("Model #%d baked total: keyframes %d, packed %d, baked %d bytes, in use %d bytes", modelId, totalCoreAnimationSize, totalPackedAnimationSize, totalBakedAnimationSize, pCoreModelData->getAnimationMemorySize());
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Reduce the keyframes of all animations and check the reduced tracks        //
+// against the original keyframes                                             //
+//----------------------------------------------------------------------------//
+
+bool Bench::runKeyframeReduction(Model *pModel, int modelId)
+{
+  const float translationTolerance = 0.01f;
+  const float rotationTolerance = 0.002f;
+  const float frameTime = 1.0f / 60.0f;
+
+  CalCoreModel *pCoreModel;
+  pCoreModel = pModel->getCalModel()->getCoreModel();
+
+  bool bSuccess;
+  bSuccess = true;
+
+  int totalKeyframeCountBefore;
+  totalKeyframeCountBefore = 0;
+  int totalKeyframeCountAfter;
+  totalKeyframeCountAfter = 0;
+
+  int coreAnimationId;
+  for(coreAnimationId = 0; coreAnimationId < pCoreModel->getCoreAnimationCount(); coreAnimationId++)
+  {
+    CalCoreAnimation *pCoreAnimation;
+    pCoreAnimation = pCoreModel->getCoreAnimation(coreAnimationId);
+    if(pCoreAnimation == 0) continue;
+
+    // work on fresh copies, the model may already use reduced animations
+    CalCoreAnimationPtr pOriginalAnimation;
+    pOriginalAnimation = CalLoader::loadCoreAnimation(pCoreAnimation->getFilename(), pCoreModel->getCoreSkeleton());
+    CalCoreAnimationPtr pReducedAnimation;
+    pReducedAnimation = CalLoader::loadCoreAnimation(pCoreAnimation->getFilename(), pCoreModel->getCoreSkeleton());
+    if(!pOriginalAnimation || !pReducedAnimation) continue;
+
+    Timer timer;
+
+    KeyframeReducer keyframeReducer(translationTolerance, rotationTolerance);
+    keyframeReducer.reduce(pReducedAnimation.get());
+
+    float reduceTime;
+    reduceTime = timer.getTime();
+
+    // the reduced tracks must hit all original keyframes within the tolerance,
+    // the error between the keyframes is only reported
+    float maxKeyframeError;
+    maxKeyframeError = 0.0f;
+    float maxTranslationError;
+    maxTranslationError = 0.0f;
+    float maxRotationError;
+    maxRotationError = 0.0f;
+    bool bBound;
+    bBound = true;
+
+    std::list<CalCoreTrack *>& listCoreTrack = pOriginalAnimation->getListCoreTrack();
+
+    std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+    for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+    {
+      CalCoreTrack *pCoreTrack;
+      pCoreTrack = *iteratorCoreTrack;
+      CalCoreTrack *pReducedCoreTrack;
+      pReducedCoreTrack = pReducedAnimation->getCoreTrack(pCoreTrack->getCoreBoneId());
+      if(pReducedCoreTrack == 0)
+      {
+        bBound = false;
+        continue;
+      }
+
+      int keyframeId;
+      for(keyframeId = 0; keyframeId < pCoreTrack->getCoreKeyframeCount(); keyframeId++)
+      {
+        CalCoreKeyframe *pCoreKeyframe;
+        pCoreKeyframe = pCoreTrack->getCoreKeyframe(keyframeId);
+
+        CalVector translation;
+        CalQuaternion rotation;
+        pReducedCoreTrack->getState(pCoreKeyframe->getTime(), translation, rotation);
+
+        float translationError;
+        translationError = (translation - pCoreKeyframe->getTranslation()).length();
+        float rotationError;
+        rotationError = KeyframeReducer::getRotationError(rotation, pCoreKeyframe->getRotation());
+
+        if((translationError > translationTolerance * 1.001f + 1e-5f) || (rotationError > rotationTolerance * 1.001f + 1e-5f)) bBound = false;
+        if(translationError / translationTolerance > maxKeyframeError) maxKeyframeError = translationError / translationTolerance;
+        if(rotationError / rotationTolerance > maxKeyframeError) maxKeyframeError = rotationError / rotationTolerance;
+      }
+
+      float time;
+      for(time = 0.0f; time < pOriginalAnimation->getDuration(); time += frameTime)
+      {
+        CalVector translationReference, translation;
+        CalQuaternion rotationReference, rotation;
+        pCoreTrack->getState(time, translationReference, rotationReference);
+        pReducedCoreTrack->getState(time, translation, rotation);
+
+        float error;
+        error = (translation - translationReference).length();
+        if(error > maxTranslationError) maxTranslationError = error;
+        error = KeyframeReducer::getRotationError(rotation, rotationReference);
+        if(error > maxRotationError) maxRotationError = error;
+      }
+    }
+
+    if(!bBound) bSuccess = false;
+
+    LOG("Model #%d reduction '%s': %d -> %d keyframes in %.3f ms, keyframe error %g/%g (%.2f of tolerance), sample error %g/%g %s", modelId, pCoreAnimation->getFilename().c_str(),
+      keyframeReducer.getKeyframeCountBefore(), keyframeReducer.getKeyframeCountAfter(), reduceTime,
+      keyframeReducer.getMaxTranslationError(), keyframeReducer.getMaxRotationError(), maxKeyframeError, maxTranslationError, maxRotationError, getResultName(bBound));
+
+    // the error per bone, only for the bones that lost keyframes
+    const std::vector<KeyframeReducer::TrackResult>& vectorTrackResult = keyframeReducer.getTrackResults();
+
+    int trackId;
+    for(trackId = 0; trackId < (int)vectorTrackResult.size(); trackId++)
+    {
+      const KeyframeReducer::TrackResult& trackResult = vectorTrackResult[trackId];
+      if(trackResult.keyframeCountAfter == trackResult.keyframeCountBefore) continue;
+
+      LOG("Model #%d reduction bone %d '%s': %d -> %d keyframes, error %g/%g", modelId, trackResult.coreBoneId, pCoreModel->getCoreSkeleton()->getCoreBone(trackResult.coreBoneId)->getName().c_str(),
+        trackResult.keyframeCountBefore, trackResult.keyframeCountAfter, trackResult.maxTranslationError, trackResult.maxRotationError);
+    }
+
+    totalKeyframeCountBefore += keyframeReducer.getKeyframeCountBefore();
+    totalKeyframeCountAfter += keyframeReducer.getKeyframeCountAfter();
+  }
+
+  LOG("Model #%d reduction total: %d -> %d keyframes", modelId, totalKeyframeCountBefore, totalKeyframeCountAfter);
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Get the id of the first core animation with a filename containing a name   //
+//----------------------------------------------------------------------------//
+
+int Bench::getCoreAnimationId(CalCoreModel *pCoreModel, const std::string& strName)
+{
+  int coreAnimationId;
+  for(coreAnimationId = 0; coreAnimationId < pCoreModel->getCoreAnimationCount(); coreAnimationId++)
+  {
+    if(pCoreModel->getCoreAnimation(coreAnimationId)->getFilename().find(strName) != std::string::npos) return coreAnimationId;
+  }
+
+  return -1;
+}
+
+//----------------------------------------------------------------------------//
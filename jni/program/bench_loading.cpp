@@ -0,0 +1,570 @@
+//----------------------------------------------------------------------------//
+// bench_loading.cpp                                                          //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "bench.h"
+#include "model.h"
+#include "assetloader.h"
+#include "mappedsource.h"
+#include "bulkstreamsource.h"
+#include "fastloader.h"
+#include "asyncloader.h"
+#include "coremodelcache.h"
+#include "cal3d/coretrack.h"
+#include "cal3d/corekeyframe.h"
+#include "Utils.h"
+#include <fstream>
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------//
+// Run the loading benchmarks on the data directory and the loaded demo       //
+// models                                                                     //
+//----------------------------------------------------------------------------//
+
+bool Bench::runLoadingBenchmarks(const std::string& strDatapath, std::vector<Model *>& vectorModel)
+{
+  bool bSuccess;
+  bSuccess = true;
+
+  if(!runAssetLoading(strDatapath)) bSuccess = false;
+  if(!runAsyncLoading(vectorModel)) bSuccess = false;
+  if(!runCoreModelCache(vectorModel)) bSuccess = false;
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Collect all binary cal3d files below a directory                           //
+//----------------------------------------------------------------------------//
+
+void Bench::findBinaryFiles(const std::string& strPath, std::vector<std::string>& vectorFilename)
+{
+  DIR *pDirectory;
+  pDirectory = opendir(strPath.c_str());
+  if(pDirectory == 0) return;
+
+  struct dirent *pEntry;
+  while((pEntry = readdir(pDirectory)) != 0)
+  {
+    std::string strName;
+    strName = pEntry->d_name;
+    if((strName == ".") || (strName == "..")) continue;
+
+    std::string strFilename;
+    strFilename = strPath + "/" + strName;
+
+    struct stat fileStat;
+    if(stat(strFilename.c_str(), &fileStat) != 0) continue;
+
+    if(S_ISDIR(fileStat.st_mode))
+    {
+      findBinaryFiles(strFilename, vectorFilename);
+    }
+    else if(AssetLoader::isBinaryFile(strFilename))
+    {
+      vectorFilename.push_back(strFilename);
+    }
+  }
+
+  closedir(pDirectory);
+}
+
+//----------------------------------------------------------------------------//
+// Add the data of a core animation to a checksum                             //
+//----------------------------------------------------------------------------//
+
+unsigned int Bench::addChecksum(unsigned int checksum, CalCoreAnimation *pCoreAnimation)
+{
+  float duration;
+  duration = pCoreAnimation->getDuration();
+  checksum = addChecksum(checksum, &duration, sizeof(duration));
+
+  std::list<CalCoreTrack *>& listCoreTrack = pCoreAnimation->getListCoreTrack();
+
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+  {
+    int coreBoneId;
+    coreBoneId = (*iteratorCoreTrack)->getCoreBoneId();
+    checksum = addChecksum(checksum, &coreBoneId, sizeof(coreBoneId));
+
+    int keyframeId;
+    for(keyframeId = 0; keyframeId < (*iteratorCoreTrack)->getCoreKeyframeCount(); keyframeId++)
+    {
+      CalCoreKeyframe *pCoreKeyframe;
+      pCoreKeyframe = (*iteratorCoreTrack)->getCoreKeyframe(keyframeId);
+
+      float time;
+      time = pCoreKeyframe->getTime();
+      checksum = addChecksum(checksum, &time, sizeof(time));
+      checksum = addChecksum(checksum, &pCoreKeyframe->getTranslation(), sizeof(CalVector));
+      checksum = addChecksum(checksum, &pCoreKeyframe->getRotation(), sizeof(CalQuaternion));
+    }
+  }
+
+  return checksum;
+}
+
+//----------------------------------------------------------------------------//
+// Add the data of a core mesh to a checksum                                  //
+//----------------------------------------------------------------------------//
+
+unsigned int Bench::addChecksum(unsigned int checksum, CalCoreMesh *pCoreMesh)
+{
+  int coreSubmeshId;
+  for(coreSubmeshId = 0; coreSubmeshId < pCoreMesh->getCoreSubmeshCount(); coreSubmeshId++)
+  {
+    CalCoreSubmesh *pCoreSubmesh;
+    pCoreSubmesh = pCoreMesh->getCoreSubmesh(coreSubmeshId);
+
+    int header[3];
+    header[0] = pCoreSubmesh->getCoreMaterialThreadId();
+    header[1] = pCoreSubmesh->getLodCount();
+    header[2] = pCoreSubmesh->getSpringCount();
+    checksum = addChecksum(checksum, header, sizeof(header));
+
+    std::vector<CalCoreSubmesh::Vertex>& vectorVertex = pCoreSubmesh->getVectorVertex();
+
+    int vertexId;
+    for(vertexId = 0; vertexId < (int)vectorVertex.size(); vertexId++)
+    {
+      CalCoreSubmesh::Vertex& vertex = vectorVertex[vertexId];
+      checksum = addChecksum(checksum, &vertex.position, sizeof(CalVector));
+      checksum = addChecksum(checksum, &vertex.normal, sizeof(CalVector));
+      checksum = addChecksum(checksum, &vertex.collapseId, sizeof(int));
+      checksum = addChecksum(checksum, &vertex.faceCollapseCount, sizeof(int));
+      if(!vertex.vectorInfluence.empty()) checksum = addChecksum(checksum, &vertex.vectorInfluence[0], (int)(vertex.vectorInfluence.size() * sizeof(CalCoreSubmesh::Influence)));
+    }
+
+    std::vector<std::vector<CalCoreSubmesh::TextureCoordinate> >& vectorvectorTextureCoordinate = pCoreSubmesh->getVectorVectorTextureCoordinate();
+
+    int textureCoordinateId;
+    for(textureCoordinateId = 0; textureCoordinateId < (int)vectorvectorTextureCoordinate.size(); textureCoordinateId++)
+    {
+      std::vector<CalCoreSubmesh::TextureCoordinate>& vectorTextureCoordinate = vectorvectorTextureCoordinate[textureCoordinateId];
+      if(!vectorTextureCoordinate.empty()) checksum = addChecksum(checksum, &vectorTextureCoordinate[0], (int)(vectorTextureCoordinate.size() * sizeof(CalCoreSubmesh::TextureCoordinate)));
+    }
+
+    std::vector<CalCoreSubmesh::Face>& vectorFace = pCoreSubmesh->getVectorFace();
+    if(!vectorFace.empty()) checksum = addChecksum(checksum, &vectorFace[0], (int)(vectorFace.size() * sizeof(CalCoreSubmesh::Face)));
+
+    std::vector<CalCoreSubmesh::Spring>& vectorSpring = pCoreSubmesh->getVectorSpring();
+    if(!vectorSpring.empty()) checksum = addChecksum(checksum, &vectorSpring[0], (int)(vectorSpring.size() * sizeof(CalCoreSubmesh::Spring)));
+
+    std::vector<CalCoreSubmesh::PhysicalProperty>& vectorPhysicalProperty = pCoreSubmesh->getVectorPhysicalProperty();
+    if(!vectorPhysicalProperty.empty()) checksum = addChecksum(checksum, &vectorPhysicalProperty[0], (int)(vectorPhysicalProperty.size() * sizeof(CalCoreSubmesh::PhysicalProperty)));
+  }
+
+  return checksum;
+}
+
+//----------------------------------------------------------------------------//
+// Add the bones of a core skeleton to a checksum                             //
+//----------------------------------------------------------------------------//
+
+unsigned int Bench::addChecksum(unsigned int checksum, CalCoreSkeleton *pCoreSkeleton)
+{
+  std::vector<CalCoreBone *>& vectorCoreBone = pCoreSkeleton->getVectorCoreBone();
+
+  int coreBoneId;
+  for(coreBoneId = 0; coreBoneId < (int)vectorCoreBone.size(); coreBoneId++)
+  {
+    CalCoreBone *pCoreBone;
+    pCoreBone = vectorCoreBone[coreBoneId];
+
+    int parentId;
+    parentId = pCoreBone->getParentId();
+    checksum = addChecksum(checksum, pCoreBone->getName().c_str(), (int)pCoreBone->getName().size());
+    checksum = addChecksum(checksum, &parentId, sizeof(parentId));
+    checksum = addChecksum(checksum, &pCoreBone->getTranslation(), sizeof(CalVector));
+    checksum = addChecksum(checksum, &pCoreBone->getRotation(), sizeof(CalQuaternion));
+  }
+
+  return checksum;
+}
+
+//----------------------------------------------------------------------------//
+// Get a checksum over everything a model loaded, including the decoded       //
+// textures that have not been uploaded yet                                   //
+//----------------------------------------------------------------------------//
+
+unsigned int Bench::getChecksum(Model *pModel)
+{
+  unsigned int checksum;
+  checksum = 2166136261u;
+
+  CalCoreModel *pCoreModel;
+  pCoreModel = pModel->getCalModel()->getCoreModel();
+
+  checksum = addChecksum(checksum, pCoreModel->getCoreSkeleton());
+
+  int coreAnimationId;
+  for(coreAnimationId = 0; coreAnimationId < pCoreModel->getCoreAnimationCount(); coreAnimationId++)
+  {
+    checksum = addChecksum(checksum, pCoreModel->getCoreAnimation(coreAnimationId));
+  }
+
+  int coreMeshId;
+  for(coreMeshId = 0; coreMeshId < pCoreModel->getCoreMeshCount(); coreMeshId++)
+  {
+    checksum = addChecksum(checksum, pCoreModel->getCoreMesh(coreMeshId));
+  }
+
+  int coreMaterialId;
+  for(coreMaterialId = 0; coreMaterialId < pCoreModel->getCoreMaterialCount(); coreMaterialId++)
+  {
+    CalCoreMaterial *pCoreMaterial;
+    pCoreMaterial = pCoreModel->getCoreMaterial(coreMaterialId);
+
+    int mapId;
+    for(mapId = 0; mapId < pCoreMaterial->getMapCount(); mapId++)
+    {
+      const std::string& strFilename = pCoreMaterial->getMapFilename(mapId);
+      checksum = addChecksum(checksum, strFilename.c_str(), (int)strFilename.size());
+    }
+  }
+
+  const std::vector<Model::TextureImage>& vectorTextureImage = pModel->getTextureImages();
+
+  int textureImageId;
+  for(textureImageId = 0; textureImageId < (int)vectorTextureImage.size(); textureImageId++)
+  {
+    const Model::TextureImage& textureImage = vectorTextureImage[textureImageId];
+
+    int header[5];
+    header[0] = textureImage.materialId;
+    header[1] = textureImage.mapId;
+    header[2] = textureImage.width;
+    header[3] = textureImage.height;
+    header[4] = textureImage.depth;
+    checksum = addChecksum(checksum, header, sizeof(header));
+    if(!textureImage.vectorPixel.empty()) checksum = addChecksum(checksum, &textureImage.vectorPixel[0], (int)textureImage.vectorPixel.size());
+  }
+
+  return checksum;
+}
+
+//----------------------------------------------------------------------------//
+// Load a binary cal3d file and get a checksum over the loaded data, all load //
+// modes have to agree                                                        //
+//----------------------------------------------------------------------------//
+
+bool Bench::loadBinaryFile(const std::string& strFilename, int loadMode, unsigned int& checksum)
+{
+  checksum = 2166136261u;
+
+  MappedSource mappedSource;
+  if(((loadMode == LOAD_MAPPED) || (loadMode == LOAD_BULK_MAPPED)) && !mappedSource.open(strFilename)) return false;
+
+  std::ifstream file;
+  file.open(strFilename.c_str(), std::ios::in | std::ios::binary);
+  BulkStreamSource bulkStreamSource(file);
+
+  BulkDataSource *pBulkDataSource;
+  pBulkDataSource = (loadMode == LOAD_BULK_MAPPED) ? (BulkDataSource *)&mappedSource : (BulkDataSource *)&bulkStreamSource;
+
+  const char *pExtension = strrchr(strFilename.c_str(), '.');
+
+  if(stricmp(pExtension, ".csf") == 0)
+  {
+    // skeletons have no bulk data, the bulk modes use the cal3d loader too
+    CalCoreSkeletonPtr pCoreSkeleton;
+    if(loadMode == LOAD_STREAM) pCoreSkeleton = CalLoader::loadCoreSkeleton(strFilename);
+    else if(loadMode == LOAD_MAPPED) pCoreSkeleton = CalLoader::loadCoreSkeleton(mappedSource);
+    else pCoreSkeleton = CalLoader::loadCoreSkeleton(*pBulkDataSource);
+    if(!pCoreSkeleton) return false;
+
+    checksum = addChecksum(checksum, pCoreSkeleton.get());
+  }
+  else if(stricmp(pExtension, ".cmf") == 0)
+  {
+    CalCoreMeshPtr pCoreMesh;
+    if(loadMode == LOAD_STREAM) pCoreMesh = CalLoader::loadCoreMesh(strFilename);
+    else if(loadMode == LOAD_MAPPED) pCoreMesh = CalLoader::loadCoreMesh(mappedSource);
+    else pCoreMesh = FastLoader::loadCoreMesh(*pBulkDataSource);
+    if(!pCoreMesh) return false;
+
+    checksum = addChecksum(checksum, pCoreMesh.get());
+  }
+  else
+  {
+    CalCoreAnimationPtr pCoreAnimation;
+    if(loadMode == LOAD_STREAM) pCoreAnimation = CalLoader::loadCoreAnimation(strFilename);
+    else if(loadMode == LOAD_MAPPED) pCoreAnimation = CalLoader::loadCoreAnimation(mappedSource);
+    else pCoreAnimation = FastLoader::loadCoreAnimation(*pBulkDataSource);
+    if(!pCoreAnimation) return false;
+
+    checksum = addChecksum(checksum, pCoreAnimation.get());
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Compare loading every binary asset through file streams, mapped files and  //
+// the bulk reads of the fast loader                                          //
+//----------------------------------------------------------------------------//
+
+bool Bench::runAssetLoading(const std::string& strDatapath)
+{
+  const int loadCount = 5;
+
+  std::vector<std::string> vectorFilename;
+  findBinaryFiles(strDatapath.empty() ? "." : strDatapath, vectorFilename);
+  std::sort(vectorFilename.begin(), vectorFilename.end());
+
+  bool bSuccess;
+  bSuccess = true;
+
+  int totalSize;
+  totalSize = 0;
+  float totalTime[LOAD_MODE_COUNT];
+
+  int loadMode;
+  for(loadMode = 0; loadMode < LOAD_MODE_COUNT; loadMode++)
+  {
+    totalTime[loadMode] = 0.0f;
+  }
+
+  int fileId;
+  for(fileId = 0; fileId < (int)vectorFilename.size(); fileId++)
+  {
+    const std::string& strFilename = vectorFilename[fileId];
+
+    struct stat fileStat;
+    if(stat(strFilename.c_str(), &fileStat) != 0) continue;
+
+    // keep the best of a few runs, the first one also warms the page cache
+    float time[LOAD_MODE_COUNT];
+    unsigned int checksum[LOAD_MODE_COUNT];
+    bool bMatch;
+    bMatch = true;
+
+    for(loadMode = 0; loadMode < LOAD_MODE_COUNT; loadMode++)
+    {
+      int loadId;
+      for(loadId = 0; loadId < loadCount; loadId++)
+      {
+        Timer timer;
+        if(!loadBinaryFile(strFilename, loadMode, checksum[loadMode])) bMatch = false;
+        float loadTime;
+        loadTime = timer.getTime();
+
+        if((loadId == 0) || (loadTime < time[loadMode])) time[loadMode] = loadTime;
+      }
+
+      if(checksum[loadMode] != checksum[LOAD_STREAM]) bMatch = false;
+      totalTime[loadMode] += time[loadMode];
+    }
+
+    if(!bMatch) bSuccess = false;
+
+    LOG("Loading '%s': %d bytes, stream %.3f ms, mapped %.3f ms, bulk stream %.3f ms, bulk mapped %.3f ms %s", strFilename.c_str(), (int)fileStat.st_size,
+      time[LOAD_STREAM], time[LOAD_MAPPED], time[LOAD_BULK_STREAM], time[LOAD_BULK_MAPPED], getResultName(bMatch));
+
+    totalSize += (int)fileStat.st_size;
+  }
+
+  LOG("Loading total: %d files, %d bytes, stream %.3f ms, mapped %.3f ms, bulk stream %.3f ms, bulk mapped %.3f ms (%.1f MB/s)", (int)vectorFilename.size(), totalSize,
+    totalTime[LOAD_STREAM], totalTime[LOAD_MAPPED], totalTime[LOAD_BULK_STREAM], totalTime[LOAD_BULK_MAPPED],
+    (totalTime[LOAD_BULK_MAPPED] > 0.0f) ? totalSize / (totalTime[LOAD_BULK_MAPPED] * 1000.0f) : 0.0f);
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Load the demo models again, once after another and once concurrently on    //
+// the asset loader, and compare what both ways loaded                        //
+//----------------------------------------------------------------------------//
+
+bool Bench::runAsyncLoading(std::vector<Model *>& vectorModel)
+{
+  int modelCount;
+  modelCount = (int)vectorModel.size();
+
+  // every model has to load its own core model for the comparison
+  bool bCacheEnabled;
+  bCacheEnabled = CoreModelCache::isEnabled();
+  CoreModelCache::setEnabled(false);
+
+  // load the models one after another
+  std::vector<Model *> vectorSerialModel;
+  std::vector<bool> vectorSerialLoaded;
+
+  Timer timer;
+
+  int modelId;
+  for(modelId = 0; modelId < modelCount; modelId++)
+  {
+    Model *pModel;
+    pModel = new Model();
+    if(!vectorModel[modelId]->getPath().empty()) pModel->setPath(vectorModel[modelId]->getPath());
+
+    vectorSerialLoaded.push_back(pModel->onLoad(vectorModel[modelId]->getFilename()));
+    vectorSerialModel.push_back(pModel);
+  }
+
+  float serialTime;
+  serialTime = timer.getTime();
+
+  // load the same models concurrently, the textures are only decoded so no
+  // gl context is needed
+  AsyncLoader asyncLoader;
+
+  for(modelId = 0; modelId < modelCount; modelId++)
+  {
+    Model *pModel;
+    pModel = new Model();
+    if(!vectorModel[modelId]->getPath().empty()) pModel->setPath(vectorModel[modelId]->getPath());
+
+    asyncLoader.addModel(pModel, vectorModel[modelId]->getFilename());
+  }
+
+  int threadCount;
+  threadCount = AsyncLoader::getDefaultThreadCount();
+
+  timer.start();
+  asyncLoader.start(threadCount);
+  asyncLoader.wait();
+
+  float asyncTime;
+  asyncTime = timer.getTime();
+
+  bool bSuccess;
+  bSuccess = true;
+
+  for(modelId = 0; modelId < modelCount; modelId++)
+  {
+    bool bMatch;
+    bMatch = vectorSerialLoaded[modelId] && (asyncLoader.getState(modelId) == AsyncLoader::STATE_LOADED);
+
+    unsigned int serialChecksum;
+    serialChecksum = 0;
+    unsigned int asyncChecksum;
+    asyncChecksum = 0;
+
+    if(bMatch)
+    {
+      serialChecksum = getChecksum(vectorSerialModel[modelId]);
+      asyncChecksum = getChecksum(asyncLoader.getModel(modelId));
+      if(serialChecksum != asyncChecksum) bMatch = false;
+    }
+
+    if(!bMatch) bSuccess = false;
+
+    LOG("Async loading '%s': serial %08x, async %08x %s", vectorModel[modelId]->getFilename().c_str(), serialChecksum, asyncChecksum, getResultName(bMatch));
+  }
+
+  LOG("Async loading: %d models, serial %.1f ms, %d threads %.1f ms", modelCount, serialTime, threadCount, asyncTime);
+
+  for(modelId = 0; modelId < modelCount; modelId++)
+  {
+    vectorSerialModel[modelId]->onShutdown();
+    delete vectorSerialModel[modelId];
+
+    asyncLoader.getModel(modelId)->onShutdown();
+    delete asyncLoader.getModel(modelId);
+  }
+
+  CoreModelCache::setEnabled(bCacheEnabled);
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Spawn instances of the demo models through the core model cache and check  //
+// that they share the core model of the demo model                           //
+//----------------------------------------------------------------------------//
+
+bool Bench::runCoreModelCache(std::vector<Model *>& vectorModel)
+{
+  const int instanceCount = 10;
+
+  if(!CoreModelCache::isEnabled()) return true;
+
+  bool bSuccess;
+  bSuccess = true;
+
+  unsigned int modelId;
+  for(modelId = 0; modelId < vectorModel.size(); modelId++)
+  {
+    Model *pModel;
+    pModel = vectorModel[modelId];
+
+    CalCoreModel *pCoreModel;
+    pCoreModel = pModel->getCalModel()->getCoreModel();
+
+    // the cost of a model that loads its own core model
+    CoreModelCache::setEnabled(false);
+
+    std::vector<Model *> vectorInstance;
+
+    Timer timer;
+
+    bool bLoaded;
+    bLoaded = loadInstances(pModel, 1, vectorInstance);
+
+    float uncachedTime;
+    uncachedTime = timer.getTime();
+
+    deleteInstances(vectorInstance);
+
+    CoreModelCache::setEnabled(true);
+
+    if(!bLoaded) bSuccess = false;
+
+    // the instances only create their model instance
+    int refCount;
+    refCount = CoreModelCache::getRefCount(pCoreModel);
+    int hitCount;
+    hitCount = CoreModelCache::getHitCount();
+    int bytesSaved;
+    bytesSaved = CoreModelCache::getBytesSaved();
+
+    bool bShared;
+    bShared = (refCount > 0);
+
+    timer.start();
+
+    if(!loadInstances(pModel, instanceCount, vectorInstance)) bShared = false;
+
+    float cachedTime;
+    cachedTime = timer.getTime();
+
+    int instanceId;
+    for(instanceId = 0; instanceId < (int)vectorInstance.size(); instanceId++)
+    {
+      if(vectorInstance[instanceId]->getCalModel()->getCoreModel() != pCoreModel) bShared = false;
+    }
+
+    if(CoreModelCache::getRefCount(pCoreModel) != refCount + instanceCount) bShared = false;
+
+    deleteInstances(vectorInstance);
+
+    // the demo model still holds its core model
+    if(CoreModelCache::getRefCount(pCoreModel) != refCount) bShared = false;
+
+    if(!bShared) bSuccess = false;
+
+    LOG("Core model cache #%d: %d instances %.3f ms, one uncached load %.3f ms, %d hits, %d bytes saved %s", modelId, instanceCount, cachedTime, uncachedTime,
+      CoreModelCache::getHitCount() - hitCount, CoreModelCache::getBytesSaved() - bytesSaved, getResultName(bShared));
+  }
+
+  LOG("Core model cache: %d core models, %d hits, %d misses, %d bytes saved", CoreModelCache::getCoreModelCount(), CoreModelCache::getHitCount(), CoreModelCache::getMissCount(), CoreModelCache::getBytesSaved());
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
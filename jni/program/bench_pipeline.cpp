@@ -0,0 +1,626 @@
+//----------------------------------------------------------------------------//
+// bench_pipeline.cpp                                                         //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "bench.h"
+#include "model.h"
+#include "crowd.h"
+#include "modelpipeline.h"
+#include "threadpool.h"
+#include "animmixer.h"
+#include "animationlod.h"
+#include "Utils.h"
+#include <float.h>
+#include <math.h>
+#include <sched.h>
+#include <pthread.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------//
+// Run the update pipeline benchmarks on the loaded demo models               //
+//----------------------------------------------------------------------------//
+
+bool Bench::runPipelineBenchmarks(std::vector<Model *>& vectorModel)
+{
+  bool bSuccess;
+  bSuccess = true;
+
+  if(!runCrowd(vectorModel)) bSuccess = false;
+  if(!runAnimationLod(vectorModel)) bSuccess = false;
+  if(!runModelPipeline(vectorModel)) bSuccess = false;
+  if(!runDoubleBuffer(vectorModel)) bSuccess = false;
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Update crowds of 1 to 256 instances of the first demo model on 1 to all    //
+// cores, the threaded updates have to match the serial ones bit for bit      //
+//----------------------------------------------------------------------------//
+
+bool Bench::runCrowd(std::vector<Model *>& vectorModel)
+{
+  const int maxInstanceCount = 256;
+  const int frameCount = 10;
+  const float frameTime = 1.0f / 30.0f;
+
+  if(vectorModel.empty()) return true;
+
+  Model *pModel;
+  pModel = vectorModel[0];
+
+  // two identical sets of instances, the first one is the serial reference
+  std::vector<Model *> vectorInstance;
+
+  bool bSuccess;
+  bSuccess = true;
+
+  if(!loadInstances(pModel, 2 * maxInstanceCount, vectorInstance)) bSuccess = false;
+
+  // spread the instances over the animation cycles
+  int instanceId;
+  for(instanceId = 0; instanceId < (int)vectorInstance.size(); instanceId++)
+  {
+    vectorInstance[instanceId]->onUpdate((instanceId % maxInstanceCount) * 0.037f);
+  }
+
+  int cpuCount;
+  cpuCount = ThreadPool::getCpuCount();
+
+  if(bSuccess)
+  {
+    Crowd crowdReference;
+    Crowd crowd;
+
+    for(instanceId = 0; instanceId < maxInstanceCount; instanceId++)
+    {
+      crowdReference.addModel(vectorInstance[instanceId]->getCalModel());
+      crowd.addModel(vectorInstance[maxInstanceCount + instanceId]->getCalModel());
+    }
+
+    ThreadPool threadPool;
+    threadPool.onInit(cpuCount);
+    crowd.setThreadPool(&threadPool);
+
+    int frameId;
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      crowdReference.update(frameTime);
+      crowd.update(frameTime);
+    }
+
+    // compare the final poses of all bones
+    int mismatchCount;
+    mismatchCount = 0;
+
+    for(instanceId = 0; instanceId < maxInstanceCount; instanceId++)
+    {
+      std::vector<CalBone *>& vectorBoneReference = crowdReference.getModel(instanceId)->getSkeleton()->getVectorBone();
+      std::vector<CalBone *>& vectorBone = crowd.getModel(instanceId)->getSkeleton()->getVectorBone();
+
+      unsigned int boneId;
+      for(boneId = 0; boneId < vectorBone.size(); boneId++)
+      {
+        if((memcmp(&vectorBone[boneId]->getTranslationAbsolute(), &vectorBoneReference[boneId]->getTranslationAbsolute(), sizeof(CalVector)) != 0)
+          || (memcmp(&vectorBone[boneId]->getRotationAbsolute(), &vectorBoneReference[boneId]->getRotationAbsolute(), sizeof(CalQuaternion)) != 0))
+        {
+          mismatchCount++;
+        }
+      }
+    }
+
+    if(mismatchCount > 0) bSuccess = false;
+
+    LOG("Crowd determinism: %d instances, %d threads, %d steals, %d bone mismatches %s", maxInstanceCount, threadPool.getThreadCount(), threadPool.getStealCount(), mismatchCount, getResultName(mismatchCount == 0));
+  }
+
+  if(bSuccess)
+  {
+    // the time of one thread per crowd size, the base of the speedups
+    std::vector<float> vectorSerialTime;
+
+    int threadCount;
+    for(threadCount = 1; threadCount <= cpuCount; threadCount++)
+    {
+      ThreadPool threadPool;
+      threadPool.onInit(threadCount);
+
+      int sizeId;
+      int instanceCount;
+      for(sizeId = 0, instanceCount = 1; instanceCount <= maxInstanceCount; sizeId++, instanceCount *= 2)
+      {
+        Crowd crowd;
+        crowd.setThreadPool(&threadPool);
+
+        for(instanceId = 0; instanceId < instanceCount; instanceId++)
+        {
+          crowd.addModel(vectorInstance[instanceId]->getCalModel());
+        }
+
+        Timer timer;
+
+        int frameId;
+        for(frameId = 0; frameId < frameCount; frameId++)
+        {
+          crowd.update(frameTime);
+        }
+
+        float time;
+        time = timer.getTime() / frameCount;
+
+        if(threadCount == 1) vectorSerialTime.push_back(time);
+
+        LOG("Crowd %d instances, %d threads: %.3f ms/frame, speedup %.2f", instanceCount, threadCount, time, getSpeedup(vectorSerialTime[sizeId], time));
+      }
+    }
+  }
+
+  deleteInstances(vectorInstance);
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Update a scene of instances spread from filling the viewport to a few      //
+// percent of it, with and without the animation level of detail, and count   //
+// the work it saves                                                          //
+//----------------------------------------------------------------------------//
+
+bool Bench::runAnimationLod(std::vector<Model *>& vectorModel)
+{
+  const int instanceCount = 100;
+  const int frameCount = 120;
+  const float frameTime = 1.0f / 30.0f;
+  const float projectionScale = 10.0f;
+  const float minScreenSize = 0.02f;
+
+  if(vectorModel.empty()) return true;
+
+  Model *pModel;
+  pModel = vectorModel[0];
+
+  // the first set of instances is updated every frame and is the reference
+  std::vector<Model *> vectorInstance;
+
+  bool bSuccess;
+  bSuccess = true;
+
+  if(!loadInstances(pModel, 2 * instanceCount, vectorInstance)) bSuccess = false;
+
+  // spread the instances over the animation cycles
+  int instanceId;
+  for(instanceId = 0; instanceId < (int)vectorInstance.size(); instanceId++)
+  {
+    vectorInstance[instanceId]->onUpdate((instanceId % instanceCount) * 0.037f);
+  }
+
+  if(bSuccess)
+  {
+    // the levels are picked once from the first pose, so the instances keep
+    // their level over the whole run
+    int levelCount[AnimationLod::LEVEL_COUNT] = { 0 };
+    std::vector<int> vectorLevel(instanceCount);
+
+    float radius;
+    radius = 0.0f;
+
+    for(instanceId = 0; instanceId < instanceCount; instanceId++)
+    {
+      Model *pInstance;
+      pInstance = vectorInstance[instanceCount + instanceId];
+
+      // the screen size at distance 1 is the distance that fills the viewport
+      float distance;
+      distance = AnimationLod::getScreenSize(pInstance->getCalModel(), 1.0f, projectionScale) / pow(minScreenSize, (float)instanceId / (instanceCount - 1));
+
+      AnimationLod::Level level;
+      level = AnimationLod::getLevel(AnimationLod::getScreenSize(pInstance->getCalModel(), distance, projectionScale));
+
+      pInstance->setAnimationLod(level);
+      vectorLevel[instanceId] = level;
+      levelCount[level]++;
+
+      // the screen size at the projection scale is the radius of the model
+      if(instanceId == 0) radius = AnimationLod::getScreenSize(pInstance->getCalModel(), projectionScale, projectionScale);
+    }
+
+    // only the updates of the run are counted
+    for(instanceId = 0; instanceId < 2 * instanceCount; instanceId++)
+    {
+      vectorInstance[instanceId]->getModelPipeline()->resetCounters();
+    }
+
+    float time[2];
+
+    int pass;
+    for(pass = 0; pass < 2; pass++)
+    {
+      AnimMixer::resetCounters();
+
+      Timer timer;
+
+      int frameId;
+      for(frameId = 0; frameId < frameCount; frameId++)
+      {
+        for(instanceId = 0; instanceId < instanceCount; instanceId++)
+        {
+          vectorInstance[pass * instanceCount + instanceId]->onUpdate(frameTime);
+        }
+      }
+
+      time[pass] = timer.getTime();
+    }
+
+    // the work that actually ran in the second pass
+    int animateCount;
+    animateCount = 0;
+    int skinCount;
+    skinCount = 0;
+    int throttledCount;
+    throttledCount = 0;
+    int interpolationCount;
+    interpolationCount = 0;
+
+    // the instances of the full level run the same stages as the reference,
+    // the others are compared relative to the size of the model
+    float maxError[AnimationLod::LEVEL_COUNT] = { 0.0f };
+
+    for(instanceId = 0; instanceId < instanceCount; instanceId++)
+    {
+      ModelPipeline *pModelPipeline;
+      pModelPipeline = vectorInstance[instanceCount + instanceId]->getModelPipeline();
+
+      animateCount += pModelPipeline->getRunCount(ModelPipeline::STAGE_ANIMATE);
+      skinCount += pModelPipeline->getRunCount(ModelPipeline::STAGE_SKIN);
+      throttledCount += pModelPipeline->getThrottledCount();
+      interpolationCount += pModelPipeline->getInterpolationCount();
+
+      std::vector<float> vectorVertexReference;
+      readVertexStream(vectorInstance[instanceId]->getModelPipeline(), vectorVertexReference);
+      std::vector<float> vectorVertex;
+      readVertexStream(pModelPipeline, vectorVertex);
+
+      float error;
+      error = (vectorVertex.size() == vectorVertexReference.size()) ? getMaxError(vectorVertex, vectorVertexReference, (int)vectorVertex.size()) : FLT_MAX;
+      if(radius > 0.0f) error /= radius;
+
+      if(error > maxError[vectorLevel[instanceId]]) maxError[vectorLevel[instanceId]] = error;
+    }
+
+    bool bMatch;
+    bMatch = (maxError[AnimationLod::LEVEL_FULL] == 0.0f) && (animateCount + throttledCount == instanceCount * frameCount);
+    if(!bMatch) bSuccess = false;
+
+    int referenceAnimateCount;
+    referenceAnimateCount = 0;
+    int referenceSkinCount;
+    referenceSkinCount = 0;
+
+    for(instanceId = 0; instanceId < instanceCount; instanceId++)
+    {
+      referenceAnimateCount += vectorInstance[instanceId]->getModelPipeline()->getRunCount(ModelPipeline::STAGE_ANIMATE);
+      referenceSkinCount += vectorInstance[instanceId]->getModelPipeline()->getRunCount(ModelPipeline::STAGE_SKIN);
+    }
+
+    LOG("Animation lod: %d instances, %d frames, levels full %d, half %d, quarter %d", instanceCount, frameCount,
+      levelCount[AnimationLod::LEVEL_FULL], levelCount[AnimationLod::LEVEL_HALF], levelCount[AnimationLod::LEVEL_QUARTER]);
+    LOG("Animation lod: every frame %.3f ms, lod %.3f ms (%.1f%% saved), animate %d -> %d, skin %d -> %d, %d throttled, %d interpolated, %d tracks skipped", time[0], time[1],
+      (time[0] > 0.0f) ? 100.0f * (time[0] - time[1]) / time[0] : 0.0f, referenceAnimateCount, animateCount, referenceSkinCount, skinCount, throttledCount, interpolationCount, AnimMixer::getSkippedTrackCount());
+    LOG("Animation lod: max error relative to the model size full %g, half %g, quarter %g %s",
+      maxError[AnimationLod::LEVEL_FULL], maxError[AnimationLod::LEVEL_HALF], maxError[AnimationLod::LEVEL_QUARTER], getResultName(bMatch));
+  }
+
+  AnimMixer::resetCounters();
+
+  deleteInstances(vectorInstance);
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Run the staged update against CalModel::update and measure how much a      //
+// crowd saves when half of it is not visible                                 //
+//----------------------------------------------------------------------------//
+
+bool Bench::runModelPipeline(std::vector<Model *>& vectorModel)
+{
+  const int instanceCount = 256;
+  const int frameCount = 10;
+  const float frameTime = 1.0f / 30.0f;
+
+  if(vectorModel.empty()) return true;
+
+  Model *pModel;
+  pModel = vectorModel[0];
+
+  std::vector<Model *> vectorInstance;
+
+  bool bSuccess;
+  bSuccess = true;
+
+  if(!loadInstances(pModel, instanceCount, vectorInstance)) bSuccess = false;
+
+  if(bSuccess)
+  {
+    // the first instance runs CalModel::update, the second one the stages,
+    // the third one the stages posed through the flat skeleton
+    CalModel *pModelReference;
+    pModelReference = vectorInstance[0]->getCalModel();
+    ModelPipeline *pModelPipeline;
+    pModelPipeline = vectorInstance[1]->getModelPipeline();
+    ModelPipeline *pFlatPipeline;
+    pFlatPipeline = vectorInstance[2]->getModelPipeline();
+    pFlatPipeline->setFlatSkeleton(true);
+
+    int frameId;
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      pModelReference->update(frameTime);
+      pModelPipeline->update(frameTime);
+      pFlatPipeline->update(frameTime);
+    }
+
+    int mismatchCount;
+    mismatchCount = 0;
+
+    std::vector<CalBone *>& vectorBoneReference = pModelReference->getSkeleton()->getVectorBone();
+    std::vector<CalBone *>& vectorBone = pModelPipeline->getModel()->getSkeleton()->getVectorBone();
+
+    unsigned int boneId;
+    for(boneId = 0; boneId < vectorBone.size(); boneId++)
+    {
+      if((memcmp(&vectorBone[boneId]->getTranslationAbsolute(), &vectorBoneReference[boneId]->getTranslationAbsolute(), sizeof(CalVector)) != 0)
+        || (memcmp(&vectorBone[boneId]->getRotationAbsolute(), &vectorBoneReference[boneId]->getRotationAbsolute(), sizeof(CalQuaternion)) != 0))
+      {
+        mismatchCount++;
+      }
+    }
+
+    if(mismatchCount > 0) bSuccess = false;
+
+    LOG("Model pipeline: %d bone mismatches against CalModel::update %s", mismatchCount, getResultName(mismatchCount == 0));
+
+    // models the flat skeleton does not support fall back to the bones of
+    // cal3d, the bone matrices the skinning uses have to match either way
+    bool bFlatSkeleton;
+    bFlatSkeleton = ((AnimMixer *)pFlatPipeline->getModel()->getAbstractMixer())->getFlatSkeleton() != 0;
+
+    int matrixValueCount;
+    matrixValueCount = (int)vectorBone.size() * Skinning::BONE_MATRIX_SIZE;
+
+    std::vector<float> vectorBoneMatrixReference(pModelPipeline->getBoneMatrices(), pModelPipeline->getBoneMatrices() + matrixValueCount);
+    std::vector<float> vectorBoneMatrix(pFlatPipeline->getBoneMatrices(), pFlatPipeline->getBoneMatrices() + matrixValueCount);
+
+    float extent;
+    extent = 0.0f;
+
+    for(boneId = 0; boneId < vectorBone.size(); boneId++)
+    {
+      int axis;
+      for(axis = 0; axis < 3; axis++)
+      {
+        if(fabs(vectorBoneMatrixReference[boneId * Skinning::BONE_MATRIX_SIZE + axis * 4 + 3]) > extent) extent = fabs(vectorBoneMatrixReference[boneId * Skinning::BONE_MATRIX_SIZE + axis * 4 + 3]);
+      }
+    }
+
+    float maxError;
+    maxError = getMaxError(vectorBoneMatrix, vectorBoneMatrixReference, matrixValueCount);
+
+    bool bMatch;
+    bMatch = (maxError <= 1e-5f * (extent + 1.0f));
+    if(!bMatch) bSuccess = false;
+
+    LOG("Model pipeline flat skeleton: %s, max error %g %s", bFlatSkeleton ? "active" : "not supported", maxError, getResultName(bMatch));
+
+    // a paused model skips every stage once its output is up to date
+    pModelPipeline->setPaused(true);
+    pModelPipeline->resetCounters();
+
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      pModelPipeline->update(frameTime);
+    }
+
+    LOG("Model pipeline paused: animate %d/%d, pose %d/%d, simulate %d/%d, skin %d/%d runs/skips", pModelPipeline->getRunCount(ModelPipeline::STAGE_ANIMATE), pModelPipeline->getSkipCount(ModelPipeline::STAGE_ANIMATE), pModelPipeline->getRunCount(ModelPipeline::STAGE_POSE), pModelPipeline->getSkipCount(ModelPipeline::STAGE_POSE), pModelPipeline->getRunCount(ModelPipeline::STAGE_SIMULATE), pModelPipeline->getSkipCount(ModelPipeline::STAGE_SIMULATE), pModelPipeline->getRunCount(ModelPipeline::STAGE_SKIN), pModelPipeline->getSkipCount(ModelPipeline::STAGE_SKIN));
+
+    // an invisible model keeps animating but is neither simulated nor skinned
+    pModelPipeline->setPaused(false);
+    pModelPipeline->setVisible(false);
+    pModelPipeline->resetCounters();
+
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      pModelPipeline->update(frameTime);
+    }
+
+    LOG("Model pipeline invisible: animate %d/%d, pose %d/%d, simulate %d/%d, skin %d/%d runs/skips", pModelPipeline->getRunCount(ModelPipeline::STAGE_ANIMATE), pModelPipeline->getSkipCount(ModelPipeline::STAGE_ANIMATE), pModelPipeline->getRunCount(ModelPipeline::STAGE_POSE), pModelPipeline->getSkipCount(ModelPipeline::STAGE_POSE), pModelPipeline->getRunCount(ModelPipeline::STAGE_SIMULATE), pModelPipeline->getSkipCount(ModelPipeline::STAGE_SIMULATE), pModelPipeline->getRunCount(ModelPipeline::STAGE_SKIN), pModelPipeline->getSkipCount(ModelPipeline::STAGE_SKIN));
+
+    if((pModelPipeline->getRunCount(ModelPipeline::STAGE_SKIN) != 0) || (pModelPipeline->getRunCount(ModelPipeline::STAGE_ANIMATE) != frameCount)) bSuccess = false;
+
+    pModelPipeline->setVisible(true);
+  }
+
+  if(bSuccess)
+  {
+    ThreadPool threadPool;
+    threadPool.onInit(ThreadPool::getCpuCount());
+
+    Crowd crowd;
+    crowd.setThreadPool(&threadPool);
+
+    int instanceId;
+    for(instanceId = 0; instanceId < instanceCount; instanceId++)
+    {
+      crowd.addModelPipeline(vectorInstance[instanceId]->getModelPipeline());
+    }
+
+    // first all instances visible, then every second one hidden
+    int passId;
+    for(passId = 0; passId < 2; passId++)
+    {
+      for(instanceId = 0; instanceId < instanceCount; instanceId++)
+      {
+        crowd.getModelPipeline(instanceId)->setVisible((passId == 0) || (instanceId % 2 == 0));
+      }
+
+      Timer timer;
+
+      int frameId;
+      for(frameId = 0; frameId < frameCount; frameId++)
+      {
+        // one stage of all instances after the other
+        int stage;
+        for(stage = 0; stage < ModelPipeline::STAGE_COUNT; stage++)
+        {
+          crowd.runStage(stage, frameTime);
+        }
+      }
+
+      float time;
+      time = timer.getTime() / frameCount;
+
+      LOG("Model pipeline crowd %d instances, %s visible, %d threads: %.3f ms/frame", instanceCount, (passId == 0) ? "all" : "half", threadPool.getThreadCount(), time);
+    }
+  }
+
+  deleteInstances(vectorInstance);
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Skin a model on an update thread while this thread reads the finished      //
+// frames like the renderer does, every frame read has to match the serially  //
+// skinned frame with the same number                                         //
+//----------------------------------------------------------------------------//
+
+bool Bench::runDoubleBuffer(std::vector<Model *>& vectorModel)
+{
+  const int frameCount = 200;
+  const float frameTime = 1.0f / 30.0f;
+
+  if(vectorModel.empty()) return true;
+
+  Model *pModel;
+  pModel = vectorModel[0];
+
+  std::vector<Model *> vectorInstance;
+
+  bool bSuccess;
+  bSuccess = loadInstances(pModel, 2, vectorInstance);
+
+  if(bSuccess)
+  {
+    Model *pInstanceReference;
+    pInstanceReference = vectorInstance[0];
+    Model *pInstance;
+    pInstance = vectorInstance[1];
+
+    // the checksums of all frames skinned on this thread alone
+    ModelPipeline *pModelPipelineReference;
+    pModelPipelineReference = pInstanceReference->getModelPipeline();
+
+    std::vector<unsigned int> vectorChecksum;
+
+    int frameId;
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      pModelPipelineReference->update(frameTime);
+      vectorChecksum.push_back(addChecksum(2166136261u, pModelPipelineReference));
+    }
+
+    ModelPipeline *pModelPipeline;
+    pModelPipeline = pInstance->getModelPipeline();
+    pModelPipeline->setDoubleBuffered(true);
+
+    PipelineUpdate pipelineUpdate;
+    pipelineUpdate.pModelPipeline = pModelPipeline;
+    pipelineUpdate.frameCount = frameCount;
+    pipelineUpdate.frameTime = frameTime;
+
+    pthread_t thread;
+    if(pthread_create(&thread, 0, runPipelineUpdate, &pipelineUpdate) != 0)
+    {
+      bSuccess = false;
+    }
+    else
+    {
+      int readCount;
+      readCount = 0;
+      int distinctCount;
+      distinctCount = 0;
+      int tornCount;
+      tornCount = 0;
+
+      int lastFrameId;
+      lastFrameId = 0;
+
+      while(lastFrameId < frameCount)
+      {
+        frameId = pModelPipeline->acquireFrame();
+
+        if(frameId > 0)
+        {
+          unsigned int checksum;
+          checksum = addChecksum(2166136261u, pModelPipeline);
+
+          // hold the frame a bit longer so the update thread runs into the fence
+          sched_yield();
+
+          unsigned int checksumAgain;
+          checksumAgain = addChecksum(2166136261u, pModelPipeline);
+
+          if((checksum != vectorChecksum[frameId - 1]) || (checksumAgain != checksum)) tornCount++;
+
+          readCount++;
+          if(frameId != lastFrameId) distinctCount++;
+        }
+
+        pModelPipeline->releaseFrame();
+
+        lastFrameId = frameId;
+      }
+
+      pthread_join(thread, 0);
+
+      if((tornCount > 0) || (pModelPipeline->getFrameCount() != frameCount)) bSuccess = false;
+
+      LOG("Double buffer: %d frames skinned, %d reads of %d distinct frames, %d fence waits, %d torn frames %s", pModelPipeline->getFrameCount(), readCount, distinctCount, pModelPipeline->getFenceWaitCount(), tornCount, getResultName(tornCount == 0));
+    }
+
+    pModelPipeline->setDoubleBuffered(false);
+  }
+
+  deleteInstances(vectorInstance);
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Update a pipeline for a number of frames, runs on its own thread           //
+//----------------------------------------------------------------------------//
+
+void *Bench::runPipelineUpdate(void *pPipelineUpdate)
+{
+  PipelineUpdate *pThis;
+  pThis = (PipelineUpdate *)pPipelineUpdate;
+
+  int frameId;
+  for(frameId = 0; frameId < pThis->frameCount; frameId++)
+  {
+    pThis->pModelPipeline->update(pThis->frameTime);
+  }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------//
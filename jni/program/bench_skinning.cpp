@@ -0,0 +1,992 @@
+//----------------------------------------------------------------------------//
+// bench_skinning.cpp                                                         //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "bench.h"
+#include "model.h"
+#include "skinning.h"
+#include "coremodeldata.h"
+#include "modelpipeline.h"
+#include "hardwareskinning.h"
+#include "Utils.h"
+
+//----------------------------------------------------------------------------//
+// Run the skinning benchmarks on the loaded demo models                      //
+//----------------------------------------------------------------------------//
+
+bool Bench::runSkinningBenchmarks(std::vector<Model *>& vectorModel)
+{
+  bool bSuccess;
+  bSuccess = true;
+
+  if(!runDualQuaternionTwist()) bSuccess = false;
+
+  unsigned int modelId;
+  for(modelId = 0; modelId < vectorModel.size(); modelId++)
+  {
+    // bring the model into an animated pose first
+    vectorModel[modelId]->onUpdate(0.25f);
+
+    runSkinStreamMemory(vectorModel[modelId], modelId);
+    runRenderData(vectorModel[modelId], modelId);
+    if(!runVertexLayout(vectorModel[modelId], modelId)) bSuccess = false;
+    if(!runHardwareSkinning(vectorModel[modelId], modelId)) bSuccess = false;
+    if(!runSkinning(vectorModel[modelId], modelId)) bSuccess = false;
+    if(!runDualQuaternion(vectorModel[modelId], modelId)) bSuccess = false;
+  }
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Compare all skinning kernels against CalPhysique and time them             //
+//----------------------------------------------------------------------------//
+
+bool Bench::runSkinning(Model *pModel, int modelId)
+{
+  const int iterationCount = 100;
+
+  CalModel *pCalModel;
+  pCalModel = pModel->getCalModel();
+
+  CoreModelData *pCoreModelData;
+  pCoreModelData = CoreModelData::get(pCalModel->getCoreModel());
+  if(pCoreModelData == 0) return true;
+
+  // collect all submeshes the kernels can handle
+  std::vector<CalSubmesh *> vectorSubmesh;
+  std::vector<const SkinStream *> vectorSkinStream;
+  int maxVertexCount;
+  maxVertexCount = 0;
+
+  std::vector<CalMesh *>& vectorMesh = pCalModel->getVectorMesh();
+  unsigned int meshId;
+  for(meshId = 0; meshId < vectorMesh.size(); meshId++)
+  {
+    int submeshId;
+    for(submeshId = 0; submeshId < vectorMesh[meshId]->getSubmeshCount(); submeshId++)
+    {
+      CalSubmesh *pSubmesh;
+      pSubmesh = vectorMesh[meshId]->getSubmesh(submeshId);
+      if(!Skinning::isSubmeshSupported(pSubmesh)) continue;
+
+      const SkinStream *pSkinStream;
+      pSkinStream = pCoreModelData->getSkinStream(pSubmesh->getCoreSubmesh());
+      if(pSkinStream == 0) continue;
+
+      vectorSubmesh.push_back(pSubmesh);
+      vectorSkinStream.push_back(pSkinStream);
+      if(pSubmesh->getVertexCount() > maxVertexCount) maxVertexCount = pSubmesh->getVertexCount();
+    }
+  }
+
+  if(vectorSubmesh.empty()) return true;
+
+  std::vector<float> vectorBoneMatrix(pCalModel->getSkeleton()->getVectorBone().size() * Skinning::BONE_MATRIX_SIZE);
+  Skinning::calculateBoneMatrices(pCalModel->getSkeleton(), &vectorBoneMatrix[0]);
+
+  std::vector<float> vectorVertexReference(maxVertexCount * 3);
+  std::vector<float> vectorNormalReference(maxVertexCount * 3);
+  std::vector<float> vectorVertex(maxVertexCount * 3);
+  std::vector<float> vectorNormal(maxVertexCount * 3);
+
+  // time the CalPhysique reference path
+  CalPhysique *pPhysique;
+  pPhysique = pCalModel->getPhysique();
+
+  Timer timer;
+
+  int iteration;
+  unsigned int submeshId;
+  for(iteration = 0; iteration < iterationCount; iteration++)
+  {
+    for(submeshId = 0; submeshId < vectorSubmesh.size(); submeshId++)
+    {
+      pPhysique->calculateVertices(vectorSubmesh[submeshId], &vectorVertexReference[0]);
+      pPhysique->calculateNormals(vectorSubmesh[submeshId], &vectorNormalReference[0]);
+    }
+  }
+
+  float physiqueTime;
+  physiqueTime = timer.getTime();
+  LOG("Model #%d skinning %s: %.3f ms/frame", modelId, Skinning::getPathName(Skinning::PATH_PHYSIQUE), physiqueTime / iterationCount);
+
+  bool bSuccess;
+  bSuccess = true;
+
+  Skinning::Path previousPath;
+  previousPath = Skinning::getPath();
+
+  int path;
+  for(path = Skinning::PATH_SCALAR; path < Skinning::PATH_COUNT; path++)
+  {
+    if(!Skinning::setPath((Skinning::Path)path)) continue;
+
+    // verify the kernel output against CalPhysique, relative to the extent of the mesh
+    float maxVertexError;
+    maxVertexError = 0.0f;
+    float maxNormalError;
+    maxNormalError = 0.0f;
+    float extent;
+    extent = 1.0f;
+
+    for(submeshId = 0; submeshId < vectorSubmesh.size(); submeshId++)
+    {
+      CalSubmesh *pSubmesh;
+      pSubmesh = vectorSubmesh[submeshId];
+
+      pPhysique->calculateVertices(pSubmesh, &vectorVertexReference[0]);
+      pPhysique->calculateNormals(pSubmesh, &vectorNormalReference[0]);
+
+      int vertexCount;
+      vertexCount = Skinning::calculateVerticesAndNormals(pSubmesh, vectorSkinStream[submeshId], &vectorBoneMatrix[0], &vectorVertex[0], &vectorNormal[0]);
+
+      int i;
+      for(i = 0; i < vertexCount * 3; i++)
+      {
+        if(fabs(vectorVertexReference[i]) > extent) extent = fabs(vectorVertexReference[i]);
+        if(fabs(vectorVertex[i] - vectorVertexReference[i]) > maxVertexError) maxVertexError = fabs(vectorVertex[i] - vectorVertexReference[i]);
+        if(fabs(vectorNormal[i] - vectorNormalReference[i]) > maxNormalError) maxNormalError = fabs(vectorNormal[i] - vectorNormalReference[i]);
+      }
+    }
+
+    bool bMatch;
+    bMatch = (maxVertexError <= 1e-4f * extent) && (maxNormalError <= 1e-4f);
+    if(!bMatch) bSuccess = false;
+
+    // time the kernel
+    timer.start();
+
+    for(iteration = 0; iteration < iterationCount; iteration++)
+    {
+      for(submeshId = 0; submeshId < vectorSubmesh.size(); submeshId++)
+      {
+        Skinning::calculateVerticesAndNormals(vectorSubmesh[submeshId], vectorSkinStream[submeshId], &vectorBoneMatrix[0], &vectorVertex[0], &vectorNormal[0]);
+      }
+    }
+
+    float time;
+    time = timer.getTime();
+    LOG("Model #%d skinning %s: %.3f ms/frame (%.2fx), max error vertex %g normal %g %s", modelId, Skinning::getPathName((Skinning::Path)path),
+      time / iterationCount, getSpeedup(physiqueTime, time), maxVertexError, maxNormalError, getResultName(bMatch));
+  }
+
+  Skinning::setPath(previousPath);
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Check the dual quaternion kernels against each other and against the       //
+// linear kernels on rigidly bound vertices, and time both methods            //
+//----------------------------------------------------------------------------//
+
+bool Bench::runDualQuaternion(Model *pModel, int modelId)
+{
+  const int iterationCount = 100;
+  const int maxBonesPerMesh = 32;
+  const float maxError = 1e-4f;
+
+  CalModel *pCalModel;
+  pCalModel = pModel->getCalModel();
+
+  CoreModelData *pCoreModelData;
+  pCoreModelData = CoreModelData::get(pCalModel->getCoreModel());
+  if(pCoreModelData == 0) return true;
+
+  int boneCount;
+  boneCount = pCalModel->getSkeleton()->getVectorBone().size();
+  if(boneCount == 0) return true;
+
+  std::vector<float> vectorBoneMatrix(boneCount * Skinning::BONE_MATRIX_SIZE);
+  Skinning::calculateBoneMatrices(pCalModel->getSkeleton(), &vectorBoneMatrix[0]);
+  std::vector<float> vectorDualQuaternion(boneCount * Skinning::DUAL_QUATERNION_SIZE);
+  Skinning::calculateDualQuaternions(&vectorBoneMatrix[0], boneCount, &vectorDualQuaternion[0]);
+
+  Skinning::Path previousPath;
+  previousPath = Skinning::getPath();
+
+  float extent;
+  extent = 1.0f;
+  float rigidError;
+  rigidError = 0.0f;
+  float pathError;
+  pathError = 0.0f;
+  float normalLengthError;
+  normalLengthError = 0.0f;
+  int rigidVertexCount;
+  rigidVertexCount = 0;
+
+  std::vector<CalSubmesh *> vectorSubmesh;
+  std::vector<const SkinStream *> vectorSkinStream;
+
+  std::vector<CalMesh *>& vectorMesh = pCalModel->getVectorMesh();
+  unsigned int meshId;
+  for(meshId = 0; meshId < vectorMesh.size(); meshId++)
+  {
+    int submeshId;
+    for(submeshId = 0; submeshId < vectorMesh[meshId]->getSubmeshCount(); submeshId++)
+    {
+      CalSubmesh *pSubmesh;
+      pSubmesh = vectorMesh[meshId]->getSubmesh(submeshId);
+      if(!Skinning::isSubmeshSupported(pSubmesh)) continue;
+
+      const SkinStream *pSkinStream;
+      pSkinStream = pCoreModelData->getSkinStream(pSubmesh->getCoreSubmesh());
+      if(pSkinStream == 0) continue;
+
+      vectorSubmesh.push_back(pSubmesh);
+      vectorSkinStream.push_back(pSkinStream);
+
+      int vertexCount;
+      vertexCount = pSubmesh->getVertexCount();
+      if(vertexCount == 0) continue;
+
+      std::vector<float> vectorLinearVertex(vertexCount * 3);
+      std::vector<float> vectorLinearNormal(vertexCount * 3);
+      std::vector<float> vectorReferenceVertex(vertexCount * 3);
+      std::vector<float> vectorReferenceNormal(vertexCount * 3);
+      std::vector<float> vectorVertex(vertexCount * 3);
+      std::vector<float> vectorNormal(vertexCount * 3);
+
+      // the scalar kernels are the reference of all paths
+      Skinning::setPath(Skinning::PATH_SCALAR);
+      Skinning::calculateVerticesAndNormals(pSubmesh, pSkinStream, &vectorBoneMatrix[0], &vectorLinearVertex[0], &vectorLinearNormal[0]);
+      Skinning::calculateVerticesAndNormals(pSubmesh, pSkinStream, &vectorDualQuaternion[0], &vectorReferenceVertex[0], &vectorReferenceNormal[0], 0, 0, Skinning::METHOD_DUAL_QUATERNION);
+
+      // both methods apply the very same transform to a vertex of one bone
+      std::vector<CalCoreSubmesh::Vertex>& vectorCoreVertex = pSubmesh->getCoreSubmesh()->getVectorVertex();
+
+      int vertexId;
+      for(vertexId = 0; vertexId < vertexCount; vertexId++)
+      {
+        int i;
+        for(i = vertexId * 3; i < vertexId * 3 + 3; i++)
+        {
+          if(fabs(vectorLinearVertex[i]) > extent) extent = fabs(vectorLinearVertex[i]);
+        }
+
+        float normalLength;
+        normalLength = sqrt(vectorReferenceNormal[vertexId * 3] * vectorReferenceNormal[vertexId * 3] + vectorReferenceNormal[vertexId * 3 + 1] * vectorReferenceNormal[vertexId * 3 + 1] + vectorReferenceNormal[vertexId * 3 + 2] * vectorReferenceNormal[vertexId * 3 + 2]);
+        if((normalLength > 0.0f) && (fabs(normalLength - 1.0f) > normalLengthError)) normalLengthError = fabs(normalLength - 1.0f);
+
+        if(vectorCoreVertex[vertexId].vectorInfluence.size() != 1) continue;
+
+        rigidVertexCount++;
+
+        for(i = vertexId * 3; i < vertexId * 3 + 3; i++)
+        {
+          if(fabs(vectorLinearVertex[i] - vectorReferenceVertex[i]) > rigidError) rigidError = fabs(vectorLinearVertex[i] - vectorReferenceVertex[i]);
+          if(fabs(vectorLinearNormal[i] - vectorReferenceNormal[i]) > rigidError) rigidError = fabs(vectorLinearNormal[i] - vectorReferenceNormal[i]);
+        }
+      }
+
+      // the simd paths against the scalar one
+      int path;
+      for(path = Skinning::PATH_SCALAR + 1; path < Skinning::PATH_COUNT; path++)
+      {
+        if(!Skinning::setPath((Skinning::Path)path)) continue;
+
+        Skinning::calculateVerticesAndNormals(pSubmesh, pSkinStream, &vectorDualQuaternion[0], &vectorVertex[0], &vectorNormal[0], 0, 0, Skinning::METHOD_DUAL_QUATERNION);
+
+        float error;
+        error = getMaxError(vectorVertex, vectorReferenceVertex, vertexCount * 3);
+        if(error > pathError) pathError = error;
+        error = getMaxError(vectorNormal, vectorReferenceNormal, vertexCount * 3);
+        if(error > pathError) pathError = error;
+      }
+    }
+  }
+
+  Skinning::setPath(previousPath);
+
+  bool bSuccess;
+  bSuccess = (rigidError <= maxError * extent) && (pathError <= maxError * extent) && (normalLengthError <= maxError);
+
+  // the dual quaternion palettes of the hardware meshes describe the same
+  // transforms as their matrix palettes
+  float paletteError;
+  paletteError = 0.0f;
+
+  HardwareSkinning hardwareSkinning;
+  if(hardwareSkinning.onInit(pCalModel, maxBonesPerMesh, HardwareSkinning::INFLUENCE_COUNT))
+  {
+    hardwareSkinning.updatePaletteMatrices();
+
+    std::vector<float> vectorPaletteMatrix(maxBonesPerMesh * HardwareSkinning::PALETTE_MATRIX_SIZE);
+    std::vector<float> vectorPaletteDualQuaternion(maxBonesPerMesh * Skinning::DUAL_QUATERNION_SIZE);
+
+    int hardwareMeshId;
+    for(hardwareMeshId = 0; hardwareMeshId < hardwareSkinning.getHardwareMeshCount(); hardwareMeshId++)
+    {
+      int paletteBoneCount;
+      paletteBoneCount = hardwareSkinning.getPaletteMatrices(hardwareMeshId, &vectorPaletteMatrix[0]);
+      hardwareSkinning.getPaletteDualQuaternions(hardwareMeshId, &vectorPaletteDualQuaternion[0]);
+
+      int paletteBoneId;
+      for(paletteBoneId = 0; paletteBoneId < paletteBoneCount; paletteBoneId++)
+      {
+        const float *m = &vectorPaletteMatrix[paletteBoneId * HardwareSkinning::PALETTE_MATRIX_SIZE];
+        const float *q = &vectorPaletteDualQuaternion[paletteBoneId * Skinning::DUAL_QUATERNION_SIZE];
+
+        // transform a point at the scale of the model with both
+        float px, py, pz;
+        px = 0.5f * extent;
+        py = -0.25f * extent;
+        pz = 0.75f * extent;
+
+        float ax, ay, az;
+        ax = q[1] * pz - q[2] * py + q[3] * px;
+        ay = q[2] * px - q[0] * pz + q[3] * py;
+        az = q[0] * py - q[1] * px + q[3] * pz;
+
+        float point[3];
+        point[0] = px + 2.0f * (q[1] * az - q[2] * ay) + 2.0f * (q[3] * q[4] - q[7] * q[0] + q[1] * q[6] - q[2] * q[5]);
+        point[1] = py + 2.0f * (q[2] * ax - q[0] * az) + 2.0f * (q[3] * q[5] - q[7] * q[1] + q[2] * q[4] - q[0] * q[6]);
+        point[2] = pz + 2.0f * (q[0] * ay - q[1] * ax) + 2.0f * (q[3] * q[6] - q[7] * q[2] + q[0] * q[5] - q[1] * q[4]);
+
+        int rowId;
+        for(rowId = 0; rowId < 3; rowId++)
+        {
+          float reference;
+          reference = m[rowId * 4] * px + m[rowId * 4 + 1] * py + m[rowId * 4 + 2] * pz + m[rowId * 4 + 3];
+          if(fabs(point[rowId] - reference) > paletteError) paletteError = fabs(point[rowId] - reference);
+        }
+      }
+    }
+
+    if(paletteError > maxError * extent) bSuccess = false;
+  }
+
+  // time both methods on the selected path
+  float time[Skinning::METHOD_COUNT];
+
+  std::vector<float> vectorVertex;
+  std::vector<float> vectorNormal;
+
+  unsigned int submeshId;
+  for(submeshId = 0; submeshId < vectorSubmesh.size(); submeshId++)
+  {
+    if(vectorSubmesh[submeshId]->getVertexCount() * 3 > (int)vectorVertex.size())
+    {
+      vectorVertex.resize(vectorSubmesh[submeshId]->getVertexCount() * 3);
+      vectorNormal.resize(vectorSubmesh[submeshId]->getVertexCount() * 3);
+    }
+  }
+
+  int method;
+  for(method = 0; method < Skinning::METHOD_COUNT; method++)
+  {
+    const float *pBoneTransform;
+    pBoneTransform = (method == Skinning::METHOD_DUAL_QUATERNION) ? &vectorDualQuaternion[0] : &vectorBoneMatrix[0];
+
+    Timer timer;
+
+    int iteration;
+    for(iteration = 0; iteration < iterationCount; iteration++)
+    {
+      // the dual quaternions are built every frame from the bone matrices
+      if(method == Skinning::METHOD_DUAL_QUATERNION) Skinning::calculateDualQuaternions(&vectorBoneMatrix[0], boneCount, &vectorDualQuaternion[0]);
+
+      for(submeshId = 0; submeshId < vectorSubmesh.size(); submeshId++)
+      {
+        if(vectorVertex.empty()) break;
+        Skinning::calculateVerticesAndNormals(vectorSubmesh[submeshId], vectorSkinStream[submeshId], pBoneTransform, &vectorVertex[0], &vectorNormal[0], 0, 0, (Skinning::Method)method);
+      }
+    }
+
+    time[method] = timer.getTime() / iterationCount;
+  }
+
+  LOG("Model #%d dual quaternion skinning (%s): linear %.3f ms, dual quaternion %.3f ms, %d rigid vertices error %g, path error %g, normal length error %g, palette error %g %s", modelId,
+    Skinning::getPathName(Skinning::getPath()), time[Skinning::METHOD_LINEAR], time[Skinning::METHOD_DUAL_QUATERNION], rigidVertexCount, rigidError, pathError, normalLengthError, paletteError, getResultName(bSuccess));
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Twist a ring of vertices bound half and half to two bones, linear blending //
+// collapses it, dual quaternions have to keep its radius                     //
+//----------------------------------------------------------------------------//
+
+bool Bench::runDualQuaternionTwist()
+{
+  const int vertexCount = 8;
+  const float twistAngle = 170.0f * 3.14159265f / 180.0f;
+  const float maxError = 1e-4f;
+
+  // a ring around the x axis, the twist axis of the second bone
+  CalCoreSubmesh coreSubmesh;
+  coreSubmesh.reserve(vertexCount, 0, 0, 0);
+
+  int vertexId;
+  for(vertexId = 0; vertexId < vertexCount; vertexId++)
+  {
+    float angle;
+    angle = 2.0f * 3.14159265f * vertexId / vertexCount;
+
+    CalCoreSubmesh::Vertex vertex;
+    vertex.position.set(0.0f, cos(angle), sin(angle));
+    vertex.normal.set(0.0f, cos(angle), sin(angle));
+    vertex.collapseId = -1;
+    vertex.faceCollapseCount = 0;
+
+    CalCoreSubmesh::Influence influence;
+    influence.boneId = 0;
+    influence.weight = 0.5f;
+    vertex.vectorInfluence.push_back(influence);
+    influence.boneId = 1;
+    vertex.vectorInfluence.push_back(influence);
+
+    coreSubmesh.setVertex(vertexId, vertex);
+  }
+
+  SkinStream skinStream;
+  if(!skinStream.create(&coreSubmesh)) return false;
+
+  CalSubmesh submesh(&coreSubmesh);
+
+  // the first bone stays in place, the second one twists around x
+  float boneMatrix[2 * 12] =
+  {
+    1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,
+    1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f
+  };
+  boneMatrix[12 + 5] = cos(twistAngle);
+  boneMatrix[12 + 6] = -sin(twistAngle);
+  boneMatrix[12 + 9] = sin(twistAngle);
+  boneMatrix[12 + 10] = cos(twistAngle);
+
+  float dualQuaternion[2 * 8];
+  Skinning::calculateDualQuaternions(boneMatrix, 2, dualQuaternion);
+
+  std::vector<float> vectorVertex(vertexCount * 3);
+  std::vector<float> vectorNormal(vertexCount * 3);
+
+  bool bSuccess;
+  bSuccess = true;
+
+  Skinning::Path previousPath;
+  previousPath = Skinning::getPath();
+
+  int path;
+  for(path = Skinning::PATH_SCALAR; path < Skinning::PATH_COUNT; path++)
+  {
+    if(!Skinning::setPath((Skinning::Path)path)) continue;
+
+    float radius[Skinning::METHOD_COUNT];
+    float error;
+    error = 0.0f;
+
+    int method;
+    for(method = 0; method < Skinning::METHOD_COUNT; method++)
+    {
+      Skinning::calculateVerticesAndNormals(&submesh, &skinStream, (method == Skinning::METHOD_DUAL_QUATERNION) ? dualQuaternion : boneMatrix, &vectorVertex[0], &vectorNormal[0], 0, 0, (Skinning::Method)method);
+
+      radius[method] = 1.0f;
+
+      for(vertexId = 0; vertexId < vertexCount; vertexId++)
+      {
+        float x, y, z;
+        x = vectorVertex[vertexId * 3];
+        y = vectorVertex[vertexId * 3 + 1];
+        z = vectorVertex[vertexId * 3 + 2];
+
+        float vertexRadius;
+        vertexRadius = sqrt(y * y + z * z);
+        if(vertexRadius < radius[method]) radius[method] = vertexRadius;
+
+        // halfway between both bones is half the twist
+        if(method == Skinning::METHOD_DUAL_QUATERNION)
+        {
+          float angle;
+          angle = 2.0f * 3.14159265f * vertexId / vertexCount + 0.5f * twistAngle;
+
+          if(fabs(x) > error) error = fabs(x);
+          if(fabs(y - cos(angle)) > error) error = fabs(y - cos(angle));
+          if(fabs(z - sin(angle)) > error) error = fabs(z - sin(angle));
+          if(fabs(vectorNormal[vertexId * 3 + 1] - cos(angle)) > error) error = fabs(vectorNormal[vertexId * 3 + 1] - cos(angle));
+          if(fabs(vectorNormal[vertexId * 3 + 2] - sin(angle)) > error) error = fabs(vectorNormal[vertexId * 3 + 2] - sin(angle));
+        }
+      }
+    }
+
+    bool bMatch;
+    bMatch = (error <= maxError);
+    if(!bMatch) bSuccess = false;
+
+    LOG("Dual quaternion twist %s: radius linear %.3f, dual quaternion %.3f, max error %g %s", Skinning::getPathName((Skinning::Path)path), radius[Skinning::METHOD_LINEAR], radius[Skinning::METHOD_DUAL_QUATERNION], error, getResultName(bMatch));
+  }
+
+  Skinning::setPath(previousPath);
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Compare the memory used by the skin streams against the core submeshes     //
+//----------------------------------------------------------------------------//
+
+void Bench::runSkinStreamMemory(Model *pModel, int modelId)
+{
+  CalCoreModel *pCoreModel;
+  pCoreModel = pModel->getCalModel()->getCoreModel();
+
+  CoreModelData *pCoreModelData;
+  pCoreModelData = CoreModelData::get(pCoreModel);
+  if(pCoreModelData == 0) return;
+
+  int totalCoreSubmeshSize;
+  totalCoreSubmeshSize = 0;
+  int totalSkinStreamSize;
+  totalSkinStreamSize = 0;
+
+  int coreMeshId;
+  for(coreMeshId = 0; coreMeshId < pCoreModel->getCoreMeshCount(); coreMeshId++)
+  {
+    CalCoreMesh *pCoreMesh;
+    pCoreMesh = pCoreModel->getCoreMesh(coreMeshId);
+
+    int coreSubmeshSize;
+    coreSubmeshSize = 0;
+    int skinStreamSize;
+    skinStreamSize = 0;
+    int truncatedVertexCount;
+    truncatedVertexCount = 0;
+
+    int coreSubmeshId;
+    for(coreSubmeshId = 0; coreSubmeshId < pCoreMesh->getCoreSubmeshCount(); coreSubmeshId++)
+    {
+      CalCoreSubmesh *pCoreSubmesh;
+      pCoreSubmesh = pCoreMesh->getCoreSubmesh(coreSubmeshId);
+
+      const SkinStream *pSkinStream;
+      pSkinStream = pCoreModelData->getSkinStream(pCoreSubmesh);
+      if(pSkinStream == 0) continue;
+
+      coreSubmeshSize += SkinStream::getCoreSubmeshMemorySize(pCoreSubmesh);
+      skinStreamSize += pSkinStream->getMemorySize();
+      truncatedVertexCount += pSkinStream->getTruncatedVertexCount();
+    }
+
+    LOG("Model #%d skin data '%s': %d bytes -> %d bytes, %d vertices truncated to %d influences", modelId, pCoreMesh->getFilename().c_str(),
+      coreSubmeshSize, skinStreamSize, truncatedVertexCount, SkinStream::INFLUENCE_COUNT);
+
+    totalCoreSubmeshSize += coreSubmeshSize;
+    totalSkinStreamSize += skinStreamSize;
+  }
+
+  LOG("Model #%d skin data total: %d bytes -> %d bytes", modelId, totalCoreSubmeshSize, totalSkinStreamSize);
+}
+
+//----------------------------------------------------------------------------//
+// Compare the bytes renderMesh copies per frame with and without the         //
+// persistent texture coordinates and faces                                   //
+//----------------------------------------------------------------------------//
+
+void Bench::runRenderData(Model *pModel, int modelId)
+{
+  // the static arrays renderMesh used to fill every frame
+  const int staticVertexCount = 30000;
+  const int staticFaceCount = 50000;
+
+  CalRenderer *pCalRenderer;
+  pCalRenderer = pModel->getCalModel()->getRenderer();
+
+  int copyBytesBefore;
+  copyBytesBefore = 0;
+  int copyBytesAfter;
+  copyBytesAfter = 0;
+
+  int meshId;
+  for(meshId = 0; meshId < pCalRenderer->getMeshCount(); meshId++)
+  {
+    int submeshId;
+    for(submeshId = 0; submeshId < pCalRenderer->getSubmeshCount(meshId); submeshId++)
+    {
+      if(!pCalRenderer->selectMeshSubmesh(meshId, submeshId)) continue;
+
+      int vertexCount;
+      vertexCount = pCalRenderer->getVertexCount();
+      int faceCount;
+      faceCount = pCalRenderer->getFaceCount();
+
+      // vertices and normals still change every frame
+      int dynamicBytes;
+      dynamicBytes = vertexCount * 6 * sizeof(float);
+
+      copyBytesBefore += dynamicBytes + vertexCount * 2 * sizeof(float) + faceCount * 3 * sizeof(CalIndex);
+      copyBytesAfter += dynamicBytes;
+    }
+  }
+
+  int staticBytes;
+  staticBytes = staticVertexCount * 2 * sizeof(float) + staticFaceCount * 3 * sizeof(CalIndex);
+
+  LOG("Model #%d render data: %d -> %d bytes copied per frame, %d bytes of static arrays -> %d bytes of submesh buffers", modelId, copyBytesBefore, copyBytesAfter, staticBytes, pModel->getRenderDataByteSize());
+}
+
+//----------------------------------------------------------------------------//
+// Compare the three pass output of separate arrays against one interleaved   //
+// stream, through CalRenderer and through the model pipeline                 //
+//----------------------------------------------------------------------------//
+
+bool Bench::runVertexLayout(Model *pModel, int modelId)
+{
+  const int frameCount = 100;
+  const float maxError = 1e-5f;
+
+  ModelPipeline *pModelPipeline;
+  pModelPipeline = pModel->getModelPipeline();
+
+  ModelPipeline::VertexLayout vertexLayout;
+  vertexLayout = pModelPipeline->getVertexLayout();
+
+  // both layouts of the pipeline have to hold the same vertices
+  std::vector<float> vectorSeparate;
+  pModelPipeline->setVertexLayout(ModelPipeline::getSeparateLayout());
+  pModelPipeline->runStage(ModelPipeline::STAGE_SKIN, 0.0f);
+  readVertexStream(pModelPipeline, vectorSeparate);
+
+  std::vector<float> vectorInterleaved;
+  pModelPipeline->setVertexLayout(ModelPipeline::getInterleavedLayout());
+  pModelPipeline->runStage(ModelPipeline::STAGE_SKIN, 0.0f);
+  readVertexStream(pModelPipeline, vectorInterleaved);
+
+  // the error is relative to the size of the model
+  float extent;
+  extent = 1.0f;
+  float error;
+  error = (vectorSeparate.size() == vectorInterleaved.size()) ? 0.0f : 1.0f;
+
+  unsigned int valueId;
+  for(valueId = 0; (valueId < vectorSeparate.size()) && (vectorSeparate.size() == vectorInterleaved.size()); valueId++)
+  {
+    if(fabs(vectorSeparate[valueId]) > extent) extent = fabs(vectorSeparate[valueId]);
+    if(fabs(vectorSeparate[valueId] - vectorInterleaved[valueId]) > error) error = fabs(vectorSeparate[valueId] - vectorInterleaved[valueId]);
+  }
+
+  bool bSuccess;
+  bSuccess = (error <= maxError * extent);
+
+  // time the calls the demo used to make against the single pass of cal3d
+  CalRenderer *pCalRenderer;
+  pCalRenderer = pModel->getCalModel()->getRenderer();
+
+  int maxVertexCount;
+  maxVertexCount = 0;
+
+  int meshId;
+  int submeshId;
+  for(meshId = 0; meshId < pCalRenderer->getMeshCount(); meshId++)
+  {
+    for(submeshId = 0; submeshId < pCalRenderer->getSubmeshCount(meshId); submeshId++)
+    {
+      if(pCalRenderer->selectMeshSubmesh(meshId, submeshId) && (pCalRenderer->getVertexCount() > maxVertexCount)) maxVertexCount = pCalRenderer->getVertexCount();
+    }
+  }
+
+  std::vector<float> vectorVertex(maxVertexCount * 3 + 1);
+  std::vector<float> vectorNormal(maxVertexCount * 3 + 1);
+  std::vector<float> vectorTextureCoordinate(maxVertexCount * 2 + 1);
+  std::vector<float> vectorStream(maxVertexCount * 8 + 1);
+
+  Timer timer;
+
+  int frameId;
+  for(frameId = 0; frameId < frameCount; frameId++)
+  {
+    for(meshId = 0; meshId < pCalRenderer->getMeshCount(); meshId++)
+    {
+      for(submeshId = 0; submeshId < pCalRenderer->getSubmeshCount(meshId); submeshId++)
+      {
+        if(!pCalRenderer->selectMeshSubmesh(meshId, submeshId)) continue;
+
+        pCalRenderer->getVertices(&vectorVertex[0]);
+        pCalRenderer->getNormals(&vectorNormal[0]);
+        pCalRenderer->getTextureCoordinates(0, &vectorTextureCoordinate[0]);
+      }
+    }
+  }
+
+  float rendererThreePassTime;
+  rendererThreePassTime = timer.getTime() / frameCount;
+
+  timer.start();
+
+  for(frameId = 0; frameId < frameCount; frameId++)
+  {
+    for(meshId = 0; meshId < pCalRenderer->getMeshCount(); meshId++)
+    {
+      for(submeshId = 0; submeshId < pCalRenderer->getSubmeshCount(meshId); submeshId++)
+      {
+        if(!pCalRenderer->selectMeshSubmesh(meshId, submeshId)) continue;
+
+        pCalRenderer->getVerticesNormalsAndTexCoords(&vectorStream[0], 1);
+      }
+    }
+  }
+
+  float rendererOnePassTime;
+  rendererOnePassTime = timer.getTime() / frameCount;
+
+  // the skin stage of the pipeline in both layouts
+  float pipelineTime[2];
+
+  int layoutId;
+  for(layoutId = 0; layoutId < 2; layoutId++)
+  {
+    pModelPipeline->setVertexLayout((layoutId == 0) ? ModelPipeline::getSeparateLayout() : ModelPipeline::getInterleavedLayout());
+
+    timer.start();
+
+    for(frameId = 0; frameId < frameCount; frameId++)
+    {
+      pModelPipeline->setDirty(ModelPipeline::DIRTY_SKIN);
+      pModelPipeline->runStage(ModelPipeline::STAGE_SKIN, 0.0f);
+    }
+
+    pipelineTime[layoutId] = timer.getTime() / frameCount;
+  }
+
+  pModelPipeline->setVertexLayout(vertexLayout);
+  pModelPipeline->runStage(ModelPipeline::STAGE_SKIN, 0.0f);
+
+  LOG("Model #%d vertex layout: renderer three pass %.3f ms, one pass %.3f ms, pipeline (%s) separate %.3f ms, interleaved %.3f ms, max error %g %s", modelId,
+    rendererThreePassTime, rendererOnePassTime, Skinning::getPathName(Skinning::getPath()), pipelineTime[0], pipelineTime[1], error, getResultName(bSuccess));
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Compare the cpu reference of the matrix palette against CalPhysique, the   //
+// hardware meshes are built without a context                                //
+//----------------------------------------------------------------------------//
+
+bool Bench::runHardwareSkinning(Model *pModel, int modelId)
+{
+  const int frameCount = 100;
+  const int maxBonesPerMesh = 32;
+  const float maxError = 1e-4f;
+
+  CalModel *pCalModel;
+  pCalModel = pModel->getCalModel();
+
+  HardwareSkinning hardwareSkinning;
+  if(!hardwareSkinning.onInit(pCalModel, maxBonesPerMesh, HardwareSkinning::INFLUENCE_COUNT))
+  {
+    LOG("Model #%d hardware skinning: FAILED to build the hardware meshes", modelId);
+    return false;
+  }
+
+  hardwareSkinning.updatePaletteMatrices();
+
+  CalHardwareModel *pHardwareModel;
+  pHardwareModel = hardwareSkinning.getHardwareModel();
+
+  std::vector<CalHardwareModel::CalHardwareMesh>& vectorHardwareMesh = pHardwareModel->getVectorHardwareMesh();
+
+  int maxVertexCount;
+  maxVertexCount = 0;
+
+  unsigned int hardwareMeshId;
+  for(hardwareMeshId = 0; hardwareMeshId < vectorHardwareMesh.size(); hardwareMeshId++)
+  {
+    if(vectorHardwareMesh[hardwareMeshId].vertexCount > maxVertexCount) maxVertexCount = vectorHardwareMesh[hardwareMeshId].vertexCount;
+  }
+
+  std::vector<float> vectorHardwareVertex(maxVertexCount * 3 + 1);
+  std::vector<float> vectorHardwareNormal(maxVertexCount * 3 + 1);
+
+  const std::vector<CalIndex>& vectorIndex = hardwareSkinning.getIndices();
+
+  std::vector<float> vectorVertex;
+  std::vector<float> vectorNormal;
+
+  float extent;
+  extent = 1.0f;
+  float error;
+  error = 0.0f;
+  int skippedCount;
+  skippedCount = 0;
+
+  // the hardware meshes of a submesh hold its faces in order, each face
+  // corner maps a hardware vertex back to a vertex of the core submesh
+  int lastMeshId, lastSubmeshId, faceId;
+  lastMeshId = -1;
+  lastSubmeshId = -1;
+  faceId = 0;
+
+  int vertexCount;
+  vertexCount = 0;
+
+  for(hardwareMeshId = 0; hardwareMeshId < vectorHardwareMesh.size(); hardwareMeshId++)
+  {
+    const CalHardwareModel::CalHardwareMesh& hardwareMesh = vectorHardwareMesh[hardwareMeshId];
+
+    CalSubmesh *pSubmesh;
+    pSubmesh = pCalModel->getMesh(hardwareMesh.meshId)->getSubmesh(hardwareMesh.submeshId);
+
+    CalCoreSubmesh *pCoreSubmesh;
+    pCoreSubmesh = pSubmesh->getCoreSubmesh();
+
+    if((hardwareMesh.meshId != lastMeshId) || (hardwareMesh.submeshId != lastSubmeshId))
+    {
+      lastMeshId = hardwareMesh.meshId;
+      lastSubmeshId = hardwareMesh.submeshId;
+      faceId = 0;
+
+      vertexCount = pSubmesh->getVertexCount();
+      vectorVertex.resize(vertexCount * 3 + 1);
+      vectorNormal.resize(vertexCount * 3 + 1);
+
+      pCalModel->getPhysique()->calculateVertices(pSubmesh, &vectorVertex[0]);
+      pCalModel->getPhysique()->calculateNormals(pSubmesh, &vectorNormal[0]);
+    }
+
+    hardwareSkinning.calculateVertices(hardwareMeshId, &vectorHardwareVertex[0], &vectorHardwareNormal[0]);
+
+    std::vector<CalCoreSubmesh::Face>& vectorFace = pCoreSubmesh->getVectorFace();
+    std::vector<CalCoreSubmesh::Vertex>& vectorCoreVertex = pCoreSubmesh->getVectorVertex();
+
+    int hardwareFaceId;
+    for(hardwareFaceId = 0; hardwareFaceId < hardwareMesh.faceCount; hardwareFaceId++, faceId++)
+    {
+      int cornerId;
+      for(cornerId = 0; cornerId < 3; cornerId++)
+      {
+        int vertexId;
+        vertexId = vectorFace[faceId].vertexId[cornerId];
+        int hardwareVertexId;
+        hardwareVertexId = vectorIndex[(hardwareMesh.startIndex + hardwareFaceId) * 3 + cornerId];
+
+        // the palette only blends the first influences of a vertex
+        if((vertexId >= vertexCount) || ((int)vectorCoreVertex[vertexId].vectorInfluence.size() > hardwareSkinning.getInfluenceCount()))
+        {
+          skippedCount++;
+          continue;
+        }
+
+        int coordinateId;
+        for(coordinateId = 0; coordinateId < 3; coordinateId++)
+        {
+          float value;
+          value = vectorVertex[vertexId * 3 + coordinateId];
+          if(fabs(value) > extent) extent = fabs(value);
+
+          float vertexError;
+          vertexError = fabs(value - vectorHardwareVertex[hardwareVertexId * 3 + coordinateId]);
+          float normalError;
+          normalError = fabs(vectorNormal[vertexId * 3 + coordinateId] - vectorHardwareNormal[hardwareVertexId * 3 + coordinateId]);
+
+          if(vertexError > error) error = vertexError;
+          if(normalError > error) error = normalError;
+        }
+      }
+    }
+  }
+
+  bool bSuccess;
+  bSuccess = (error <= maxError * extent);
+
+  // the packed palettes have to match the per bone queries of cal3d
+  std::vector<float> vectorPalette(maxBonesPerMesh * HardwareSkinning::PALETTE_MATRIX_SIZE);
+  std::vector<float> vectorReferencePalette(maxBonesPerMesh * HardwareSkinning::PALETTE_MATRIX_SIZE);
+
+  float paletteError;
+  paletteError = 0.0f;
+
+  for(hardwareMeshId = 0; hardwareMeshId < vectorHardwareMesh.size(); hardwareMeshId++)
+  {
+    int boneCount;
+    boneCount = hardwareSkinning.getPaletteMatrices(hardwareMeshId, &vectorPalette[0]);
+    getPaletteMatrices(pHardwareModel, pCalModel->getSkeleton(), hardwareMeshId, &vectorReferencePalette[0]);
+
+    int valueId;
+    for(valueId = 0; valueId < boneCount * HardwareSkinning::PALETTE_MATRIX_SIZE; valueId++)
+    {
+      if(fabs(vectorPalette[valueId] - vectorReferencePalette[valueId]) > paletteError) paletteError = fabs(vectorPalette[valueId] - vectorReferencePalette[valueId]);
+    }
+  }
+
+  if(paletteError > maxError * extent) bSuccess = false;
+
+  // the palettes of all hardware meshes per frame, queried bone by bone
+  // against the bulk update
+  Timer timer;
+
+  int frameId;
+  for(frameId = 0; frameId < frameCount; frameId++)
+  {
+    for(hardwareMeshId = 0; hardwareMeshId < vectorHardwareMesh.size(); hardwareMeshId++)
+    {
+      getPaletteMatrices(pHardwareModel, pCalModel->getSkeleton(), hardwareMeshId, &vectorReferencePalette[0]);
+    }
+  }
+
+  float boneQueryTime;
+  boneQueryTime = timer.getTime() / frameCount;
+
+  // the cpu work per frame, the palettes against the skin stage
+  timer.start();
+
+  for(frameId = 0; frameId < frameCount; frameId++)
+  {
+    hardwareSkinning.updatePaletteMatrices();
+  }
+
+  float paletteTime;
+  paletteTime = timer.getTime() / frameCount;
+
+  ModelPipeline *pModelPipeline;
+  pModelPipeline = pModel->getModelPipeline();
+
+  timer.start();
+
+  for(frameId = 0; frameId < frameCount; frameId++)
+  {
+    pModelPipeline->setDirty(ModelPipeline::DIRTY_SKIN);
+    pModelPipeline->runStage(ModelPipeline::STAGE_SKIN, 0.0f);
+  }
+
+  float skinTime;
+  skinTime = timer.getTime() / frameCount;
+
+  LOG("Model #%d hardware skinning: %d hardware meshes, %d bytes static, palettes %.3f ms (per bone queries %.3f ms) vs cpu skinning %.3f ms, %d corners skipped, max error %g, palette error %g %s", modelId,
+    hardwareSkinning.getHardwareMeshCount(), hardwareSkinning.getByteSize(), paletteTime, boneQueryTime, skinTime, skippedCount, error, paletteError, getResultName(bSuccess));
+
+  return bSuccess;
+}
+
+//----------------------------------------------------------------------------//
+// Build the palette of a hardware mesh through the per bone queries of       //
+// CalHardwareModel, the reference of the packed palettes                     //
+//----------------------------------------------------------------------------//
+
+void Bench::getPaletteMatrices(CalHardwareModel *pHardwareModel, CalSkeleton *pSkeleton, int hardwareMeshId, float *pPaletteBuffer)
+{
+  pHardwareModel->selectHardwareMesh(hardwareMeshId);
+
+  int boneId;
+  for(boneId = 0; boneId < pHardwareModel->getBoneCount(); boneId++)
+  {
+    CalMatrix matrix(pHardwareModel->getRotationBoneSpace(boneId, pSkeleton));
+    const CalVector& translation = pHardwareModel->getTranslationBoneSpace(boneId, pSkeleton);
+
+    float *pMatrix = &pPaletteBuffer[boneId * HardwareSkinning::PALETTE_MATRIX_SIZE];
+    pMatrix[0] = matrix.dxdx; pMatrix[1] = matrix.dxdy; pMatrix[2] = matrix.dxdz; pMatrix[3] = translation.x;
+    pMatrix[4] = matrix.dydx; pMatrix[5] = matrix.dydy; pMatrix[6] = matrix.dydz; pMatrix[7] = translation.y;
+    pMatrix[8] = matrix.dzdx; pMatrix[9] = matrix.dzdy; pMatrix[10] = matrix.dzdz; pMatrix[11] = translation.z;
+  }
+}
+
+//----------------------------------------------------------------------------//
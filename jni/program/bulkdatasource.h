@@ -0,0 +1,66 @@
+//----------------------------------------------------------------------------//
+// bulkdatasource.h                                                           //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef BULKDATASOURCE_H
+#define BULKDATASOURCE_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+// a data source that also reads whole arrays of little endian values with a
+// single call, used by the fast loader
+class BulkDataSource : public CalDataSource
+{
+// member functions
+public:
+  virtual int getRemainingSize() const = 0;
+  virtual bool readFloatArray(float *pValue, int count) = 0;
+  virtual bool readIntegerArray(int *pValue, int count) = 0;
+
+  // check a count read from the file before it sizes an array, the elements
+  // have to fit into the bytes left so the byte count cannot overflow
+  bool isArrayAvailable(int count, int elementSize) const
+  {
+    return (count >= 0) && (count <= getRemainingSize() / elementSize);
+  }
+
+  // convert 32 bit little endian values in place
+  static void swapArray(void *pValue, int count)
+  {
+#ifdef CAL3D_BIG_ENDIAN
+    unsigned char *pByte = (unsigned char *)pValue;
+
+    int i;
+    for(i = 0; i < count; i++, pByte += 4)
+    {
+      unsigned char byte;
+      byte = pByte[0];
+      pByte[0] = pByte[3];
+      pByte[3] = byte;
+      byte = pByte[1];
+      pByte[1] = pByte[2];
+      pByte[2] = byte;
+    }
+#else
+    (void)pValue;
+    (void)count;
+#endif
+  }
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,164 @@
+//----------------------------------------------------------------------------//
+// bulkstreamsource.cpp                                                       //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "bulkstreamsource.h"
+#include <limits.h>
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+BulkStreamSource::BulkStreamSource(std::istream& input)
+  : m_input(input)
+{
+  // the end is looked up once, a stream that cannot seek has no known size
+  m_endPosition = -1;
+
+  std::streampos position;
+  position = m_input.tellg();
+
+  if(position != std::streampos(-1))
+  {
+    m_input.seekg(0, std::ios::end);
+    m_endPosition = m_input.tellg();
+    m_input.seekg(position);
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+BulkStreamSource::~BulkStreamSource()
+{
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bytes left to read, as many as an int holds if the size  //
+// of the stream is unknown                                                   //
+//----------------------------------------------------------------------------//
+
+int BulkStreamSource::getRemainingSize() const
+{
+  if(m_endPosition == std::streampos(-1)) return INT_MAX;
+
+  std::streampos position;
+  position = m_input.tellg();
+  if(position == std::streampos(-1)) return 0;
+
+  std::streamoff remainingSize;
+  remainingSize = m_endPosition - position;
+  if(remainingSize < 0) return 0;
+
+  return (remainingSize > INT_MAX) ? INT_MAX : (int)remainingSize;
+}
+
+//----------------------------------------------------------------------------//
+// Check if all reads succeeded so far                                        //
+//----------------------------------------------------------------------------//
+
+bool BulkStreamSource::ok() const
+{
+  return !!m_input;
+}
+
+//----------------------------------------------------------------------------//
+// Read a number of bytes                                                     //
+//----------------------------------------------------------------------------//
+
+bool BulkStreamSource::readBytes(void *pBuffer, int length)
+{
+  return CalPlatform::readBytes(m_input, pBuffer, length);
+}
+
+//----------------------------------------------------------------------------//
+// Read a float                                                               //
+//----------------------------------------------------------------------------//
+
+bool BulkStreamSource::readFloat(float& value)
+{
+  return CalPlatform::readFloat(m_input, value);
+}
+
+//----------------------------------------------------------------------------//
+// Read an array of floats with a single stream read                          //
+//----------------------------------------------------------------------------//
+
+bool BulkStreamSource::readFloatArray(float *pValue, int count)
+{
+  if(count <= 0) return count == 0;
+
+  if(!isArrayAvailable(count, 4))
+  {
+    m_input.setstate(std::ios::failbit);
+    return false;
+  }
+
+  m_input.read((char *)pValue, count * 4);
+  if(!m_input) return false;
+
+  swapArray(pValue, count);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Read an integer                                                            //
+//----------------------------------------------------------------------------//
+
+bool BulkStreamSource::readInteger(int& value)
+{
+  return CalPlatform::readInteger(m_input, value);
+}
+
+//----------------------------------------------------------------------------//
+// Read an array of integers with a single stream read                        //
+//----------------------------------------------------------------------------//
+
+bool BulkStreamSource::readIntegerArray(int *pValue, int count)
+{
+  if(count <= 0) return count == 0;
+
+  if(!isArrayAvailable(count, 4))
+  {
+    m_input.setstate(std::ios::failbit);
+    return false;
+  }
+
+  m_input.read((char *)pValue, count * 4);
+  if(!m_input) return false;
+
+  swapArray(pValue, count);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Read a length prefixed string                                              //
+//----------------------------------------------------------------------------//
+
+bool BulkStreamSource::readString(std::string& strValue)
+{
+  return CalPlatform::readString(m_input, strValue);
+}
+
+//----------------------------------------------------------------------------//
+// Report a read error                                                        //
+//----------------------------------------------------------------------------//
+
+void BulkStreamSource::setError() const
+{
+  CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+}
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,52 @@
+//----------------------------------------------------------------------------//
+// bulkstreamsource.h                                                         //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef BULKSTREAMSOURCE_H
+#define BULKSTREAMSOURCE_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+#include "bulkdatasource.h"
+#include <iostream>
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+class BulkStreamSource : public BulkDataSource
+{
+// member variables
+protected:
+  std::istream& m_input;
+  std::streampos m_endPosition;
+
+// constructors/destructor
+public:
+  BulkStreamSource(std::istream& input);
+  virtual ~BulkStreamSource();
+
+// member functions
+public:
+  virtual int getRemainingSize() const;
+  virtual bool ok() const;
+  virtual bool readBytes(void *pBuffer, int length);
+  virtual bool readFloat(float& value);
+  virtual bool readFloatArray(float *pValue, int count);
+  virtual bool readInteger(int& value);
+  virtual bool readIntegerArray(int *pValue, int count);
+  virtual bool readString(std::string& strValue);
+  virtual void setError() const;
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
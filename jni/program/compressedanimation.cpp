@@ -0,0 +1,714 @@
+//----------------------------------------------------------------------------//
+// compressedanimation.cpp                                                    //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "compressedanimation.h"
+#include "bulkstreamsource.h"
+#include "keyframereducer.h"
+#include "cal3d/coretrack.h"
+#include "cal3d/corekeyframe.h"
+#include <fstream>
+#include <math.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------//
+// Static member variables initialization                                     //
+//----------------------------------------------------------------------------//
+
+const char CompressedAnimation::FILE_MAGIC[4] = { 'C', 'C', 'A', '\0' };
+const int CompressedAnimation::FILE_VERSION = 2;
+
+// the three smallest components of a unit quaternion lie in [-1/sqrt(2), 1/sqrt(2)]
+static const float SMALLEST_THREE_RANGE = 0.70710678f;
+static const float SMALLEST_THREE_STEPS = 32767.0f;
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+CompressedAnimation::CompressedAnimation()
+{
+  m_duration = 0.0f;
+  m_translationTolerance = 0.0f;
+  m_rotationTolerance = 0.0f;
+  m_maxTranslationError = 0.0f;
+  m_maxRotationError = 0.0f;
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+CompressedAnimation::~CompressedAnimation()
+{
+}
+
+//----------------------------------------------------------------------------//
+// Compress the rotation channel of a track                                   //
+//----------------------------------------------------------------------------//
+
+void CompressedAnimation::compressRotations(Track& track, const std::vector<CalQuaternion>& vectorRotation)
+{
+  int keyframeCount;
+  keyframeCount = (int)vectorRotation.size();
+
+  // drop the channel if all keyframes are close enough to the first one
+  float error;
+  error = 0.0f;
+
+  int keyframeId;
+  for(keyframeId = 1; keyframeId < keyframeCount; keyframeId++)
+  {
+    float keyframeError;
+    keyframeError = KeyframeReducer::getRotationError(vectorRotation[keyframeId], vectorRotation[0]);
+    if(keyframeError > error) error = keyframeError;
+  }
+
+  if(error <= m_rotationTolerance)
+  {
+    track.rotationChannel = CHANNEL_CONSTANT;
+    track.rotationId = (int)m_vectorFloat.size();
+    m_vectorFloat.push_back(vectorRotation[0].x);
+    m_vectorFloat.push_back(vectorRotation[0].y);
+    m_vectorFloat.push_back(vectorRotation[0].z);
+    m_vectorFloat.push_back(vectorRotation[0].w);
+
+    if(error > m_maxRotationError) m_maxRotationError = error;
+    return;
+  }
+
+  // quantize to 48 bit and check the error bound
+  std::vector<unsigned short> vectorShort(keyframeCount * 3);
+
+  error = 0.0f;
+  for(keyframeId = 0; keyframeId < keyframeCount; keyframeId++)
+  {
+    encodeRotation(vectorRotation[keyframeId], &vectorShort[keyframeId * 3]);
+
+    CalQuaternion rotation;
+    decodeRotation(&vectorShort[keyframeId * 3], rotation);
+
+    float keyframeError;
+    keyframeError = KeyframeReducer::getRotationError(rotation, vectorRotation[keyframeId]);
+    if(keyframeError > error) error = keyframeError;
+  }
+
+  if(error <= m_rotationTolerance)
+  {
+    track.rotationChannel = CHANNEL_QUANTIZED;
+    track.rotationId = (int)m_vectorShort.size();
+    m_vectorShort.insert(m_vectorShort.end(), vectorShort.begin(), vectorShort.end());
+
+    if(error > m_maxRotationError) m_maxRotationError = error;
+    return;
+  }
+
+  // keep the channel as it is
+  track.rotationChannel = CHANNEL_RAW;
+  track.rotationId = (int)m_vectorFloat.size();
+  for(keyframeId = 0; keyframeId < keyframeCount; keyframeId++)
+  {
+    m_vectorFloat.push_back(vectorRotation[keyframeId].x);
+    m_vectorFloat.push_back(vectorRotation[keyframeId].y);
+    m_vectorFloat.push_back(vectorRotation[keyframeId].z);
+    m_vectorFloat.push_back(vectorRotation[keyframeId].w);
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Compress the translation channel of a track                                //
+//----------------------------------------------------------------------------//
+
+void CompressedAnimation::compressTranslations(Track& track, const std::vector<CalVector>& vectorTranslation)
+{
+  int keyframeCount;
+  keyframeCount = (int)vectorTranslation.size();
+
+  CalVector minimum(vectorTranslation[0]);
+  CalVector maximum(vectorTranslation[0]);
+
+  int keyframeId;
+  for(keyframeId = 1; keyframeId < keyframeCount; keyframeId++)
+  {
+    int i;
+    for(i = 0; i < 3; i++)
+    {
+      if(vectorTranslation[keyframeId][i] < minimum[i]) minimum[i] = vectorTranslation[keyframeId][i];
+      if(vectorTranslation[keyframeId][i] > maximum[i]) maximum[i] = vectorTranslation[keyframeId][i];
+    }
+  }
+
+  // drop the channel if all keyframes are close enough to the center
+  CalVector center(minimum);
+  center.blend(0.5f, maximum);
+
+  float error;
+  error = 0.0f;
+
+  for(keyframeId = 0; keyframeId < keyframeCount; keyframeId++)
+  {
+    float keyframeError;
+    keyframeError = (vectorTranslation[keyframeId] - center).length();
+    if(keyframeError > error) error = keyframeError;
+  }
+
+  if(error <= m_translationTolerance)
+  {
+    track.translationChannel = CHANNEL_CONSTANT;
+    track.translationId = (int)m_vectorFloat.size();
+    m_vectorFloat.push_back(center.x);
+    m_vectorFloat.push_back(center.y);
+    m_vectorFloat.push_back(center.z);
+
+    if(error > m_maxTranslationError) m_maxTranslationError = error;
+    return;
+  }
+
+  // quantize to 16 bit over the range of the track and check the error bound
+  track.translationMin = minimum;
+  track.translationScale = (maximum - minimum) / 65535.0f;
+
+  std::vector<unsigned short> vectorShort(keyframeCount * 3);
+
+  error = 0.0f;
+  for(keyframeId = 0; keyframeId < keyframeCount; keyframeId++)
+  {
+    CalVector translation;
+
+    int i;
+    for(i = 0; i < 3; i++)
+    {
+      int quantized;
+      quantized = 0;
+      if(track.translationScale[i] > 0.0f) quantized = (int)((vectorTranslation[keyframeId][i] - minimum[i]) / track.translationScale[i] + 0.5f);
+      if(quantized > 65535) quantized = 65535;
+
+      vectorShort[keyframeId * 3 + i] = (unsigned short)quantized;
+      translation[i] = minimum[i] + quantized * track.translationScale[i];
+    }
+
+    float keyframeError;
+    keyframeError = (translation - vectorTranslation[keyframeId]).length();
+    if(keyframeError > error) error = keyframeError;
+  }
+
+  if(error <= m_translationTolerance)
+  {
+    track.translationChannel = CHANNEL_QUANTIZED;
+    track.translationId = (int)m_vectorShort.size();
+    m_vectorShort.insert(m_vectorShort.end(), vectorShort.begin(), vectorShort.end());
+
+    if(error > m_maxTranslationError) m_maxTranslationError = error;
+    return;
+  }
+
+  // keep the channel as it is
+  track.translationChannel = CHANNEL_RAW;
+  track.translationId = (int)m_vectorFloat.size();
+  for(keyframeId = 0; keyframeId < keyframeCount; keyframeId++)
+  {
+    m_vectorFloat.push_back(vectorTranslation[keyframeId].x);
+    m_vectorFloat.push_back(vectorTranslation[keyframeId].y);
+    m_vectorFloat.push_back(vectorTranslation[keyframeId].z);
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Compress all tracks of a core animation within the given error bounds, the //
+// translation error in model units and the rotation error in radians         //
+//----------------------------------------------------------------------------//
+
+bool CompressedAnimation::create(CalCoreAnimation *pCoreAnimation, float translationTolerance, float rotationTolerance)
+{
+  m_duration = pCoreAnimation->getDuration();
+  m_translationTolerance = translationTolerance;
+  m_rotationTolerance = rotationTolerance;
+  m_maxTranslationError = 0.0f;
+  m_maxRotationError = 0.0f;
+
+  m_vectorTrack.clear();
+  m_vectorTime.clear();
+  m_vectorFloat.clear();
+  m_vectorShort.clear();
+
+  // keep the core track list order, the mixer blends in that order
+  std::list<CalCoreTrack *>& listCoreTrack = pCoreAnimation->getListCoreTrack();
+
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+  {
+    CalCoreTrack *pCoreTrack;
+    pCoreTrack = *iteratorCoreTrack;
+
+    Track track;
+    track.coreBoneId = pCoreTrack->getCoreBoneId();
+    track.keyframeId = (int)m_vectorTime.size();
+    track.keyframeCount = pCoreTrack->getCoreKeyframeCount();
+    track.translationChannel = CHANNEL_CONSTANT;
+    track.translationId = 0;
+    track.rotationChannel = CHANNEL_CONSTANT;
+    track.rotationId = 0;
+
+    if(track.keyframeCount == 0)
+    {
+      m_vectorTrack.push_back(track);
+      continue;
+    }
+
+    std::vector<float> vectorTime(track.keyframeCount);
+    std::vector<CalVector> vectorTranslation(track.keyframeCount);
+    std::vector<CalQuaternion> vectorRotation(track.keyframeCount);
+
+    int keyframeId;
+    for(keyframeId = 0; keyframeId < track.keyframeCount; keyframeId++)
+    {
+      CalCoreKeyframe *pCoreKeyframe;
+      pCoreKeyframe = pCoreTrack->getCoreKeyframe(keyframeId);
+
+      vectorTime[keyframeId] = pCoreKeyframe->getTime();
+      vectorTranslation[keyframeId] = pCoreKeyframe->getTranslation();
+      vectorRotation[keyframeId] = pCoreKeyframe->getRotation();
+    }
+
+    compressTranslations(track, vectorTranslation);
+    compressRotations(track, vectorRotation);
+
+    // a track with two constant channels needs a single keyframe
+    if((track.translationChannel == CHANNEL_CONSTANT) && (track.rotationChannel == CHANNEL_CONSTANT)) track.keyframeCount = 1;
+
+    m_vectorTime.insert(m_vectorTime.end(), vectorTime.begin(), vectorTime.begin() + track.keyframeCount);
+    m_vectorTrack.push_back(track);
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Decode a 48 bit smallest-three rotation                                    //
+//----------------------------------------------------------------------------//
+
+void CompressedAnimation::decodeRotation(const unsigned short *pShort, CalQuaternion& rotation)
+{
+  // the index of the dropped largest component is stored in the top bits of
+  // the first two values
+  int largestId;
+  largestId = (pShort[0] >> 15) | ((pShort[1] >> 15) << 1);
+
+  float component[4];
+  float sum;
+  sum = 0.0f;
+
+  int i, j;
+  for(i = 0, j = 0; i < 4; i++)
+  {
+    if(i == largestId) continue;
+
+    component[i] = (pShort[j] & 0x7fff) * (2.0f * SMALLEST_THREE_RANGE / SMALLEST_THREE_STEPS) - SMALLEST_THREE_RANGE;
+    sum += component[i] * component[i];
+    j++;
+  }
+
+  component[largestId] = (sum < 1.0f) ? (float)sqrt(1.0f - sum) : 0.0f;
+
+  rotation = CalQuaternion(component[0], component[1], component[2], component[3]);
+}
+
+//----------------------------------------------------------------------------//
+// Encode a rotation as 48 bit smallest-three                                 //
+//----------------------------------------------------------------------------//
+
+void CompressedAnimation::encodeRotation(const CalQuaternion& rotation, unsigned short *pShort)
+{
+  float component[4];
+  component[0] = rotation.x;
+  component[1] = rotation.y;
+  component[2] = rotation.z;
+  component[3] = rotation.w;
+
+  int largestId;
+  largestId = 0;
+
+  int i, j;
+  for(i = 1; i < 4; i++)
+  {
+    if(fabs(component[i]) > fabs(component[largestId])) largestId = i;
+  }
+
+  // q and -q are the same rotation, so the dropped component is always positive
+  float sign;
+  sign = (component[largestId] < 0.0f) ? -1.0f : 1.0f;
+
+  for(i = 0, j = 0; i < 4; i++)
+  {
+    if(i == largestId) continue;
+
+    float value;
+    value = sign * component[i];
+    if(value < -SMALLEST_THREE_RANGE) value = -SMALLEST_THREE_RANGE;
+    if(value > SMALLEST_THREE_RANGE) value = SMALLEST_THREE_RANGE;
+
+    pShort[j] = (unsigned short)((value + SMALLEST_THREE_RANGE) * (SMALLEST_THREE_STEPS / (2.0f * SMALLEST_THREE_RANGE)) + 0.5f);
+    j++;
+  }
+
+  pShort[0] |= (unsigned short)((largestId & 1) << 15);
+  pShort[1] |= (unsigned short)((largestId >> 1) << 15);
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of translation and rotation channels stored a given way     //
+//----------------------------------------------------------------------------//
+
+int CompressedAnimation::getChannelCount(int channel) const
+{
+  int channelCount;
+  channelCount = 0;
+
+  unsigned int trackId;
+  for(trackId = 0; trackId < m_vectorTrack.size(); trackId++)
+  {
+    if(m_vectorTrack[trackId].keyframeCount == 0) continue;
+    if(m_vectorTrack[trackId].translationChannel == channel) channelCount++;
+    if(m_vectorTrack[trackId].rotationChannel == channel) channelCount++;
+  }
+
+  return channelCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the core bone id of a track                                            //
+//----------------------------------------------------------------------------//
+
+int CompressedAnimation::getCoreBoneId(int trackId) const
+{
+  return m_vectorTrack[trackId].coreBoneId;
+}
+
+//----------------------------------------------------------------------------//
+// Get the duration of the animation                                          //
+//----------------------------------------------------------------------------//
+
+float CompressedAnimation::getDuration() const
+{
+  return m_duration;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of keyframes of a track                                     //
+//----------------------------------------------------------------------------//
+
+int CompressedAnimation::getKeyframeCount(int trackId) const
+{
+  return m_vectorTrack[trackId].keyframeCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the largest rotation error of all keyframes                            //
+//----------------------------------------------------------------------------//
+
+float CompressedAnimation::getMaxRotationError() const
+{
+  return m_maxRotationError;
+}
+
+//----------------------------------------------------------------------------//
+// Get the largest translation error of all keyframes                         //
+//----------------------------------------------------------------------------//
+
+float CompressedAnimation::getMaxTranslationError() const
+{
+  return m_maxTranslationError;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bytes used by the compressed animation                   //
+//----------------------------------------------------------------------------//
+
+int CompressedAnimation::getMemorySize() const
+{
+  return sizeof(CompressedAnimation)
+    + m_vectorTrack.capacity() * sizeof(Track)
+    + m_vectorTime.capacity() * sizeof(float)
+    + m_vectorFloat.capacity() * sizeof(float)
+    + m_vectorShort.capacity() * sizeof(unsigned short);
+}
+
+//----------------------------------------------------------------------------//
+// Decode the rotation of a keyframe                                          //
+//----------------------------------------------------------------------------//
+
+void CompressedAnimation::getRotation(int trackId, int keyframeId, CalQuaternion& rotation) const
+{
+  const Track& track = m_vectorTrack[trackId];
+
+  if(track.rotationChannel == CHANNEL_QUANTIZED)
+  {
+    decodeRotation(&m_vectorShort[track.rotationId + keyframeId * 3], rotation);
+    return;
+  }
+
+  const float *pFloat = &m_vectorFloat[track.rotationId];
+  if(track.rotationChannel == CHANNEL_RAW) pFloat += keyframeId * 4;
+
+  rotation = CalQuaternion(pFloat[0], pFloat[1], pFloat[2], pFloat[3]);
+}
+
+//----------------------------------------------------------------------------//
+// Get the keyframe times of a track                                          //
+//----------------------------------------------------------------------------//
+
+const float *CompressedAnimation::getTimes(int trackId) const
+{
+  if(m_vectorTime.empty()) return 0;
+
+  return &m_vectorTime[0] + m_vectorTrack[trackId].keyframeId;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of tracks                                                   //
+//----------------------------------------------------------------------------//
+
+int CompressedAnimation::getTrackCount() const
+{
+  return (int)m_vectorTrack.size();
+}
+
+//----------------------------------------------------------------------------//
+// Decode the translation of a keyframe                                       //
+//----------------------------------------------------------------------------//
+
+void CompressedAnimation::getTranslation(int trackId, int keyframeId, CalVector& translation) const
+{
+  const Track& track = m_vectorTrack[trackId];
+
+  if(track.translationChannel == CHANNEL_QUANTIZED)
+  {
+    const unsigned short *pShort = &m_vectorShort[track.translationId + keyframeId * 3];
+    translation.x = track.translationMin.x + pShort[0] * track.translationScale.x;
+    translation.y = track.translationMin.y + pShort[1] * track.translationScale.y;
+    translation.z = track.translationMin.z + pShort[2] * track.translationScale.z;
+    return;
+  }
+
+  const float *pFloat = &m_vectorFloat[track.translationId];
+  if(track.translationChannel == CHANNEL_RAW) pFloat += keyframeId * 3;
+
+  translation = CalVector(pFloat[0], pFloat[1], pFloat[2]);
+}
+
+//----------------------------------------------------------------------------//
+// Load a compressed animation from a file                                    //
+//----------------------------------------------------------------------------//
+
+bool CompressedAnimation::load(const std::string& strFilename)
+{
+  std::ifstream file;
+  file.open(strFilename.c_str(), std::ios::in | std::ios::binary);
+  if(!file) return false;
+
+  return load(file);
+}
+
+//----------------------------------------------------------------------------//
+// Load a compressed animation from a stream                                  //
+//----------------------------------------------------------------------------//
+
+bool CompressedAnimation::load(std::istream& input)
+{
+  // check the magic and the version
+  char magic[4];
+  if(!CalPlatform::readBytes(input, magic, 4) || (memcmp(magic, FILE_MAGIC, 4) != 0)) return false;
+
+  int version;
+  if(!CalPlatform::readInteger(input, version) || (version != FILE_VERSION)) return false;
+
+  if(!CalPlatform::readFloat(input, m_duration)) return false;
+  if(!CalPlatform::readFloat(input, m_translationTolerance)) return false;
+  if(!CalPlatform::readFloat(input, m_rotationTolerance)) return false;
+  if(!CalPlatform::readFloat(input, m_maxTranslationError)) return false;
+  if(!CalPlatform::readFloat(input, m_maxRotationError)) return false;
+
+  // read the stream sizes first, so the tracks can be validated against them
+  int trackCount, timeCount, floatCount, shortCount;
+  if(!CalPlatform::readInteger(input, trackCount) || (trackCount < 0)) return false;
+  if(!CalPlatform::readInteger(input, timeCount) || (timeCount < 0)) return false;
+  if(!CalPlatform::readInteger(input, floatCount) || (floatCount < 0)) return false;
+  if(!CalPlatform::readInteger(input, shortCount) || (shortCount < 0)) return false;
+
+  // every count has to fit into the bytes left before it sizes an array, a
+  // track is stored as 13 integers and floats
+  const int trackSize = 13 * 4;
+
+  BulkStreamSource source(input);
+  if(!source.isArrayAvailable(trackCount, trackSize) || !source.isArrayAvailable(timeCount, 4)) return false;
+  if(!source.isArrayAvailable(floatCount, 4) || !source.isArrayAvailable(shortCount, 2)) return false;
+
+  m_vectorTrack.resize(trackCount);
+
+  int trackId;
+  for(trackId = 0; trackId < trackCount; trackId++)
+  {
+    Track& track = m_vectorTrack[trackId];
+
+    bool bRead;
+    bRead = CalPlatform::readInteger(input, track.coreBoneId)
+      && CalPlatform::readInteger(input, track.keyframeId)
+      && CalPlatform::readInteger(input, track.keyframeCount)
+      && CalPlatform::readInteger(input, track.translationChannel)
+      && CalPlatform::readInteger(input, track.translationId)
+      && CalPlatform::readFloat(input, track.translationMin.x)
+      && CalPlatform::readFloat(input, track.translationMin.y)
+      && CalPlatform::readFloat(input, track.translationMin.z)
+      && CalPlatform::readFloat(input, track.translationScale.x)
+      && CalPlatform::readFloat(input, track.translationScale.y)
+      && CalPlatform::readFloat(input, track.translationScale.z)
+      && CalPlatform::readInteger(input, track.rotationChannel)
+      && CalPlatform::readInteger(input, track.rotationId);
+    if(!bRead) return false;
+
+    // reject tracks that point outside of the streams, the keyframe count is
+    // at most the time count, so the sizes below cannot overflow
+    if((track.keyframeId < 0) || (track.keyframeCount < 0) || (track.keyframeCount > timeCount - track.keyframeId)) return false;
+    if(track.keyframeCount == 0) continue;
+
+    int translationSize, rotationSize;
+    switch(track.translationChannel)
+    {
+      case CHANNEL_CONSTANT: translationSize = 3; break;
+      case CHANNEL_QUANTIZED: translationSize = track.keyframeCount * 3; break;
+      case CHANNEL_RAW: translationSize = track.keyframeCount * 3; break;
+      default: return false;
+    }
+    switch(track.rotationChannel)
+    {
+      case CHANNEL_CONSTANT: rotationSize = 4; break;
+      case CHANNEL_QUANTIZED: rotationSize = track.keyframeCount * 3; break;
+      case CHANNEL_RAW: rotationSize = track.keyframeCount * 4; break;
+      default: return false;
+    }
+
+    int translationLimit, rotationLimit;
+    translationLimit = (track.translationChannel == CHANNEL_QUANTIZED) ? shortCount : floatCount;
+    rotationLimit = (track.rotationChannel == CHANNEL_QUANTIZED) ? shortCount : floatCount;
+    if((track.translationId < 0) || (translationSize > translationLimit - track.translationId)) return false;
+    if((track.rotationId < 0) || (rotationSize > rotationLimit - track.rotationId)) return false;
+  }
+
+  if(!source.isArrayAvailable(timeCount, 4)) return false;
+
+  m_vectorTime.resize(timeCount);
+  int timeId;
+  for(timeId = 0; timeId < timeCount; timeId++)
+  {
+    if(!CalPlatform::readFloat(input, m_vectorTime[timeId])) return false;
+  }
+
+  if(!source.isArrayAvailable(floatCount, 4)) return false;
+
+  m_vectorFloat.resize(floatCount);
+  int floatId;
+  for(floatId = 0; floatId < floatCount; floatId++)
+  {
+    if(!CalPlatform::readFloat(input, m_vectorFloat[floatId])) return false;
+  }
+
+  if(!source.isArrayAvailable(shortCount, 2)) return false;
+
+  // the quantized values are stored little endian, like all cal3d files
+  m_vectorShort.resize(shortCount);
+  int shortId;
+  for(shortId = 0; shortId < shortCount; shortId++)
+  {
+    unsigned char buffer[2];
+    if(!CalPlatform::readBytes(input, buffer, 2)) return false;
+    m_vectorShort[shortId] = (unsigned short)(buffer[0] | (buffer[1] << 8));
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Save the compressed animation to a file                                    //
+//----------------------------------------------------------------------------//
+
+bool CompressedAnimation::save(const std::string& strFilename) const
+{
+  std::ofstream file;
+  file.open(strFilename.c_str(), std::ios::out | std::ios::binary);
+  if(!file) return false;
+
+  return save(file);
+}
+
+//----------------------------------------------------------------------------//
+// Save the compressed animation to a stream                                  //
+//----------------------------------------------------------------------------//
+
+bool CompressedAnimation::save(std::ostream& output) const
+{
+  CalPlatform::writeBytes(output, FILE_MAGIC, 4);
+  CalPlatform::writeInteger(output, FILE_VERSION);
+
+  CalPlatform::writeFloat(output, m_duration);
+  CalPlatform::writeFloat(output, m_translationTolerance);
+  CalPlatform::writeFloat(output, m_rotationTolerance);
+  CalPlatform::writeFloat(output, m_maxTranslationError);
+  CalPlatform::writeFloat(output, m_maxRotationError);
+
+  CalPlatform::writeInteger(output, (int)m_vectorTrack.size());
+  CalPlatform::writeInteger(output, (int)m_vectorTime.size());
+  CalPlatform::writeInteger(output, (int)m_vectorFloat.size());
+  CalPlatform::writeInteger(output, (int)m_vectorShort.size());
+
+  unsigned int trackId;
+  for(trackId = 0; trackId < m_vectorTrack.size(); trackId++)
+  {
+    const Track& track = m_vectorTrack[trackId];
+
+    CalPlatform::writeInteger(output, track.coreBoneId);
+    CalPlatform::writeInteger(output, track.keyframeId);
+    CalPlatform::writeInteger(output, track.keyframeCount);
+    CalPlatform::writeInteger(output, track.translationChannel);
+    CalPlatform::writeInteger(output, track.translationId);
+    CalPlatform::writeFloat(output, track.translationMin.x);
+    CalPlatform::writeFloat(output, track.translationMin.y);
+    CalPlatform::writeFloat(output, track.translationMin.z);
+    CalPlatform::writeFloat(output, track.translationScale.x);
+    CalPlatform::writeFloat(output, track.translationScale.y);
+    CalPlatform::writeFloat(output, track.translationScale.z);
+    CalPlatform::writeInteger(output, track.rotationChannel);
+    CalPlatform::writeInteger(output, track.rotationId);
+  }
+
+  unsigned int i;
+  for(i = 0; i < m_vectorTime.size(); i++)
+  {
+    CalPlatform::writeFloat(output, m_vectorTime[i]);
+  }
+
+  for(i = 0; i < m_vectorFloat.size(); i++)
+  {
+    CalPlatform::writeFloat(output, m_vectorFloat[i]);
+  }
+
+  for(i = 0; i < m_vectorShort.size(); i++)
+  {
+    unsigned char buffer[2];
+    buffer[0] = (unsigned char)(m_vectorShort[i] & 0xff);
+    buffer[1] = (unsigned char)(m_vectorShort[i] >> 8);
+    CalPlatform::writeBytes(output, buffer, 2);
+  }
+
+  return !output.fail();
+}
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,103 @@
+//----------------------------------------------------------------------------//
+// compressedanimation.h                                                      //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef COMPRESSEDANIMATION_H
+#define COMPRESSEDANIMATION_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+#include <iostream>
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+class CompressedAnimation
+{
+// misc
+public:
+  // storage of a translation or rotation channel
+  //   constant:  one float value for all keyframes
+  //   quantized: 16 bit range-quantized translations, 48 bit smallest-three
+  //              rotations
+  //   raw:       float values, used when quantizing exceeds the error bound
+  enum Channel
+  {
+    CHANNEL_CONSTANT = 0,
+    CHANNEL_QUANTIZED,
+    CHANNEL_RAW
+  };
+
+  struct Track
+  {
+    int coreBoneId;
+    int keyframeId;
+    int keyframeCount;
+    int translationChannel;
+    int translationId;
+    CalVector translationMin;
+    CalVector translationScale;
+    int rotationChannel;
+    int rotationId;
+  };
+
+  // version 2 measures the rotation errors in radians
+  static const char FILE_MAGIC[4];
+  static const int FILE_VERSION;
+
+// member variables
+protected:
+  float m_duration;
+  float m_translationTolerance;
+  float m_rotationTolerance;
+  float m_maxTranslationError;
+  float m_maxRotationError;
+  std::vector<Track> m_vectorTrack;
+  std::vector<float> m_vectorTime;
+  std::vector<float> m_vectorFloat;
+  std::vector<unsigned short> m_vectorShort;
+
+// constructors/destructor
+public:
+  CompressedAnimation();
+  virtual ~CompressedAnimation();
+
+// member functions
+public:
+  bool create(CalCoreAnimation *pCoreAnimation, float translationTolerance, float rotationTolerance);
+  int getChannelCount(int channel) const;
+  int getCoreBoneId(int trackId) const;
+  float getDuration() const;
+  int getKeyframeCount(int trackId) const;
+  float getMaxRotationError() const;
+  float getMaxTranslationError() const;
+  int getMemorySize() const;
+  void getRotation(int trackId, int keyframeId, CalQuaternion& rotation) const;
+  const float *getTimes(int trackId) const;
+  int getTrackCount() const;
+  void getTranslation(int trackId, int keyframeId, CalVector& translation) const;
+  bool load(const std::string& strFilename);
+  bool load(std::istream& input);
+  bool save(const std::string& strFilename) const;
+  bool save(std::ostream& output) const;
+
+protected:
+  void compressRotations(Track& track, const std::vector<CalQuaternion>& vectorRotation);
+  void compressTranslations(Track& track, const std::vector<CalVector>& vectorTranslation);
+
+  static void decodeRotation(const unsigned short *pShort, CalQuaternion& rotation);
+  static void encodeRotation(const CalQuaternion& rotation, unsigned short *pShort);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,346 @@
+//----------------------------------------------------------------------------//
+// coremodelcache.cpp                                                         //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "coremodelcache.h"
+#include "coremodeldata.h"
+#include "cal3d/coretrack.h"
+#include "cal3d/corekeyframe.h"
+
+//----------------------------------------------------------------------------//
+// Static member variables initialization                                     //
+//----------------------------------------------------------------------------//
+
+std::map<std::string, CoreModelCache::Entry> CoreModelCache::m_mapEntry;
+pthread_mutex_t CoreModelCache::m_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t CoreModelCache::m_condition = PTHREAD_COND_INITIALIZER;
+bool CoreModelCache::m_bEnabled = true;
+int CoreModelCache::m_hitCount = 0;
+int CoreModelCache::m_missCount = 0;
+int CoreModelCache::m_bytesSaved = 0;
+
+//----------------------------------------------------------------------------//
+// Get the shared core model of a key, on a miss 0 is returned and the caller //
+// has to load the core model and hand it over with insert or give up with    //
+// cancel, other callers of the same key wait until then                      //
+//----------------------------------------------------------------------------//
+
+CalCoreModel *CoreModelCache::acquire(const std::string& strKey, CoreModelInfo& coreModelInfo)
+{
+  pthread_mutex_lock(&m_mutex);
+
+  if(!m_bEnabled)
+  {
+    m_missCount++;
+    pthread_mutex_unlock(&m_mutex);
+    return 0;
+  }
+
+  std::map<std::string, Entry>::iterator iteratorEntry;
+  iteratorEntry = m_mapEntry.find(strKey);
+
+  // wait while another thread loads the same core model
+  while((iteratorEntry != m_mapEntry.end()) && iteratorEntry->second.bLoading)
+  {
+    pthread_cond_wait(&m_condition, &m_mutex);
+    iteratorEntry = m_mapEntry.find(strKey);
+  }
+
+  if(iteratorEntry == m_mapEntry.end())
+  {
+    Entry entry;
+    entry.pCoreModel = 0;
+    entry.refCount = 0;
+    entry.bLoading = true;
+    m_mapEntry[strKey] = entry;
+
+    m_missCount++;
+    pthread_mutex_unlock(&m_mutex);
+    return 0;
+  }
+
+  Entry& entry = iteratorEntry->second;
+  entry.refCount++;
+  coreModelInfo = entry.coreModelInfo;
+
+  m_hitCount++;
+  m_bytesSaved += entry.coreModelInfo.byteSize;
+
+  pthread_mutex_unlock(&m_mutex);
+
+  return entry.pCoreModel;
+}
+
+//----------------------------------------------------------------------------//
+// Give up loading a core model after a miss                                  //
+//----------------------------------------------------------------------------//
+
+void CoreModelCache::cancel(const std::string& strKey)
+{
+  pthread_mutex_lock(&m_mutex);
+
+  std::map<std::string, Entry>::iterator iteratorEntry;
+  iteratorEntry = m_mapEntry.find(strKey);
+  if((iteratorEntry != m_mapEntry.end()) && iteratorEntry->second.bLoading)
+  {
+    // the next waiting caller tries to load it on its own
+    m_mapEntry.erase(iteratorEntry);
+    pthread_cond_broadcast(&m_condition);
+  }
+
+  pthread_mutex_unlock(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Find the entry of a core model, the mutex has to be locked                 //
+//----------------------------------------------------------------------------//
+
+std::map<std::string, CoreModelCache::Entry>::iterator CoreModelCache::find(CalCoreModel *pCoreModel)
+{
+  std::map<std::string, Entry>::iterator iteratorEntry;
+  for(iteratorEntry = m_mapEntry.begin(); iteratorEntry != m_mapEntry.end(); ++iteratorEntry)
+  {
+    if(iteratorEntry->second.pCoreModel == pCoreModel) break;
+  }
+
+  return iteratorEntry;
+}
+
+//----------------------------------------------------------------------------//
+// Estimate the memory used by the core data of a core model                  //
+//----------------------------------------------------------------------------//
+
+int CoreModelCache::getByteSize(CalCoreModel *pCoreModel)
+{
+  int byteSize;
+  byteSize = 0;
+
+  CalCoreSkeleton *pCoreSkeleton;
+  pCoreSkeleton = pCoreModel->getCoreSkeleton();
+  if(pCoreSkeleton != 0)
+  {
+    byteSize += (int)(pCoreSkeleton->getVectorCoreBone().size() * sizeof(CalCoreBone));
+  }
+
+  int coreAnimationId;
+  for(coreAnimationId = 0; coreAnimationId < pCoreModel->getCoreAnimationCount(); coreAnimationId++)
+  {
+    CalCoreAnimation *pCoreAnimation;
+    pCoreAnimation = pCoreModel->getCoreAnimation(coreAnimationId);
+    if(pCoreAnimation == 0) continue;
+
+    byteSize += (int)(pCoreAnimation->getListCoreTrack().size() * sizeof(CalCoreTrack));
+    byteSize += pCoreAnimation->getTotalNumberOfKeyframes() * (int)(sizeof(CalCoreKeyframe) + sizeof(CalCoreKeyframe *));
+  }
+
+  int coreMeshId;
+  for(coreMeshId = 0; coreMeshId < pCoreModel->getCoreMeshCount(); coreMeshId++)
+  {
+    CalCoreMesh *pCoreMesh;
+    pCoreMesh = pCoreModel->getCoreMesh(coreMeshId);
+
+    int coreSubmeshId;
+    for(coreSubmeshId = 0; coreSubmeshId < pCoreMesh->getCoreSubmeshCount(); coreSubmeshId++)
+    {
+      CalCoreSubmesh *pCoreSubmesh;
+      pCoreSubmesh = pCoreMesh->getCoreSubmesh(coreSubmeshId);
+
+      std::vector<CalCoreSubmesh::Vertex>& vectorVertex = pCoreSubmesh->getVectorVertex();
+
+      int vertexId;
+      for(vertexId = 0; vertexId < (int)vectorVertex.size(); vertexId++)
+      {
+        byteSize += (int)(sizeof(CalCoreSubmesh::Vertex) + vectorVertex[vertexId].vectorInfluence.size() * sizeof(CalCoreSubmesh::Influence));
+      }
+
+      std::vector<std::vector<CalCoreSubmesh::TextureCoordinate> >& vectorvectorTextureCoordinate = pCoreSubmesh->getVectorVectorTextureCoordinate();
+
+      int textureCoordinateId;
+      for(textureCoordinateId = 0; textureCoordinateId < (int)vectorvectorTextureCoordinate.size(); textureCoordinateId++)
+      {
+        byteSize += (int)(vectorvectorTextureCoordinate[textureCoordinateId].size() * sizeof(CalCoreSubmesh::TextureCoordinate));
+      }
+
+      byteSize += (int)(pCoreSubmesh->getVectorFace().size() * sizeof(CalCoreSubmesh::Face));
+      byteSize += (int)(pCoreSubmesh->getVectorSpring().size() * sizeof(CalCoreSubmesh::Spring));
+      byteSize += (int)(pCoreSubmesh->getVectorPhysicalProperty().size() * sizeof(CalCoreSubmesh::PhysicalProperty));
+    }
+  }
+
+  return byteSize;
+}
+
+//----------------------------------------------------------------------------//
+// Get the estimated memory not spent on duplicate core models                //
+//----------------------------------------------------------------------------//
+
+int CoreModelCache::getBytesSaved()
+{
+  pthread_mutex_lock(&m_mutex);
+  int bytesSaved;
+  bytesSaved = m_bytesSaved;
+  pthread_mutex_unlock(&m_mutex);
+
+  return bytesSaved;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of cached core models                                       //
+//----------------------------------------------------------------------------//
+
+int CoreModelCache::getCoreModelCount()
+{
+  pthread_mutex_lock(&m_mutex);
+  int coreModelCount;
+  coreModelCount = (int)m_mapEntry.size();
+  pthread_mutex_unlock(&m_mutex);
+
+  return coreModelCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of core models handed out from the cache                    //
+//----------------------------------------------------------------------------//
+
+int CoreModelCache::getHitCount()
+{
+  pthread_mutex_lock(&m_mutex);
+  int hitCount;
+  hitCount = m_hitCount;
+  pthread_mutex_unlock(&m_mutex);
+
+  return hitCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of core models that had to be loaded                        //
+//----------------------------------------------------------------------------//
+
+int CoreModelCache::getMissCount()
+{
+  pthread_mutex_lock(&m_mutex);
+  int missCount;
+  missCount = m_missCount;
+  pthread_mutex_unlock(&m_mutex);
+
+  return missCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of models sharing a core model, 0 if it is not cached       //
+//----------------------------------------------------------------------------//
+
+int CoreModelCache::getRefCount(CalCoreModel *pCoreModel)
+{
+  pthread_mutex_lock(&m_mutex);
+
+  std::map<std::string, Entry>::iterator iteratorEntry;
+  iteratorEntry = find(pCoreModel);
+
+  int refCount;
+  refCount = (iteratorEntry != m_mapEntry.end()) ? iteratorEntry->second.refCount : 0;
+
+  pthread_mutex_unlock(&m_mutex);
+
+  return refCount;
+}
+
+//----------------------------------------------------------------------------//
+// Hand a core model loaded after a miss over to the cache                    //
+//----------------------------------------------------------------------------//
+
+void CoreModelCache::insert(const std::string& strKey, CalCoreModel *pCoreModel, const CoreModelInfo& coreModelInfo)
+{
+  pthread_mutex_lock(&m_mutex);
+
+  // a disabled cache leaves the core model to its model
+  std::map<std::string, Entry>::iterator iteratorEntry;
+  iteratorEntry = m_mapEntry.find(strKey);
+  if((iteratorEntry != m_mapEntry.end()) && iteratorEntry->second.bLoading)
+  {
+    Entry& entry = iteratorEntry->second;
+    entry.pCoreModel = pCoreModel;
+    entry.coreModelInfo = coreModelInfo;
+    entry.refCount = 1;
+    entry.bLoading = false;
+
+    pthread_cond_broadcast(&m_condition);
+  }
+
+  pthread_mutex_unlock(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Check if core models are shared                                            //
+//----------------------------------------------------------------------------//
+
+bool CoreModelCache::isEnabled()
+{
+  pthread_mutex_lock(&m_mutex);
+  bool bEnabled;
+  bEnabled = m_bEnabled;
+  pthread_mutex_unlock(&m_mutex);
+
+  return bEnabled;
+}
+
+//----------------------------------------------------------------------------//
+// Release a core model, it is destroyed together with its derived data once  //
+// no model uses it anymore                                                   //
+//----------------------------------------------------------------------------//
+
+void CoreModelCache::release(CalCoreModel *pCoreModel)
+{
+  if(pCoreModel == 0) return;
+
+  pthread_mutex_lock(&m_mutex);
+
+  std::map<std::string, Entry>::iterator iteratorEntry;
+  iteratorEntry = find(pCoreModel);
+
+  bool bDestroy;
+  bDestroy = true;
+
+  if(iteratorEntry != m_mapEntry.end())
+  {
+    iteratorEntry->second.refCount--;
+    if(iteratorEntry->second.refCount > 0)
+    {
+      bDestroy = false;
+    }
+    else
+    {
+      m_mapEntry.erase(iteratorEntry);
+    }
+  }
+
+  pthread_mutex_unlock(&m_mutex);
+
+  if(bDestroy)
+  {
+    delete CoreModelData::get(pCoreModel);
+    delete pCoreModel;
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Enable or disable sharing for the core models loaded from now on           //
+//----------------------------------------------------------------------------//
+
+void CoreModelCache::setEnabled(bool bEnabled)
+{
+  pthread_mutex_lock(&m_mutex);
+  m_bEnabled = bEnabled;
+  pthread_mutex_unlock(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,79 @@
+//----------------------------------------------------------------------------//
+// coremodelcache.h                                                           //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef COREMODELCACHE_H
+#define COREMODELCACHE_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+#include <pthread.h>
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+// shares the core models between all models loaded from the same model
+// configuration file, the core model is destroyed with its last model
+class CoreModelCache
+{
+// misc
+public:
+  // what a model reads from its configuration file besides the core model
+  struct CoreModelInfo
+  {
+    float renderScale;
+    int animationId[16];
+    int animationCount;
+    int byteSize;
+  };
+
+protected:
+  struct Entry
+  {
+    CalCoreModel *pCoreModel;
+    CoreModelInfo coreModelInfo;
+    int refCount;
+    bool bLoading;
+  };
+
+// member variables
+protected:
+  static std::map<std::string, Entry> m_mapEntry;
+  static pthread_mutex_t m_mutex;
+  static pthread_cond_t m_condition;
+  static bool m_bEnabled;
+  static int m_hitCount;
+  static int m_missCount;
+  static int m_bytesSaved;
+
+// member functions
+public:
+  static CalCoreModel *acquire(const std::string& strKey, CoreModelInfo& coreModelInfo);
+  static void cancel(const std::string& strKey);
+  static int getByteSize(CalCoreModel *pCoreModel);
+  static int getBytesSaved();
+  static int getCoreModelCount();
+  static int getHitCount();
+  static int getMissCount();
+  static int getRefCount(CalCoreModel *pCoreModel);
+  static void insert(const std::string& strKey, CalCoreModel *pCoreModel, const CoreModelInfo& coreModelInfo);
+  static bool isEnabled();
+  static void release(CalCoreModel *pCoreModel);
+  static void setEnabled(bool bEnabled);
+
+protected:
+  static std::map<std::string, Entry>::iterator find(CalCoreModel *pCoreModel);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
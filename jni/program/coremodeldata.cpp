@@ -0,0 +1,475 @@
+//----------------------------------------------------------------------------//
+// coremodeldata.cpp                                                          //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "coremodeldata.h"
+#include "packedanimation.h"
+#include "bakedanimation.h"
+#include "compressedanimation.h"
+#include "skinstream.h"
+#include "posecache.h"
+#include "Utils.h"
+#include "cal3d/coretrack.h"
+#include "cal3d/corekeyframe.h"
+
+//----------------------------------------------------------------------------//
+// Static member variables initialization                                     //
+//----------------------------------------------------------------------------//
+
+bool CoreModelData::m_bKeyframesReleased = true;
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+CoreModelData::CoreModelData(CalCoreModel *pCoreModel)
+{
+  m_pCoreModel = pCoreModel;
+
+  // make the data reachable from every model instance of the core model, and
+  // from the loading code before onInit is called
+  m_pCoreModel->setUserData((Cal::UserData)this);
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+CoreModelData::~CoreModelData()
+{
+  onShutdown();
+}
+
+//----------------------------------------------------------------------------//
+// Compress all core animations that are not compressed yet, their keyframes  //
+// are released unless the benchmarks keep them                               //
+//----------------------------------------------------------------------------//
+
+void CoreModelData::compressAnimations(float translationTolerance, float rotationTolerance)
+{
+  int coreAnimationId;
+  for(coreAnimationId = 0; coreAnimationId < m_pCoreModel->getCoreAnimationCount(); coreAnimationId++)
+  {
+    CalCoreAnimation *pCoreAnimation;
+    pCoreAnimation = m_pCoreModel->getCoreAnimation(coreAnimationId);
+    if((pCoreAnimation == 0) || (getCompressedAnimation(pCoreAnimation) != 0)) continue;
+
+    // baked animations are sampled from their keyframes, not compressed
+    if(m_mapBakeRate.find(pCoreAnimation) != m_mapBakeRate.end()) continue;
+
+    CompressedAnimation *pCompressedAnimation;
+    pCompressedAnimation = new CompressedAnimation();
+    if(!pCompressedAnimation->create(pCoreAnimation, translationTolerance, rotationTolerance))
+    {
+      delete pCompressedAnimation;
+      continue;
+    }
+
+    m_mapCompressedAnimation[pCoreAnimation] = pCompressedAnimation;
+
+    // the mixer only samples the compressed tracks from now on
+    if(m_bKeyframesReleased) releaseKeyframes(pCoreAnimation);
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Mark the bones an animation level of detail may leave out, the fingers,    //
+// toes, ponytails and tails by name, and all bones below them                //
+//----------------------------------------------------------------------------//
+
+void CoreModelData::findDetailBones()
+{
+  static const char *detailBoneName[] = { "Finger", "Toe", "Tail" };
+
+  m_vectorDetailBone.clear();
+
+  CalCoreSkeleton *pCoreSkeleton;
+  pCoreSkeleton = m_pCoreModel->getCoreSkeleton();
+  if(pCoreSkeleton == 0) return;
+
+  std::vector<CalCoreBone *>& vectorCoreBone = pCoreSkeleton->getVectorCoreBone();
+  m_vectorDetailBone.assign(vectorCoreBone.size(), false);
+
+  int coreBoneId;
+  for(coreBoneId = 0; coreBoneId < (int)vectorCoreBone.size(); coreBoneId++)
+  {
+    // the bones are not sorted, so walk up to the root
+    int parentId;
+    for(parentId = coreBoneId; parentId != -1; parentId = vectorCoreBone[parentId]->getParentId())
+    {
+      const std::string& strName = vectorCoreBone[parentId]->getName();
+
+      int nameId;
+      for(nameId = 0; nameId < (int)(sizeof(detailBoneName) / sizeof(detailBoneName[0])); nameId++)
+      {
+        if(strName.find(detailBoneName[nameId]) != std::string::npos) m_vectorDetailBone[coreBoneId] = true;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bytes used by the packed, compressed and baked keyframes //
+//----------------------------------------------------------------------------//
+
+int CoreModelData::getAnimationMemorySize()
+{
+  int memorySize;
+  memorySize = 0;
+
+  std::map<CalCoreAnimation *, PackedAnimation *>::iterator iteratorPackedAnimation;
+  for(iteratorPackedAnimation = m_mapPackedAnimation.begin(); iteratorPackedAnimation != m_mapPackedAnimation.end(); ++iteratorPackedAnimation)
+  {
+    memorySize += iteratorPackedAnimation->second->getMemorySize();
+  }
+
+  std::map<CalCoreAnimation *, CompressedAnimation *>::iterator iteratorCompressedAnimation;
+  for(iteratorCompressedAnimation = m_mapCompressedAnimation.begin(); iteratorCompressedAnimation != m_mapCompressedAnimation.end(); ++iteratorCompressedAnimation)
+  {
+    memorySize += iteratorCompressedAnimation->second->getMemorySize();
+  }
+
+  std::map<CalCoreAnimation *, BakedAnimation *>::iterator iteratorBakedAnimation;
+  for(iteratorBakedAnimation = m_mapBakedAnimation.begin(); iteratorBakedAnimation != m_mapBakedAnimation.end(); ++iteratorBakedAnimation)
+  {
+    memorySize += iteratorBakedAnimation->second->getMemorySize();
+  }
+
+  return memorySize;
+}
+
+//----------------------------------------------------------------------------//
+// Get the baked samples of a core animation                                  //
+//----------------------------------------------------------------------------//
+
+BakedAnimation *CoreModelData::getBakedAnimation(CalCoreAnimation *pCoreAnimation)
+{
+  std::map<CalCoreAnimation *, BakedAnimation *>::iterator iteratorBakedAnimation;
+  iteratorBakedAnimation = m_mapBakedAnimation.find(pCoreAnimation);
+  if(iteratorBakedAnimation == m_mapBakedAnimation.end()) return 0;
+
+  return iteratorBakedAnimation->second;
+}
+
+//----------------------------------------------------------------------------//
+// Get the detail bones by core bone id, empty without a skeleton             //
+//----------------------------------------------------------------------------//
+
+const std::vector<bool>& CoreModelData::getDetailBones()
+{
+  return m_vectorDetailBone;
+}
+
+//----------------------------------------------------------------------------//
+// Get the core model data attached to a core model                           //
+//----------------------------------------------------------------------------//
+
+CoreModelData *CoreModelData::get(CalCoreModel *pCoreModel)
+{
+  return (CoreModelData *)pCoreModel->getUserData();
+}
+
+//----------------------------------------------------------------------------//
+// Get the compressed keyframes of a core animation                           //
+//----------------------------------------------------------------------------//
+
+CompressedAnimation *CoreModelData::getCompressedAnimation(CalCoreAnimation *pCoreAnimation)
+{
+  std::map<CalCoreAnimation *, CompressedAnimation *>::iterator iteratorCompressedAnimation;
+  iteratorCompressedAnimation = m_mapCompressedAnimation.find(pCoreAnimation);
+  if(iteratorCompressedAnimation == m_mapCompressedAnimation.end()) return 0;
+
+  return iteratorCompressedAnimation->second;
+}
+
+//----------------------------------------------------------------------------//
+// Get the packed keyframes of a core animation                               //
+//----------------------------------------------------------------------------//
+
+PackedAnimation *CoreModelData::getPackedAnimation(CalCoreAnimation *pCoreAnimation)
+{
+  std::map<CalCoreAnimation *, PackedAnimation *>::iterator iteratorPackedAnimation;
+  iteratorPackedAnimation = m_mapPackedAnimation.find(pCoreAnimation);
+  if(iteratorPackedAnimation == m_mapPackedAnimation.end()) return 0;
+
+  return iteratorPackedAnimation->second;
+}
+
+//----------------------------------------------------------------------------//
+// Get the baked skin stream of a core submesh                                //
+//----------------------------------------------------------------------------//
+
+SkinStream *CoreModelData::getSkinStream(CalCoreSubmesh *pCoreSubmesh)
+{
+  std::map<CalCoreSubmesh *, SkinStream *>::iterator iteratorSkinStream;
+  iteratorSkinStream = m_mapSkinStream.find(pCoreSubmesh);
+  if(iteratorSkinStream == m_mapSkinStream.end()) return 0;
+
+  return iteratorSkinStream->second;
+}
+
+//----------------------------------------------------------------------------//
+// Check if onInit deletes the keyframes of cal3d it no longer needs          //
+//----------------------------------------------------------------------------//
+
+bool CoreModelData::isKeyframesReleased()
+{
+  return m_bKeyframesReleased;
+}
+
+//----------------------------------------------------------------------------//
+// Load a compressed animation file and add it to the core model              //
+//----------------------------------------------------------------------------//
+
+int CoreModelData::loadCompressedAnimation(const std::string& strFilename)
+{
+  CompressedAnimation *pCompressedAnimation;
+  pCompressedAnimation = new CompressedAnimation();
+  if(!pCompressedAnimation->load(strFilename))
+  {
+    delete pCompressedAnimation;
+    return -1;
+  }
+
+  // the mixer indexes its poses by the bone ids of the tracks, so a file
+  // made for another skeleton must not get in; like CalLoader the skeleton
+  // has to be loaded first
+  if(m_pCoreModel->getCoreSkeleton() == 0)
+  {
+    delete pCompressedAnimation;
+    return -1;
+  }
+
+  int boneCount;
+  boneCount = (int)m_pCoreModel->getCoreSkeleton()->getVectorCoreBone().size();
+
+  int trackId;
+  for(trackId = 0; trackId < pCompressedAnimation->getTrackCount(); trackId++)
+  {
+    int coreBoneId;
+    coreBoneId = pCompressedAnimation->getCoreBoneId(trackId);
+    if((coreBoneId < 0) || (coreBoneId >= boneCount))
+    {
+      delete pCompressedAnimation;
+      return -1;
+    }
+  }
+
+  // the mixer schedules core animations, so add one without any tracks; the
+  // keyframes only exist in compressed form
+  CalCoreAnimationPtr pCoreAnimation;
+  pCoreAnimation = new CalCoreAnimation();
+  pCoreAnimation->setDuration(pCompressedAnimation->getDuration());
+  pCoreAnimation->setFilename(strFilename);
+
+  int coreAnimationId;
+  coreAnimationId = m_pCoreModel->addCoreAnimation(pCoreAnimation.get());
+  if(coreAnimationId == -1)
+  {
+    delete pCompressedAnimation;
+    return -1;
+  }
+
+  m_mapCompressedAnimation[pCoreAnimation.get()] = pCompressedAnimation;
+
+  return coreAnimationId;
+}
+
+//----------------------------------------------------------------------------//
+// Bake all derived data of the loaded core model                             //
+//----------------------------------------------------------------------------//
+
+bool CoreModelData::onInit()
+{
+  findDetailBones();
+
+  // bake one skin stream for every core submesh of every core mesh
+  int coreMeshId;
+  for(coreMeshId = 0; coreMeshId < m_pCoreModel->getCoreMeshCount(); coreMeshId++)
+  {
+    CalCoreMesh *pCoreMesh;
+    pCoreMesh = m_pCoreModel->getCoreMesh(coreMeshId);
+
+    int coreSubmeshId;
+    for(coreSubmeshId = 0; coreSubmeshId < pCoreMesh->getCoreSubmeshCount(); coreSubmeshId++)
+    {
+      CalCoreSubmesh *pCoreSubmesh;
+      pCoreSubmesh = pCoreMesh->getCoreSubmesh(coreSubmeshId);
+
+      SkinStream *pSkinStream;
+      pSkinStream = new SkinStream();
+      if(!pSkinStream->create(pCoreSubmesh))
+      {
+        // too many vertices for 16 bit ids, CalPhysique will skin this one
+        LOG("Skin stream creation failed for submesh %d of '%s'.", coreSubmeshId, pCoreMesh->getFilename().c_str());
+        delete pSkinStream;
+        continue;
+      }
+
+      m_mapSkinStream[pCoreSubmesh] = pSkinStream;
+    }
+  }
+
+  // bake the core animations that asked for it
+  std::map<CalCoreAnimation *, float>::iterator iteratorBakeRate;
+  for(iteratorBakeRate = m_mapBakeRate.begin(); iteratorBakeRate != m_mapBakeRate.end(); ++iteratorBakeRate)
+  {
+    CalCoreAnimation *pCoreAnimation;
+    pCoreAnimation = iteratorBakeRate->first;
+    if(getCompressedAnimation(pCoreAnimation) != 0) continue;
+
+    BakedAnimation *pBakedAnimation;
+    pBakedAnimation = new BakedAnimation();
+    if(!pBakedAnimation->create(pCoreAnimation, iteratorBakeRate->second))
+    {
+      delete pBakedAnimation;
+      continue;
+    }
+
+    LOG("Baked '%s' at %g Hz: %d samples, %d bytes (%d bytes of keyframes %s).", pCoreAnimation->getFilename().c_str(), pBakedAnimation->getSampleRate(), pBakedAnimation->getSampleCount(), pBakedAnimation->getMemorySize(), PackedAnimation::getCoreAnimationMemorySize(pCoreAnimation), m_bKeyframesReleased ? "released" : "kept");
+
+    m_mapBakedAnimation[pCoreAnimation] = pBakedAnimation;
+
+    // the mixer only samples the baked poses from now on
+    if(m_bKeyframesReleased) releaseKeyframes(pCoreAnimation);
+  }
+
+  // pack the keyframes of every core animation that is not compressed or
+  // baked
+  int coreAnimationId;
+  for(coreAnimationId = 0; coreAnimationId < m_pCoreModel->getCoreAnimationCount(); coreAnimationId++)
+  {
+    CalCoreAnimation *pCoreAnimation;
+    pCoreAnimation = m_pCoreModel->getCoreAnimation(coreAnimationId);
+    if((pCoreAnimation == 0) || (getCompressedAnimation(pCoreAnimation) != 0)) continue;
+    if(getBakedAnimation(pCoreAnimation) != 0) continue;
+
+    PackedAnimation *pPackedAnimation;
+    pPackedAnimation = new PackedAnimation();
+    pPackedAnimation->create(pCoreAnimation);
+
+    m_mapPackedAnimation[pCoreAnimation] = pPackedAnimation;
+
+    // the mixer only samples the packed keyframes from now on
+    if(m_bKeyframesReleased) releaseKeyframes(pCoreAnimation);
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Release all derived data                                                   //
+//----------------------------------------------------------------------------//
+
+void CoreModelData::onShutdown()
+{
+  // the shared poses must not outlive their core animations
+  int coreAnimationId;
+  for(coreAnimationId = 0; coreAnimationId < m_pCoreModel->getCoreAnimationCount(); coreAnimationId++)
+  {
+    PoseCache::remove(m_pCoreModel->getCoreAnimation(coreAnimationId));
+  }
+
+  std::map<CalCoreSubmesh *, SkinStream *>::iterator iteratorSkinStream;
+  for(iteratorSkinStream = m_mapSkinStream.begin(); iteratorSkinStream != m_mapSkinStream.end(); ++iteratorSkinStream)
+  {
+    delete iteratorSkinStream->second;
+  }
+  m_mapSkinStream.clear();
+
+  std::map<CalCoreAnimation *, PackedAnimation *>::iterator iteratorPackedAnimation;
+  for(iteratorPackedAnimation = m_mapPackedAnimation.begin(); iteratorPackedAnimation != m_mapPackedAnimation.end(); ++iteratorPackedAnimation)
+  {
+    delete iteratorPackedAnimation->second;
+  }
+  m_mapPackedAnimation.clear();
+
+  std::map<CalCoreAnimation *, BakedAnimation *>::iterator iteratorBakedAnimation;
+  for(iteratorBakedAnimation = m_mapBakedAnimation.begin(); iteratorBakedAnimation != m_mapBakedAnimation.end(); ++iteratorBakedAnimation)
+  {
+    delete iteratorBakedAnimation->second;
+  }
+  m_mapBakedAnimation.clear();
+  m_mapBakeRate.clear();
+
+  std::map<CalCoreAnimation *, CompressedAnimation *>::iterator iteratorCompressedAnimation;
+  for(iteratorCompressedAnimation = m_mapCompressedAnimation.begin(); iteratorCompressedAnimation != m_mapCompressedAnimation.end(); ++iteratorCompressedAnimation)
+  {
+    delete iteratorCompressedAnimation->second;
+  }
+  m_mapCompressedAnimation.clear();
+
+  if(m_pCoreModel->getUserData() == (Cal::UserData)this) m_pCoreModel->setUserData(0);
+}
+
+//----------------------------------------------------------------------------//
+// Delete the keyframes of a core animation, the tracks stay with their bone  //
+// ids so the animation can still be scheduled; the pointer arrays of the     //
+// tracks keep their capacity                                                 //
+//----------------------------------------------------------------------------//
+
+void CoreModelData::releaseKeyframes(CalCoreAnimation *pCoreAnimation)
+{
+  std::list<CalCoreTrack *>& listCoreTrack = pCoreAnimation->getListCoreTrack();
+
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+  {
+    CalCoreTrack *pCoreTrack;
+    pCoreTrack = *iteratorCoreTrack;
+
+    // from the back, so every removal is constant time
+    int keyframeId;
+    for(keyframeId = pCoreTrack->getCoreKeyframeCount() - 1; keyframeId >= 0; keyframeId--)
+    {
+      CalCoreKeyframe *pCoreKeyframe;
+      pCoreKeyframe = pCoreTrack->getCoreKeyframe(keyframeId);
+      pCoreTrack->removeCoreKeyFrame(keyframeId);
+
+      pCoreKeyframe->destroy();
+      delete pCoreKeyframe;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Bake a core animation at a fixed sample rate in onInit instead of packing  //
+// its keyframes, a rate of 0 keeps the keyframes                             //
+//----------------------------------------------------------------------------//
+
+void CoreModelData::setBakeRate(int coreAnimationId, float sampleRate)
+{
+  CalCoreAnimation *pCoreAnimation;
+  pCoreAnimation = m_pCoreModel->getCoreAnimation(coreAnimationId);
+  if(pCoreAnimation == 0) return;
+
+  if(sampleRate > 0.0f)
+  {
+    m_mapBakeRate[pCoreAnimation] = sampleRate;
+  }
+  else
+  {
+    m_mapBakeRate.erase(pCoreAnimation);
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Set if onInit deletes the keyframes of cal3d it no longer needs, only      //
+// before any core model is loaded                                            //
+//----------------------------------------------------------------------------//
+
+void CoreModelData::setKeyframesReleased(bool bKeyframesReleased)
+{
+  m_bKeyframesReleased = bKeyframesReleased;
+}
+
+//----------------------------------------------------------------------------//
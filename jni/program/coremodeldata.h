@@ -0,0 +1,77 @@
+//----------------------------------------------------------------------------//
+// coremodeldata.h                                                            //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef COREMODELDATA_H
+#define COREMODELDATA_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+
+//----------------------------------------------------------------------------//
+// Forward declarations                                                       //
+//----------------------------------------------------------------------------//
+
+class BakedAnimation;
+class CompressedAnimation;
+class PackedAnimation;
+class SkinStream;
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+class CoreModelData
+{
+// member variables
+protected:
+  CalCoreModel *m_pCoreModel;
+  std::map<CalCoreAnimation *, float> m_mapBakeRate;
+  std::map<CalCoreAnimation *, BakedAnimation *> m_mapBakedAnimation;
+  std::map<CalCoreAnimation *, CompressedAnimation *> m_mapCompressedAnimation;
+  std::map<CalCoreAnimation *, PackedAnimation *> m_mapPackedAnimation;
+  std::map<CalCoreSubmesh *, SkinStream *> m_mapSkinStream;
+  std::vector<bool> m_vectorDetailBone;
+
+  // the keyframes of cal3d are deleted once the mixer has its own copy
+  static bool m_bKeyframesReleased;
+
+// constructors/destructor
+public:
+  CoreModelData(CalCoreModel *pCoreModel);
+  virtual ~CoreModelData();
+
+// member functions
+public:
+  void compressAnimations(float translationTolerance, float rotationTolerance);
+  int getAnimationMemorySize();
+  BakedAnimation *getBakedAnimation(CalCoreAnimation *pCoreAnimation);
+  CompressedAnimation *getCompressedAnimation(CalCoreAnimation *pCoreAnimation);
+  const std::vector<bool>& getDetailBones();
+  PackedAnimation *getPackedAnimation(CalCoreAnimation *pCoreAnimation);
+  SkinStream *getSkinStream(CalCoreSubmesh *pCoreSubmesh);
+  int loadCompressedAnimation(const std::string& strFilename);
+  bool onInit();
+  void onShutdown();
+  void setBakeRate(int coreAnimationId, float sampleRate);
+
+  static CoreModelData *get(CalCoreModel *pCoreModel);
+  static bool isKeyframesReleased();
+  static void releaseKeyframes(CalCoreAnimation *pCoreAnimation);
+  static void setKeyframesReleased(bool bKeyframesReleased);
+
+protected:
+  void findDetailBones();
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,216 @@
+//----------------------------------------------------------------------------//
+// crowd.cpp                                                                  //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "crowd.h"
+#include "threadpool.h"
+#include "modelpipeline.h"
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+Crowd::Crowd()
+{
+  m_pThreadPool = 0;
+  m_grainSize = 1;
+  m_elapsedSeconds = 0.0f;
+  m_stage = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+Crowd::~Crowd()
+{
+}
+
+//----------------------------------------------------------------------------//
+// Add a model instance, the crowd does not take ownership                    //
+//----------------------------------------------------------------------------//
+
+int Crowd::addModel(CalModel *pModel)
+{
+  m_vectorModel.push_back(pModel);
+
+  return (int)m_vectorModel.size() - 1;
+}
+
+//----------------------------------------------------------------------------//
+// Add a staged model instance, the crowd does not take ownership             //
+//----------------------------------------------------------------------------//
+
+int Crowd::addModelPipeline(ModelPipeline *pModelPipeline)
+{
+  m_vectorModelPipeline.push_back(pModelPipeline);
+
+  return (int)m_vectorModelPipeline.size() - 1;
+}
+
+//----------------------------------------------------------------------------//
+// Remove all model instances                                                 //
+//----------------------------------------------------------------------------//
+
+void Crowd::clear()
+{
+  m_vectorModel.clear();
+  m_vectorModelPipeline.clear();
+}
+
+//----------------------------------------------------------------------------//
+// Get a model instance                                                       //
+//----------------------------------------------------------------------------//
+
+CalModel *Crowd::getModel(int modelId)
+{
+  return m_vectorModel[modelId];
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of model instances                                          //
+//----------------------------------------------------------------------------//
+
+int Crowd::getModelCount()
+{
+  return (int)m_vectorModel.size();
+}
+
+//----------------------------------------------------------------------------//
+// Get a staged model instance                                                //
+//----------------------------------------------------------------------------//
+
+ModelPipeline *Crowd::getModelPipeline(int modelPipelineId)
+{
+  return m_vectorModelPipeline[modelPipelineId];
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of staged model instances                                   //
+//----------------------------------------------------------------------------//
+
+int Crowd::getModelPipelineCount()
+{
+  return (int)m_vectorModelPipeline.size();
+}
+
+//----------------------------------------------------------------------------//
+// Run one stage of a staged model instance, called on the threads of the     //
+// pool                                                                       //
+//----------------------------------------------------------------------------//
+
+void Crowd::runModelPipelineStage(void *pCrowd, int modelPipelineId)
+{
+  Crowd *pThis;
+  pThis = (Crowd *)pCrowd;
+
+  pThis->m_vectorModelPipeline[modelPipelineId]->runStage(pThis->m_stage, pThis->m_elapsedSeconds);
+}
+
+//----------------------------------------------------------------------------//
+// Run one stage of all staged model instances, the stages of one model have  //
+// to run in order but different models may be in different stages            //
+//----------------------------------------------------------------------------//
+
+void Crowd::runStage(int stage, float elapsedSeconds)
+{
+  m_stage = stage;
+  m_elapsedSeconds = elapsedSeconds;
+
+  if(m_pThreadPool == 0)
+  {
+    int modelPipelineId;
+    for(modelPipelineId = 0; modelPipelineId < (int)m_vectorModelPipeline.size(); modelPipelineId++)
+    {
+      runModelPipelineStage(this, modelPipelineId);
+    }
+
+    return;
+  }
+
+  m_pThreadPool->run(runModelPipelineStage, this, (int)m_vectorModelPipeline.size(), m_grainSize);
+}
+
+//----------------------------------------------------------------------------//
+// Set the number of model instances a thread takes at once                   //
+//----------------------------------------------------------------------------//
+
+void Crowd::setGrainSize(int grainSize)
+{
+  m_grainSize = (grainSize < 1) ? 1 : grainSize;
+}
+
+//----------------------------------------------------------------------------//
+// Set the thread pool the updates run on, without one they run serially      //
+//----------------------------------------------------------------------------//
+
+void Crowd::setThreadPool(ThreadPool *pThreadPool)
+{
+  m_pThreadPool = pThreadPool;
+}
+
+//----------------------------------------------------------------------------//
+// Update all model instances                                                 //
+//----------------------------------------------------------------------------//
+
+void Crowd::update(float elapsedSeconds)
+{
+  m_elapsedSeconds = elapsedSeconds;
+
+  if(m_pThreadPool == 0)
+  {
+    int modelId;
+    for(modelId = 0; modelId < (int)m_vectorModel.size(); modelId++)
+    {
+      updateModel(this, modelId);
+    }
+
+    int modelPipelineId;
+    for(modelPipelineId = 0; modelPipelineId < (int)m_vectorModelPipeline.size(); modelPipelineId++)
+    {
+      updateModelPipeline(this, modelPipelineId);
+    }
+
+    return;
+  }
+
+  m_pThreadPool->run(updateModel, this, (int)m_vectorModel.size(), m_grainSize);
+  m_pThreadPool->run(updateModelPipeline, this, (int)m_vectorModelPipeline.size(), m_grainSize);
+}
+
+//----------------------------------------------------------------------------//
+// Update one model instance, called on the threads of the pool               //
+//----------------------------------------------------------------------------//
+
+void Crowd::updateModel(void *pCrowd, int modelId)
+{
+  Crowd *pThis;
+  pThis = (Crowd *)pCrowd;
+
+  // mixer, morph target mixer, skeleton, physique and spring system
+  pThis->m_vectorModel[modelId]->update(pThis->m_elapsedSeconds);
+}
+
+//----------------------------------------------------------------------------//
+// Run all stages of a staged model instance, called on the threads of the    //
+// pool                                                                       //
+//----------------------------------------------------------------------------//
+
+void Crowd::updateModelPipeline(void *pCrowd, int modelPipelineId)
+{
+  Crowd *pThis;
+  pThis = (Crowd *)pCrowd;
+
+  pThis->m_vectorModelPipeline[modelPipelineId]->update(pThis->m_elapsedSeconds);
+}
+
+//----------------------------------------------------------------------------//
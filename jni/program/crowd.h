@@ -0,0 +1,72 @@
+//----------------------------------------------------------------------------//
+// crowd.h                                                                    //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef CROWD_H
+#define CROWD_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+
+//----------------------------------------------------------------------------//
+// Forward declarations                                                       //
+//----------------------------------------------------------------------------//
+
+class ModelPipeline;
+class ThreadPool;
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+// updates a batch of model instances on a thread pool, every instance only
+// touches its own state and reads the shared core data, so the result does
+// not depend on the number of threads or the order of the updates, staged
+// models can also be run one stage at a time
+class Crowd
+{
+// member variables
+protected:
+  std::vector<CalModel *> m_vectorModel;
+  std::vector<ModelPipeline *> m_vectorModelPipeline;
+  ThreadPool *m_pThreadPool;
+  int m_grainSize;
+  float m_elapsedSeconds;
+  int m_stage;
+
+// constructors/destructor
+public:
+  Crowd();
+  virtual ~Crowd();
+
+// member functions
+public:
+  int addModel(CalModel *pModel);
+  int addModelPipeline(ModelPipeline *pModelPipeline);
+  void clear();
+  CalModel *getModel(int modelId);
+  int getModelCount();
+  ModelPipeline *getModelPipeline(int modelPipelineId);
+  int getModelPipelineCount();
+  void runStage(int stage, float elapsedSeconds);
+  void setGrainSize(int grainSize);
+  void setThreadPool(ThreadPool *pThreadPool);
+  void update(float elapsedSeconds);
+
+protected:
+  static void runModelPipelineStage(void *pCrowd, int modelPipelineId);
+  static void updateModel(void *pCrowd, int modelId);
+  static void updateModelPipeline(void *pCrowd, int modelPipelineId);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
@@ -22,6 +22,14 @@
 #include "menu.h"
 #include "tga.h"
 #include "Utils.h"
+#include "skinning.h"
+#include "bench.h"
+#include "asyncloader.h"
+#include "coremodelcache.h"
+#include "coremodeldata.h"
+#include "modelpipeline.h"
+#include "hardwareskinning.h"
+#include "animationlod.h"
 
 
 //----------------------------------------------------------------------------//
@@ -53,6 +61,10 @@ Demo::Demo()
   m_bRightMouseButtonDown = false;
   m_lastTick = Utils::getCurrentTime();
   m_currentModel = 0;
+  m_pAsyncLoader = 0;
+  m_loadingStartTick = 0;
+  m_bLoaded = false;
+  m_bLoadingFailed = false;
   m_bPaused = false;
   m_bOutputAverageCPUTimeAtExit = false;
 }
@@ -84,6 +96,29 @@ std::string Demo::getDatapath()
 }
 
 
+//----------------------------------------------------------------------------//
+// Set up the orthogonal projection for the 2d overlay                        //
+//----------------------------------------------------------------------------//
+
+void Demo::beginOverlay()
+{
+  //flip the texture on y axis
+  glMatrixMode(GL_TEXTURE);
+  glLoadIdentity();
+  glScalef(1,1,1);
+
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glOrthof(0, (GLfloat)m_width, 0, (GLfloat)m_height, -1.0f, 1.0f);
+
+  glMatrixMode(GL_MODELVIEW);
+  glLoadIdentity();
+
+  // we will render some alpha-blended textures
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
 //----------------------------------------------------------------------------//
 // Get the current model                                                      //
 //----------------------------------------------------------------------------//
@@ -196,6 +231,15 @@ bool Demo::loadTexture(const std::string& strFilename, GLuint& pId)
   return true;
 }
 
+//----------------------------------------------------------------------------//
+// Check if the models are still being loaded, a failed loading has ended     //
+//----------------------------------------------------------------------------//
+
+bool Demo::isLoading()
+{
+  return !m_bLoaded && !m_bLoadingFailed;
+}
+
 //----------------------------------------------------------------------------//
 // Make next model the current one                                            //
 //----------------------------------------------------------------------------//
@@ -283,6 +327,31 @@ void Demo::onIdle()
     m_fpsFrames = 0;
   }
 
+  // hand the loaded models their textures until all of them are ready
+  if(m_pAsyncLoader != 0)
+  {
+    m_pAsyncLoader->onUpdate();
+    if(m_pAsyncLoader->isFinished())
+    {
+      m_bLoaded = onLoadingDone();
+      m_bLoadingFailed = !m_bLoaded;
+    }
+  }
+
+  // the demo has nothing to show without its models, the same as a failed
+  // initialization
+  if(m_bLoadingFailed)
+  {
+    LOG("Initialization of the demo failed.");
+    exit(-1);
+  }
+
+  if(isLoading())
+  {
+    m_lastTick = tick;
+    return;
+  }
+
 	static double start;
 	static double firstTime, lastTime;
 	start = Utils::getCurrentTime();
@@ -295,13 +364,28 @@ void Demo::onIdle()
 		lastTime = start;
 	}
 
-  // update the current model
-  if(!m_bPaused)
+  // pick the animation level of detail from the size of the model on screen,
+  // the projection of onRender has a near plane of 10 render scales and a
+  // frustum top of 1
+  Model *pModel;
+  pModel = m_vectorModel[m_currentModel];
+
+  if(AnimationLod::isEnabled())
+  {
+    float renderScale;
+    renderScale = pModel->getRenderScale();
+    pModel->setAnimationLod(AnimationLod::getLevel(AnimationLod::getScreenSize(pModel->getCalModel(), m_distance * renderScale, renderScale * 10.0f)));
+  }
+  else
   {
-		//for (int i = 0; i < 10; i++)
-			m_vectorModel[m_currentModel]->onUpdate(elapsedSeconds);
+    pModel->setAnimationLod(AnimationLod::LEVEL_FULL);
   }
 
+  // update the current model, a paused model skips its animation but gets
+  // skinned again if e.g. its lod level changed
+  m_vectorModel[m_currentModel]->getModelPipeline()->setPaused(m_bPaused);
+  m_vectorModel[m_currentModel]->onUpdate(elapsedSeconds);
+
 	double stop = Utils::getCurrentTime();
 
 	stop -= start;
@@ -358,67 +442,34 @@ bool Demo::onInit()
       mFPSSprite[digitId] = new Sprite(pos, size, m_fpsTextureId);
   }
 
-  // initialize models
-  Model *pModel;
-
-  // load 'cally' model
-  LOG("Loading 'cally' model ...");
+#ifdef USE_BENCHMARK
+  // the benchmarks compare against the keyframes of cal3d, so keep them
+  CoreModelData::setKeyframesReleased(false);
+#endif
 
-  pModel = new Model();
+  // queue all models, they are parsed on worker threads while the loading
+  // state is shown and finished in onLoadingDone
+  m_pAsyncLoader = new AsyncLoader();
 
-  if (m_strCal3D_Datapath != "")
-    pModel->setPath( m_strCal3D_Datapath + "/" + "cally/" );
+  const char *modelNames[] = { "cally", "skeleton", "paladin" };
 
-  if(!pModel->onInit(m_strDatapath + "cally.cfg"))
+  int modelId;
+  for(modelId = 0; modelId < 3; modelId++)
   {
-    delete pModel;
-    LOG("Model initialization failed! (cally)");
-    return false;
-  }
-  m_vectorModel.push_back(pModel);
-
-  // load 'skeleton' model
-  LOG("Loading 'skeleton' model ...");
-
-  pModel = new Model();
-
-  if (m_strCal3D_Datapath != "")
-    pModel->setPath( m_strCal3D_Datapath + "/" + "skeleton/" );
-
-  if(!pModel->onInit(m_strDatapath + "skeleton.cfg"))
-  {
-    delete pModel;
-    LOG("Model initialization failed! (skeleton)");
-    return false;
-  }
-
-  m_vectorModel.push_back(pModel);
-
-  // load 'paladin' model
-  LOG("Loading 'paladin' model ...");
-
-  pModel = new Model();
-
-  if (m_strCal3D_Datapath != "")
-    pModel->setPath( m_strCal3D_Datapath + "/" + "paladin/" );
-
-  if(!pModel->onInit(m_strDatapath + "paladin.cfg"))
-  {
-    delete pModel;
-    LOG("Model initialization failed! (paladin)");
-    return false;
-  }
-
-  m_vectorModel.push_back(pModel);
+    LOG("Loading '%s' model ...", modelNames[modelId]);
 
+    Model *pModel;
+    pModel = new Model();
 
-  // initialize menu
-  if(!theMenu.onInit(m_width, m_height))
-  {
-    LOG("Menu initialization failed!");
-    return false;
+    if (m_strCal3D_Datapath != "")
+      pModel->setPath( m_strCal3D_Datapath + "/" + modelNames[modelId] + "/" );
+
+    m_pAsyncLoader->addModel(pModel, m_strDatapath + modelNames[modelId] + ".cfg");
   }
 
+  m_loadingStartTick = Utils::getCurrentTime();
+  m_pAsyncLoader->start(AsyncLoader::getDefaultThreadCount());
+
   // we're done
   LOG("Initialization done.");
   return true;
@@ -433,19 +484,129 @@ void Demo::onKey(unsigned char key, int x, int y)
   // test for quit event
   if((key == 27) || (key == 'q') || (key == 'Q')) exit(0);
 
+  // nothing to control while the models are loading
+  if(isLoading()) return;
+
   // test for pause event
   if(key == ' ') m_bPaused = !m_bPaused;
 
+  // test for skinning path switch event
+  if((key == 'k') || (key == 'K'))
+  {
+    // cycle through all skinning paths supported by this cpu
+    int path;
+    path = Skinning::getPath();
+    do
+    {
+      path = (path + 1) % Skinning::PATH_COUNT;
+    } while(!Skinning::setPath((Skinning::Path)path));
+
+    LOG("Skinning path: %s", Skinning::getPathName(Skinning::getPath()));
+  }
+
+  // test for skinning method switch event
+  if((key == 'd') || (key == 'D'))
+  {
+    ModelPipeline *pModelPipeline;
+    pModelPipeline = m_vectorModel[m_currentModel]->getModelPipeline();
+    pModelPipeline->setSkinningMethod((Skinning::Method)((pModelPipeline->getSkinningMethod() + 1) % Skinning::METHOD_COUNT));
+
+    LOG("Skinning method: %s", Skinning::getMethodName(pModelPipeline->getSkinningMethod()));
+  }
+
+  // test for flat skeleton switch event
+  if((key == 'f') || (key == 'F'))
+  {
+    ModelPipeline *pModelPipeline;
+    pModelPipeline = m_vectorModel[m_currentModel]->getModelPipeline();
+    pModelPipeline->setFlatSkeleton(!pModelPipeline->isFlatSkeleton());
+
+    LOG("Flat skeleton: %s", pModelPipeline->isFlatSkeleton() ? "on" : "off");
+  }
+
+  // test for animation level of detail switch event
+  if((key == 'a') || (key == 'A'))
+  {
+    AnimationLod::setEnabled(!AnimationLod::isEnabled());
+
+    LOG("Animation lod: %s", AnimationLod::isEnabled() ? "on" : "off");
+  }
+
+  // test for hardware skinning switch event
+  if((key == 'h') || (key == 'H'))
+  {
+    HardwareSkinning::setEnabled(!HardwareSkinning::isEnabled());
+
+    LOG("Hardware skinning: %s", HardwareSkinning::isEnabled() ? "on" : "off");
+  }
+
   // let the menu handle the rest
   theMenu.onKey(key, x, y);
 }
 
+//----------------------------------------------------------------------------//
+// Take over the models once the loader has finished                          //
+//----------------------------------------------------------------------------//
+
+bool Demo::onLoadingDone()
+{
+  // the workers have nothing left to do at this point
+  m_pAsyncLoader->wait();
+
+  int jobId;
+  for(jobId = 0; jobId < m_pAsyncLoader->getJobCount(); jobId++)
+  {
+    Model *pModel;
+    pModel = m_pAsyncLoader->getModel(jobId);
+
+    if(m_pAsyncLoader->getState(jobId) == AsyncLoader::STATE_DONE)
+    {
+      m_vectorModel.push_back(pModel);
+    }
+    else
+    {
+      LOG("Model initialization failed! (%s)", pModel->getFilename().c_str());
+      pModel->onShutdown();
+      delete pModel;
+    }
+  }
+
+  delete m_pAsyncLoader;
+  m_pAsyncLoader = 0;
+
+  if(m_vectorModel.empty())
+  {
+    LOG("No model could be loaded!");
+    return false;
+  }
+
+  LOG("Loaded %d models in %u ms.", (int)m_vectorModel.size(), Utils::getCurrentTime() - m_loadingStartTick);
+  LOG("Core model cache: %d hits, %d misses, %d bytes saved", CoreModelCache::getHitCount(), CoreModelCache::getMissCount(), CoreModelCache::getBytesSaved());
+
+#ifdef USE_BENCHMARK
+  // run the headless benchmarks on the freshly loaded models
+  Bench::onInit(m_strCal3D_Datapath, m_vectorModel);
+#endif
+
+  // initialize menu
+  if(!theMenu.onInit(m_width, m_height))
+  {
+    LOG("Menu initialization failed!");
+    return false;
+  }
+
+  return true;
+}
+
 //----------------------------------------------------------------------------//
 // Handle a mouse button down event                                           //
 //----------------------------------------------------------------------------//
 
 void Demo::onMouseButtonDown(int button, int x, int y)
 {
+  // the menu needs a model to work on
+  if(isLoading()) return;
+
   // let the meu handle mouse buttons first
   if(!theMenu.onMouseButtonDown(button, x, y))
   {
@@ -472,6 +633,9 @@ void Demo::onMouseButtonDown(int button, int x, int y)
 
 void Demo::onMouseButtonUp(int button, int x, int y)
 {
+  // the menu needs a model to work on
+  if(isLoading()) return;
+
   // let the meu handle mouse buttons first
   if(!theMenu.onMouseButtonUp(button, x, y))
   {
@@ -498,6 +662,9 @@ void Demo::onMouseButtonUp(int button, int x, int y)
 
 void Demo::onMouseMove(int x, int y)
 {
+  // the menu needs a model to work on
+  if(isLoading()) return;
+
   // let the meu handle mouse buttons first
   if(!theMenu.onMouseMove(x, y))
   {
@@ -544,6 +711,17 @@ void Demo::onRender()
   glClearColor(0.0f, 0.0f, 0.2f, 0.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+  // show the logo and the loading progress until the models are ready
+  if(isLoading())
+  {
+    beginOverlay();
+    mLogoSprite->onRender();
+    renderDigits((m_pAsyncLoader != 0) ? (int)(m_pAsyncLoader->getProgress() * 100.0f) : 0);
+
+    m_fpsFrames++;
+    return;
+  }
+
   // get the render scale of the model
   float renderScale;
   renderScale = m_vectorModel[m_currentModel]->getRenderScale();
@@ -583,22 +761,8 @@ void Demo::onRender()
   // render model
   m_vectorModel[m_currentModel]->onRender();
 
-  // switch to orthogonal projection for 2d stuff
-  //flip the texture on y axis
-  glMatrixMode(GL_TEXTURE);
-  glLoadIdentity();
-  glScalef(1,1,1);
-
-  glMatrixMode(GL_PROJECTION);
-  glLoadIdentity();
-  glOrthof(0, (GLfloat)m_width, 0, (GLfloat)m_height, -1.0f, 1.0f);
-
-  glMatrixMode(GL_MODELVIEW);
-  glLoadIdentity();
-
-  // we will render some alpha-blended textures
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  // switch to orthogonal projection for 2d stuff
+  beginOverlay();
 
   // render menu
   theMenu.onRender();
@@ -606,20 +770,8 @@ void Demo::onRender()
   // render logo
   mLogoSprite->onRender();
 
-  // render fps
-  int digit = m_fps;
-  for(int digitId = 2; digitId >= 0; digitId--)
-  {
-      float * tempTextCoord = mFPSSprite[digitId]->getTextureCoord();
-      float tx = (float)(digit % 10) * 0.0625f;
-      tempTextCoord[0] = tx;              tempTextCoord[1] = 1.0f;
-      tempTextCoord[2] = tx + 0.0625f;    tempTextCoord[3] = 1.0f;
-      tempTextCoord[4] = tx;              tempTextCoord[5] = 0.0f;
-      tempTextCoord[6] = tx + 0.0625f;    tempTextCoord[7] = 0.0f;
-      mFPSSprite[digitId]->onRender();
-
-      digit /= 10;
-  }
+  // render fps
+  renderDigits(m_fps);
     /*      int error = glGetError();
     if(error == GL_NO_ERROR)
         LOG("No Error");
@@ -640,6 +792,27 @@ void Demo::onRender()
   m_fpsFrames++;
 }
 
+//----------------------------------------------------------------------------//
+// Render a three digit number with the fps sprites                           //
+//----------------------------------------------------------------------------//
+
+void Demo::renderDigits(int number)
+{
+  int digit = number;
+  for(int digitId = 2; digitId >= 0; digitId--)
+  {
+      float * tempTextCoord = mFPSSprite[digitId]->getTextureCoord();
+      float tx = (float)(digit % 10) * 0.0625f;
+      tempTextCoord[0] = tx;              tempTextCoord[1] = 1.0f;
+      tempTextCoord[2] = tx + 0.0625f;    tempTextCoord[3] = 1.0f;
+      tempTextCoord[4] = tx;              tempTextCoord[5] = 0.0f;
+      tempTextCoord[6] = tx + 0.0625f;    tempTextCoord[7] = 0.0f;
+      mFPSSprite[digitId]->onRender();
+
+      digit /= 10;
+  }
+}
+
 //----------------------------------------------------------------------------//
 // Shut the demo down                                                         //
 //----------------------------------------------------------------------------//
@@ -651,6 +824,22 @@ void Demo::onShutdown()
   delete mLogoSprite;
   theMenu.onShutdown();
 
+  // shut down the models that are still loading
+  if(m_pAsyncLoader != 0)
+  {
+    m_pAsyncLoader->wait();
+
+    int jobId;
+    for(jobId = 0; jobId < m_pAsyncLoader->getJobCount(); jobId++)
+    {
+      m_pAsyncLoader->getModel(jobId)->onShutdown();
+      delete m_pAsyncLoader->getModel(jobId);
+    }
+
+    delete m_pAsyncLoader;
+    m_pAsyncLoader = 0;
+  }
+
   // shut all models down
   unsigned int modelId;
   for(modelId = 0; modelId < m_vectorModel.size(); modelId++)
@@ -22,6 +22,7 @@
 // Forward declarations                                                       //
 //----------------------------------------------------------------------------//
 
+class AsyncLoader;
 class Model;
 
 //----------------------------------------------------------------------------//
@@ -52,6 +53,10 @@ protected:
   std::string m_strDatapath;
   std::string m_strCal3D_Datapath;
   std::vector<Model *> m_vectorModel;
+  AsyncLoader *m_pAsyncLoader;
+  unsigned int m_loadingStartTick;
+  bool m_bLoaded;
+  bool m_bLoadingFailed;
   unsigned int m_currentModel;
   bool m_bPaused;
 	float m_averageCPUTime;
@@ -73,6 +78,7 @@ public:
   int getHeight();
   Model *getModel();
   int getWidth();
+  bool isLoading();
   bool loadTexture(const std::string& strFllename, GLuint& pId);
   void nextModel();
   bool onCreate(int argc, char *argv[]);
@@ -85,6 +91,11 @@ public:
   void onRender();
   void onShutdown();
   void setDimension(int width, int height);
+
+protected:
+  void beginOverlay();
+  bool onLoadingDone();
+  void renderDigits(int number);
 };
 
 extern Demo theDemo;
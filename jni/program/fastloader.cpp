@@ -0,0 +1,311 @@
+//----------------------------------------------------------------------------//
+// fastloader.cpp                                                             //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "fastloader.h"
+#include "bulkdatasource.h"
+#include "cal3d/coretrack.h"
+#include "cal3d/corekeyframe.h"
+#include <string.h>
+
+//----------------------------------------------------------------------------//
+// Load a core animation, same file layout as CalLoader::loadCoreAnimation    //
+//----------------------------------------------------------------------------//
+
+CalCoreAnimationPtr FastLoader::loadCoreAnimation(BulkDataSource& dataSource)
+{
+  if(!readHeader(dataSource, Cal::ANIMATION_FILE_MAGIC)) return 0;
+
+  float duration;
+  int trackCount;
+  if(!dataSource.readFloat(duration) || !dataSource.readInteger(trackCount))
+  {
+    dataSource.setError();
+    return 0;
+  }
+
+  if(duration <= 0.0f)
+  {
+    CalError::setLastError(CalError::INVALID_ANIMATION_DURATION, __FILE__, __LINE__);
+    return 0;
+  }
+
+  CalCoreAnimationPtr pCoreAnimation;
+  pCoreAnimation = new CalCoreAnimation();
+  pCoreAnimation->setDuration(duration);
+
+  // the keyframes of each track are read into this buffer with a single call
+  std::vector<float> vectorKeyframeData;
+
+  int trackId;
+  for(trackId = 0; trackId < trackCount; trackId++)
+  {
+    CalCoreTrack *pCoreTrack;
+    pCoreTrack = loadCoreTrack(dataSource, vectorKeyframeData);
+    if(pCoreTrack == 0) return 0;
+
+    pCoreAnimation->addCoreTrack(pCoreTrack);
+  }
+
+  return pCoreAnimation;
+}
+
+//----------------------------------------------------------------------------//
+// Load a core mesh, same file layout as CalLoader::loadCoreMesh              //
+//----------------------------------------------------------------------------//
+
+CalCoreMeshPtr FastLoader::loadCoreMesh(BulkDataSource& dataSource)
+{
+  if(!readHeader(dataSource, Cal::MESH_FILE_MAGIC)) return 0;
+
+  int submeshCount;
+  if(!dataSource.readInteger(submeshCount))
+  {
+    dataSource.setError();
+    return 0;
+  }
+
+  CalCoreMeshPtr pCoreMesh;
+  pCoreMesh = new CalCoreMesh();
+
+  int submeshId;
+  for(submeshId = 0; submeshId < submeshCount; submeshId++)
+  {
+    CalCoreSubmesh *pCoreSubmesh;
+    pCoreSubmesh = loadCoreSubmesh(dataSource);
+    if(pCoreSubmesh == 0) return 0;
+
+    pCoreMesh->addCoreSubmesh(pCoreSubmesh);
+  }
+
+  return pCoreMesh;
+}
+
+//----------------------------------------------------------------------------//
+// Load a core submesh, the vertex data is written straight into the vectors  //
+// of the submesh                                                             //
+//----------------------------------------------------------------------------//
+
+CalCoreSubmesh *FastLoader::loadCoreSubmesh(BulkDataSource& dataSource)
+{
+  // material thread, vertex, face, lod, spring and texture coordinate counts
+  int header[6];
+  if(!dataSource.readIntegerArray(header, 6))
+  {
+    dataSource.setError();
+    return 0;
+  }
+
+  int vertexCount;
+  vertexCount = header[1];
+  int faceCount;
+  faceCount = header[2];
+  int springCount;
+  springCount = header[4];
+  int textureCoordinateCount;
+  textureCoordinateCount = header[5];
+
+  // a vertex takes at least its 8 values, a face 3 indices, a spring 4 values
+  // and a texture coordinate 2 values per vertex; counts the file cannot hold
+  // are rejected before they size any array
+  int vertexTextureCoordinateSize;
+  vertexTextureCoordinateSize = (vertexCount > 0) ? vertexCount * 8 : 8;
+
+  if(!dataSource.isArrayAvailable(vertexCount, 32) || !dataSource.isArrayAvailable(faceCount, 12) || !dataSource.isArrayAvailable(springCount, 16)
+    || !dataSource.isArrayAvailable(textureCoordinateCount, vertexTextureCoordinateSize))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return 0;
+  }
+
+  CalCoreSubmesh *pCoreSubmesh;
+  pCoreSubmesh = new CalCoreSubmesh();
+  pCoreSubmesh->setCoreMaterialThreadId(header[0]);
+  pCoreSubmesh->setLodCount(header[3]);
+
+  if(!pCoreSubmesh->reserve(vertexCount, textureCoordinateCount, faceCount, springCount))
+  {
+    CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__);
+    delete pCoreSubmesh;
+    return 0;
+  }
+
+  std::vector<CalCoreSubmesh::Vertex>& vectorVertex = pCoreSubmesh->getVectorVertex();
+  std::vector<std::vector<CalCoreSubmesh::TextureCoordinate> >& vectorvectorTextureCoordinate = pCoreSubmesh->getVectorVectorTextureCoordinate();
+  std::vector<CalCoreSubmesh::PhysicalProperty>& vectorPhysicalProperty = pCoreSubmesh->getVectorPhysicalProperty();
+
+  bool bOk;
+  bOk = true;
+
+  int vertexId;
+  for(vertexId = 0; bOk && (vertexId < vertexCount); vertexId++)
+  {
+    CalCoreSubmesh::Vertex& vertex = vectorVertex[vertexId];
+
+    // position, normal, collapse id and face collapse count
+    float vertexData[8];
+    bOk = dataSource.readFloatArray(vertexData, 8);
+    if(!bOk) break;
+
+    vertex.position.set(vertexData[0], vertexData[1], vertexData[2]);
+    vertex.normal.set(vertexData[3], vertexData[4], vertexData[5]);
+    memcpy(&vertex.collapseId, &vertexData[6], 4);
+    memcpy(&vertex.faceCollapseCount, &vertexData[7], 4);
+
+    int textureCoordinateId;
+    for(textureCoordinateId = 0; bOk && (textureCoordinateId < textureCoordinateCount); textureCoordinateId++)
+    {
+      bOk = dataSource.readFloatArray(&vectorvectorTextureCoordinate[textureCoordinateId][vertexId].u, 2);
+    }
+
+    int influenceCount;
+    bOk = bOk && dataSource.readInteger(influenceCount) && dataSource.isArrayAvailable(influenceCount, 8);
+    if(!bOk) break;
+
+    // an influence is a bone id and a weight, both 32 bit
+    vertex.vectorInfluence.resize(influenceCount);
+    if(influenceCount > 0)
+    {
+      bOk = dataSource.readIntegerArray((int *)&vertex.vectorInfluence[0], influenceCount * 2);
+    }
+
+    if(bOk && (springCount > 0))
+    {
+      bOk = dataSource.readFloat(vectorPhysicalProperty[vertexId].weight);
+    }
+  }
+
+  // a spring is two vertex ids, the coefficient and the idle length
+  if(bOk && (springCount > 0))
+  {
+    bOk = dataSource.readIntegerArray((int *)&pCoreSubmesh->getVectorSpring()[0], springCount * 4);
+  }
+
+  // the faces are stored as integers but kept as indices
+  if(bOk && (faceCount > 0))
+  {
+    std::vector<int> vectorFaceData(faceCount * 3);
+    bOk = dataSource.readIntegerArray(&vectorFaceData[0], faceCount * 3);
+
+    std::vector<CalCoreSubmesh::Face>& vectorFace = pCoreSubmesh->getVectorFace();
+
+#ifdef CAL_16BIT_INDICES
+    // like CalLoader, indices that do not fit into 16 bits fail the load
+    // instead of being truncated
+    int valueId;
+    for(valueId = 0; bOk && (valueId < faceCount * 3); valueId++)
+    {
+      if((vectorFaceData[valueId] < 0) || (vectorFaceData[valueId] > 65535))
+      {
+        CalError::setLastError(CalError::INDEX_BUILD_FAILED, __FILE__, __LINE__);
+        delete pCoreSubmesh;
+        return 0;
+      }
+    }
+#endif
+
+    int faceId;
+    for(faceId = 0; bOk && (faceId < faceCount); faceId++)
+    {
+      vectorFace[faceId].vertexId[0] = (CalIndex)vectorFaceData[faceId * 3];
+      vectorFace[faceId].vertexId[1] = (CalIndex)vectorFaceData[faceId * 3 + 1];
+      vectorFace[faceId].vertexId[2] = (CalIndex)vectorFaceData[faceId * 3 + 2];
+    }
+  }
+
+  if(!bOk)
+  {
+    dataSource.setError();
+    delete pCoreSubmesh;
+    return 0;
+  }
+
+  return pCoreSubmesh;
+}
+
+//----------------------------------------------------------------------------//
+// Load a core track, all keyframes come in with a single read                //
+//----------------------------------------------------------------------------//
+
+CalCoreTrack *FastLoader::loadCoreTrack(BulkDataSource& dataSource, std::vector<float>& vectorKeyframeData)
+{
+  int coreBoneId;
+  int keyframeCount;
+  if(!dataSource.readInteger(coreBoneId) || !dataSource.readInteger(keyframeCount))
+  {
+    dataSource.setError();
+    return 0;
+  }
+
+  // a keyframe is 8 values, the count is checked before it sizes the array;
+  // negative bone ids are rejected like in CalLoader
+  if((coreBoneId < 0) || (keyframeCount <= 0) || !dataSource.isArrayAvailable(keyframeCount, 32))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return 0;
+  }
+
+  // time, translation and rotation of each keyframe
+  vectorKeyframeData.resize(keyframeCount * 8);
+  if(!dataSource.readFloatArray(&vectorKeyframeData[0], keyframeCount * 8))
+  {
+    dataSource.setError();
+    return 0;
+  }
+
+  CalCoreTrack *pCoreTrack;
+  pCoreTrack = new CalCoreTrack();
+  pCoreTrack->create();
+  pCoreTrack->setCoreBoneId(coreBoneId);
+
+  int keyframeId;
+  for(keyframeId = 0; keyframeId < keyframeCount; keyframeId++)
+  {
+    const float *pData = &vectorKeyframeData[keyframeId * 8];
+
+    CalCoreKeyframe *pCoreKeyframe;
+    pCoreKeyframe = new CalCoreKeyframe();
+    pCoreKeyframe->create();
+    pCoreKeyframe->setTime(pData[0]);
+    pCoreKeyframe->setTranslation(CalVector(pData[1], pData[2], pData[3]));
+    pCoreKeyframe->setRotation(CalQuaternion(pData[4], pData[5], pData[6], pData[7]));
+
+    pCoreTrack->addCoreKeyframe(pCoreKeyframe);
+  }
+
+  return pCoreTrack;
+}
+
+//----------------------------------------------------------------------------//
+// Check the magic token and the version of a file                            //
+//----------------------------------------------------------------------------//
+
+bool FastLoader::readHeader(BulkDataSource& dataSource, const char *pMagic)
+{
+  char magic[4];
+  if(!dataSource.readBytes(magic, 4) || (memcmp(magic, pMagic, 4) != 0))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return false;
+  }
+
+  int version;
+  if(!dataSource.readInteger(version) || (version < Cal::EARLIEST_COMPATIBLE_FILE_VERSION) || (version > Cal::CURRENT_FILE_VERSION))
+  {
+    CalError::setLastError(CalError::INCOMPATIBLE_FILE_VERSION, __FILE__, __LINE__);
+    return false;
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
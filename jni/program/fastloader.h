@@ -0,0 +1,47 @@
+//----------------------------------------------------------------------------//
+// fastloader.h                                                               //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef FASTLOADER_H
+#define FASTLOADER_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+
+//----------------------------------------------------------------------------//
+// Forward declarations                                                       //
+//----------------------------------------------------------------------------//
+
+class BulkDataSource;
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+// reads the binary mesh and animation files like CalLoader, but with bulk
+// array reads for the vertex, face and keyframe data; the loading mode of
+// CalLoader is not applied, the demo never changes it
+class FastLoader
+{
+// member functions
+public:
+  static CalCoreAnimationPtr loadCoreAnimation(BulkDataSource& dataSource);
+  static CalCoreMeshPtr loadCoreMesh(BulkDataSource& dataSource);
+
+protected:
+  static CalCoreSubmesh *loadCoreSubmesh(BulkDataSource& dataSource);
+  static CalCoreTrack *loadCoreTrack(BulkDataSource& dataSource, std::vector<float>& vectorKeyframeData);
+  static bool readHeader(BulkDataSource& dataSource, const char *pMagic);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,382 @@
+//----------------------------------------------------------------------------//
+// flatskeleton.cpp                                                           //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "flatskeleton.h"
+#include "skinning.h"
+#include <string.h>
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+FlatSkeleton::FlatSkeleton()
+{
+  m_pCoreSkeleton = 0;
+  m_bSorted = true;
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+FlatSkeleton::~FlatSkeleton()
+{
+}
+
+//----------------------------------------------------------------------------//
+// Calculate the absolute and bone space states and the bone matrices of all  //
+// bones, same results as CalSkeleton::calculateState                         //
+//----------------------------------------------------------------------------//
+
+void FlatSkeleton::calculateState()
+{
+  int boneCount;
+  boneCount = (int)m_vectorLocal.size();
+
+  int index;
+  for(index = 0; index < boneCount; index++)
+  {
+    // the parent was calculated earlier in this pass
+    int parentIndex;
+    parentIndex = m_vectorParentIndex[index];
+
+    if(parentIndex == -1)
+    {
+      m_vectorAbsolute[index] = m_vectorLocal[index];
+    }
+    else
+    {
+      multiply(m_vectorLocal[index], m_vectorAbsolute[parentIndex], m_vectorAbsolute[index]);
+    }
+
+    multiply(m_vectorCoreBoneSpace[index], m_vectorAbsolute[index], m_vectorBoneSpace[index]);
+
+    // same matrix as CalMatrix::operator=(const CalQuaternion&), in the
+    // layout of the bone matrices of Skinning
+    const Transform& boneSpace = m_vectorBoneSpace[index];
+    const float *q = boneSpace.rotation;
+
+    float xx2, yy2, zz2, xy2, zw2, xz2, yw2, yz2, xw2;
+    xx2 = q[0] * q[0] * 2;
+    yy2 = q[1] * q[1] * 2;
+    zz2 = q[2] * q[2] * 2;
+    xy2 = q[0] * q[1] * 2;
+    zw2 = q[2] * q[3] * 2;
+    xz2 = q[0] * q[2] * 2;
+    yw2 = q[1] * q[3] * 2;
+    yz2 = q[1] * q[2] * 2;
+    xw2 = q[0] * q[3] * 2;
+
+    float *pMatrix = &m_vectorBoneMatrix[index * Skinning::BONE_MATRIX_SIZE];
+    pMatrix[0] = 1 - yy2 - zz2; pMatrix[1] = xy2 + zw2; pMatrix[2] = xz2 - yw2; pMatrix[3] = boneSpace.translation[0];
+    pMatrix[4] = xy2 - zw2; pMatrix[5] = 1 - xx2 - zz2; pMatrix[6] = yz2 + xw2; pMatrix[7] = boneSpace.translation[1];
+    pMatrix[8] = xz2 + yw2; pMatrix[9] = yz2 - xw2; pMatrix[10] = 1 - xx2 - yy2; pMatrix[11] = boneSpace.translation[2];
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Create the arrays of a core skeleton, the bones start in the core state    //
+//----------------------------------------------------------------------------//
+
+bool FlatSkeleton::create(CalCoreSkeleton *pCoreSkeleton)
+{
+  m_pCoreSkeleton = pCoreSkeleton;
+
+  if(pCoreSkeleton == 0) return false;
+
+  std::vector<CalCoreBone *>& vectorCoreBone = pCoreSkeleton->getVectorCoreBone();
+
+  int boneCount;
+  boneCount = (int)vectorCoreBone.size();
+
+  // every bone appends its children, so each parent stays before them
+  m_vectorBoneId.clear();
+  m_vectorBoneId.reserve(boneCount);
+
+  std::vector<int>& vectorRootCoreBoneId = pCoreSkeleton->getVectorRootCoreBoneId();
+  m_vectorBoneId.insert(m_vectorBoneId.end(), vectorRootCoreBoneId.begin(), vectorRootCoreBoneId.end());
+
+  int index;
+  for(index = 0; index < (int)m_vectorBoneId.size(); index++)
+  {
+    std::list<int>& listChildId = vectorCoreBone[m_vectorBoneId[index]]->getListChildId();
+    m_vectorBoneId.insert(m_vectorBoneId.end(), listChildId.begin(), listChildId.end());
+  }
+
+  if((int)m_vectorBoneId.size() != boneCount)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    m_vectorBoneId.clear();
+    return false;
+  }
+
+  m_vectorIndex.assign(boneCount, -1);
+  m_bSorted = true;
+
+  for(index = 0; index < boneCount; index++)
+  {
+    m_vectorIndex[m_vectorBoneId[index]] = index;
+    if(m_vectorBoneId[index] != index) m_bSorted = false;
+  }
+
+  m_vectorParentIndex.resize(boneCount);
+  m_vectorLocal.resize(boneCount);
+  m_vectorAbsolute.resize(boneCount);
+  m_vectorCoreBoneSpace.resize(boneCount);
+  m_vectorBoneSpace.resize(boneCount);
+  m_vectorBoneMatrix.resize(boneCount * Skinning::BONE_MATRIX_SIZE);
+
+  for(index = 0; index < boneCount; index++)
+  {
+    CalCoreBone *pCoreBone;
+    pCoreBone = vectorCoreBone[m_vectorBoneId[index]];
+
+    int parentId;
+    parentId = pCoreBone->getParentId();
+    m_vectorParentIndex[index] = (parentId == -1) ? -1 : m_vectorIndex[parentId];
+
+    const CalVector& translation = pCoreBone->getTranslationBoneSpace();
+    const CalQuaternion& rotation = pCoreBone->getRotationBoneSpace();
+
+    Transform& coreBoneSpace = m_vectorCoreBoneSpace[index];
+    coreBoneSpace.translation[0] = translation.x;
+    coreBoneSpace.translation[1] = translation.y;
+    coreBoneSpace.translation[2] = translation.z;
+    coreBoneSpace.rotation[0] = rotation.x;
+    coreBoneSpace.rotation[1] = rotation.y;
+    coreBoneSpace.rotation[2] = rotation.z;
+    coreBoneSpace.rotation[3] = rotation.w;
+  }
+
+  setCoreState();
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bones                                                    //
+//----------------------------------------------------------------------------//
+
+int FlatSkeleton::getBoneCount()
+{
+  return m_vectorLocal.size();
+}
+
+//----------------------------------------------------------------------------//
+// Get the cal3d bone id of a sorted index                                    //
+//----------------------------------------------------------------------------//
+
+int FlatSkeleton::getBoneId(int index)
+{
+  return m_vectorBoneId[index];
+}
+
+//----------------------------------------------------------------------------//
+// Get the bone matrices in cal3d bone id order, the layout of                //
+// Skinning::calculateBoneMatrices                                            //
+//----------------------------------------------------------------------------//
+
+void FlatSkeleton::getBoneMatrices(float *pBoneMatrixBuffer)
+{
+  if(m_vectorBoneMatrix.empty()) return;
+
+  // most exporters already write the parents first
+  if(m_bSorted)
+  {
+    memcpy(pBoneMatrixBuffer, &m_vectorBoneMatrix[0], m_vectorBoneMatrix.size() * sizeof(float));
+    return;
+  }
+
+  int index;
+  for(index = 0; index < (int)m_vectorBoneId.size(); index++)
+  {
+    memcpy(&pBoneMatrixBuffer[m_vectorBoneId[index] * Skinning::BONE_MATRIX_SIZE], &m_vectorBoneMatrix[index * Skinning::BONE_MATRIX_SIZE], Skinning::BONE_MATRIX_SIZE * sizeof(float));
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Get the memory used by the arrays                                          //
+//----------------------------------------------------------------------------//
+
+int FlatSkeleton::getByteSize()
+{
+  return (m_vectorParentIndex.size() + m_vectorBoneId.size() + m_vectorIndex.size()) * sizeof(int)
+    + (m_vectorLocal.size() + m_vectorAbsolute.size() + m_vectorCoreBoneSpace.size() + m_vectorBoneSpace.size()) * sizeof(Transform)
+    + m_vectorBoneMatrix.size() * sizeof(float);
+}
+
+//----------------------------------------------------------------------------//
+// Get the sorted index of a cal3d bone id                                    //
+//----------------------------------------------------------------------------//
+
+int FlatSkeleton::getIndex(int boneId)
+{
+  return m_vectorIndex[boneId];
+}
+
+//----------------------------------------------------------------------------//
+// Get the sorted index of the parent of a bone, -1 for a root bone           //
+//----------------------------------------------------------------------------//
+
+int FlatSkeleton::getParentIndex(int index)
+{
+  return m_vectorParentIndex[index];
+}
+
+//----------------------------------------------------------------------------//
+// Get the relative rotation of a bone, like CalBone::getRotation             //
+//----------------------------------------------------------------------------//
+
+CalQuaternion FlatSkeleton::getRotation(int boneId)
+{
+  const float *q = m_vectorLocal[m_vectorIndex[boneId]].rotation;
+  return CalQuaternion(q[0], q[1], q[2], q[3]);
+}
+
+//----------------------------------------------------------------------------//
+// Get the absolute rotation of a bone, like CalBone::getRotationAbsolute     //
+//----------------------------------------------------------------------------//
+
+CalQuaternion FlatSkeleton::getRotationAbsolute(int boneId)
+{
+  const float *q = m_vectorAbsolute[m_vectorIndex[boneId]].rotation;
+  return CalQuaternion(q[0], q[1], q[2], q[3]);
+}
+
+//----------------------------------------------------------------------------//
+// Get the bone space rotation of a bone, like CalBone::getRotationBoneSpace  //
+//----------------------------------------------------------------------------//
+
+CalQuaternion FlatSkeleton::getRotationBoneSpace(int boneId)
+{
+  const float *q = m_vectorBoneSpace[m_vectorIndex[boneId]].rotation;
+  return CalQuaternion(q[0], q[1], q[2], q[3]);
+}
+
+//----------------------------------------------------------------------------//
+// Get the relative translation of a bone, like CalBone::getTranslation       //
+//----------------------------------------------------------------------------//
+
+CalVector FlatSkeleton::getTranslation(int boneId)
+{
+  const float *t = m_vectorLocal[m_vectorIndex[boneId]].translation;
+  return CalVector(t[0], t[1], t[2]);
+}
+
+//----------------------------------------------------------------------------//
+// Get the absolute translation of a bone, like                               //
+// CalBone::getTranslationAbsolute                                            //
+//----------------------------------------------------------------------------//
+
+CalVector FlatSkeleton::getTranslationAbsolute(int boneId)
+{
+  const float *t = m_vectorAbsolute[m_vectorIndex[boneId]].translation;
+  return CalVector(t[0], t[1], t[2]);
+}
+
+//----------------------------------------------------------------------------//
+// Get the bone space translation of a bone, like                             //
+// CalBone::getTranslationBoneSpace                                           //
+//----------------------------------------------------------------------------//
+
+CalVector FlatSkeleton::getTranslationBoneSpace(int boneId)
+{
+  const float *t = m_vectorBoneSpace[m_vectorIndex[boneId]].translation;
+  return CalVector(t[0], t[1], t[2]);
+}
+
+//----------------------------------------------------------------------------//
+// Transform a transformation into the space of its parent, the same          //
+// quaternion products as CalBone::calculateState                             //
+//----------------------------------------------------------------------------//
+
+void FlatSkeleton::multiply(const Transform& transform, const Transform& parent, Transform& result)
+{
+  const float *q = parent.rotation;
+  const float *v = transform.translation;
+  const float *r = transform.rotation;
+
+  // CalVector::operator*=(const CalQuaternion&), the conjugate of the
+  // rotation times the vector times the rotation
+  float tx, ty, tz, tw;
+  tx = q[3] * v[0] - q[1] * v[2] + q[2] * v[1];
+  ty = q[3] * v[1] + q[0] * v[2] - q[2] * v[0];
+  tz = q[3] * v[2] - q[0] * v[1] + q[1] * v[0];
+  tw = q[0] * v[0] + q[1] * v[1] + q[2] * v[2];
+
+  result.translation[0] = tw * q[0] + tx * q[3] + ty * q[2] - tz * q[1] + parent.translation[0];
+  result.translation[1] = tw * q[1] - tx * q[2] + ty * q[3] + tz * q[0] + parent.translation[1];
+  result.translation[2] = tw * q[2] + tx * q[1] - ty * q[0] + tz * q[3] + parent.translation[2];
+
+  // CalQuaternion::operator*=(const CalQuaternion&)
+  float x, y, z, w;
+  x = r[3] * q[0] + r[0] * q[3] + r[1] * q[2] - r[2] * q[1];
+  y = r[3] * q[1] - r[0] * q[2] + r[1] * q[3] + r[2] * q[0];
+  z = r[3] * q[2] + r[0] * q[1] - r[1] * q[0] + r[2] * q[3];
+  w = r[3] * q[3] - r[0] * q[0] - r[1] * q[1] - r[2] * q[2];
+
+  result.rotation[0] = x;
+  result.rotation[1] = y;
+  result.rotation[2] = z;
+  result.rotation[3] = w;
+}
+
+//----------------------------------------------------------------------------//
+// Set the relative states of all bones to the core states                    //
+//----------------------------------------------------------------------------//
+
+void FlatSkeleton::setCoreState()
+{
+  if(m_pCoreSkeleton == 0) return;
+
+  std::vector<CalCoreBone *>& vectorCoreBone = m_pCoreSkeleton->getVectorCoreBone();
+
+  int boneId;
+  for(boneId = 0; boneId < (int)m_vectorIndex.size(); boneId++)
+  {
+    setState(boneId, vectorCoreBone[boneId]->getTranslation(), vectorCoreBone[boneId]->getRotation());
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Copy the relative states of all bones of a calculated cal3d skeleton       //
+//----------------------------------------------------------------------------//
+
+void FlatSkeleton::setState(CalSkeleton *pSkeleton)
+{
+  std::vector<CalBone *>& vectorBone = pSkeleton->getVectorBone();
+
+  int boneId;
+  for(boneId = 0; boneId < (int)m_vectorIndex.size(); boneId++)
+  {
+    setState(boneId, vectorBone[boneId]->getTranslation(), vectorBone[boneId]->getRotation());
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Set the relative state of a bone                                           //
+//----------------------------------------------------------------------------//
+
+void FlatSkeleton::setState(int boneId, const CalVector& translation, const CalQuaternion& rotation)
+{
+  Transform& local = m_vectorLocal[m_vectorIndex[boneId]];
+  local.translation[0] = translation.x;
+  local.translation[1] = translation.y;
+  local.translation[2] = translation.z;
+  local.rotation[0] = rotation.x;
+  local.rotation[1] = rotation.y;
+  local.rotation[2] = rotation.z;
+  local.rotation[3] = rotation.w;
+}
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,84 @@
+//----------------------------------------------------------------------------//
+// flatskeleton.h                                                             //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef FLATSKELETON_H
+#define FLATSKELETON_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+// the bone states of a skeleton in contiguous arrays, sorted so that every
+// parent comes before its children, so the absolute states are calculated in
+// one linear pass instead of the recursion through the bones of CalSkeleton;
+// the arrays are indexed by the sorted index, the getters that take a bone id
+// use the bone ids of cal3d
+class FlatSkeleton
+{
+// misc
+public:
+  // a rigid transformation, the rotation is a quaternion in the convention of
+  // CalQuaternion
+  struct Transform
+  {
+    float translation[3];
+    float rotation[4];
+  };
+
+// member variables
+protected:
+  CalCoreSkeleton *m_pCoreSkeleton;
+  std::vector<int> m_vectorParentIndex;
+  std::vector<int> m_vectorBoneId;
+  std::vector<int> m_vectorIndex;
+  std::vector<Transform> m_vectorLocal;
+  std::vector<Transform> m_vectorAbsolute;
+  std::vector<Transform> m_vectorCoreBoneSpace;
+  std::vector<Transform> m_vectorBoneSpace;
+  std::vector<float> m_vectorBoneMatrix;
+  bool m_bSorted;
+
+// constructors/destructor
+public:
+  FlatSkeleton();
+  virtual ~FlatSkeleton();
+
+// member functions
+public:
+  void calculateState();
+  bool create(CalCoreSkeleton *pCoreSkeleton);
+  int getBoneCount();
+  int getBoneId(int index);
+  void getBoneMatrices(float *pBoneMatrixBuffer);
+  int getByteSize();
+  int getIndex(int boneId);
+  int getParentIndex(int index);
+  CalQuaternion getRotation(int boneId);
+  CalQuaternion getRotationAbsolute(int boneId);
+  CalQuaternion getRotationBoneSpace(int boneId);
+  CalVector getTranslation(int boneId);
+  CalVector getTranslationAbsolute(int boneId);
+  CalVector getTranslationBoneSpace(int boneId);
+  void setCoreState();
+  void setState(CalSkeleton *pSkeleton);
+  void setState(int boneId, const CalVector& translation, const CalQuaternion& rotation);
+
+protected:
+  static void multiply(const Transform& transform, const Transform& parent, Transform& result);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,563 @@
+//----------------------------------------------------------------------------//
+// hardwareskinning.cpp                                                       //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "hardwareskinning.h"
+#include "skinning.h"
+#include <EGL/egl.h>
+#include <stddef.h>
+#include <math.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------//
+// Static member variables initialization                                     //
+//----------------------------------------------------------------------------//
+
+const int HardwareSkinning::INFLUENCE_COUNT = 4;
+const int HardwareSkinning::PALETTE_MATRIX_SIZE = 12;
+
+PFNGLCURRENTPALETTEMATRIXOESPROC HardwareSkinning::m_glCurrentPaletteMatrixOES = 0;
+PFNGLLOADPALETTEFROMMODELVIEWMATRIXOESPROC HardwareSkinning::m_glLoadPaletteFromModelViewMatrixOES = 0;
+PFNGLMATRIXINDEXPOINTEROESPROC HardwareSkinning::m_glMatrixIndexPointerOES = 0;
+PFNGLWEIGHTPOINTEROESPROC HardwareSkinning::m_glWeightPointerOES = 0;
+bool HardwareSkinning::m_bEnabled = false;
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+HardwareSkinning::HardwareSkinning()
+{
+  m_pModel = 0;
+  m_pHardwareModel = 0;
+  m_influenceCount = INFLUENCE_COUNT;
+  m_vertexBufferId = 0;
+  m_indexBufferId = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+HardwareSkinning::~HardwareSkinning()
+{
+  onShutdown();
+}
+
+//----------------------------------------------------------------------------//
+// Bind the buffers and enable the matrix palette, must run on the thread     //
+// that owns the context                                                      //
+//----------------------------------------------------------------------------//
+
+void HardwareSkinning::beginRendering()
+{
+  glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferId);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferId);
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_NORMAL_ARRAY);
+  glEnableClientState(GL_MATRIX_INDEX_ARRAY_OES);
+  glEnableClientState(GL_WEIGHT_ARRAY_OES);
+
+  glEnable(GL_MATRIX_PALETTE_OES);
+}
+
+//----------------------------------------------------------------------------//
+// Skin a hardware mesh on the cpu exactly like the matrix palette does, the  //
+// reference the gpu output gets verified against                             //
+//----------------------------------------------------------------------------//
+
+int HardwareSkinning::calculateVertices(int hardwareMeshId, float *pVertexBuffer, float *pNormalBuffer)
+{
+  if(!m_pHardwareModel->selectHardwareMesh(hardwareMeshId)) return 0;
+
+  int baseVertexId;
+  baseVertexId = m_pHardwareModel->getBaseVertexIndex();
+  int vertexCount;
+  vertexCount = m_pHardwareModel->getVertexCount();
+
+  const float *pPaletteMatrix;
+  pPaletteMatrix = &m_vectorPaletteMatrix[m_vectorFirstPaletteMatrixId[hardwareMeshId] * PALETTE_MATRIX_SIZE];
+
+  int vertexId;
+  for(vertexId = 0; vertexId < vertexCount; vertexId++)
+  {
+    const Vertex& vertex = m_vectorVertex[baseVertexId + vertexId];
+
+    float x, y, z;
+    x = y = z = 0.0f;
+    float nx, ny, nz;
+    nx = ny = nz = 0.0f;
+
+    // the weighted sum of all palette matrices, one per vertex unit
+    int influenceId;
+    for(influenceId = 0; influenceId < m_influenceCount; influenceId++)
+    {
+      float weight;
+      weight = vertex.weight[influenceId];
+      if(weight == 0.0f) continue;
+
+      const float *m = &pPaletteMatrix[vertex.matrixIndex[influenceId] * PALETTE_MATRIX_SIZE];
+
+      x += weight * (m[0] * vertex.position[0] + m[1] * vertex.position[1] + m[2] * vertex.position[2] + m[3]);
+      y += weight * (m[4] * vertex.position[0] + m[5] * vertex.position[1] + m[6] * vertex.position[2] + m[7]);
+      z += weight * (m[8] * vertex.position[0] + m[9] * vertex.position[1] + m[10] * vertex.position[2] + m[11]);
+
+      nx += weight * (m[0] * vertex.normal[0] + m[1] * vertex.normal[1] + m[2] * vertex.normal[2]);
+      ny += weight * (m[4] * vertex.normal[0] + m[5] * vertex.normal[1] + m[6] * vertex.normal[2]);
+      nz += weight * (m[8] * vertex.normal[0] + m[9] * vertex.normal[1] + m[10] * vertex.normal[2]);
+    }
+
+    pVertexBuffer[vertexId * 3] = x;
+    pVertexBuffer[vertexId * 3 + 1] = y;
+    pVertexBuffer[vertexId * 3 + 2] = z;
+
+    float length;
+    length = sqrt(nx * nx + ny * ny + nz * nz);
+    if(length > 0.0f)
+    {
+      nx /= length;
+      ny /= length;
+      nz /= length;
+    }
+
+    pNormalBuffer[vertexId * 3] = nx;
+    pNormalBuffer[vertexId * 3 + 1] = ny;
+    pNormalBuffer[vertexId * 3 + 2] = nz;
+  }
+
+  return vertexCount;
+}
+
+//----------------------------------------------------------------------------//
+// Load the palette of a hardware mesh and draw it, between beginRendering    //
+// and endRendering                                                           //
+//----------------------------------------------------------------------------//
+
+void HardwareSkinning::drawHardwareMesh(int hardwareMeshId, GLenum mode)
+{
+  if(!m_pHardwareModel->selectHardwareMesh(hardwareMeshId)) return;
+
+  // every palette matrix is the current modelview times the bone transform
+  const float *pPaletteMatrix;
+  pPaletteMatrix = &m_vectorPaletteMatrix[m_vectorFirstPaletteMatrixId[hardwareMeshId] * PALETTE_MATRIX_SIZE];
+
+  glMatrixMode(GL_MATRIX_PALETTE_OES);
+
+  int boneId;
+  for(boneId = 0; boneId < m_pHardwareModel->getBoneCount(); boneId++)
+  {
+    // gl takes column-major 4x4 matrices
+    const float *m = &pPaletteMatrix[boneId * PALETTE_MATRIX_SIZE];
+
+    GLfloat matrix[16];
+    matrix[0] = m[0]; matrix[4] = m[1]; matrix[8] = m[2]; matrix[12] = m[3];
+    matrix[1] = m[4]; matrix[5] = m[5]; matrix[9] = m[6]; matrix[13] = m[7];
+    matrix[2] = m[8]; matrix[6] = m[9]; matrix[10] = m[10]; matrix[14] = m[11];
+    matrix[3] = 0.0f; matrix[7] = 0.0f; matrix[11] = 0.0f; matrix[15] = 1.0f;
+
+    m_glCurrentPaletteMatrixOES(boneId);
+    m_glLoadPaletteFromModelViewMatrixOES();
+    glMultMatrixf(matrix);
+  }
+
+  glMatrixMode(GL_MODELVIEW);
+
+  // the indices of a hardware mesh start at its base vertex
+  const char *pBaseVertex;
+  pBaseVertex = (const char *)0 + m_pHardwareModel->getBaseVertexIndex() * sizeof(Vertex);
+
+  glVertexPointer(3, GL_FLOAT, sizeof(Vertex), pBaseVertex + offsetof(Vertex, position));
+  glNormalPointer(GL_FLOAT, sizeof(Vertex), pBaseVertex + offsetof(Vertex, normal));
+  glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), pBaseVertex + offsetof(Vertex, textureCoordinate));
+  m_glWeightPointerOES(m_influenceCount, GL_FLOAT, sizeof(Vertex), pBaseVertex + offsetof(Vertex, weight));
+  m_glMatrixIndexPointerOES(m_influenceCount, GL_UNSIGNED_BYTE, sizeof(Vertex), pBaseVertex + offsetof(Vertex, matrixIndex));
+
+  glDrawElements(mode, m_pHardwareModel->getFaceCount() * 3, GL_UNSIGNED_SHORT, (const char *)0 + m_pHardwareModel->getStartIndex() * sizeof(CalIndex));
+}
+
+//----------------------------------------------------------------------------//
+// Restore the states changed by beginRendering                               //
+//----------------------------------------------------------------------------//
+
+void HardwareSkinning::endRendering()
+{
+  glDisable(GL_MATRIX_PALETTE_OES);
+
+  glDisableClientState(GL_WEIGHT_ARRAY_OES);
+  glDisableClientState(GL_MATRIX_INDEX_ARRAY_OES);
+  glDisableClientState(GL_NORMAL_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+//----------------------------------------------------------------------------//
+// Get the memory of the static vertex and index data                         //
+//----------------------------------------------------------------------------//
+
+int HardwareSkinning::getByteSize()
+{
+  return m_vectorVertex.size() * sizeof(Vertex) + m_vectorIndex.size() * sizeof(CalIndex);
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of hardware meshes                                          //
+//----------------------------------------------------------------------------//
+
+int HardwareSkinning::getHardwareMeshCount()
+{
+  return (m_pHardwareModel != 0) ? m_pHardwareModel->getHardwareMeshCount() : 0;
+}
+
+//----------------------------------------------------------------------------//
+// Get the hardware model                                                     //
+//----------------------------------------------------------------------------//
+
+CalHardwareModel *HardwareSkinning::getHardwareModel()
+{
+  return m_pHardwareModel;
+}
+
+//----------------------------------------------------------------------------//
+// Get the index buffer, the indices of a hardware mesh start at its base     //
+// vertex                                                                     //
+//----------------------------------------------------------------------------//
+
+const std::vector<CalIndex>& HardwareSkinning::getIndices()
+{
+  return m_vectorIndex;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of influences per vertex                                    //
+//----------------------------------------------------------------------------//
+
+int HardwareSkinning::getInfluenceCount()
+{
+  return m_influenceCount;
+}
+
+//----------------------------------------------------------------------------//
+// Convert the packed palette of a hardware mesh into dual quaternions, the   //
+// buffer needs room for Skinning::DUAL_QUATERNION_SIZE floats per bone       //
+//----------------------------------------------------------------------------//
+
+int HardwareSkinning::getPaletteDualQuaternions(int hardwareMeshId, float *pPaletteBuffer)
+{
+  int paletteMatrixCount;
+  paletteMatrixCount = getPaletteMatrixCount(hardwareMeshId);
+  if(paletteMatrixCount == 0) return 0;
+
+  Skinning::calculateDualQuaternions(&m_vectorPaletteMatrix[m_vectorFirstPaletteMatrixId[hardwareMeshId] * PALETTE_MATRIX_SIZE], paletteMatrixCount, pPaletteBuffer);
+
+  return paletteMatrixCount;
+}
+
+//----------------------------------------------------------------------------//
+// Copy the packed palette of a hardware mesh in one go, the buffer needs     //
+// room for PALETTE_MATRIX_SIZE floats per bone of the hardware mesh          //
+//----------------------------------------------------------------------------//
+
+int HardwareSkinning::getPaletteMatrices(int hardwareMeshId, float *pPaletteBuffer)
+{
+  int paletteMatrixCount;
+  paletteMatrixCount = getPaletteMatrixCount(hardwareMeshId);
+  if(paletteMatrixCount == 0) return 0;
+
+  memcpy(pPaletteBuffer, &m_vectorPaletteMatrix[m_vectorFirstPaletteMatrixId[hardwareMeshId] * PALETTE_MATRIX_SIZE], paletteMatrixCount * PALETTE_MATRIX_SIZE * sizeof(float));
+
+  return paletteMatrixCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bones in the palette of a hardware mesh                  //
+//----------------------------------------------------------------------------//
+
+int HardwareSkinning::getPaletteMatrixCount(int hardwareMeshId)
+{
+  if((hardwareMeshId < 0) || (hardwareMeshId >= (int)m_vectorFirstPaletteMatrixId.size())) return 0;
+
+  int nextPaletteMatrixId;
+  nextPaletteMatrixId = (hardwareMeshId + 1 < (int)m_vectorFirstPaletteMatrixId.size()) ? m_vectorFirstPaletteMatrixId[hardwareMeshId + 1] : (int)m_vectorPaletteBoneId.size();
+
+  return nextPaletteMatrixId - m_vectorFirstPaletteMatrixId[hardwareMeshId];
+}
+
+//----------------------------------------------------------------------------//
+// Get the palette size and the number of vertex units of the context         //
+//----------------------------------------------------------------------------//
+
+void HardwareSkinning::getLimits(int& maxBonesPerMesh, int& influenceCount)
+{
+  GLint maxPaletteMatrices;
+  maxPaletteMatrices = 0;
+  glGetIntegerv(GL_MAX_PALETTE_MATRICES_OES, &maxPaletteMatrices);
+
+  GLint maxVertexUnits;
+  maxVertexUnits = 0;
+  glGetIntegerv(GL_MAX_VERTEX_UNITS_OES, &maxVertexUnits);
+
+  // the matrix indices are stored in bytes
+  maxBonesPerMesh = (maxPaletteMatrices < 256) ? maxPaletteMatrices : 256;
+  influenceCount = (maxVertexUnits < INFLUENCE_COUNT) ? maxVertexUnits : INFLUENCE_COUNT;
+}
+
+//----------------------------------------------------------------------------//
+// Check if models get skinned on the gpu                                     //
+//----------------------------------------------------------------------------//
+
+bool HardwareSkinning::isEnabled()
+{
+  return m_bEnabled;
+}
+
+//----------------------------------------------------------------------------//
+// Check if the context supports the matrix palette, must run on the thread   //
+// that owns the context                                                      //
+//----------------------------------------------------------------------------//
+
+bool HardwareSkinning::isSupported()
+{
+  const char *pExtensions;
+  pExtensions = (const char *)glGetString(GL_EXTENSIONS);
+  if((pExtensions == 0) || (strstr(pExtensions, "GL_OES_matrix_palette") == 0)) return false;
+
+  if(m_glCurrentPaletteMatrixOES == 0)
+  {
+    m_glCurrentPaletteMatrixOES = (PFNGLCURRENTPALETTEMATRIXOESPROC)eglGetProcAddress("glCurrentPaletteMatrixOES");
+    m_glLoadPaletteFromModelViewMatrixOES = (PFNGLLOADPALETTEFROMMODELVIEWMATRIXOESPROC)eglGetProcAddress("glLoadPaletteFromModelViewMatrixOES");
+    m_glMatrixIndexPointerOES = (PFNGLMATRIXINDEXPOINTEROESPROC)eglGetProcAddress("glMatrixIndexPointerOES");
+    m_glWeightPointerOES = (PFNGLWEIGHTPOINTEROESPROC)eglGetProcAddress("glWeightPointerOES");
+  }
+
+  return (m_glCurrentPaletteMatrixOES != 0) && (m_glLoadPaletteFromModelViewMatrixOES != 0) && (m_glMatrixIndexPointerOES != 0) && (m_glWeightPointerOES != 0);
+}
+
+//----------------------------------------------------------------------------//
+// Check if the static data is on the gpu                                     //
+//----------------------------------------------------------------------------//
+
+bool HardwareSkinning::isUploaded()
+{
+  return m_vertexBufferId != 0;
+}
+
+//----------------------------------------------------------------------------//
+// Split the meshes of a model into hardware meshes and build the static      //
+// vertex and index data, needs no context                                    //
+//----------------------------------------------------------------------------//
+
+bool HardwareSkinning::onInit(CalModel *pModel, int maxBonesPerMesh, int influenceCount)
+{
+  onShutdown();
+
+  m_pModel = pModel;
+  m_influenceCount = (influenceCount < 1) ? 1 : ((influenceCount > INFLUENCE_COUNT) ? INFLUENCE_COUNT : influenceCount);
+
+  CalCoreModel *pCoreModel;
+  pCoreModel = pModel->getCoreModel();
+
+  // the model has all core meshes attached, a split may duplicate a vertex
+  // for every face that uses it
+  std::vector<int> vectorCoreMeshId;
+  int maxIndexCount;
+  maxIndexCount = 0;
+
+  int coreMeshId;
+  for(coreMeshId = 0; coreMeshId < pCoreModel->getCoreMeshCount(); coreMeshId++)
+  {
+    vectorCoreMeshId.push_back(coreMeshId);
+
+    CalCoreMesh *pCoreMesh;
+    pCoreMesh = pCoreModel->getCoreMesh(coreMeshId);
+
+    int coreSubmeshId;
+    for(coreSubmeshId = 0; coreSubmeshId < pCoreMesh->getCoreSubmeshCount(); coreSubmeshId++)
+    {
+      maxIndexCount += pCoreMesh->getCoreSubmesh(coreSubmeshId)->getFaceCount() * 3;
+    }
+  }
+
+  if(maxIndexCount == 0) return false;
+
+  std::vector<float> vectorPosition(maxIndexCount * 3);
+  std::vector<float> vectorNormal(maxIndexCount * 3);
+  std::vector<float> vectorTextureCoordinate(maxIndexCount * 2);
+  std::vector<float> vectorWeight(maxIndexCount * INFLUENCE_COUNT);
+  std::vector<float> vectorMatrixIndex(maxIndexCount * INFLUENCE_COUNT);
+  m_vectorIndex.resize(maxIndexCount);
+
+  m_pHardwareModel = new CalHardwareModel(pCoreModel);
+  m_pHardwareModel->setVertexBuffer((char *)&vectorPosition[0], 3 * sizeof(float));
+  m_pHardwareModel->setNormalBuffer((char *)&vectorNormal[0], 3 * sizeof(float));
+  m_pHardwareModel->setWeightBuffer((char *)&vectorWeight[0], INFLUENCE_COUNT * sizeof(float));
+  m_pHardwareModel->setMatrixIndexBuffer((char *)&vectorMatrixIndex[0], INFLUENCE_COUNT * sizeof(float));
+  m_pHardwareModel->setTextureCoordNum(1);
+  m_pHardwareModel->setTextureCoordBuffer(0, (char *)&vectorTextureCoordinate[0], 2 * sizeof(float));
+  m_pHardwareModel->setIndexBuffer(&m_vectorIndex[0]);
+  m_pHardwareModel->setCoreMeshIds(vectorCoreMeshId);
+
+  bool bLoaded;
+  bLoaded = m_pHardwareModel->load(0, 0, maxBonesPerMesh);
+
+  // the buffers above are released on return
+  m_pHardwareModel->setVertexBuffer(0, 0);
+  m_pHardwareModel->setNormalBuffer(0, 0);
+  m_pHardwareModel->setWeightBuffer(0, 0);
+  m_pHardwareModel->setMatrixIndexBuffer(0, 0);
+  m_pHardwareModel->setTextureCoordBuffer(0, 0, 0);
+  m_pHardwareModel->setIndexBuffer(0);
+
+  if(!bLoaded)
+  {
+    onShutdown();
+    return false;
+  }
+
+  m_vectorIndex.resize(m_pHardwareModel->getTotalFaceCount() * 3);
+
+  int vertexCount;
+  vertexCount = m_pHardwareModel->getTotalVertexCount();
+  m_vectorVertex.resize(vertexCount);
+
+  int vertexId;
+  for(vertexId = 0; vertexId < vertexCount; vertexId++)
+  {
+    Vertex& vertex = m_vectorVertex[vertexId];
+
+    memcpy(vertex.position, &vectorPosition[vertexId * 3], sizeof(vertex.position));
+    memcpy(vertex.normal, &vectorNormal[vertexId * 3], sizeof(vertex.normal));
+    memcpy(vertex.textureCoordinate, &vectorTextureCoordinate[vertexId * 2], sizeof(vertex.textureCoordinate));
+
+    // weights beyond the vertex units of the context are dropped, the rest
+    // gets scaled back to a sum of one
+    float weightSum;
+    weightSum = 0.0f;
+
+    int influenceId;
+    for(influenceId = 0; influenceId < INFLUENCE_COUNT; influenceId++)
+    {
+      vertex.weight[influenceId] = (influenceId < m_influenceCount) ? vectorWeight[vertexId * INFLUENCE_COUNT + influenceId] : 0.0f;
+      vertex.matrixIndex[influenceId] = (unsigned char)vectorMatrixIndex[vertexId * INFLUENCE_COUNT + influenceId];
+
+      weightSum += vertex.weight[influenceId];
+    }
+
+    if((m_influenceCount < INFLUENCE_COUNT) && (weightSum > 0.0f))
+    {
+      for(influenceId = 0; influenceId < m_influenceCount; influenceId++)
+      {
+        vertex.weight[influenceId] /= weightSum;
+      }
+    }
+  }
+
+  // one palette per hardware mesh, all palettes are stored back to back with
+  // the skeleton bone of every entry
+  std::vector<CalHardwareModel::CalHardwareMesh>& vectorHardwareMesh = m_pHardwareModel->getVectorHardwareMesh();
+
+  unsigned int hardwareMeshId;
+  for(hardwareMeshId = 0; hardwareMeshId < vectorHardwareMesh.size(); hardwareMeshId++)
+  {
+    m_vectorFirstPaletteMatrixId.push_back(m_vectorPaletteBoneId.size());
+
+    const std::vector<int>& vectorBoneId = vectorHardwareMesh[hardwareMeshId].m_vectorBonesIndices;
+    m_vectorPaletteBoneId.insert(m_vectorPaletteBoneId.end(), vectorBoneId.begin(), vectorBoneId.end());
+  }
+
+  m_vectorBoneMatrix.resize(pModel->getSkeleton()->getVectorBone().size() * Skinning::BONE_MATRIX_SIZE);
+  m_vectorPaletteMatrix.resize(m_vectorPaletteBoneId.size() * PALETTE_MATRIX_SIZE);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Release all data, the buffers are only deleted on the thread that owns the //
+// context                                                                    //
+//----------------------------------------------------------------------------//
+
+void HardwareSkinning::onShutdown()
+{
+  if(m_vertexBufferId != 0) glDeleteBuffers(1, &m_vertexBufferId);
+  if(m_indexBufferId != 0) glDeleteBuffers(1, &m_indexBufferId);
+  m_vertexBufferId = 0;
+  m_indexBufferId = 0;
+
+  delete m_pHardwareModel;
+  m_pHardwareModel = 0;
+
+  m_vectorVertex.clear();
+  m_vectorIndex.clear();
+  m_vectorBoneMatrix.clear();
+  m_vectorPaletteMatrix.clear();
+  m_vectorPaletteBoneId.clear();
+  m_vectorFirstPaletteMatrixId.clear();
+}
+
+//----------------------------------------------------------------------------//
+// Upload the static data into buffer objects, must run on the thread that    //
+// owns the context                                                           //
+//----------------------------------------------------------------------------//
+
+bool HardwareSkinning::onUpload()
+{
+  if(m_vectorVertex.empty() || m_vectorIndex.empty()) return false;
+
+  glGenBuffers(1, &m_vertexBufferId);
+  glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferId);
+  glBufferData(GL_ARRAY_BUFFER, m_vectorVertex.size() * sizeof(Vertex), &m_vectorVertex[0], GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glGenBuffers(1, &m_indexBufferId);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferId);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_vectorIndex.size() * sizeof(CalIndex), &m_vectorIndex[0], GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  return glGetError() == GL_NO_ERROR;
+}
+
+//----------------------------------------------------------------------------//
+// Switch between gpu and cpu skinning                                        //
+//----------------------------------------------------------------------------//
+
+void HardwareSkinning::setEnabled(bool bEnabled)
+{
+  m_bEnabled = bEnabled;
+}
+
+//----------------------------------------------------------------------------//
+// Build the palettes of all hardware meshes from the current pose, every     //
+// bone matrix is converted once and gathered into the palettes using it      //
+//----------------------------------------------------------------------------//
+
+void HardwareSkinning::updatePaletteMatrices()
+{
+  if(m_vectorPaletteBoneId.empty()) return;
+
+  // the same bone space transform CalPhysique applies
+  Skinning::calculateBoneMatrices(m_pModel->getSkeleton(), &m_vectorBoneMatrix[0]);
+
+  const float *pBoneMatrix;
+  pBoneMatrix = &m_vectorBoneMatrix[0];
+  float *pPaletteMatrix;
+  pPaletteMatrix = &m_vectorPaletteMatrix[0];
+
+  unsigned int paletteMatrixId;
+  for(paletteMatrixId = 0; paletteMatrixId < m_vectorPaletteBoneId.size(); paletteMatrixId++)
+  {
+    memcpy(&pPaletteMatrix[paletteMatrixId * PALETTE_MATRIX_SIZE], &pBoneMatrix[m_vectorPaletteBoneId[paletteMatrixId] * Skinning::BONE_MATRIX_SIZE], PALETTE_MATRIX_SIZE * sizeof(float));
+  }
+}
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,102 @@
+//----------------------------------------------------------------------------//
+// hardwareskinning.h                                                         //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef HARDWARESKINNING_H
+#define HARDWARESKINNING_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+// skins a model on the gpu through the matrix palette of OpenGL ES 1.1, the
+// meshes are split by CalHardwareModel into hardware meshes with bounded bone
+// palettes and uploaded once, only the palettes change every frame
+class HardwareSkinning
+{
+// misc
+public:
+  // the most influences CalHardwareModel writes per vertex
+  static const int INFLUENCE_COUNT;
+
+  // a palette matrix is a row-major 3x4 matrix, the layout of the bone
+  // matrices of Skinning
+  static const int PALETTE_MATRIX_SIZE;
+
+  // the static vertex of the vertex buffer
+  struct Vertex
+  {
+    float position[3];
+    float normal[3];
+    float textureCoordinate[2];
+    float weight[4];
+    unsigned char matrixIndex[4];
+  };
+
+// member variables
+protected:
+  CalModel *m_pModel;
+  CalHardwareModel *m_pHardwareModel;
+  int m_influenceCount;
+  std::vector<Vertex> m_vectorVertex;
+  std::vector<CalIndex> m_vectorIndex;
+  std::vector<float> m_vectorBoneMatrix;
+  std::vector<float> m_vectorPaletteMatrix;
+  std::vector<int> m_vectorPaletteBoneId;
+  std::vector<int> m_vectorFirstPaletteMatrixId;
+  GLuint m_vertexBufferId;
+  GLuint m_indexBufferId;
+
+  static PFNGLCURRENTPALETTEMATRIXOESPROC m_glCurrentPaletteMatrixOES;
+  static PFNGLLOADPALETTEFROMMODELVIEWMATRIXOESPROC m_glLoadPaletteFromModelViewMatrixOES;
+  static PFNGLMATRIXINDEXPOINTEROESPROC m_glMatrixIndexPointerOES;
+  static PFNGLWEIGHTPOINTEROESPROC m_glWeightPointerOES;
+  static bool m_bEnabled;
+
+// constructors/destructor
+public:
+  HardwareSkinning();
+  virtual ~HardwareSkinning();
+
+// member functions
+public:
+  void beginRendering();
+  int calculateVertices(int hardwareMeshId, float *pVertexBuffer, float *pNormalBuffer);
+  void drawHardwareMesh(int hardwareMeshId, GLenum mode);
+  void endRendering();
+  int getByteSize();
+  int getHardwareMeshCount();
+  CalHardwareModel *getHardwareModel();
+  const std::vector<CalIndex>& getIndices();
+  int getInfluenceCount();
+  int getPaletteDualQuaternions(int hardwareMeshId, float *pPaletteBuffer);
+  int getPaletteMatrices(int hardwareMeshId, float *pPaletteBuffer);
+  bool isUploaded();
+  bool onInit(CalModel *pModel, int maxBonesPerMesh, int influenceCount);
+  void onShutdown();
+  bool onUpload();
+  void updatePaletteMatrices();
+
+  static void getLimits(int& maxBonesPerMesh, int& influenceCount);
+  static bool isEnabled();
+  static bool isSupported();
+  static void setEnabled(bool bEnabled);
+
+protected:
+  int getPaletteMatrixCount(int hardwareMeshId);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
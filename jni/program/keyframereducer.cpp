@@ -0,0 +1,325 @@
+//----------------------------------------------------------------------------//
+// keyframereducer.cpp                                                        //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "keyframereducer.h"
+#include "cal3d/coretrack.h"
+#include "cal3d/corekeyframe.h"
+#include <math.h>
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+KeyframeReducer::KeyframeReducer(float translationTolerance, float rotationTolerance)
+{
+  m_translationTolerance = translationTolerance;
+  m_rotationTolerance = rotationTolerance;
+  m_keyframeCountBefore = 0;
+  m_keyframeCountAfter = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+KeyframeReducer::~KeyframeReducer()
+{
+}
+
+//----------------------------------------------------------------------------//
+// Get the error of a keyframe against the interpolation between two others   //
+//----------------------------------------------------------------------------//
+
+void KeyframeReducer::getError(const std::vector<CalCoreKeyframe *>& vectorKeyframe, int startId, int endId, int keyframeId, float& translationError, float& rotationError)
+{
+  CalCoreKeyframe *pStartKeyframe;
+  pStartKeyframe = vectorKeyframe[startId];
+  CalCoreKeyframe *pEndKeyframe;
+  pEndKeyframe = vectorKeyframe[endId];
+  CalCoreKeyframe *pKeyframe;
+  pKeyframe = vectorKeyframe[keyframeId];
+
+  // same blending as CalCoreTrack::getState
+  float duration;
+  duration = pEndKeyframe->getTime() - pStartKeyframe->getTime();
+
+  float blendFactor;
+  blendFactor = (duration > 0.0f) ? (pKeyframe->getTime() - pStartKeyframe->getTime()) / duration : 0.0f;
+
+  CalVector translation;
+  translation = pStartKeyframe->getTranslation();
+  translation.blend(blendFactor, pEndKeyframe->getTranslation());
+
+  CalQuaternion rotation;
+  rotation = pStartKeyframe->getRotation();
+  rotation.blend(blendFactor, pEndKeyframe->getRotation());
+
+  translationError = (translation - pKeyframe->getTranslation()).length();
+  rotationError = getRotationError(rotation, pKeyframe->getRotation());
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of keyframes after the last reduction                       //
+//----------------------------------------------------------------------------//
+
+int KeyframeReducer::getKeyframeCountAfter() const
+{
+  return m_keyframeCountAfter;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of keyframes before the last reduction                      //
+//----------------------------------------------------------------------------//
+
+int KeyframeReducer::getKeyframeCountBefore() const
+{
+  return m_keyframeCountBefore;
+}
+
+//----------------------------------------------------------------------------//
+// Get the largest rotation error of the last reduction                       //
+//----------------------------------------------------------------------------//
+
+float KeyframeReducer::getMaxRotationError() const
+{
+  float maxRotationError;
+  maxRotationError = 0.0f;
+
+  int trackId;
+  for(trackId = 0; trackId < (int)m_vectorTrackResult.size(); trackId++)
+  {
+    if(m_vectorTrackResult[trackId].maxRotationError > maxRotationError) maxRotationError = m_vectorTrackResult[trackId].maxRotationError;
+  }
+
+  return maxRotationError;
+}
+
+//----------------------------------------------------------------------------//
+// Get the largest translation error of the last reduction                    //
+//----------------------------------------------------------------------------//
+
+float KeyframeReducer::getMaxTranslationError() const
+{
+  float maxTranslationError;
+  maxTranslationError = 0.0f;
+
+  int trackId;
+  for(trackId = 0; trackId < (int)m_vectorTrackResult.size(); trackId++)
+  {
+    if(m_vectorTrackResult[trackId].maxTranslationError > maxTranslationError) maxTranslationError = m_vectorTrackResult[trackId].maxTranslationError;
+  }
+
+  return maxTranslationError;
+}
+
+//----------------------------------------------------------------------------//
+// Get the angle in radians between two rotations                             //
+//----------------------------------------------------------------------------//
+
+float KeyframeReducer::getRotationError(const CalQuaternion& rotation, const CalQuaternion& rotationReference)
+{
+  // q and -q are the same rotation
+  float dot;
+  dot = rotation.x * rotationReference.x + rotation.y * rotationReference.y + rotation.z * rotationReference.z + rotation.w * rotationReference.w;
+
+  float sign;
+  sign = (dot < 0.0f) ? -1.0f : 1.0f;
+
+  float dx, dy, dz, dw;
+  dx = rotation.x - sign * rotationReference.x;
+  dy = rotation.y - sign * rotationReference.y;
+  dz = rotation.z - sign * rotationReference.z;
+  dw = rotation.w - sign * rotationReference.w;
+
+  // the chord between the quaternions stays accurate for small angles, unlike
+  // the arc cosine of the dot product
+  float halfChord;
+  halfChord = 0.5f * sqrt(dx * dx + dy * dy + dz * dz + dw * dw);
+  if(halfChord > 1.0f) halfChord = 1.0f;
+
+  return 4.0f * asin(halfChord);
+}
+
+//----------------------------------------------------------------------------//
+// Get the results of the last reduction per track                            //
+//----------------------------------------------------------------------------//
+
+const std::vector<KeyframeReducer::TrackResult>& KeyframeReducer::getTrackResults() const
+{
+  return m_vectorTrackResult;
+}
+
+//----------------------------------------------------------------------------//
+// Check if all keyframes between two others can be interpolated              //
+//----------------------------------------------------------------------------//
+
+bool KeyframeReducer::isSegment(const std::vector<CalCoreKeyframe *>& vectorKeyframe, int startId, int endId) const
+{
+  int keyframeId;
+  for(keyframeId = startId + 1; keyframeId < endId; keyframeId++)
+  {
+    float translationError, rotationError;
+    getError(vectorKeyframe, startId, endId, keyframeId, translationError, rotationError);
+
+    if((translationError > m_translationTolerance) || (rotationError > m_rotationTolerance)) return false;
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Remove the redundant keyframes of all tracks of a core animation           //
+//----------------------------------------------------------------------------//
+
+bool KeyframeReducer::reduce(CalCoreAnimation *pCoreAnimation)
+{
+  m_keyframeCountBefore = 0;
+  m_keyframeCountAfter = 0;
+  m_vectorTrackResult.clear();
+
+  if(pCoreAnimation == 0) return false;
+
+  m_keyframeCountBefore = pCoreAnimation->getTotalNumberOfKeyframes();
+
+  std::list<CalCoreTrack *>& listCoreTrack = pCoreAnimation->getListCoreTrack();
+
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+  {
+    TrackResult trackResult;
+    reduceTrack(*iteratorCoreTrack, trackResult);
+
+    m_vectorTrackResult.push_back(trackResult);
+  }
+
+  m_keyframeCountAfter = pCoreAnimation->getTotalNumberOfKeyframes();
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Load a core animation file, reduce it and save it to another file          //
+//----------------------------------------------------------------------------//
+
+bool KeyframeReducer::reduceFile(const std::string& strFilename, const std::string& strOutputFilename, CalCoreSkeleton *pCoreSkeleton)
+{
+  CalCoreAnimationPtr pCoreAnimation;
+  pCoreAnimation = CalLoader::loadCoreAnimation(strFilename, pCoreSkeleton);
+  if(!pCoreAnimation) return false;
+
+  if(!reduce(pCoreAnimation.get())) return false;
+
+  return CalSaver::saveCoreAnimation(strOutputFilename, pCoreAnimation.get());
+}
+
+//----------------------------------------------------------------------------//
+// Remove the redundant keyframes of a core track                             //
+//----------------------------------------------------------------------------//
+
+void KeyframeReducer::reduceTrack(CalCoreTrack *pCoreTrack, TrackResult& trackResult)
+{
+  int keyframeCount;
+  keyframeCount = pCoreTrack->getCoreKeyframeCount();
+
+  trackResult.coreBoneId = pCoreTrack->getCoreBoneId();
+  trackResult.keyframeCountBefore = keyframeCount;
+  trackResult.keyframeCountAfter = keyframeCount;
+  trackResult.maxTranslationError = 0.0f;
+  trackResult.maxRotationError = 0.0f;
+
+  if(keyframeCount <= 1) return;
+
+  std::vector<CalCoreKeyframe *> vectorKeyframe(keyframeCount);
+
+  int keyframeId;
+  for(keyframeId = 0; keyframeId < keyframeCount; keyframeId++)
+  {
+    vectorKeyframe[keyframeId] = pCoreTrack->getCoreKeyframe(keyframeId);
+  }
+
+  std::vector<bool> vectorKeep(keyframeCount, false);
+  vectorKeep[0] = true;
+
+  // a track that never leaves its first keyframe collapses to that keyframe
+  bool bConstant;
+  bConstant = true;
+
+  for(keyframeId = 1; bConstant && (keyframeId < keyframeCount); keyframeId++)
+  {
+    float translationError, rotationError;
+    getError(vectorKeyframe, 0, 0, keyframeId, translationError, rotationError);
+
+    if((translationError > m_translationTolerance) || (rotationError > m_rotationTolerance)) bConstant = false;
+  }
+
+  if(!bConstant)
+  {
+    // grow each segment until one of its inner keyframes can no longer be
+    // interpolated, the keyframe before the failing end starts the next one
+    vectorKeep[keyframeCount - 1] = true;
+
+    int startId;
+    startId = 0;
+
+    int endId;
+    for(endId = 2; endId < keyframeCount; endId++)
+    {
+      if(!isSegment(vectorKeyframe, startId, endId))
+      {
+        startId = endId - 1;
+        vectorKeep[startId] = true;
+      }
+    }
+  }
+
+  // measure the error of the removed keyframes against the kept ones
+  int startId;
+  startId = 0;
+
+  for(keyframeId = 1; keyframeId < keyframeCount; keyframeId++)
+  {
+    if(!vectorKeep[keyframeId] && (keyframeId < keyframeCount - 1)) continue;
+
+    int endId;
+    endId = vectorKeep[keyframeId] ? keyframeId : startId;
+
+    int removedId;
+    for(removedId = startId + 1; removedId <= keyframeId; removedId++)
+    {
+      if(vectorKeep[removedId]) continue;
+
+      float translationError, rotationError;
+      getError(vectorKeyframe, startId, endId, removedId, translationError, rotationError);
+
+      if(translationError > trackResult.maxTranslationError) trackResult.maxTranslationError = translationError;
+      if(rotationError > trackResult.maxRotationError) trackResult.maxRotationError = rotationError;
+    }
+
+    startId = keyframeId;
+  }
+
+  // remove the keyframes back to front, the track does not release them
+  for(keyframeId = keyframeCount - 1; keyframeId >= 0; keyframeId--)
+  {
+    if(vectorKeep[keyframeId]) continue;
+
+    pCoreTrack->removeCoreKeyFrame(keyframeId);
+
+    vectorKeyframe[keyframeId]->destroy();
+    delete vectorKeyframe[keyframeId];
+
+    trackResult.keyframeCountAfter--;
+  }
+}
+
+//----------------------------------------------------------------------------//
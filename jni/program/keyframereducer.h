@@ -0,0 +1,71 @@
+//----------------------------------------------------------------------------//
+// keyframereducer.h                                                          //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef KEYFRAMEREDUCER_H
+#define KEYFRAMEREDUCER_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+class KeyframeReducer
+{
+// misc
+public:
+  // the result of the last reduction for one track
+  struct TrackResult
+  {
+    int coreBoneId;
+    int keyframeCountBefore;
+    int keyframeCountAfter;
+    float maxTranslationError;
+    float maxRotationError;
+  };
+
+// member variables
+protected:
+  float m_translationTolerance;
+  float m_rotationTolerance;
+  int m_keyframeCountBefore;
+  int m_keyframeCountAfter;
+  std::vector<TrackResult> m_vectorTrackResult;
+
+// constructors/destructor
+public:
+  KeyframeReducer(float translationTolerance, float rotationTolerance);
+  virtual ~KeyframeReducer();
+
+// member functions
+public:
+  int getKeyframeCountAfter() const;
+  int getKeyframeCountBefore() const;
+  float getMaxRotationError() const;
+  float getMaxTranslationError() const;
+  const std::vector<TrackResult>& getTrackResults() const;
+  bool reduce(CalCoreAnimation *pCoreAnimation);
+  bool reduceFile(const std::string& strFilename, const std::string& strOutputFilename, CalCoreSkeleton *pCoreSkeleton);
+
+  static float getRotationError(const CalQuaternion& rotation, const CalQuaternion& rotationReference);
+
+protected:
+  bool isSegment(const std::vector<CalCoreKeyframe *>& vectorKeyframe, int startId, int endId) const;
+  void reduceTrack(CalCoreTrack *pCoreTrack, TrackResult& trackResult);
+
+  static void getError(const std::vector<CalCoreKeyframe *>& vectorKeyframe, int startId, int endId, int keyframeId, float& translationError, float& rotationError);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,297 @@
+//----------------------------------------------------------------------------//
+// mappedsource.cpp                                                           //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "mappedsource.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+MappedSource::MappedSource()
+{
+  m_pData = 0;
+  m_size = 0;
+  m_offset = 0;
+  m_bError = true;
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+MappedSource::~MappedSource()
+{
+  close();
+}
+
+//----------------------------------------------------------------------------//
+// Unmap the file                                                             //
+//----------------------------------------------------------------------------//
+
+void MappedSource::close()
+{
+  if(m_pData != 0)
+  {
+    munmap((void *)m_pData, m_size);
+  }
+
+  m_pData = 0;
+  m_size = 0;
+  m_offset = 0;
+  m_bError = true;
+}
+
+//----------------------------------------------------------------------------//
+// Get a pointer to the next bytes of the file without copying them           //
+//----------------------------------------------------------------------------//
+
+const void *MappedSource::getData(int length)
+{
+  if(m_bError || (length < 0) || (length > m_size - m_offset))
+  {
+    m_bError = true;
+    return 0;
+  }
+
+  const char *pData;
+  pData = m_pData + m_offset;
+  m_offset += length;
+
+  return pData;
+}
+
+//----------------------------------------------------------------------------//
+// Get the read position                                                      //
+//----------------------------------------------------------------------------//
+
+int MappedSource::getOffset() const
+{
+  return m_offset;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bytes left to read                                       //
+//----------------------------------------------------------------------------//
+
+int MappedSource::getRemainingSize() const
+{
+  return m_size - m_offset;
+}
+
+//----------------------------------------------------------------------------//
+// Get the size of the mapped file                                            //
+//----------------------------------------------------------------------------//
+
+int MappedSource::getSize() const
+{
+  return m_size;
+}
+
+//----------------------------------------------------------------------------//
+// Check if all reads succeeded so far                                        //
+//----------------------------------------------------------------------------//
+
+bool MappedSource::ok() const
+{
+  return !m_bError;
+}
+
+//----------------------------------------------------------------------------//
+// Map a file into memory                                                     //
+//----------------------------------------------------------------------------//
+
+bool MappedSource::open(const std::string& strFilename)
+{
+  close();
+
+  int fd;
+  fd = ::open(strFilename.c_str(), O_RDONLY);
+  if(fd == -1)
+  {
+    CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilename);
+    return false;
+  }
+
+  struct stat fileStat;
+  if((fstat(fd, &fileStat) == -1) || (fileStat.st_size <= 0))
+  {
+    ::close(fd);
+    CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilename);
+    return false;
+  }
+
+  void *pData;
+  pData = mmap(0, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  // the mapping stays valid after the descriptor is closed
+  ::close(fd);
+
+  if(pData == MAP_FAILED)
+  {
+    CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilename);
+    return false;
+  }
+
+  // the loaders walk the file front to back exactly once
+  madvise(pData, fileStat.st_size, MADV_SEQUENTIAL);
+
+  m_pData = (const char *)pData;
+  m_size = (int)fileStat.st_size;
+  m_offset = 0;
+  m_bError = false;
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Read a number of bytes                                                     //
+//----------------------------------------------------------------------------//
+
+bool MappedSource::readBytes(void *pBuffer, int length)
+{
+  const void *pData;
+  pData = getData(length);
+  if(pData == 0) return false;
+
+  memcpy(pBuffer, pData, length);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Read a float, the files are little endian like CalPlatform expects         //
+//----------------------------------------------------------------------------//
+
+bool MappedSource::readFloat(float& value)
+{
+  const unsigned char *pData;
+  pData = (const unsigned char *)getData(4);
+  if(pData == 0) return false;
+
+#ifdef CAL3D_BIG_ENDIAN
+  unsigned char swapped[4];
+  swapped[0] = pData[3];
+  swapped[1] = pData[2];
+  swapped[2] = pData[1];
+  swapped[3] = pData[0];
+  memcpy(&value, swapped, 4);
+#else
+  memcpy(&value, pData, 4);
+#endif
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Read an array of floats with a single copy                                 //
+//----------------------------------------------------------------------------//
+
+bool MappedSource::readFloatArray(float *pValue, int count)
+{
+  if(!isArrayAvailable(count, 4))
+  {
+    m_bError = true;
+    return false;
+  }
+
+  const void *pData;
+  pData = getData(count * 4);
+  if(pData == 0) return false;
+
+  memcpy(pValue, pData, count * 4);
+  swapArray(pValue, count);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Read an integer                                                            //
+//----------------------------------------------------------------------------//
+
+bool MappedSource::readInteger(int& value)
+{
+  const unsigned char *pData;
+  pData = (const unsigned char *)getData(4);
+  if(pData == 0) return false;
+
+#ifdef CAL3D_BIG_ENDIAN
+  value = pData[0] | (pData[1] << 8) | (pData[2] << 16) | (pData[3] << 24);
+#else
+  memcpy(&value, pData, 4);
+#endif
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Read an array of integers with a single copy                               //
+//----------------------------------------------------------------------------//
+
+bool MappedSource::readIntegerArray(int *pValue, int count)
+{
+  if(!isArrayAvailable(count, 4))
+  {
+    m_bError = true;
+    return false;
+  }
+
+  const void *pData;
+  pData = getData(count * 4);
+  if(pData == 0) return false;
+
+  memcpy(pValue, pData, count * 4);
+  swapArray(pValue, count);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Read a length prefixed string, same layout as CalPlatform::readString      //
+//----------------------------------------------------------------------------//
+
+bool MappedSource::readString(std::string& strValue)
+{
+  int length;
+  if(!readInteger(length)) return false;
+
+  if(length < 0)
+  {
+    m_bError = true;
+    return false;
+  }
+
+  const char *pData;
+  pData = (const char *)getData(length);
+  if(pData == 0) return false;
+
+  // the stored length includes the terminating zero
+  strValue.assign(pData, strnlen(pData, length));
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Report a read error                                                        //
+//----------------------------------------------------------------------------//
+
+void MappedSource::setError() const
+{
+  CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+}
+
+//----------------------------------------------------------------------------//
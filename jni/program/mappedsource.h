@@ -0,0 +1,58 @@
+//----------------------------------------------------------------------------//
+// mappedsource.h                                                             //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef MAPPEDSOURCE_H
+#define MAPPEDSOURCE_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+#include "bulkdatasource.h"
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+class MappedSource : public BulkDataSource
+{
+// member variables
+protected:
+  const char *m_pData;
+  int m_size;
+  int m_offset;
+  bool m_bError;
+
+// constructors/destructor
+public:
+  MappedSource();
+  virtual ~MappedSource();
+
+// member functions
+public:
+  void close();
+  const void *getData(int length);
+  int getOffset() const;
+  virtual int getRemainingSize() const;
+  int getSize() const;
+  virtual bool ok() const;
+  bool open(const std::string& strFilename);
+  virtual bool readBytes(void *pBuffer, int length);
+  virtual bool readFloat(float& value);
+  virtual bool readFloatArray(float *pValue, int count);
+  virtual bool readInteger(int& value);
+  virtual bool readIntegerArray(int *pValue, int count);
+  virtual bool readString(std::string& strValue);
+  virtual void setError() const;
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
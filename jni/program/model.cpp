@@ -4,6 +4,14 @@
 #include "menu.h"
 #include "Utils.h"
 #include "tga.h"
+#include "coremodeldata.h"
+#include "animmixer.h"
+#include "keyframereducer.h"
+#include "assetloader.h"
+#include "coremodelcache.h"
+#include "modelpipeline.h"
+#include "hardwareskinning.h"
+#include "animationlod.h"
 
 //----------------------------------------------------------------------------//
 // Static member variables initialization                                     //
@@ -19,7 +27,10 @@ const int Model::STATE_MOTION = 2;
 
 Model::Model()
 {
-  m_calCoreModel = new CalCoreModel("dummy");
+  m_calCoreModel = 0;
+  m_calModel = 0;
+  m_pModelPipeline = 0;
+  m_pHardwareSkinning = 0;
 
   m_state = STATE_IDLE;
   m_motionBlend[0] = 0.6f;
@@ -29,6 +40,7 @@ Model::Model()
   m_meshCount = 0;
   m_renderScale = 1.0f;
   m_lodLevel = 1.0f;
+  m_animationLod = AnimationLod::LEVEL_FULL;
 /* DEBUG-CODE
   Sphere.x = 0.0f;
   Sphere.y = 5.0f;
@@ -61,6 +73,24 @@ void Model::executeAction(int action)
   }
 }
 
+//----------------------------------------------------------------------------//
+// Get the cal3d model instance                                               //
+//----------------------------------------------------------------------------//
+
+CalModel *Model::getCalModel()
+{
+  return m_calModel;
+}
+
+//----------------------------------------------------------------------------//
+// Get the animation level of detail of the model                             //
+//----------------------------------------------------------------------------//
+
+int Model::getAnimationLod()
+{
+  return m_animationLod;
+}
+
 //----------------------------------------------------------------------------//
 // Get the lod level of the model                                             //
 //----------------------------------------------------------------------------//
@@ -81,6 +111,43 @@ void Model::getMotionBlend(float *pMotionBlend)
   pMotionBlend[2] = m_motionBlend[2];
 }
 
+//----------------------------------------------------------------------------//
+// Get the gpu skinning of the model, 0 if the context has no matrix palette  //
+//----------------------------------------------------------------------------//
+
+HardwareSkinning *Model::getHardwareSkinning()
+{
+  return m_pHardwareSkinning;
+}
+
+//----------------------------------------------------------------------------//
+// Get the staged update of the model                                         //
+//----------------------------------------------------------------------------//
+
+ModelPipeline *Model::getModelPipeline()
+{
+  return m_pModelPipeline;
+}
+
+//----------------------------------------------------------------------------//
+// Get the memory of the persistent render data of all submeshes              //
+//----------------------------------------------------------------------------//
+
+int Model::getRenderDataByteSize()
+{
+  int byteSize;
+  byteSize = 0;
+
+  unsigned int submeshRenderDataId;
+  for(submeshRenderDataId = 0; submeshRenderDataId < m_vectorSubmeshRenderData.size(); submeshRenderDataId++)
+  {
+    const SubmeshRenderData& submeshRenderData = m_vectorSubmeshRenderData[submeshRenderDataId];
+    byteSize += submeshRenderData.vectorFace.size() * sizeof(CalIndex);
+  }
+
+  return byteSize;
+}
+
 //----------------------------------------------------------------------------//
 // Get the render scale of the model                                          //
 //----------------------------------------------------------------------------//
@@ -116,92 +183,154 @@ int readInt( std::ifstream *file )
  }
 
 //----------------------------------------------------------------------------//
-// Load and create a texture from a given file                                //
+// Decode a texture file into memory, no gl calls so it can run on any thread //
 //----------------------------------------------------------------------------//
 
-GLuint Model::loadTexture(const std::string& strFilename)
+bool Model::decodeTexture(const std::string& strFilename, TextureImage& textureImage)
 {
-  GLuint pId=0;
-  if(stricmp(strrchr(strFilename.c_str(),'.'),".raw")==0)
-  {
+  const char *pExtension;
+  pExtension = strrchr(strFilename.c_str(), '.');
+  if(pExtension == 0) return false;
 
-     // open the texture file
-     std::ifstream file;
-     file.open(strFilename.c_str(), std::ios::in | std::ios::binary);
-     if(!file)
-     {
-       LOG( ("Texture file '" + strFilename + "' not found.").c_str() );
-       return 0;
-     }
-
-     // load the dimension of the texture
-     int width = readInt(&file);
-     int height = readInt(&file);
-     int depth = readInt(&file);
-
-     // allocate a temporary buffer to load the texture to
-    unsigned char *pBuffer;
-    pBuffer = new unsigned char[width * height * depth];
-    if(pBuffer == 0)
+  if(stricmp(pExtension, ".raw") == 0)
+  {
+    // open the texture file
+    std::ifstream file;
+    file.open(strFilename.c_str(), std::ios::in | std::ios::binary);
+    if(!file)
     {
-      LOG( ("Memory allocation for texture '" + strFilename + "' failed.").c_str());
-      return 0;
+      LOG(("Texture file '" + strFilename + "' not found.").c_str());
+      return false;
     }
 
+    // load the dimension of the texture
+    textureImage.width = readInt(&file);
+    textureImage.height = readInt(&file);
+    textureImage.depth = readInt(&file);
+
     // load the texture
-    file.read((char *)pBuffer, width * height * depth);
+    textureImage.vectorPixel.resize(textureImage.width * textureImage.height * textureImage.depth);
+    if(!textureImage.vectorPixel.empty()) file.read((char *)&textureImage.vectorPixel[0], textureImage.vectorPixel.size());
 
     // explicitely close the file
     file.close();
+  }
+  else if(stricmp(pExtension, ".tga") == 0)
+  {
+    CTga *Tga;
+    Tga = new CTga();
+
+    //Note: This will always make a 32-bit texture
+    if(Tga->ReadFile(strFilename.c_str()) == 0)
+    {
+      Tga->Release();
+      return false;
+    }
+
+    textureImage.width = Tga->GetSizeX();
+    textureImage.height = Tga->GetSizeY();
+    textureImage.depth = Tga->Bpp() / 8;
+
+    const unsigned char *pPixel;
+    pPixel = (const unsigned char *)Tga->GetPointer();
+    textureImage.vectorPixel.assign(pPixel, pPixel + textureImage.width * textureImage.height * textureImage.depth);
+
+    Tga->Release();
+  }
+  else
+  {
+    return false;
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Copy the faces of the current lod level of all submeshes                   //
+//----------------------------------------------------------------------------//
+
+void Model::extractFaces()
+{
+  CalRenderer *pCalRenderer;
+  pCalRenderer = m_calModel->getRenderer();
+
+  int meshId;
+  for(meshId = 0; meshId < (int)m_vectorFirstSubmeshRenderDataId.size(); meshId++)
+  {
+    int submeshId;
+    for(submeshId = 0; submeshId < pCalRenderer->getSubmeshCount(meshId); submeshId++)
+    {
+      SubmeshRenderData& submeshRenderData = m_vectorSubmeshRenderData[m_vectorFirstSubmeshRenderDataId[meshId] + submeshId];
+      submeshRenderData.faceCount = 0;
+
+      if(!pCalRenderer->selectMeshSubmesh(meshId, submeshId) || submeshRenderData.vectorFace.empty()) continue;
 
-    // generate texture
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glGenTextures(1, &pId);
-    glBindTexture(GL_TEXTURE_2D, pId);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, (depth == 3) ? GL_RGB : GL_RGBA, width, height, 0, (depth == 3) ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, &pBuffer[0]);
-
-    // free the allocated memory
-    delete [] pBuffer;
-
-  }
-  else if (stricmp(strrchr(strFilename.c_str(),'.'),".tga")==0)
-  {
-
-    CTga *Tga;
-    Tga = new CTga();
-
-    //Note: This will always make a 32-bit texture
-    if(Tga->ReadFile(strFilename.c_str())==0)
-    {
-      Tga->Release();
-      return false;
-    }
-
-    //Bind texture
-    int width = Tga->GetSizeX();
-    int height = Tga->GetSizeY();
-    int depth = Tga->Bpp() / 8;
-
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-    glGenTextures(1, &pId);
-
-    glBindTexture(GL_TEXTURE_2D, pId);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, ((depth == 3) ? GL_RGB : GL_RGBA), width, height, 0, ((depth == 3) ? GL_RGB : GL_RGBA) , GL_UNSIGNED_BYTE, (char*)Tga->GetPointer() );
-
-	 Tga->Release();
-  }
-
-  return pId;
+      submeshRenderData.faceCount = pCalRenderer->getFaces(&submeshRenderData.vectorFace[0]);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Create the persistent render data of all submeshes, sized for the highest  //
+// lod level so a lod change only has to copy the faces again                 //
+//----------------------------------------------------------------------------//
+
+void Model::extractRenderData()
+{
+  m_vectorSubmeshRenderData.clear();
+  m_vectorFirstSubmeshRenderDataId.clear();
+
+  std::vector<CalMesh *>& vectorMesh = m_calModel->getVectorMesh();
+
+  unsigned int meshId;
+  for(meshId = 0; meshId < vectorMesh.size(); meshId++)
+  {
+    m_vectorFirstSubmeshRenderDataId.push_back((int)m_vectorSubmeshRenderData.size());
+
+    std::vector<CalSubmesh *>& vectorSubmesh = vectorMesh[meshId]->getVectorSubmesh();
+
+    unsigned int submeshId;
+    for(submeshId = 0; submeshId < vectorSubmesh.size(); submeshId++)
+    {
+      CalCoreSubmesh *pCoreSubmesh;
+      pCoreSubmesh = vectorSubmesh[submeshId]->getCoreSubmesh();
+
+      m_vectorSubmeshRenderData.push_back(SubmeshRenderData());
+
+      SubmeshRenderData& submeshRenderData = m_vectorSubmeshRenderData.back();
+      submeshRenderData.faceCount = 0;
+      submeshRenderData.vectorFace.resize(pCoreSubmesh->getFaceCount() * 3);
+    }
+  }
+
+  extractFaces();
+}
+
+//----------------------------------------------------------------------------//
+// Get the model configuration file                                           //
+//----------------------------------------------------------------------------//
+
+const std::string& Model::getFilename()
+{
+  return m_strFilename;
+}
+
+//----------------------------------------------------------------------------//
+// Get the data path set by the application                                   //
+//----------------------------------------------------------------------------//
+
+const std::string& Model::getPath()
+{
+  return m_path;
+}
+
+//----------------------------------------------------------------------------//
+// Get the decoded textures that still wait for their upload                  //
+//----------------------------------------------------------------------------//
+
+const std::vector<Model::TextureImage>& Model::getTextureImages()
+{
+  return m_vectorTextureImage;
 }
 
 //----------------------------------------------------------------------------//
@@ -209,6 +338,15 @@ GLuint Model::loadTexture(const std::string& strFilename)
 //----------------------------------------------------------------------------//
 
 bool Model::onInit(const std::string& strFilename)
+{
+  return onLoad(strFilename) && onUpload();
+}
+
+//----------------------------------------------------------------------------//
+// Load the core model from a model configuration file                        //
+//----------------------------------------------------------------------------//
+
+bool Model::loadCoreModel(const std::string& strFilename)
 {
   // open the model configuration file
   std::ifstream file;
@@ -226,6 +364,25 @@ bool Model::onInit(const std::string& strFilename)
   int animationCount;
   animationCount = 0;
 
+  // animations are only reduced or compressed if the configuration asks for it
+  float reductionTranslationTolerance;
+  reductionTranslationTolerance = 0.0f;
+  float reductionRotationTolerance;
+  reductionRotationTolerance = 0.0f;
+  float translationTolerance;
+  translationTolerance = 0.0f;
+  float rotationTolerance;
+  rotationTolerance = 0.0f;
+
+  // the animations keep their keyframes unless a bake rate is set
+  float bakeRate;
+  bakeRate = 0.0f;
+
+  // the derived data lives next to the core model, compressed animation
+  // files are loaded through it
+  CoreModelData *pCoreModelData;
+  pCoreModelData = new CoreModelData(m_calCoreModel);
+
   // parse all lines from the model configuration file
   int line;
   for(line = 1; ; line++)
@@ -280,6 +437,36 @@ bool Model::onInit(const std::string& strFilename)
       // set rendering scale factor
       m_renderScale = atof(strData.c_str());
     }
+    else if(strKey == "compression")
+    {
+      // compress the animations within the given translation and rotation
+      // (radians) error
+      if(sscanf(strData.c_str(), "%f %f", &translationTolerance, &rotationTolerance) != 2)
+      {
+        LOG((strFilename + ": Invalid compression tolerances.").c_str());
+        return false;
+      }
+    }
+    else if(strKey == "keyframe_reduction")
+    {
+      // remove the keyframes that can be interpolated within the given
+      // translation and rotation (radians) error
+      if(sscanf(strData.c_str(), "%f %f", &reductionTranslationTolerance, &reductionRotationTolerance) != 2)
+      {
+        LOG((strFilename + ": Invalid keyframe reduction tolerances.").c_str());
+        return false;
+      }
+    }
+    else if(strKey == "bake_rate")
+    {
+      // sample the following animations at a fixed rate instead of searching
+      // their keyframes, 0 keeps the keyframes
+      if((sscanf(strData.c_str(), "%f", &bakeRate) != 1) || (bakeRate < 0.0f))
+      {
+        LOG((strFilename + ": Invalid bake rate.").c_str());
+        return false;
+      }
+    }
     else if(strKey == "path")
     {
       // set the new path for the data files if one hasn't been set already
@@ -289,7 +476,7 @@ bool Model::onInit(const std::string& strFilename)
     {
       // load core skeleton
       LOG(("Loading skeleton '" + strData + "'...").c_str());
-      if(!m_calCoreModel->loadCoreSkeleton(strPath + strData))
+      if(!AssetLoader::loadCoreSkeleton(m_calCoreModel, strPath + strData))
       {
         CalError::printLastError();
         return false;
@@ -299,11 +486,29 @@ bool Model::onInit(const std::string& strFilename)
     {
       // load core animation
       LOG(("Loading animation '" + strData + "'...").c_str());
-      m_animationId[animationCount] = m_calCoreModel->loadCoreAnimation(strPath + strData);
-      if(m_animationId[animationCount] == -1)
+
+      const char *pExtension = strrchr(strData.c_str(), '.');
+      if((pExtension != 0) && (stricmp(pExtension, ".cca") == 0))
       {
-        CalError::printLastError();
-        return false;
+        m_animationId[animationCount] = pCoreModelData->loadCompressedAnimation(strPath + strData);
+        if(m_animationId[animationCount] == -1)
+        {
+          LOG(("Failed to load compressed animation '" + strData + "'.").c_str());
+          return false;
+        }
+
+        if(bakeRate > 0.0f) LOG(("Compressed animation '" + strData + "' has no keyframes to bake.").c_str());
+      }
+      else
+      {
+        m_animationId[animationCount] = AssetLoader::loadCoreAnimation(m_calCoreModel, strPath + strData);
+        if(m_animationId[animationCount] == -1)
+        {
+          CalError::printLastError();
+          return false;
+        }
+
+        pCoreModelData->setBakeRate(m_animationId[animationCount], bakeRate);
       }
 
       animationCount++;
@@ -312,7 +517,7 @@ bool Model::onInit(const std::string& strFilename)
     {
       // load core mesh
       LOG(("Loading mesh '" + strData + "'...").c_str());
-      if(m_calCoreModel->loadCoreMesh(strPath + strData) == -1)
+      if(AssetLoader::loadCoreMesh(m_calCoreModel, strPath + strData) == -1)
       {
         CalError::printLastError();
         return false;
@@ -338,7 +543,8 @@ bool Model::onInit(const std::string& strFilename)
   // explicitely close the file
   file.close();
 
-  // load all textures and store the opengl texture id in the corresponding map in the material
+  // decode all textures, they are uploaded and stored in the user data of
+  // the corresponding map in the material by onUpload
   int materialId;
   for(materialId = 0; materialId < m_calCoreModel->getCoreMaterialCount(); materialId++)
   {
@@ -354,12 +560,13 @@ bool Model::onInit(const std::string& strFilename)
       std::string strFilename;
       strFilename = pCoreMaterial->getMapFilename(mapId);
 
-      // load the texture from the file
-      GLuint textureId;
-      textureId = loadTexture(strPath + strFilename);
+      // decode the texture from the file
+      TextureImage textureImage;
+      textureImage.materialId = materialId;
+      textureImage.mapId = mapId;
+      if(!decodeTexture(strPath + strFilename, textureImage)) continue;
 
-      // store the opengl texture id in the user data of the map
-      pCoreMaterial->setMapUserData(mapId, (Cal::UserData)textureId);
+      m_vectorTextureImage.push_back(textureImage);
     }
   }
 
@@ -379,8 +586,93 @@ bool Model::onInit(const std::string& strFilename)
 
   m_calCoreModel->getCoreSkeleton()->calculateBoundingBoxes(m_calCoreModel);
 
+  // drop the redundant keyframes before they get baked
+  if((reductionTranslationTolerance > 0.0f) || (reductionRotationTolerance > 0.0f))
+  {
+    KeyframeReducer keyframeReducer(reductionTranslationTolerance, reductionRotationTolerance);
+
+    int coreAnimationId;
+    for(coreAnimationId = 0; coreAnimationId < m_calCoreModel->getCoreAnimationCount(); coreAnimationId++)
+    {
+      CalCoreAnimation *pCoreAnimation;
+      pCoreAnimation = m_calCoreModel->getCoreAnimation(coreAnimationId);
+      if(pCoreAnimation == 0) continue;
+
+      keyframeReducer.reduce(pCoreAnimation);
+      LOG("Reduced animation '%s': %d -> %d keyframes", pCoreAnimation->getFilename().c_str(), keyframeReducer.getKeyframeCountBefore(), keyframeReducer.getKeyframeCountAfter());
+    }
+  }
+
+  // bake the skin streams and keyframes used by the kernels and the mixer
+  if((translationTolerance > 0.0f) || (rotationTolerance > 0.0f))
+  {
+    pCoreModelData->compressAnimations(translationTolerance, rotationTolerance);
+  }
+  pCoreModelData->onInit();
+
+  m_animationCount = animationCount;
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Load the model, everything but the texture upload, so it can run on a      //
+// worker thread                                                              //
+//----------------------------------------------------------------------------//
+
+bool Model::onLoad(const std::string& strFilename)
+{
+  m_strFilename = strFilename;
+
+  // models of the same configuration share one core model, the data path
+  // overrides the one in the configuration so it is part of the key
+  std::string strKey;
+  strKey = strFilename + "|" + m_path;
+
+  CoreModelCache::CoreModelInfo coreModelInfo;
+  m_calCoreModel = CoreModelCache::acquire(strKey, coreModelInfo);
+
+  if(m_calCoreModel == 0)
+  {
+    m_calCoreModel = new CalCoreModel("dummy");
+
+    if(!loadCoreModel(strFilename))
+    {
+      CoreModelCache::cancel(strKey);
+
+      delete CoreModelData::get(m_calCoreModel);
+      delete m_calCoreModel;
+      m_calCoreModel = 0;
+
+      return false;
+    }
+
+    coreModelInfo.renderScale = m_renderScale;
+    coreModelInfo.animationCount = m_animationCount;
+    memcpy(coreModelInfo.animationId, m_animationId, sizeof(m_animationId));
+    coreModelInfo.byteSize = CoreModelCache::getByteSize(m_calCoreModel);
+
+    int textureImageId;
+    for(textureImageId = 0; textureImageId < (int)m_vectorTextureImage.size(); textureImageId++)
+    {
+      coreModelInfo.byteSize += (int)m_vectorTextureImage[textureImageId].vectorPixel.size();
+    }
+
+    CoreModelCache::insert(strKey, m_calCoreModel, coreModelInfo);
+  }
+  else
+  {
+    // the textures of a shared core model are uploaded by its first model
+    m_renderScale = coreModelInfo.renderScale;
+    m_animationCount = coreModelInfo.animationCount;
+    memcpy(m_animationId, coreModelInfo.animationId, sizeof(m_animationId));
+  }
+
   m_calModel = new CalModel(m_calCoreModel);
 
+  // replace the default mixer, the model takes ownership
+  m_calModel->setAbstractMixer(new AnimMixer(m_calModel));
+
   // attach all meshes to the model
   int meshId;
   for(meshId = 0; meshId < m_calCoreModel->getCoreMeshCount(); meshId++)
@@ -397,15 +689,173 @@ bool Model::onInit(const std::string& strFilename)
   m_calModel->getMixer()->blendCycle(m_animationId[STATE_MOTION + 1], m_motionBlend[1], 0.0f);
   m_calModel->getMixer()->blendCycle(m_animationId[STATE_MOTION + 2], m_motionBlend[2], 0.0f);
 
+  // the pipeline owns the bone matrices and the skinned vertices, it needs
+  // the attached meshes, positions, normals and texture coordinates are
+  // rendered from one interleaved stream
+  m_pModelPipeline = new ModelPipeline(m_calModel);
+  m_pModelPipeline->setVertexLayout(ModelPipeline::getInterleavedLayout());
+
+  // the faces are copied once instead of every frame
+  extractRenderData();
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Upload the decoded textures, must run on the thread that owns the context  //
+//----------------------------------------------------------------------------//
+
+bool Model::onUpload()
+{
+  int textureImageId;
+  for(textureImageId = 0; textureImageId < (int)m_vectorTextureImage.size(); textureImageId++)
+  {
+    const TextureImage& textureImage = m_vectorTextureImage[textureImageId];
+
+    // create the texture
+    GLuint textureId;
+    textureId = uploadTexture(textureImage);
+
+    // store the opengl texture id in the user data of the map
+    m_calCoreModel->getCoreMaterial(textureImage.materialId)->setMapUserData(textureImage.mapId, (Cal::UserData)textureId);
+  }
+
+  // the pixels are owned by gl now
+  std::vector<TextureImage>().swap(m_vectorTextureImage);
+
+  // split the meshes into hardware meshes that fit the palette of the context
+  // and upload them once, the cpu path stays the fallback
+  if((m_pHardwareSkinning == 0) && HardwareSkinning::isSupported())
+  {
+    int maxBonesPerMesh, influenceCount;
+    HardwareSkinning::getLimits(maxBonesPerMesh, influenceCount);
+
+    m_pHardwareSkinning = new HardwareSkinning();
+    if(!m_pHardwareSkinning->onInit(m_calModel, maxBonesPerMesh, influenceCount) || !m_pHardwareSkinning->onUpload())
+    {
+      LOG("Hardware skinning of '%s' failed", m_strFilename.c_str());
+
+      delete m_pHardwareSkinning;
+      m_pHardwareSkinning = 0;
+    }
+  }
+
   return true;
 }
 
+//----------------------------------------------------------------------------//
+// Render the hardware meshes of the model, the skinning runs in the matrix   //
+// palette of the context                                                     //
+//----------------------------------------------------------------------------//
+
+void Model::renderHardwareMesh(bool bWireframe, bool bLight)
+{
+  CalHardwareModel *pHardwareModel;
+  pHardwareModel = m_pHardwareSkinning->getHardwareModel();
+
+  // the palettes follow the pose of the last update
+  m_pHardwareSkinning->updatePaletteMatrices();
+
+  // set the global OpenGL states
+  glEnable(GL_DEPTH_TEST);
+  glShadeModel(GL_SMOOTH);
+
+  // set the lighting mode if necessary
+  if(bLight)
+  {
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+  }
+
+  m_pHardwareSkinning->beginRendering();
+
+  int hardwareMeshId;
+  for(hardwareMeshId = 0; hardwareMeshId < pHardwareModel->getHardwareMeshCount(); hardwareMeshId++)
+  {
+    pHardwareModel->selectHardwareMesh(hardwareMeshId);
+
+    unsigned char meshColor[4];
+    GLfloat materialColor[4];
+
+    // set the material ambient color
+    pHardwareModel->getAmbientColor(&meshColor[0]);
+    materialColor[0] = CLAMP(meshColor[0] / 255.0f,0,1);  materialColor[1] = CLAMP(meshColor[1] / 255.0f,0,1);
+    materialColor[2] = CLAMP(meshColor[2] / 255.0f,0,1);  materialColor[3] = CLAMP(meshColor[3] / 255.0f,0,1);
+    glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, materialColor);
+
+    // set the material diffuse color
+    pHardwareModel->getDiffuseColor(&meshColor[0]);
+    materialColor[0] = CLAMP(meshColor[0] / 255.0f,0,1);  materialColor[1] = CLAMP(meshColor[1] / 255.0f,0,1);
+    materialColor[2] = CLAMP(meshColor[2] / 255.0f,0,1);  materialColor[3] = 1;
+    glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, materialColor);
+
+    // set the vertex color if we have no lights
+    if(!bLight)
+    {
+      glColor4f(materialColor[0],materialColor[1],materialColor[2],materialColor[3]);
+    }
+
+    // set the material specular color
+    pHardwareModel->getSpecularColor(&meshColor[0]);
+    materialColor[0] = meshColor[0] / 255.0f;  materialColor[1] = meshColor[1] / 255.0f; materialColor[2] = meshColor[2] / 255.0f; materialColor[3] = meshColor[3] / 255.0f;
+    glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, materialColor);
+
+    // set the material shininess factor
+    float shininess;
+    shininess = 50.0f;
+    glMaterialfv(GL_FRONT_AND_BACK, GL_SHININESS, &shininess);
+
+    // set the texture state if necessary, the texture coordinates are part
+    // of the vertex buffer
+    GLuint textureId;
+    textureId = (GLuint)pHardwareModel->getMapUserData(0);
+    if(textureId != 0)
+    {
+      glEnable(GL_TEXTURE_2D);
+      glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+      glEnable(GL_COLOR_MATERIAL);
+      glBindTexture(GL_TEXTURE_2D, textureId);
+      glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    }
+
+    // draw the hardware mesh
+    m_pHardwareSkinning->drawHardwareMesh(hardwareMeshId, bWireframe ? GL_LINES : GL_TRIANGLES);
+
+    // disable the texture state if necessary
+    if(textureId != 0)
+    {
+      glDisable(GL_COLOR_MATERIAL);
+      glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+      glDisable(GL_TEXTURE_2D);
+    }
+  }
+
+  m_pHardwareSkinning->endRendering();
+
+  // reset the lighting mode
+  if(bLight)
+  {
+    glDisable(GL_LIGHTING);
+    glDisable(GL_LIGHT0);
+  }
+
+  // reset the global OpenGL states
+  glDisable(GL_DEPTH_TEST);
+}
+
 //----------------------------------------------------------------------------//
 // Render the mesh of the model                                               //
 //----------------------------------------------------------------------------//
 
 void Model::renderMesh(bool bWireframe, bool bLight)
 {
+  // the gpu skins the uploaded hardware meshes itself
+  if(HardwareSkinning::isEnabled() && (m_pHardwareSkinning != 0))
+  {
+    renderHardwareMesh(bWireframe, bLight);
+    return;
+  }
+
   // get the renderer of the model
   CalRenderer *pCalRenderer;
   pCalRenderer = m_calModel->getRenderer();
@@ -430,6 +880,10 @@ void Model::renderMesh(bool bWireframe, bool bLight)
   glEnableClientState(GL_VERTEX_ARRAY);
   glEnableClientState(GL_NORMAL_ARRAY);
 
+  // hold the last finished frame, an update thread skins the next one into the
+  // other buffer of a double buffered pipeline meanwhile
+  m_pModelPipeline->acquireFrame();
+
   // get the number of meshes
   int meshCount;
   meshCount = pCalRenderer->getMeshCount();
@@ -481,31 +935,32 @@ void Model::renderMesh(bool bWireframe, bool bLight)
         shininess = 50.0f; //TODO: pCalRenderer->getShininess();
         glMaterialfv(GL_FRONT_AND_BACK, GL_SHININESS, &shininess);
 
-        // get the transformed vertices of the submesh
-        static float meshVertices[30000][3];
-        int vertexCount;
-        vertexCount = pCalRenderer->getVertices(&meshVertices[0][0]);
+        // get the vertex stream the pipeline skinned in the last update, the
+        // stride is 0 for separate arrays
+        const float *pVertexBuffer;
+        pVertexBuffer = m_pModelPipeline->getVertices(meshId, submeshId);
+        const float *pNormalBuffer;
+        pNormalBuffer = m_pModelPipeline->getNormals(meshId, submeshId);
+        const float *pTextureCoordinateBuffer;
+        pTextureCoordinateBuffer = m_pModelPipeline->getTextureCoordinates(meshId, submeshId);
+        if((pVertexBuffer == 0) || (pNormalBuffer == 0)) continue;
 
-        // get the transformed normals of the submesh
-        static float meshNormals[30000][3];
-        pCalRenderer->getNormals(&meshNormals[0][0]);
+        int stride;
+        stride = m_pModelPipeline->getVertexLayout().stride;
 
-        // get the texture coordinates of the submesh
-        static float meshTextureCoordinates[30000][2];
-        int textureCoordinateCount;
-        textureCoordinateCount = pCalRenderer->getTextureCoordinates(0, &meshTextureCoordinates[0][0]);
+        // get the faces extracted for the current lod level
+        const SubmeshRenderData& submeshRenderData = m_vectorSubmeshRenderData[m_vectorFirstSubmeshRenderDataId[meshId] + submeshId];
 
-        // get the faces of the submesh
-        static CalIndex meshFaces[50000][3];
         int faceCount;
-        faceCount = pCalRenderer->getFaces(&meshFaces[0][0]);
+        faceCount = submeshRenderData.faceCount;
+        if(faceCount == 0) continue;
 
         // set the vertex and normal buffers
-        glVertexPointer(3, GL_FLOAT, 0, &meshVertices[0][0]);
-        glNormalPointer(GL_FLOAT, 0, &meshNormals[0][0]);
+        glVertexPointer(3, GL_FLOAT, stride, pVertexBuffer);
+        glNormalPointer(GL_FLOAT, stride, pNormalBuffer);
 
         // set the texture coordinate buffer and state if necessary
-        if((pCalRenderer->getMapCount() > 0) && (textureCoordinateCount > 0))
+        if((pCalRenderer->getMapCount() > 0) && (pTextureCoordinateBuffer != 0))
         {
           glEnable(GL_TEXTURE_2D);
           glEnableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -515,21 +970,21 @@ void Model::renderMesh(bool bWireframe, bool bLight)
           glBindTexture(GL_TEXTURE_2D, (GLuint)pCalRenderer->getMapUserData(0));
 
           // set the texture coordinate buffer
-          glTexCoordPointer(2, GL_FLOAT, 0, &meshTextureCoordinates[0][0]);
+          glTexCoordPointer(2, GL_FLOAT, stride, pTextureCoordinateBuffer);
           glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
         }
 
         // draw the submesh
         if(bWireframe)
-            glDrawElements(GL_LINES, faceCount * 3, GL_UNSIGNED_SHORT, &meshFaces[0][0]);
+            glDrawElements(GL_LINES, faceCount * 3, GL_UNSIGNED_SHORT, &submeshRenderData.vectorFace[0]);
         else
         //if(sizeof(CalIndex)==2)
-            glDrawElements(GL_TRIANGLES, faceCount * 3, GL_UNSIGNED_SHORT, &meshFaces[0][0]);
+            glDrawElements(GL_TRIANGLES, faceCount * 3, GL_UNSIGNED_SHORT, &submeshRenderData.vectorFace[0]);
         //else
-		//	  glDrawElements(GL_TRIANGLES, faceCount * 3, GL_UNSIGNED_INT, &meshFaces[0][0]);
+		//	  glDrawElements(GL_TRIANGLES, faceCount * 3, GL_UNSIGNED_INT, &submeshRenderData.vectorFace[0]);
 
         // disable the texture coordinate state if necessary
-        if((pCalRenderer->getMapCount() > 0) && (textureCoordinateCount > 0))
+        if((pCalRenderer->getMapCount() > 0) && (pTextureCoordinateBuffer != 0))
         {
           glDisable(GL_COLOR_MATERIAL);
           glDisableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -554,6 +1009,9 @@ glEnd();
     }
   }
 
+  // the vertex arrays were consumed by the draw calls
+  m_pModelPipeline->releaseFrame();
+
   // clear vertex array state
   glDisableClientState(GL_NORMAL_ARRAY);
   glDisableClientState(GL_VERTEX_ARRAY);
@@ -641,8 +1099,11 @@ void Model::onRender()
 
 void Model::onUpdate(float elapsedSeconds)
 {
-  // update the model
-  m_calModel->update(elapsedSeconds);
+  // the cpu skinning is skipped while the gpu skins the model
+  m_pModelPipeline->setVisible(!HardwareSkinning::isEnabled() || (m_pHardwareSkinning == 0));
+
+  // update the model, the same as CalModel::update plus the skinning
+  m_pModelPipeline->update(elapsedSeconds);
 }
 
 //----------------------------------------------------------------------------//
@@ -651,8 +1112,31 @@ void Model::onUpdate(float elapsedSeconds)
 
 void Model::onShutdown()
 {
+  delete m_pHardwareSkinning;
+  m_pHardwareSkinning = 0;
+
+  delete m_pModelPipeline;
+  m_pModelPipeline = 0;
+
   delete m_calModel;
-  delete m_calCoreModel;
+  m_calModel = 0;
+
+  // the core model goes away with the last model sharing it
+  CoreModelCache::release(m_calCoreModel);
+  m_calCoreModel = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Set the animation level of detail of the model, how often it is updated    //
+// and if its detail bones are animated                                       //
+//----------------------------------------------------------------------------//
+
+void Model::setAnimationLod(int animationLod)
+{
+  m_animationLod = animationLod;
+
+  m_pModelPipeline->setUpdateInterval(AnimationLod::getUpdateInterval((AnimationLod::Level)m_animationLod));
+  ((AnimMixer *)m_calModel->getAbstractMixer())->setDetailSkipped(AnimationLod::isDetailSkipped((AnimationLod::Level)m_animationLod));
 }
 
 //----------------------------------------------------------------------------//
@@ -665,6 +1149,10 @@ void Model::setLodLevel(float lodLevel)
 
   // set the new lod level in the cal model renderer
   m_calModel->setLodLevel(m_lodLevel);
+
+  // the vertex and face counts changed, skin again even if the model is paused
+  m_pModelPipeline->setDirty(ModelPipeline::DIRTY_SKIN);
+  extractFaces();
 }
 
 //----------------------------------------------------------------------------//
@@ -736,3 +1224,30 @@ void Model::setPath( const std::string& strPath )
 }
 
 //----------------------------------------------------------------------------//
+// Create a texture from a decoded image                                      //
+//----------------------------------------------------------------------------//
+
+GLuint Model::uploadTexture(const TextureImage& textureImage)
+{
+  if(textureImage.vectorPixel.empty()) return 0;
+
+  GLenum format;
+  format = (textureImage.depth == 3) ? GL_RGB : GL_RGBA;
+
+  // generate texture
+  GLuint textureId;
+  textureId = 0;
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glGenTextures(1, &textureId);
+  glBindTexture(GL_TEXTURE_2D, textureId);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexImage2D(GL_TEXTURE_2D, 0, format, textureImage.width, textureImage.height, 0, format, GL_UNSIGNED_BYTE, &textureImage.vectorPixel[0]);
+
+  return textureId;
+}
+
+//----------------------------------------------------------------------------//
@@ -17,6 +17,13 @@
 
 #include "global.h"
 
+//----------------------------------------------------------------------------//
+// Forward declarations                                                       //
+//----------------------------------------------------------------------------//
+
+class HardwareSkinning;
+class ModelPipeline;
+
 //----------------------------------------------------------------------------//
 // Class declaration                                                          //
 //----------------------------------------------------------------------------//
@@ -29,6 +36,25 @@ public:
   static const int STATE_FANCY;
   static const int STATE_MOTION;
 
+  // a texture decoded by onLoad that waits for its upload in onUpload
+  struct TextureImage
+  {
+    int materialId;
+    int mapId;
+    int width;
+    int height;
+    int depth;
+    std::vector<unsigned char> vectorPixel;
+  };
+
+  // the faces of a submesh, they only change with the lod level, the texture
+  // coordinates live in the vertex stream of the pipeline
+  struct SubmeshRenderData
+  {
+    int faceCount;
+    std::vector<CalIndex> vectorFace;
+  };
+
 // member variables
 protected:
   int m_state;
@@ -43,7 +69,14 @@ protected:
   float m_motionBlend[3];
   float m_renderScale;
   float m_lodLevel;
+  int m_animationLod;
   std::string m_path;
+  std::string m_strFilename;
+  std::vector<TextureImage> m_vectorTextureImage;
+  ModelPipeline *m_pModelPipeline;
+  std::vector<SubmeshRenderData> m_vectorSubmeshRenderData;
+  std::vector<int> m_vectorFirstSubmeshRenderDataId;
+  HardwareSkinning *m_pHardwareSkinning;
 
 // constructors/destructor
 public:
@@ -53,14 +86,25 @@ public:
 // member functions
 public:
   void executeAction(int action);
+  int getAnimationLod();
+  CalModel *getCalModel();
+  const std::string& getFilename();
+  HardwareSkinning *getHardwareSkinning();
   float getLodLevel();
   void getMotionBlend(float *pMotionBlend);
+  ModelPipeline *getModelPipeline();
+  const std::string& getPath();
+  int getRenderDataByteSize();
   float getRenderScale();
   int getState();
+  const std::vector<TextureImage>& getTextureImages();
   bool onInit(const std::string& strFilename);
+  bool onLoad(const std::string& strFilename);
   void onRender();
   void onShutdown();
   void onUpdate(float elapsedSeconds);
+  bool onUpload();
+  void setAnimationLod(int animationLod);
   void setLodLevel(float lodLevel);
   void setMotionBlend(float *pMotionBlend, float delay);
   void setState(int state, float delay);
@@ -75,8 +119,13 @@ public:
 */
 
 protected:
-  GLuint loadTexture(const std::string& strFilename);
+  bool decodeTexture(const std::string& strFilename, TextureImage& textureImage);
+  void extractFaces();
+  void extractRenderData();
+  bool loadCoreModel(const std::string& strFilename);
+  void renderHardwareMesh(bool bWireframe, bool bLight);
   void renderMesh(bool bWireframe, bool bLight);
+  GLuint uploadTexture(const TextureImage& textureImage);
 };
 
 #endif
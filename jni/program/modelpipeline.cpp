@@ -0,0 +1,1155 @@
+//----------------------------------------------------------------------------//
+// modelpipeline.cpp                                                          //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "modelpipeline.h"
+#include "animmixer.h"
+#include "coremodeldata.h"
+#include "skinning.h"
+#include <algorithm>
+#include <string.h>
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+ModelPipeline::ModelPipeline(CalModel *pModel)
+{
+  m_pModel = pModel;
+  m_dirtyFlags = DIRTY_ALL;
+  m_bPaused = false;
+  m_bVisible = true;
+  m_simulateSeconds = 0.0f;
+  m_vertexLayout = getSeparateLayout();
+  m_skinningMethod = Skinning::METHOD_LINEAR;
+  m_bFlatSkeleton = false;
+  m_bFlatSkeletonActive = false;
+  m_bDoubleBuffered = false;
+  m_frontBufferId = 0;
+  m_readBufferId = -1;
+  m_bufferFrameId[0] = 0;
+  m_bufferFrameId[1] = 0;
+  m_frameCount = 0;
+  m_fenceWaitCount = 0;
+  m_updateInterval = 1;
+  m_intervalFrameId = 0;
+  m_leadSeconds = 0.0f;
+  m_intervalSeconds = 0.0f;
+  m_keyframeId = 0;
+  m_bKeyframeValid = false;
+
+  pthread_mutex_init(&m_mutex, 0);
+  pthread_cond_init(&m_condition, 0);
+
+  m_vectorBoneMatrix.resize(pModel->getSkeleton()->getVectorBone().size() * Skinning::BONE_MATRIX_SIZE);
+
+  CoreModelData *pCoreModelData;
+  pCoreModelData = CoreModelData::get(pModel->getCoreModel());
+
+  // one output buffer per submesh, large enough for the highest lod level, the
+  // second buffer is only allocated for double buffering
+  std::vector<CalMesh *>& vectorMesh = pModel->getVectorMesh();
+
+  unsigned int meshId;
+  for(meshId = 0; meshId < vectorMesh.size(); meshId++)
+  {
+    m_vectorFirstSubmeshOutputId.push_back((int)m_vectorSubmeshOutput.size());
+
+    std::vector<CalSubmesh *>& vectorSubmesh = vectorMesh[meshId]->getVectorSubmesh();
+
+    unsigned int submeshId;
+    for(submeshId = 0; submeshId < vectorSubmesh.size(); submeshId++)
+    {
+      SubmeshOutput submeshOutput;
+      submeshOutput.pSubmesh = vectorSubmesh[submeshId];
+      submeshOutput.pSkinStream = (pCoreModelData != 0) ? pCoreModelData->getSkinStream(submeshOutput.pSubmesh->getCoreSubmesh()) : 0;
+      submeshOutput.textureCoordinateCount = 0;
+      submeshOutput.vertexCount[0] = 0;
+      submeshOutput.vertexCount[1] = 0;
+      submeshOutput.keyframeVertexCount[0] = 0;
+      submeshOutput.keyframeVertexCount[1] = 0;
+
+      m_vectorSubmeshOutput.push_back(submeshOutput);
+
+      allocateBuffer(m_vectorSubmeshOutput.back(), 0);
+    }
+  }
+
+  resetCounters();
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+ModelPipeline::~ModelPipeline()
+{
+  pthread_cond_destroy(&m_condition);
+  pthread_mutex_destroy(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Take the last finished frame for rendering, the update thread does not     //
+// write into it until it is released, returns the number of the frame        //
+//----------------------------------------------------------------------------//
+
+int ModelPipeline::acquireFrame()
+{
+  int frameId;
+
+  pthread_mutex_lock(&m_mutex);
+  m_readBufferId = m_bDoubleBuffered ? m_frontBufferId : -1;
+  frameId = m_bufferFrameId[m_frontBufferId];
+  pthread_mutex_unlock(&m_mutex);
+
+  return frameId;
+}
+
+//----------------------------------------------------------------------------//
+// Allocate an output buffer of a submesh in the current vertex layout, the   //
+// texture coordinates never change and are filled in right away              //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::allocateBuffer(SubmeshOutput& submeshOutput, int bufferId)
+{
+  CalCoreSubmesh *pCoreSubmesh;
+  pCoreSubmesh = submeshOutput.pSubmesh->getCoreSubmesh();
+
+  int vertexCount;
+  vertexCount = pCoreSubmesh->getVertexCount();
+
+  // only the first texture coordinate set gets rendered
+  std::vector<std::vector<CalCoreSubmesh::TextureCoordinate> >& vectorvectorTextureCoordinate = pCoreSubmesh->getVectorVectorTextureCoordinate();
+
+  int textureCoordinateCount;
+  textureCoordinateCount = vectorvectorTextureCoordinate.empty() ? 0 : std::min((int)vectorvectorTextureCoordinate[0].size(), vertexCount);
+
+  submeshOutput.textureCoordinateCount = textureCoordinateCount;
+  submeshOutput.vertexCount[bufferId] = 0;
+
+  int textureCoordinateId;
+
+  if(m_vertexLayout.stride == 0)
+  {
+    submeshOutput.vectorVertex[bufferId].assign(vertexCount * 3, 0.0f);
+    submeshOutput.vectorNormal[bufferId].assign(vertexCount * 3, 0.0f);
+
+    // all buffers share the same texture coordinates
+    if(bufferId != 0) return;
+
+    submeshOutput.vectorTextureCoordinate.resize(textureCoordinateCount * 2);
+    for(textureCoordinateId = 0; textureCoordinateId < textureCoordinateCount; textureCoordinateId++)
+    {
+      submeshOutput.vectorTextureCoordinate[textureCoordinateId * 2] = vectorvectorTextureCoordinate[0][textureCoordinateId].u;
+      submeshOutput.vectorTextureCoordinate[textureCoordinateId * 2 + 1] = vectorvectorTextureCoordinate[0][textureCoordinateId].v;
+    }
+
+    return;
+  }
+
+  submeshOutput.vectorVertex[bufferId].assign(vertexCount * m_vertexLayout.stride / sizeof(float), 0.0f);
+  std::vector<float>().swap(submeshOutput.vectorNormal[bufferId]);
+  if(bufferId == 0) std::vector<float>().swap(submeshOutput.vectorTextureCoordinate);
+
+  if((m_vertexLayout.textureCoordinateOffset < 0) || submeshOutput.vectorVertex[bufferId].empty()) return;
+
+  char *pBuffer;
+  pBuffer = (char *)&submeshOutput.vectorVertex[bufferId][0] + m_vertexLayout.textureCoordinateOffset;
+
+  for(textureCoordinateId = 0; textureCoordinateId < textureCoordinateCount; textureCoordinateId++)
+  {
+    float *pTextureCoordinate;
+    pTextureCoordinate = (float *)(pBuffer + textureCoordinateId * m_vertexLayout.stride);
+    pTextureCoordinate[0] = vectorvectorTextureCoordinate[0][textureCoordinateId].u;
+    pTextureCoordinate[1] = vectorvectorTextureCoordinate[0][textureCoordinateId].v;
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Advance the animations and the morph target weights                        //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::animate(float elapsedSeconds)
+{
+  // a paused model keeps its pose and needs no further stage
+  if(m_bPaused)
+  {
+    m_skipCount[STAGE_ANIMATE]++;
+    return;
+  }
+
+  m_pModel->getAbstractMixer()->updateAnimation(elapsedSeconds);
+  m_pModel->getMorphTargetMixer()->update(elapsedSeconds);
+
+  // the spring system integrates over all time it has not seen yet
+  m_simulateSeconds += elapsedSeconds;
+
+  m_dirtyFlags |= DIRTY_ALL;
+  m_runCount[STAGE_ANIMATE]++;
+}
+
+//----------------------------------------------------------------------------//
+// Get the buffer the skin stage writes into, waits as long as the render     //
+// thread still holds it                                                      //
+//----------------------------------------------------------------------------//
+
+int ModelPipeline::beginWrite()
+{
+  if(!m_bDoubleBuffered) return 0;
+
+  int bufferId;
+
+  pthread_mutex_lock(&m_mutex);
+  bufferId = 1 - m_frontBufferId;
+  while(m_readBufferId == bufferId)
+  {
+    m_fenceWaitCount++;
+    pthread_cond_wait(&m_condition, &m_mutex);
+  }
+  pthread_mutex_unlock(&m_mutex);
+
+  return bufferId;
+}
+
+//----------------------------------------------------------------------------//
+// Publish a completely skinned buffer as the new front buffer                //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::endWrite(int bufferId)
+{
+  pthread_mutex_lock(&m_mutex);
+  m_frameCount++;
+  m_bufferFrameId[bufferId] = m_frameCount;
+  m_frontBufferId = bufferId;
+  pthread_mutex_unlock(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Get the bone matrices of the last pose for the skinning kernels            //
+//----------------------------------------------------------------------------//
+
+const float *ModelPipeline::getBoneMatrices()
+{
+  return m_vectorBoneMatrix.empty() ? 0 : &m_vectorBoneMatrix[0];
+}
+
+//----------------------------------------------------------------------------//
+// Get the bone transforms of the skinning method, 0 if there are no bones    //
+//----------------------------------------------------------------------------//
+
+const float *ModelPipeline::getBoneTransforms()
+{
+  if(m_vectorBoneMatrix.empty()) return 0;
+
+  return (m_skinningMethod == Skinning::METHOD_DUAL_QUATERNION) ? &m_vectorDualQuaternion[0] : &m_vectorBoneMatrix[0];
+}
+
+//----------------------------------------------------------------------------//
+// Get the stages that have to run again                                      //
+//----------------------------------------------------------------------------//
+
+int ModelPipeline::getDirtyFlags()
+{
+  return m_dirtyFlags;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of times the skin stage had to wait for the render thread   //
+//----------------------------------------------------------------------------//
+
+int ModelPipeline::getFenceWaitCount()
+{
+  int fenceWaitCount;
+
+  pthread_mutex_lock(&m_mutex);
+  fenceWaitCount = m_fenceWaitCount;
+  pthread_mutex_unlock(&m_mutex);
+
+  return fenceWaitCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of finished skinned frames                                  //
+//----------------------------------------------------------------------------//
+
+int ModelPipeline::getFrameCount()
+{
+  int frameCount;
+
+  pthread_mutex_lock(&m_mutex);
+  frameCount = m_frameCount;
+  pthread_mutex_unlock(&m_mutex);
+
+  return frameCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the layout of one stream with position, normal and texture coordinate  //
+//----------------------------------------------------------------------------//
+
+ModelPipeline::VertexLayout ModelPipeline::getInterleavedLayout()
+{
+  VertexLayout vertexLayout;
+  vertexLayout.stride = 8 * sizeof(float);
+  vertexLayout.normalOffset = 3 * sizeof(float);
+  vertexLayout.textureCoordinateOffset = 6 * sizeof(float);
+
+  return vertexLayout;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of updates that interpolated the skinned output             //
+//----------------------------------------------------------------------------//
+
+int ModelPipeline::getInterpolationCount()
+{
+  return m_interpolationCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the model instance                                                     //
+//----------------------------------------------------------------------------//
+
+CalModel *ModelPipeline::getModel()
+{
+  return m_pModel;
+}
+
+//----------------------------------------------------------------------------//
+// Get the skinned normals of a submesh                                       //
+//----------------------------------------------------------------------------//
+
+const float *ModelPipeline::getNormals(int meshId, int submeshId)
+{
+  SubmeshOutput& submeshOutput = getSubmeshOutput(meshId, submeshId);
+
+  int bufferId;
+  bufferId = getReadBufferId();
+
+  if(m_vertexLayout.stride == 0)
+  {
+    return submeshOutput.vectorNormal[bufferId].empty() ? 0 : &submeshOutput.vectorNormal[bufferId][0];
+  }
+
+  return submeshOutput.vectorVertex[bufferId].empty() ? 0 : (const float *)((const char *)&submeshOutput.vectorVertex[bufferId][0] + m_vertexLayout.normalOffset);
+}
+
+//----------------------------------------------------------------------------//
+// Get the buffer the getters read from, the acquired one if there is one     //
+//----------------------------------------------------------------------------//
+
+int ModelPipeline::getReadBufferId()
+{
+  if(!m_bDoubleBuffered) return 0;
+
+  return (m_readBufferId >= 0) ? m_readBufferId : m_frontBufferId;
+}
+
+//----------------------------------------------------------------------------//
+// Get the separate arrays layout, the default                                //
+//----------------------------------------------------------------------------//
+
+ModelPipeline::VertexLayout ModelPipeline::getSeparateLayout()
+{
+  VertexLayout vertexLayout;
+  vertexLayout.stride = 0;
+  vertexLayout.normalOffset = 0;
+  vertexLayout.textureCoordinateOffset = 0;
+
+  return vertexLayout;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of times a stage did its work                               //
+//----------------------------------------------------------------------------//
+
+int ModelPipeline::getRunCount(int stage)
+{
+  return m_runCount[stage];
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of times a stage had nothing to do                          //
+//----------------------------------------------------------------------------//
+
+int ModelPipeline::getSkipCount(int stage)
+{
+  return m_skipCount[stage];
+}
+
+//----------------------------------------------------------------------------//
+// Get how the influences of a vertex are blended                             //
+//----------------------------------------------------------------------------//
+
+Skinning::Method ModelPipeline::getSkinningMethod()
+{
+  return m_skinningMethod;
+}
+
+//----------------------------------------------------------------------------//
+// Get the output buffers of a submesh                                        //
+//----------------------------------------------------------------------------//
+
+ModelPipeline::SubmeshOutput& ModelPipeline::getSubmeshOutput(int meshId, int submeshId)
+{
+  return m_vectorSubmeshOutput[m_vectorFirstSubmeshOutputId[meshId] + submeshId];
+}
+
+//----------------------------------------------------------------------------//
+// Get the texture coordinates of a submesh, 0 if it has none                 //
+//----------------------------------------------------------------------------//
+
+const float *ModelPipeline::getTextureCoordinates(int meshId, int submeshId)
+{
+  SubmeshOutput& submeshOutput = getSubmeshOutput(meshId, submeshId);
+  if(submeshOutput.textureCoordinateCount == 0) return 0;
+
+  if(m_vertexLayout.stride == 0) return &submeshOutput.vectorTextureCoordinate[0];
+
+  int bufferId;
+  bufferId = getReadBufferId();
+
+  if((m_vertexLayout.textureCoordinateOffset < 0) || submeshOutput.vectorVertex[bufferId].empty()) return 0;
+
+  return (const float *)((const char *)&submeshOutput.vectorVertex[bufferId][0] + m_vertexLayout.textureCoordinateOffset);
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of updates that skipped all stages because of the update    //
+// interval                                                                   //
+//----------------------------------------------------------------------------//
+
+int ModelPipeline::getThrottledCount()
+{
+  return m_throttledCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of updates between two runs of the stages                   //
+//----------------------------------------------------------------------------//
+
+int ModelPipeline::getUpdateInterval()
+{
+  return m_updateInterval;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of skinned vertices of a submesh                            //
+//----------------------------------------------------------------------------//
+
+int ModelPipeline::getVertexCount(int meshId, int submeshId)
+{
+  return getSubmeshOutput(meshId, submeshId).vertexCount[getReadBufferId()];
+}
+
+//----------------------------------------------------------------------------//
+// Get the layout of the skinned output                                       //
+//----------------------------------------------------------------------------//
+
+const ModelPipeline::VertexLayout& ModelPipeline::getVertexLayout()
+{
+  return m_vertexLayout;
+}
+
+//----------------------------------------------------------------------------//
+// Get the skinned vertices of a submesh                                      //
+//----------------------------------------------------------------------------//
+
+const float *ModelPipeline::getVertices(int meshId, int submeshId)
+{
+  SubmeshOutput& submeshOutput = getSubmeshOutput(meshId, submeshId);
+
+  int bufferId;
+  bufferId = getReadBufferId();
+
+  return submeshOutput.vectorVertex[bufferId].empty() ? 0 : &submeshOutput.vectorVertex[bufferId][0];
+}
+
+//----------------------------------------------------------------------------//
+// Write the skinned output between the last two skinned keyframes, a factor  //
+// of 0 is the older keyframe; the normals are not renormalized, the          //
+// keyframes are close enough for that                                        //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::interpolate(float factor)
+{
+  if(!m_bVisible || !m_bKeyframeValid) return;
+
+  int stride;
+  stride = m_vertexLayout.stride;
+
+  int bufferId;
+  bufferId = beginWrite();
+
+  unsigned int submeshOutputId;
+  for(submeshOutputId = 0; submeshOutputId < m_vectorSubmeshOutput.size(); submeshOutputId++)
+  {
+    SubmeshOutput& submeshOutput = m_vectorSubmeshOutput[submeshOutputId];
+    if(submeshOutput.vectorVertex[bufferId].empty() || submeshOutput.vectorKeyframeVertex[m_keyframeId].empty()) continue;
+
+    const int olderKeyframeId = 1 - m_keyframeId;
+
+    int vertexCount;
+    vertexCount = submeshOutput.keyframeVertexCount[m_keyframeId];
+
+    // the vertex count changes with the lod level, such keyframes can not be
+    // interpolated
+    float submeshFactor;
+    submeshFactor = (submeshOutput.keyframeVertexCount[olderKeyframeId] == vertexCount) ? factor : 1.0f;
+
+    // an interleaved stream is interpolated as a whole, the texture
+    // coordinates are the same in both keyframes and stay unchanged
+    if(stride == 0)
+    {
+      interpolateArray(&submeshOutput.vectorKeyframeVertex[olderKeyframeId][0], &submeshOutput.vectorKeyframeVertex[m_keyframeId][0], vertexCount * 3, submeshFactor, &submeshOutput.vectorVertex[bufferId][0]);
+      interpolateArray(&submeshOutput.vectorKeyframeNormal[olderKeyframeId][0], &submeshOutput.vectorKeyframeNormal[m_keyframeId][0], vertexCount * 3, submeshFactor, &submeshOutput.vectorNormal[bufferId][0]);
+    }
+    else
+    {
+      interpolateArray(&submeshOutput.vectorKeyframeVertex[olderKeyframeId][0], &submeshOutput.vectorKeyframeVertex[m_keyframeId][0], vertexCount * stride / sizeof(float), submeshFactor, &submeshOutput.vectorVertex[bufferId][0]);
+    }
+
+    submeshOutput.vertexCount[bufferId] = vertexCount;
+  }
+
+  endWrite(bufferId);
+
+  m_interpolationCount++;
+}
+
+//----------------------------------------------------------------------------//
+// Interpolate two arrays of floats linearly                                  //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::interpolateArray(const float *pValue, const float *pTargetValue, int count, float factor, float *pOutput)
+{
+  int i;
+  for(i = 0; i < count; i++)
+  {
+    pOutput[i] = pValue[i] + (pTargetValue[i] - pValue[i]) * factor;
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Check if the skinned output is double buffered                             //
+//----------------------------------------------------------------------------//
+
+bool ModelPipeline::isDoubleBuffered()
+{
+  return m_bDoubleBuffered;
+}
+
+//----------------------------------------------------------------------------//
+// Check if the poses go through the flat skeleton when the model allows it   //
+//----------------------------------------------------------------------------//
+
+bool ModelPipeline::isFlatSkeleton()
+{
+  return m_bFlatSkeleton;
+}
+
+//----------------------------------------------------------------------------//
+// Check if nothing but the skinning kernels reads the bones of cal3d, the    //
+// physique fallback, the spring system and the hardware skinning of hidden   //
+// models all need them                                                       //
+//----------------------------------------------------------------------------//
+
+bool ModelPipeline::isFlatSkeletonSupported()
+{
+  if(!m_bVisible || m_vectorBoneMatrix.empty()) return false;
+  if((Skinning::getPath() == Skinning::PATH_PHYSIQUE) && (m_skinningMethod != Skinning::METHOD_DUAL_QUATERNION)) return false;
+
+  unsigned int submeshOutputId;
+  for(submeshOutputId = 0; submeshOutputId < m_vectorSubmeshOutput.size(); submeshOutputId++)
+  {
+    CalSubmesh *pSubmesh;
+    pSubmesh = m_vectorSubmeshOutput[submeshOutputId].pSubmesh;
+
+    if(m_vectorSubmeshOutput[submeshOutputId].pSkinStream == 0) return false;
+    if(!Skinning::isSubmeshSupported(pSubmesh) || pSubmesh->hasInternalData()) return false;
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Check if the animations are paused                                         //
+//----------------------------------------------------------------------------//
+
+bool ModelPipeline::isPaused()
+{
+  return m_bPaused;
+}
+
+//----------------------------------------------------------------------------//
+// Check if the model gets rendered                                           //
+//----------------------------------------------------------------------------//
+
+bool ModelPipeline::isVisible()
+{
+  return m_bVisible;
+}
+
+//----------------------------------------------------------------------------//
+// Blend the animations into the skeleton and build the bone matrices         //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::pose()
+{
+  if((m_dirtyFlags & DIRTY_POSE) == 0)
+  {
+    m_skipCount[STAGE_POSE]++;
+    return;
+  }
+
+  bool bFlatSkeleton;
+  bFlatSkeleton = m_bFlatSkeleton && isFlatSkeletonSupported();
+
+  // only pipelines that ever used the switch touch the mixer, the flat
+  // skeleton needs the AnimMixer of Model
+  if(bFlatSkeleton != m_bFlatSkeletonActive)
+  {
+    ((AnimMixer *)m_pModel->getAbstractMixer())->setFlatSkeleton(bFlatSkeleton ? &m_flatSkeleton : 0);
+    m_bFlatSkeletonActive = bFlatSkeleton;
+  }
+
+  m_pModel->getAbstractMixer()->updateSkeleton();
+
+  if(!m_vectorBoneMatrix.empty())
+  {
+    if(bFlatSkeleton)
+    {
+      m_flatSkeleton.getBoneMatrices(&m_vectorBoneMatrix[0]);
+    }
+    else
+    {
+      Skinning::calculateBoneMatrices(m_pModel->getSkeleton(), &m_vectorBoneMatrix[0]);
+    }
+
+    if(m_skinningMethod == Skinning::METHOD_DUAL_QUATERNION)
+    {
+      Skinning::calculateDualQuaternions(&m_vectorBoneMatrix[0], m_vectorBoneMatrix.size() / Skinning::BONE_MATRIX_SIZE, &m_vectorDualQuaternion[0]);
+    }
+  }
+
+  m_dirtyFlags &= ~DIRTY_POSE;
+  m_runCount[STAGE_POSE]++;
+}
+
+//----------------------------------------------------------------------------//
+// Give the acquired frame back to the update thread                          //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::releaseFrame()
+{
+  pthread_mutex_lock(&m_mutex);
+  m_readBufferId = -1;
+  pthread_cond_signal(&m_condition);
+  pthread_mutex_unlock(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Reset the run and skip counters                                            //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::resetCounters()
+{
+  int stage;
+  for(stage = 0; stage < STAGE_COUNT; stage++)
+  {
+    m_runCount[stage] = 0;
+    m_skipCount[stage] = 0;
+  }
+
+  m_throttledCount = 0;
+  m_interpolationCount = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Run a single stage, for schedulers that run one stage of many models       //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::runStage(int stage, float elapsedSeconds)
+{
+  switch(stage)
+  {
+    case STAGE_ANIMATE:
+      animate(elapsedSeconds);
+      break;
+    case STAGE_POSE:
+      pose();
+      break;
+    case STAGE_SIMULATE:
+      simulate();
+      break;
+    case STAGE_SKIN:
+      skin();
+      break;
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Force stages to run again, e.g. after the lod level or the skinning path   //
+// changed                                                                    //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::setDirty(int dirtyFlags)
+{
+  m_dirtyFlags |= dirtyFlags;
+
+  // the skinned keyframes are out of date as well
+  if((dirtyFlags & DIRTY_SKIN) != 0) m_bKeyframeValid = false;
+}
+
+//----------------------------------------------------------------------------//
+// Switch double buffering on or off, only while no other thread uses the     //
+// pipeline                                                                   //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::setDoubleBuffered(bool bDoubleBuffered)
+{
+  if(bDoubleBuffered == m_bDoubleBuffered) return;
+
+  unsigned int submeshOutputId;
+  for(submeshOutputId = 0; submeshOutputId < m_vectorSubmeshOutput.size(); submeshOutputId++)
+  {
+    SubmeshOutput& submeshOutput = m_vectorSubmeshOutput[submeshOutputId];
+
+    if(bDoubleBuffered)
+    {
+      allocateBuffer(submeshOutput, 1);
+    }
+    else
+    {
+      // keep the last finished frame in the single buffer
+      if(m_frontBufferId == 1)
+      {
+        submeshOutput.vectorVertex[0].swap(submeshOutput.vectorVertex[1]);
+        submeshOutput.vectorNormal[0].swap(submeshOutput.vectorNormal[1]);
+        submeshOutput.vertexCount[0] = submeshOutput.vertexCount[1];
+      }
+
+      std::vector<float>().swap(submeshOutput.vectorVertex[1]);
+      std::vector<float>().swap(submeshOutput.vectorNormal[1]);
+      submeshOutput.vertexCount[1] = 0;
+    }
+  }
+
+  m_bufferFrameId[0] = m_bufferFrameId[m_frontBufferId];
+  m_bufferFrameId[1] = 0;
+  m_frontBufferId = 0;
+  m_readBufferId = -1;
+  m_bDoubleBuffered = bDoubleBuffered;
+}
+
+//----------------------------------------------------------------------------//
+// Pose through the flat skeleton instead of the bones of cal3d, only taken   //
+// while isFlatSkeletonSupported holds; the bones of cal3d keep their last    //
+// state meanwhile, so bounding boxes and other bone queries see that state   //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::setFlatSkeleton(bool bFlatSkeleton)
+{
+  // skeletons that cannot be sorted parents first stay on the bones of cal3d
+  if(bFlatSkeleton && (m_flatSkeleton.getBoneCount() == 0))
+  {
+    if(!m_flatSkeleton.create(m_pModel->getSkeleton()->getCoreSkeleton())) bFlatSkeleton = false;
+  }
+
+  m_bFlatSkeleton = bFlatSkeleton;
+  setDirty(DIRTY_POSE);
+}
+
+//----------------------------------------------------------------------------//
+// Pause or resume the animations                                             //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::setPaused(bool bPaused)
+{
+  m_bPaused = bPaused;
+}
+
+//----------------------------------------------------------------------------//
+// Select how the influences of a vertex are blended, only while no other     //
+// thread uses the pipeline                                                   //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::setSkinningMethod(Skinning::Method method)
+{
+  if(method == m_skinningMethod) return;
+
+  m_skinningMethod = method;
+
+  // the dual quaternions are built from the bone matrices of the last pose
+  if((m_skinningMethod == Skinning::METHOD_DUAL_QUATERNION) && !m_vectorBoneMatrix.empty())
+  {
+    m_vectorDualQuaternion.resize(m_vectorBoneMatrix.size() / Skinning::BONE_MATRIX_SIZE * Skinning::DUAL_QUATERNION_SIZE);
+    Skinning::calculateDualQuaternions(&m_vectorBoneMatrix[0], m_vectorBoneMatrix.size() / Skinning::BONE_MATRIX_SIZE, &m_vectorDualQuaternion[0]);
+  }
+
+  // skin again even if the model is paused
+  m_dirtyFlags |= DIRTY_SKIN;
+  m_bKeyframeValid = false;
+}
+
+//----------------------------------------------------------------------------//
+// Set the number of updates between two runs of the stages, the updates in   //
+// between interpolate the skinned output; switching starts over from the     //
+// current pose                                                               //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::setUpdateInterval(int updateInterval)
+{
+  if(updateInterval < 1) updateInterval = 1;
+  if(updateInterval == m_updateInterval) return;
+
+  m_updateInterval = updateInterval;
+  m_intervalFrameId = 0;
+  m_leadSeconds = 0.0f;
+  m_intervalSeconds = 0.0f;
+  m_bKeyframeValid = false;
+
+  // the keyframes are only kept while the updates are throttled
+  if(m_updateInterval > 1) return;
+
+  unsigned int submeshOutputId;
+  for(submeshOutputId = 0; submeshOutputId < m_vectorSubmeshOutput.size(); submeshOutputId++)
+  {
+    SubmeshOutput& submeshOutput = m_vectorSubmeshOutput[submeshOutputId];
+
+    int keyframeId;
+    for(keyframeId = 0; keyframeId < KEYFRAME_COUNT; keyframeId++)
+    {
+      std::vector<float>().swap(submeshOutput.vectorKeyframeVertex[keyframeId]);
+      std::vector<float>().swap(submeshOutput.vectorKeyframeNormal[keyframeId]);
+      submeshOutput.keyframeVertexCount[keyframeId] = 0;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Change the layout of the skinned output, only while no other thread uses   //
+// the pipeline, the next skin stage fills the new buffers                    //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::setVertexLayout(const VertexLayout& vertexLayout)
+{
+  m_vertexLayout = vertexLayout;
+
+  unsigned int submeshOutputId;
+  for(submeshOutputId = 0; submeshOutputId < m_vectorSubmeshOutput.size(); submeshOutputId++)
+  {
+    SubmeshOutput& submeshOutput = m_vectorSubmeshOutput[submeshOutputId];
+
+    int bufferId;
+    for(bufferId = 0; bufferId < (m_bDoubleBuffered ? BUFFER_COUNT : 1); bufferId++)
+    {
+      allocateBuffer(submeshOutput, bufferId);
+    }
+
+    // the keyframes get copied from the new buffers by the next keyframe
+    int keyframeId;
+    for(keyframeId = 0; keyframeId < KEYFRAME_COUNT; keyframeId++)
+    {
+      std::vector<float>().swap(submeshOutput.vectorKeyframeVertex[keyframeId]);
+      std::vector<float>().swap(submeshOutput.vectorKeyframeNormal[keyframeId]);
+    }
+  }
+
+  m_dirtyFlags |= DIRTY_SKIN;
+  m_bKeyframeValid = false;
+}
+
+//----------------------------------------------------------------------------//
+// Set if the model gets rendered, invisible models are not skinned or        //
+// simulated until they become visible again, the spring system then carries  //
+// on where it stopped and the time it spent hidden is dropped                //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::setVisible(bool bVisible)
+{
+  // hidden models pose the bones of cal3d again, even while paused
+  if(m_bFlatSkeletonActive && !bVisible) setDirty(DIRTY_POSE);
+
+  m_bVisible = bVisible;
+}
+
+//----------------------------------------------------------------------------//
+// Run the physique and the spring system on the posed skeleton               //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::simulate()
+{
+  // a hidden period as a single step would blow up the verlet integration
+  if(!m_bVisible) m_simulateSeconds = 0.0f;
+
+  if(((m_dirtyFlags & DIRTY_SIMULATE) == 0) || !m_bVisible)
+  {
+    m_skipCount[STAGE_SIMULATE]++;
+    return;
+  }
+
+  m_pModel->getPhysique()->update();
+  m_pModel->getSpringSystem()->update(m_simulateSeconds);
+  m_simulateSeconds = 0.0f;
+
+  m_dirtyFlags &= ~DIRTY_SIMULATE;
+  m_runCount[STAGE_SIMULATE]++;
+}
+
+//----------------------------------------------------------------------------//
+// Skin all submeshes into their output buffers                               //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::skin()
+{
+  if(((m_dirtyFlags & DIRTY_SKIN) == 0) || !m_bVisible)
+  {
+    m_skipCount[STAGE_SKIN]++;
+    return;
+  }
+
+  // CalPhysique only blends linearly, dual quaternions always take a kernel
+  bool bSkinningKernel;
+  bSkinningKernel = ((Skinning::getPath() != Skinning::PATH_PHYSIQUE) || (m_skinningMethod == Skinning::METHOD_DUAL_QUATERNION)) && !m_vectorBoneMatrix.empty();
+
+  int bufferId;
+  bufferId = beginWrite();
+
+  unsigned int submeshOutputId;
+  for(submeshOutputId = 0; submeshOutputId < m_vectorSubmeshOutput.size(); submeshOutputId++)
+  {
+    SubmeshOutput& submeshOutput = m_vectorSubmeshOutput[submeshOutputId];
+    if(submeshOutput.vectorVertex[bufferId].empty()) continue;
+
+    // positions and normals are written in one pass, into one stream if the
+    // layout is interleaved
+    float *pVertexBuffer;
+    pVertexBuffer = &submeshOutput.vectorVertex[bufferId][0];
+    float *pNormalBuffer;
+    pNormalBuffer = (m_vertexLayout.stride == 0) ? &submeshOutput.vectorNormal[bufferId][0] : (float *)((char *)pVertexBuffer + m_vertexLayout.normalOffset);
+
+    submeshOutput.vertexCount[bufferId] = skinSubmesh(submeshOutput, pVertexBuffer, pNormalBuffer, bSkinningKernel);
+  }
+
+  endWrite(bufferId);
+
+  m_dirtyFlags &= ~DIRTY_SKIN;
+  m_runCount[STAGE_SKIN]++;
+}
+
+//----------------------------------------------------------------------------//
+// Skin all submeshes into a new keyframe of the throttled updates, the       //
+// keyframes have the layout of the output buffers                            //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::skinKeyframe()
+{
+  // the keyframes of an invisible model get out of date
+  if(!m_bVisible) m_bKeyframeValid = false;
+
+  if(((m_dirtyFlags & DIRTY_SKIN) == 0) || !m_bVisible)
+  {
+    m_skipCount[STAGE_SKIN]++;
+    return;
+  }
+
+  bool bSkinningKernel;
+  bSkinningKernel = ((Skinning::getPath() != Skinning::PATH_PHYSIQUE) || (m_skinningMethod == Skinning::METHOD_DUAL_QUATERNION)) && !m_vectorBoneMatrix.empty();
+
+  // the new keyframe replaces the older one
+  m_keyframeId = 1 - m_keyframeId;
+
+  unsigned int submeshOutputId;
+  for(submeshOutputId = 0; submeshOutputId < m_vectorSubmeshOutput.size(); submeshOutputId++)
+  {
+    SubmeshOutput& submeshOutput = m_vectorSubmeshOutput[submeshOutputId];
+    if(submeshOutput.vectorVertex[0].empty()) continue;
+
+    // the keyframes start as copies of the first buffer, so an interleaved
+    // keyframe holds the texture coordinates as well
+    int keyframeId;
+    for(keyframeId = 0; keyframeId < KEYFRAME_COUNT; keyframeId++)
+    {
+      if(submeshOutput.vectorKeyframeVertex[keyframeId].size() == submeshOutput.vectorVertex[0].size()) continue;
+
+      submeshOutput.vectorKeyframeVertex[keyframeId] = submeshOutput.vectorVertex[0];
+      submeshOutput.vectorKeyframeNormal[keyframeId] = submeshOutput.vectorNormal[0];
+      submeshOutput.keyframeVertexCount[keyframeId] = 0;
+    }
+
+    float *pVertexBuffer;
+    pVertexBuffer = &submeshOutput.vectorKeyframeVertex[m_keyframeId][0];
+    float *pNormalBuffer;
+    pNormalBuffer = (m_vertexLayout.stride == 0) ? &submeshOutput.vectorKeyframeNormal[m_keyframeId][0] : (float *)((char *)pVertexBuffer + m_vertexLayout.normalOffset);
+
+    submeshOutput.keyframeVertexCount[m_keyframeId] = skinSubmesh(submeshOutput, pVertexBuffer, pNormalBuffer, bSkinningKernel);
+
+    // without a valid older keyframe there is nothing to interpolate from
+    if(!m_bKeyframeValid)
+    {
+      submeshOutput.vectorKeyframeVertex[1 - m_keyframeId] = submeshOutput.vectorKeyframeVertex[m_keyframeId];
+      submeshOutput.vectorKeyframeNormal[1 - m_keyframeId] = submeshOutput.vectorKeyframeNormal[m_keyframeId];
+      submeshOutput.keyframeVertexCount[1 - m_keyframeId] = submeshOutput.keyframeVertexCount[m_keyframeId];
+    }
+  }
+
+  m_bKeyframeValid = true;
+
+  m_dirtyFlags &= ~DIRTY_SKIN;
+  m_runCount[STAGE_SKIN]++;
+}
+
+//----------------------------------------------------------------------------//
+// Skin one submesh into the given buffers, returns the number of vertices    //
+//----------------------------------------------------------------------------//
+
+int ModelPipeline::skinSubmesh(SubmeshOutput& submeshOutput, float *pVertexBuffer, float *pNormalBuffer, bool bSkinningKernel)
+{
+  CalSubmesh *pSubmesh;
+  pSubmesh = submeshOutput.pSubmesh;
+
+  int stride;
+  stride = m_vertexLayout.stride;
+
+  if(bSkinningKernel && (submeshOutput.pSkinStream != 0) && Skinning::isSubmeshSupported(pSubmesh))
+  {
+    return Skinning::calculateVerticesAndNormals(pSubmesh, submeshOutput.pSkinStream, getBoneTransforms(), pVertexBuffer, pNormalBuffer, stride, stride, m_skinningMethod);
+  }
+
+  if(pSubmesh->hasInternalData())
+  {
+    // the spring system already moved these vertices, same as CalRenderer
+    int vertexCount;
+    vertexCount = pSubmesh->getVertexCount();
+
+    if((vertexCount > 0) && (stride == 0))
+    {
+      memcpy(pVertexBuffer, &pSubmesh->getVectorVertex()[0], vertexCount * sizeof(CalVector));
+      memcpy(pNormalBuffer, &pSubmesh->getVectorNormal()[0], vertexCount * sizeof(CalVector));
+    }
+    else if(vertexCount > 0)
+    {
+      std::vector<CalVector>& vectorVertex = pSubmesh->getVectorVertex();
+      std::vector<CalVector>& vectorNormal = pSubmesh->getVectorNormal();
+
+      int vertexId;
+      for(vertexId = 0; vertexId < vertexCount; vertexId++)
+      {
+        memcpy((char *)pVertexBuffer + vertexId * stride, &vectorVertex[vertexId], sizeof(CalVector));
+        memcpy((char *)pNormalBuffer + vertexId * stride, &vectorNormal[vertexId], sizeof(CalVector));
+      }
+    }
+
+    return vertexCount;
+  }
+
+  if((stride != 0) && (m_vertexLayout.normalOffset == 3 * sizeof(float)))
+  {
+    return m_pModel->getPhysique()->calculateVerticesAndNormals(pSubmesh, pVertexBuffer, stride);
+  }
+
+  int vertexCount;
+  vertexCount = m_pModel->getPhysique()->calculateVertices(pSubmesh, pVertexBuffer, stride);
+  m_pModel->getPhysique()->calculateNormals(pSubmesh, pNormalBuffer, stride);
+
+  return vertexCount;
+}
+
+//----------------------------------------------------------------------------//
+// Run all stages, the same work as CalModel::update plus the skinning        //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::update(float elapsedSeconds)
+{
+  if(m_updateInterval > 1)
+  {
+    updateThrottled(elapsedSeconds);
+    return;
+  }
+
+  animate(elapsedSeconds);
+  pose();
+  simulate();
+  skin();
+}
+
+//----------------------------------------------------------------------------//
+// Run all stages every n-th update only, ahead of the displayed time by one  //
+// interval, and interpolate the skinned output towards that keyframe in all  //
+// updates; the updates run on stage by stage are never throttled             //
+//----------------------------------------------------------------------------//
+
+void ModelPipeline::updateThrottled(float elapsedSeconds)
+{
+  // a paused model keeps its output, the stages only run if they are dirty
+  if(m_bPaused)
+  {
+    animate(elapsedSeconds);
+    pose();
+    simulate();
+    skin();
+    return;
+  }
+
+  // a visible model without keyframes starts over at the current time, the
+  // output of an invisible one is not needed
+  if(m_bVisible && !m_bKeyframeValid)
+  {
+    animate(elapsedSeconds);
+    pose();
+    simulate();
+    skinKeyframe();
+
+    m_intervalFrameId = 0;
+    m_leadSeconds = 0.0f;
+    m_intervalSeconds = 0.0f;
+
+    interpolate(1.0f);
+    return;
+  }
+
+  m_leadSeconds -= elapsedSeconds;
+
+  if(m_intervalFrameId == 0)
+  {
+    // the frame time is expected to stay the same over the interval, the
+    // lead left over from the last interval corrects the difference
+    float animateSeconds;
+    animateSeconds = m_updateInterval * elapsedSeconds - m_leadSeconds;
+    if(animateSeconds < 0.0f) animateSeconds = 0.0f;
+
+    animate(animateSeconds);
+    pose();
+    simulate();
+    skinKeyframe();
+
+    // the output is interpolated over the time between the two keyframes
+    m_leadSeconds += animateSeconds;
+    m_intervalSeconds = animateSeconds;
+  }
+  else
+  {
+    m_throttledCount++;
+  }
+
+  m_intervalFrameId = (m_intervalFrameId + 1) % m_updateInterval;
+
+  float factor;
+  factor = (m_intervalSeconds > 0.0f) ? 1.0f - m_leadSeconds / m_intervalSeconds : 1.0f;
+  if(factor < 0.0f) factor = 0.0f;
+  if(factor > 1.0f) factor = 1.0f;
+
+  interpolate(factor);
+}
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,190 @@
+//----------------------------------------------------------------------------//
+// modelpipeline.h                                                            //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef MODELPIPELINE_H
+#define MODELPIPELINE_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+#include "flatskeleton.h"
+#include "skinning.h"
+#include <pthread.h>
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+// the work of CalModel::update split into stages that can be scheduled on
+// their own, a stage only runs if its input changed since its last run,
+// double buffered pipelines can be updated on one thread while another one
+// renders the last finished frame; an update interval above 1 runs the
+// stages only every n-th update and interpolates the skinned output between
+// two skinned keyframes in the updates in between
+class ModelPipeline
+{
+// misc
+public:
+  // the stages in the order they have to run
+  enum Stage
+  {
+    STAGE_ANIMATE = 0,
+    STAGE_POSE,
+    STAGE_SIMULATE,
+    STAGE_SKIN,
+    STAGE_COUNT
+  };
+
+  enum
+  {
+    DIRTY_POSE = 1 << STAGE_POSE,
+    DIRTY_SIMULATE = 1 << STAGE_SIMULATE,
+    DIRTY_SKIN = 1 << STAGE_SKIN,
+    DIRTY_ALL = DIRTY_POSE | DIRTY_SIMULATE | DIRTY_SKIN
+  };
+
+  enum
+  {
+    BUFFER_COUNT = 2,
+    KEYFRAME_COUNT = 2
+  };
+
+  // the layout of the skinned output in bytes, a stride of 0 keeps vertices,
+  // normals and texture coordinates in separate tightly packed arrays, an
+  // offset of -1 leaves the texture coordinates out of an interleaved stream
+  struct VertexLayout
+  {
+    int stride;
+    int normalOffset;
+    int textureCoordinateOffset;
+  };
+
+protected:
+  struct SubmeshOutput
+  {
+    CalSubmesh *pSubmesh;
+    const SkinStream *pSkinStream;
+    int textureCoordinateCount;
+    int vertexCount[BUFFER_COUNT];
+    std::vector<float> vectorVertex[BUFFER_COUNT];
+    std::vector<float> vectorNormal[BUFFER_COUNT];
+    std::vector<float> vectorTextureCoordinate;
+    int keyframeVertexCount[KEYFRAME_COUNT];
+    std::vector<float> vectorKeyframeVertex[KEYFRAME_COUNT];
+    std::vector<float> vectorKeyframeNormal[KEYFRAME_COUNT];
+  };
+
+// member variables
+protected:
+  CalModel *m_pModel;
+  int m_dirtyFlags;
+  bool m_bPaused;
+  bool m_bVisible;
+  float m_simulateSeconds;
+  VertexLayout m_vertexLayout;
+  Skinning::Method m_skinningMethod;
+  std::vector<float> m_vectorBoneMatrix;
+  std::vector<float> m_vectorDualQuaternion;
+  // the flat skeleton only takes over the posing while nothing else reads the
+  // bones of cal3d, the active flag tells if the mixer currently uses it
+  FlatSkeleton m_flatSkeleton;
+  bool m_bFlatSkeleton;
+  bool m_bFlatSkeletonActive;
+  std::vector<SubmeshOutput> m_vectorSubmeshOutput;
+  std::vector<int> m_vectorFirstSubmeshOutputId;
+  int m_runCount[STAGE_COUNT];
+  int m_skipCount[STAGE_COUNT];
+  bool m_bDoubleBuffered;
+  int m_frontBufferId;
+  int m_readBufferId;
+  int m_bufferFrameId[BUFFER_COUNT];
+  int m_frameCount;
+  int m_fenceWaitCount;
+  int m_updateInterval;
+  int m_intervalFrameId;
+  // the animations run ahead of the displayed time by the lead, the
+  // interval is the lead right after the last keyframe
+  float m_leadSeconds;
+  float m_intervalSeconds;
+  int m_keyframeId;
+  bool m_bKeyframeValid;
+  int m_throttledCount;
+  int m_interpolationCount;
+  pthread_mutex_t m_mutex;
+  pthread_cond_t m_condition;
+
+// constructors/destructor
+public:
+  ModelPipeline(CalModel *pModel);
+  virtual ~ModelPipeline();
+
+// member functions
+public:
+  int acquireFrame();
+  void animate(float elapsedSeconds);
+  const float *getBoneMatrices();
+  int getDirtyFlags();
+  int getFenceWaitCount();
+  int getFrameCount();
+  int getInterpolationCount();
+  CalModel *getModel();
+  const float *getNormals(int meshId, int submeshId);
+  int getRunCount(int stage);
+  int getSkipCount(int stage);
+  Skinning::Method getSkinningMethod();
+  const float *getTextureCoordinates(int meshId, int submeshId);
+  int getThrottledCount();
+  int getUpdateInterval();
+  int getVertexCount(int meshId, int submeshId);
+  const VertexLayout& getVertexLayout();
+  const float *getVertices(int meshId, int submeshId);
+  bool isDoubleBuffered();
+  bool isFlatSkeleton();
+  bool isPaused();
+  bool isVisible();
+  void pose();
+  void releaseFrame();
+  void resetCounters();
+  void runStage(int stage, float elapsedSeconds);
+  void setDirty(int dirtyFlags);
+  void setDoubleBuffered(bool bDoubleBuffered);
+  void setFlatSkeleton(bool bFlatSkeleton);
+  void setPaused(bool bPaused);
+  void setSkinningMethod(Skinning::Method method);
+  void setUpdateInterval(int updateInterval);
+  void setVertexLayout(const VertexLayout& vertexLayout);
+  void setVisible(bool bVisible);
+  void simulate();
+  void skin();
+  void update(float elapsedSeconds);
+
+  static VertexLayout getInterleavedLayout();
+  static VertexLayout getSeparateLayout();
+
+protected:
+  void allocateBuffer(SubmeshOutput& submeshOutput, int bufferId);
+  int beginWrite();
+  void endWrite(int bufferId);
+  const float *getBoneTransforms();
+  int getReadBufferId();
+  SubmeshOutput& getSubmeshOutput(int meshId, int submeshId);
+  void interpolate(float factor);
+  bool isFlatSkeletonSupported();
+  void skinKeyframe();
+  int skinSubmesh(SubmeshOutput& submeshOutput, float *pVertexBuffer, float *pNormalBuffer, bool bSkinningKernel);
+  void updateThrottled(float elapsedSeconds);
+
+  static void interpolateArray(const float *pValue, const float *pTargetValue, int count, float factor, float *pOutput);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
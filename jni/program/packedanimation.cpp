@@ -0,0 +1,213 @@
+//----------------------------------------------------------------------------//
+// packedanimation.cpp                                                        //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "packedanimation.h"
+#include "cal3d/coretrack.h"
+#include "cal3d/corekeyframe.h"
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+PackedAnimation::PackedAnimation()
+{
+  m_duration = 0.0f;
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+PackedAnimation::~PackedAnimation()
+{
+}
+
+//----------------------------------------------------------------------------//
+// Pack all keyframes of a core animation                                     //
+//----------------------------------------------------------------------------//
+
+bool PackedAnimation::create(CalCoreAnimation *pCoreAnimation)
+{
+  m_duration = pCoreAnimation->getDuration();
+
+  std::list<CalCoreTrack *>& listCoreTrack = pCoreAnimation->getListCoreTrack();
+
+  // size the streams once, so packing does a handful of allocations instead
+  // of one per keyframe
+  int keyframeCount;
+  keyframeCount = 0;
+
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+  {
+    keyframeCount += (*iteratorCoreTrack)->getCoreKeyframeCount();
+  }
+
+  m_vectorTrack.clear();
+  m_vectorTrack.reserve(listCoreTrack.size());
+  m_vectorTime.clear();
+  m_vectorTime.reserve(keyframeCount);
+  m_vectorTranslation.clear();
+  m_vectorTranslation.reserve(keyframeCount);
+  m_vectorRotation.clear();
+  m_vectorRotation.reserve(keyframeCount);
+
+  // keep the core track list order, the mixer blends in that order
+  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+  {
+    CalCoreTrack *pCoreTrack;
+    pCoreTrack = *iteratorCoreTrack;
+
+    Track track;
+    track.coreBoneId = pCoreTrack->getCoreBoneId();
+    track.keyframeId = (int)m_vectorTime.size();
+    track.keyframeCount = pCoreTrack->getCoreKeyframeCount();
+    m_vectorTrack.push_back(track);
+
+    int keyframeId;
+    for(keyframeId = 0; keyframeId < track.keyframeCount; keyframeId++)
+    {
+      CalCoreKeyframe *pCoreKeyframe;
+      pCoreKeyframe = pCoreTrack->getCoreKeyframe(keyframeId);
+
+      m_vectorTime.push_back(pCoreKeyframe->getTime());
+      m_vectorTranslation.push_back(pCoreKeyframe->getTranslation());
+      m_vectorRotation.push_back(pCoreKeyframe->getRotation());
+    }
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Get the core bone id of a track                                            //
+//----------------------------------------------------------------------------//
+
+int PackedAnimation::getCoreBoneId(int trackId) const
+{
+  return m_vectorTrack[trackId].coreBoneId;
+}
+
+//----------------------------------------------------------------------------//
+// Get the duration of the animation                                          //
+//----------------------------------------------------------------------------//
+
+float PackedAnimation::getDuration() const
+{
+  return m_duration;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of keyframes of all tracks                                  //
+//----------------------------------------------------------------------------//
+
+int PackedAnimation::getKeyframeCount() const
+{
+  return (int)m_vectorTime.size();
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of keyframes of a track                                     //
+//----------------------------------------------------------------------------//
+
+int PackedAnimation::getKeyframeCount(int trackId) const
+{
+  return m_vectorTrack[trackId].keyframeCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bytes used by the packed animation                       //
+//----------------------------------------------------------------------------//
+
+int PackedAnimation::getMemorySize() const
+{
+  return sizeof(PackedAnimation)
+    + m_vectorTrack.capacity() * sizeof(Track)
+    + m_vectorTime.capacity() * sizeof(float)
+    + m_vectorTranslation.capacity() * sizeof(CalVector)
+    + m_vectorRotation.capacity() * sizeof(CalQuaternion);
+}
+
+//----------------------------------------------------------------------------//
+// Get the keyframe rotations of a track                                      //
+//----------------------------------------------------------------------------//
+
+const CalQuaternion *PackedAnimation::getRotations(int trackId) const
+{
+  if(m_vectorRotation.empty()) return 0;
+
+  return &m_vectorRotation[0] + m_vectorTrack[trackId].keyframeId;
+}
+
+//----------------------------------------------------------------------------//
+// Get the keyframe times of a track                                          //
+//----------------------------------------------------------------------------//
+
+const float *PackedAnimation::getTimes(int trackId) const
+{
+  if(m_vectorTime.empty()) return 0;
+
+  return &m_vectorTime[0] + m_vectorTrack[trackId].keyframeId;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of tracks                                                   //
+//----------------------------------------------------------------------------//
+
+int PackedAnimation::getTrackCount() const
+{
+  return (int)m_vectorTrack.size();
+}
+
+//----------------------------------------------------------------------------//
+// Get the keyframe translations of a track                                   //
+//----------------------------------------------------------------------------//
+
+const CalVector *PackedAnimation::getTranslations(int trackId) const
+{
+  if(m_vectorTranslation.empty()) return 0;
+
+  return &m_vectorTranslation[0] + m_vectorTrack[trackId].keyframeId;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bytes the keyframes of a core animation use              //
+//----------------------------------------------------------------------------//
+
+int PackedAnimation::getCoreAnimationMemorySize(CalCoreAnimation *pCoreAnimation)
+{
+  // every track, track list node and keyframe is a separate heap block;
+  // count the usual 8 bytes of allocator bookkeeping for each of them
+  const int allocationOverhead = 8;
+
+  std::list<CalCoreTrack *>& listCoreTrack = pCoreAnimation->getListCoreTrack();
+
+  int size;
+  size = 0;
+
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+  {
+    int keyframeCount;
+    keyframeCount = (*iteratorCoreTrack)->getCoreKeyframeCount();
+
+    size += 3 * sizeof(void *) + allocationOverhead;
+    size += sizeof(CalCoreTrack) + allocationOverhead;
+    if(keyframeCount > 0) size += keyframeCount * sizeof(CalCoreKeyframe *) + allocationOverhead;
+    size += keyframeCount * (sizeof(CalCoreKeyframe) + allocationOverhead);
+  }
+
+  return size;
+}
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,67 @@
+//----------------------------------------------------------------------------//
+// packedanimation.h                                                          //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef PACKEDANIMATION_H
+#define PACKEDANIMATION_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+class PackedAnimation
+{
+// misc
+public:
+  // the keyframes of a track are a range of the shared time, translation and
+  // rotation streams
+  struct Track
+  {
+    int coreBoneId;
+    int keyframeId;
+    int keyframeCount;
+  };
+
+// member variables
+protected:
+  float m_duration;
+  std::vector<Track> m_vectorTrack;
+  std::vector<float> m_vectorTime;
+  std::vector<CalVector> m_vectorTranslation;
+  std::vector<CalQuaternion> m_vectorRotation;
+
+// constructors/destructor
+public:
+  PackedAnimation();
+  virtual ~PackedAnimation();
+
+// member functions
+public:
+  bool create(CalCoreAnimation *pCoreAnimation);
+  int getCoreBoneId(int trackId) const;
+  float getDuration() const;
+  int getKeyframeCount() const;
+  int getKeyframeCount(int trackId) const;
+  int getMemorySize() const;
+  const CalQuaternion *getRotations(int trackId) const;
+  const float *getTimes(int trackId) const;
+  int getTrackCount() const;
+  const CalVector *getTranslations(int trackId) const;
+
+  static int getCoreAnimationMemorySize(CalCoreAnimation *pCoreAnimation);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,511 @@
+//----------------------------------------------------------------------------//
+// poseblender.cpp                                                            //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "poseblender.h"
+#include <math.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+//----------------------------------------------------------------------------//
+// Static member variables initialization                                     //
+//----------------------------------------------------------------------------//
+
+const int PoseBlender::BLOCK_SIZE = 4;
+
+// polynomials in the dot product, fitted by Arseny Kapoulkine
+const float PoseBlender::CORRECTION_A[4] = { 1.0904f, -3.2452f, 3.55645f, -1.43519f };
+const float PoseBlender::CORRECTION_B[3] = { 0.848013f, -1.06021f, 0.215638f };
+
+// u[i] = 1 / (i * (2i + 1)) and v[i] = i / (2i + 1), the last term is scaled
+// by the minimax factor of Eberly for eight terms
+const int PoseBlender::MINIMAX_DEGREE = 8;
+const float PoseBlender::MINIMAX_U[8] = { 1.0f / 3.0f, 1.0f / 10.0f, 1.0f / 21.0f, 1.0f / 36.0f, 1.0f / 55.0f, 1.0f / 78.0f, 1.0f / 105.0f, 1.85298109f / 136.0f };
+const float PoseBlender::MINIMAX_V[8] = { 1.0f / 3.0f, 2.0f / 5.0f, 3.0f / 7.0f, 4.0f / 9.0f, 5.0f / 11.0f, 6.0f / 13.0f, 7.0f / 15.0f, 1.85298109f * 8.0f / 17.0f };
+
+//----------------------------------------------------------------------------//
+// Blend a pose into another one, same weighting as CalBone::blendState: the  //
+// first state of a bone is copied, later ones are interpolated by their      //
+// share of the accumulated weight                                            //
+//----------------------------------------------------------------------------//
+
+void PoseBlender::blend(float *pPose, const float *pSourcePose, int blockCount, Mode mode)
+{
+  Kernel kernel;
+  kernel = getKernel(Skinning::getPath(), mode);
+  kernel(pPose, pSourcePose, blockCount, mode);
+}
+
+//----------------------------------------------------------------------------//
+// Blend a rotation towards another one, the same as CalQuaternion::blend     //
+// with the interpolation of a mode                                           //
+//----------------------------------------------------------------------------//
+
+void PoseBlender::blendRotation(CalQuaternion& rotation, float factor, const CalQuaternion& sourceRotation, Mode mode)
+{
+  if(mode == MODE_SLERP)
+  {
+    rotation.blend(factor, sourceRotation);
+    return;
+  }
+
+  // interpolate towards the closer of q and -q
+  float dot;
+  dot = rotation.x * sourceRotation.x + rotation.y * sourceRotation.y + rotation.z * sourceRotation.z + rotation.w * sourceRotation.w;
+
+  float absDot;
+  absDot = (dot < 0.0f) ? -dot : dot;
+
+  float inverseFactor, sourceFactor;
+  switch(mode)
+  {
+    case MODE_CORRECTED_NLERP:
+      sourceFactor = getCorrectedFactor(factor, absDot);
+      inverseFactor = 1.0f - sourceFactor;
+      break;
+    case MODE_MINIMAX_SLERP:
+      inverseFactor = getMinimaxFactor(1.0f - factor, absDot - 1.0f);
+      sourceFactor = getMinimaxFactor(factor, absDot - 1.0f);
+      break;
+    default:
+      inverseFactor = 1.0f - factor;
+      sourceFactor = factor;
+      break;
+  }
+
+  if(dot < 0.0f) sourceFactor = -sourceFactor;
+
+  float x, y, z, w;
+  x = inverseFactor * rotation.x + sourceFactor * sourceRotation.x;
+  y = inverseFactor * rotation.y + sourceFactor * sourceRotation.y;
+  z = inverseFactor * rotation.z + sourceFactor * sourceRotation.z;
+  w = inverseFactor * rotation.w + sourceFactor * sourceRotation.w;
+
+  // the minimax slerp stays on the unit sphere within its error
+  if(mode == MODE_MINIMAX_SLERP)
+  {
+    rotation.set(x, y, z, w);
+    return;
+  }
+
+  float length;
+  length = x * x + y * y + z * z + w * w;
+
+  float invLength;
+  invLength = 1.0f / (float)sqrt(length > 1e-30f ? length : 1e-30f);
+
+  rotation.set(x * invLength, y * invLength, z * invLength, w * invLength);
+}
+
+//----------------------------------------------------------------------------//
+// Scalar kernel, the reference of the simd kernels; the slerp mode is the    //
+// same blending as CalBone::blendState                                       //
+//----------------------------------------------------------------------------//
+
+void PoseBlender::blendScalar(float *pPose, const float *pSourcePose, int blockCount, Mode mode)
+{
+  int boneCount;
+  boneCount = blockCount * BLOCK_SIZE;
+
+  int boneId;
+  for(boneId = 0; boneId < boneCount; boneId++)
+  {
+    CalVector sourceTranslation;
+    CalQuaternion sourceRotation;
+    float sourceWeight;
+    getState(pSourcePose, boneId, sourceTranslation, sourceRotation, sourceWeight);
+    if(sourceWeight <= 0.0f) continue;
+
+    CalVector translation;
+    CalQuaternion rotation;
+    float weight;
+    getState(pPose, boneId, translation, rotation, weight);
+
+    if(weight == 0.0f)
+    {
+      setState(pPose, boneId, sourceTranslation, sourceRotation, sourceWeight);
+      continue;
+    }
+
+    float factor;
+    factor = sourceWeight / (weight + sourceWeight);
+
+    translation.blend(factor, sourceTranslation);
+    blendRotation(rotation, factor, sourceRotation, mode);
+
+    setState(pPose, boneId, translation, rotation, weight + sourceWeight);
+  }
+}
+
+//----------------------------------------------------------------------------//
+// SSE kernel of the approximated modes, one block of four bones per          //
+// iteration                                                                  //
+//----------------------------------------------------------------------------//
+
+#if defined(__SSE__)
+
+static inline __m128 selectSse(__m128 mask, __m128 a, __m128 b)
+{
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// same operations in the same order as PoseBlender::getCorrectedFactor
+static inline __m128 getCorrectedFactorSse(__m128 factor, __m128 dot)
+{
+  __m128 a = _mm_add_ps(_mm_set1_ps(PoseBlender::CORRECTION_A[2]), _mm_mul_ps(dot, _mm_set1_ps(PoseBlender::CORRECTION_A[3])));
+  a = _mm_add_ps(_mm_set1_ps(PoseBlender::CORRECTION_A[1]), _mm_mul_ps(dot, a));
+  a = _mm_add_ps(_mm_set1_ps(PoseBlender::CORRECTION_A[0]), _mm_mul_ps(dot, a));
+
+  __m128 b = _mm_add_ps(_mm_set1_ps(PoseBlender::CORRECTION_B[1]), _mm_mul_ps(dot, _mm_set1_ps(PoseBlender::CORRECTION_B[2])));
+  b = _mm_add_ps(_mm_set1_ps(PoseBlender::CORRECTION_B[0]), _mm_mul_ps(dot, b));
+
+  __m128 centered = _mm_sub_ps(factor, _mm_set1_ps(0.5f));
+  __m128 k = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(a, centered), centered), b);
+
+  return _mm_add_ps(factor, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(factor, centered), _mm_sub_ps(factor, _mm_set1_ps(1.0f))), k));
+}
+
+// same operations in the same order as PoseBlender::getMinimaxFactor
+static inline __m128 getMinimaxFactorSse(__m128 factor, __m128 dotMinusOne)
+{
+  __m128 squaredFactor = _mm_mul_ps(factor, factor);
+  __m128 result = _mm_set1_ps(1.0f);
+
+  int i;
+  for(i = PoseBlender::MINIMAX_DEGREE - 1; i >= 0; i--)
+  {
+    __m128 term = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(PoseBlender::MINIMAX_U[i]), squaredFactor), _mm_set1_ps(PoseBlender::MINIMAX_V[i]));
+    result = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_mul_ps(term, dotMinusOne), result));
+  }
+
+  return _mm_mul_ps(factor, result);
+}
+
+#endif
+
+void PoseBlender::blendSse(float *pPose, const float *pSourcePose, int blockCount, Mode mode)
+{
+#if defined(__SSE__)
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 signMask = _mm_set1_ps(-0.0f);
+
+  int blockId;
+  for(blockId = 0; blockId < blockCount; blockId++)
+  {
+    float *pBlock = &pPose[blockId * BLOCK_SIZE * ROW_COUNT];
+    const float *pSourceBlock = &pSourcePose[blockId * BLOCK_SIZE * ROW_COUNT];
+
+    __m128 sourceWeight = _mm_loadu_ps(&pSourceBlock[ROW_WEIGHT * BLOCK_SIZE]);
+    __m128 weight = _mm_loadu_ps(&pBlock[ROW_WEIGHT * BLOCK_SIZE]);
+
+    // lanes without a source state keep their state, lanes without a state
+    // take the source state, the others are interpolated; the discarded
+    // lanes may hold anything, including the nan of 0 / 0
+    __m128 active = _mm_cmpgt_ps(sourceWeight, zero);
+    if(_mm_movemask_ps(active) == 0) continue;
+
+    __m128 first = _mm_cmpeq_ps(weight, zero);
+    __m128 totalWeight = _mm_add_ps(weight, sourceWeight);
+    __m128 factor = _mm_div_ps(sourceWeight, totalWeight);
+
+    __m128 value[ROW_COUNT];
+    __m128 sourceValue[ROW_COUNT];
+
+    int row;
+    for(row = 0; row < ROW_WEIGHT; row++)
+    {
+      value[row] = _mm_loadu_ps(&pBlock[row * BLOCK_SIZE]);
+      sourceValue[row] = _mm_loadu_ps(&pSourceBlock[row * BLOCK_SIZE]);
+    }
+
+    __m128 blended[ROW_COUNT];
+
+    for(row = ROW_TRANSLATION_X; row <= ROW_TRANSLATION_Z; row++)
+    {
+      blended[row] = _mm_add_ps(value[row], _mm_mul_ps(factor, _mm_sub_ps(sourceValue[row], value[row])));
+    }
+
+    // interpolate towards the closer of q and -q
+    __m128 dot = _mm_mul_ps(value[ROW_ROTATION_X], sourceValue[ROW_ROTATION_X]);
+    dot = _mm_add_ps(dot, _mm_mul_ps(value[ROW_ROTATION_Y], sourceValue[ROW_ROTATION_Y]));
+    dot = _mm_add_ps(dot, _mm_mul_ps(value[ROW_ROTATION_Z], sourceValue[ROW_ROTATION_Z]));
+    dot = _mm_add_ps(dot, _mm_mul_ps(value[ROW_ROTATION_W], sourceValue[ROW_ROTATION_W]));
+
+    __m128 absDot = _mm_andnot_ps(signMask, dot);
+
+    __m128 inverseFactor, sourceFactor;
+    switch(mode)
+    {
+      case MODE_CORRECTED_NLERP:
+        sourceFactor = getCorrectedFactorSse(factor, absDot);
+        inverseFactor = _mm_sub_ps(one, sourceFactor);
+        break;
+      case MODE_MINIMAX_SLERP:
+        inverseFactor = getMinimaxFactorSse(_mm_sub_ps(one, factor), _mm_sub_ps(absDot, one));
+        sourceFactor = getMinimaxFactorSse(factor, _mm_sub_ps(absDot, one));
+        break;
+      default:
+        inverseFactor = _mm_sub_ps(one, factor);
+        sourceFactor = factor;
+        break;
+    }
+
+    sourceFactor = _mm_xor_ps(sourceFactor, _mm_and_ps(_mm_cmplt_ps(dot, zero), signMask));
+
+    __m128 length = zero;
+    for(row = ROW_ROTATION_X; row <= ROW_ROTATION_W; row++)
+    {
+      blended[row] = _mm_add_ps(_mm_mul_ps(inverseFactor, value[row]), _mm_mul_ps(sourceFactor, sourceValue[row]));
+      length = _mm_add_ps(length, _mm_mul_ps(blended[row], blended[row]));
+    }
+
+    // the minimax slerp stays on the unit sphere within its error
+    if(mode != MODE_MINIMAX_SLERP)
+    {
+      __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(length, _mm_set1_ps(1e-30f))));
+
+      for(row = ROW_ROTATION_X; row <= ROW_ROTATION_W; row++)
+      {
+        blended[row] = _mm_mul_ps(blended[row], invLength);
+      }
+    }
+
+    blended[ROW_WEIGHT] = totalWeight;
+    value[ROW_WEIGHT] = weight;
+    sourceValue[ROW_WEIGHT] = sourceWeight;
+
+    for(row = 0; row < ROW_COUNT; row++)
+    {
+      __m128 result = selectSse(first, sourceValue[row], blended[row]);
+      _mm_storeu_ps(&pBlock[row * BLOCK_SIZE], selectSse(active, result, value[row]));
+    }
+  }
+#endif
+}
+
+//----------------------------------------------------------------------------//
+// Clear the weights of a pose, the bones are not part of it afterwards       //
+//----------------------------------------------------------------------------//
+
+void PoseBlender::clear(float *pPose, int blockCount)
+{
+  int blockId;
+  for(blockId = 0; blockId < blockCount; blockId++)
+  {
+    float *pWeight = &pPose[(blockId * ROW_COUNT + ROW_WEIGHT) * BLOCK_SIZE];
+    pWeight[0] = 0.0f;
+    pWeight[1] = 0.0f;
+    pWeight[2] = 0.0f;
+    pWeight[3] = 0.0f;
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of blocks of a pose                                         //
+//----------------------------------------------------------------------------//
+
+int PoseBlender::getBlockCount(int boneCount)
+{
+  return (boneCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+//----------------------------------------------------------------------------//
+// Get the factor of the corrected nlerp, the polynomial bends the factor so  //
+// that the normalized interpolation follows the constant speed of slerp      //
+//----------------------------------------------------------------------------//
+
+float PoseBlender::getCorrectedFactor(float factor, float dot)
+{
+  float a;
+  a = CORRECTION_A[0] + dot * (CORRECTION_A[1] + dot * (CORRECTION_A[2] + dot * CORRECTION_A[3]));
+  float b;
+  b = CORRECTION_B[0] + dot * (CORRECTION_B[1] + dot * CORRECTION_B[2]);
+
+  float centered;
+  centered = factor - 0.5f;
+  float k;
+  k = a * centered * centered + b;
+
+  return factor + factor * centered * (factor - 1.0f) * k;
+}
+
+//----------------------------------------------------------------------------//
+// Get the kernel function of a path and a mode                               //
+//----------------------------------------------------------------------------//
+
+PoseBlender::Kernel PoseBlender::getKernel(Skinning::Path path, Mode mode)
+{
+  // the acos and sin of slerp stay scalar
+  if(mode == MODE_SLERP) return blendScalar;
+
+#ifdef HAVE_NEON
+  if(path == Skinning::PATH_NEON) return blendPoseNeon;
+#endif
+#if defined(__SSE__)
+  if(path == Skinning::PATH_SSE) return blendSse;
+#endif
+
+  return blendScalar;
+}
+
+//----------------------------------------------------------------------------//
+// Get the largest rotation error of a mode against slerp, in radians of the  //
+// rotation, for factors in [0, 1] and any two unit quaternions; measured     //
+// over a dense sweep of angles and factors, Bench::runRotationBlending       //
+// checks it                                                                  //
+//----------------------------------------------------------------------------//
+
+float PoseBlender::getMaxError(Mode mode)
+{
+  switch(mode)
+  {
+    case MODE_NLERP:
+      return 0.143f;
+    case MODE_CORRECTED_NLERP:
+      return 8e-4f;
+    case MODE_MINIMAX_SLERP:
+      return 6e-5f;
+    default:
+      return 0.0f;
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Get the factor of one quaternion of the minimax slerp, sin(f * angle) /    //
+// sin(angle) as a polynomial in the factor and the dot product               //
+//----------------------------------------------------------------------------//
+
+float PoseBlender::getMinimaxFactor(float factor, float dotMinusOne)
+{
+  float squaredFactor;
+  squaredFactor = factor * factor;
+
+  float result;
+  result = 1.0f;
+
+  int i;
+  for(i = MINIMAX_DEGREE - 1; i >= 0; i--)
+  {
+    result = 1.0f + (MINIMAX_U[i] * squaredFactor - MINIMAX_V[i]) * dotMinusOne * result;
+  }
+
+  return factor * result;
+}
+
+//----------------------------------------------------------------------------//
+// Get a printable name of a mode                                             //
+//----------------------------------------------------------------------------//
+
+const char *PoseBlender::getModeName(Mode mode)
+{
+  switch(mode)
+  {
+    case MODE_NLERP:
+      return "nlerp";
+    case MODE_SLERP:
+      return "slerp";
+    case MODE_CORRECTED_NLERP:
+      return "corrected nlerp";
+    case MODE_MINIMAX_SLERP:
+      return "minimax slerp";
+    default:
+      return "unknown";
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of floats of a pose                                         //
+//----------------------------------------------------------------------------//
+
+int PoseBlender::getPoseSize(int boneCount)
+{
+  return getBlockCount(boneCount) * BLOCK_SIZE * ROW_COUNT;
+}
+
+//----------------------------------------------------------------------------//
+// Get the state of a bone of a pose                                          //
+//----------------------------------------------------------------------------//
+
+void PoseBlender::getState(const float *pPose, int boneId, CalVector& translation, CalQuaternion& rotation, float& weight)
+{
+  const float *pLane = &pPose[(boneId / BLOCK_SIZE) * BLOCK_SIZE * ROW_COUNT + boneId % BLOCK_SIZE];
+
+  translation.set(pLane[ROW_TRANSLATION_X * BLOCK_SIZE], pLane[ROW_TRANSLATION_Y * BLOCK_SIZE], pLane[ROW_TRANSLATION_Z * BLOCK_SIZE]);
+  rotation.set(pLane[ROW_ROTATION_X * BLOCK_SIZE], pLane[ROW_ROTATION_Y * BLOCK_SIZE], pLane[ROW_ROTATION_Z * BLOCK_SIZE], pLane[ROW_ROTATION_W * BLOCK_SIZE]);
+  weight = pLane[ROW_WEIGHT * BLOCK_SIZE];
+}
+
+//----------------------------------------------------------------------------//
+// Blend a layer into a pose, same as CalBone::lockState: the weight of the   //
+// layer is clamped to what the pose leaves, and the layer is cleared         //
+//----------------------------------------------------------------------------//
+
+void PoseBlender::lock(float *pPose, float *pLayerPose, int blockCount, Mode mode)
+{
+  int blockId;
+  for(blockId = 0; blockId < blockCount; blockId++)
+  {
+    const float *pWeight = &pPose[(blockId * ROW_COUNT + ROW_WEIGHT) * BLOCK_SIZE];
+    float *pLayerWeight = &pLayerPose[(blockId * ROW_COUNT + ROW_WEIGHT) * BLOCK_SIZE];
+
+    int lane;
+    for(lane = 0; lane < BLOCK_SIZE; lane++)
+    {
+      if(pLayerWeight[lane] > 1.0f - pWeight[lane]) pLayerWeight[lane] = 1.0f - pWeight[lane];
+    }
+  }
+
+  blend(pPose, pLayerPose, blockCount, mode);
+  clear(pLayerPose, blockCount);
+}
+
+//----------------------------------------------------------------------------//
+// Set the state of a bone of a pose                                          //
+//----------------------------------------------------------------------------//
+
+void PoseBlender::setState(float *pPose, int boneId, const CalVector& translation, const CalQuaternion& rotation, float weight)
+{
+  float *pLane = &pPose[(boneId / BLOCK_SIZE) * BLOCK_SIZE * ROW_COUNT + boneId % BLOCK_SIZE];
+
+  pLane[ROW_TRANSLATION_X * BLOCK_SIZE] = translation.x;
+  pLane[ROW_TRANSLATION_Y * BLOCK_SIZE] = translation.y;
+  pLane[ROW_TRANSLATION_Z * BLOCK_SIZE] = translation.z;
+  pLane[ROW_ROTATION_X * BLOCK_SIZE] = rotation.x;
+  pLane[ROW_ROTATION_Y * BLOCK_SIZE] = rotation.y;
+  pLane[ROW_ROTATION_Z * BLOCK_SIZE] = rotation.z;
+  pLane[ROW_ROTATION_W * BLOCK_SIZE] = rotation.w;
+  pLane[ROW_WEIGHT * BLOCK_SIZE] = weight;
+}
+
+//----------------------------------------------------------------------------//
+// Set the weight of all bones that are part of a pose                        //
+//----------------------------------------------------------------------------//
+
+void PoseBlender::setWeight(float *pPose, int blockCount, float weight)
+{
+  int blockId;
+  for(blockId = 0; blockId < blockCount; blockId++)
+  {
+    float *pWeight = &pPose[(blockId * ROW_COUNT + ROW_WEIGHT) * BLOCK_SIZE];
+
+    int lane;
+    for(lane = 0; lane < BLOCK_SIZE; lane++)
+    {
+      if(pWeight[lane] != 0.0f) pWeight[lane] = weight;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------//
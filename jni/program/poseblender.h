@@ -0,0 +1,103 @@
+//----------------------------------------------------------------------------//
+// poseblender.h                                                              //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef POSEBLENDER_H
+#define POSEBLENDER_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+#include "skinning.h"
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+// blends whole poses with the weighting of CalBone::blendState, a pose holds
+// the relative states of all bones of a skeleton in blocks of four bones and
+// every row of a block holds one component of the four bones, so the kernels
+// blend four bones per iteration; the kernel follows the path of Skinning
+class PoseBlender
+{
+// misc
+public:
+  // how the rotations are interpolated, slerp is CalQuaternion::blend and
+  // matches cal3d exactly, nlerp normalizes the linear interpolation, the
+  // corrected nlerp bends the factor of nlerp towards the constant speed of
+  // slerp, and the minimax slerp replaces the acos and sin of slerp by a
+  // polynomial (Eberly, "A Fast and Accurate Algorithm for Computing SLERP");
+  // getMaxError gives the accuracy of each mode
+  enum Mode
+  {
+    MODE_NLERP = 0,
+    MODE_SLERP,
+    MODE_CORRECTED_NLERP,
+    MODE_MINIMAX_SLERP,
+    MODE_COUNT
+  };
+
+  // the rows of a block, a bone with a zero weight is not part of the pose
+  enum Row
+  {
+    ROW_TRANSLATION_X = 0,
+    ROW_TRANSLATION_Y,
+    ROW_TRANSLATION_Z,
+    ROW_ROTATION_X,
+    ROW_ROTATION_Y,
+    ROW_ROTATION_Z,
+    ROW_ROTATION_W,
+    ROW_WEIGHT,
+    ROW_COUNT
+  };
+
+  // the number of bones of a block
+  static const int BLOCK_SIZE;
+
+  // the coefficients of the corrected nlerp and of the minimax slerp, shared
+  // by all kernels
+  static const float CORRECTION_A[4];
+  static const float CORRECTION_B[3];
+  static const int MINIMAX_DEGREE;
+  static const float MINIMAX_U[8];
+  static const float MINIMAX_V[8];
+
+  typedef void (*Kernel)(float *pPose, const float *pSourcePose, int blockCount, Mode mode);
+
+// member functions
+public:
+  static void blend(float *pPose, const float *pSourcePose, int blockCount, Mode mode);
+  static void blendRotation(CalQuaternion& rotation, float factor, const CalQuaternion& sourceRotation, Mode mode);
+  static void clear(float *pPose, int blockCount);
+  static int getBlockCount(int boneCount);
+  static float getMaxError(Mode mode);
+  static const char *getModeName(Mode mode);
+  static int getPoseSize(int boneCount);
+  static void getState(const float *pPose, int boneId, CalVector& translation, CalQuaternion& rotation, float& weight);
+  static void lock(float *pPose, float *pLayerPose, int blockCount, Mode mode);
+  static void setState(float *pPose, int boneId, const CalVector& translation, const CalQuaternion& rotation, float weight);
+  static void setWeight(float *pPose, int blockCount, float weight);
+
+protected:
+  static void blendScalar(float *pPose, const float *pSourcePose, int blockCount, Mode mode);
+  static void blendSse(float *pPose, const float *pSourcePose, int blockCount, Mode mode);
+  static float getCorrectedFactor(float factor, float dot);
+  static Kernel getKernel(Skinning::Path path, Mode mode);
+  static float getMinimaxFactor(float factor, float dotMinusOne);
+};
+
+#ifdef HAVE_NEON
+// implemented in poseblender_neon.cpp, which is built with -mfpu=neon
+void blendPoseNeon(float *pPose, const float *pSourcePose, int blockCount, PoseBlender::Mode mode);
+#endif
+
+#endif
+
+//----------------------------------------------------------------------------//
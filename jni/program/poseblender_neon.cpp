@@ -0,0 +1,168 @@
+//----------------------------------------------------------------------------//
+// poseblender_neon.cpp                                                       //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "poseblender.h"
+
+#ifdef HAVE_NEON
+
+#include <arm_neon.h>
+
+// see PoseBlender::getCorrectedFactor
+static inline float32x4_t getCorrectedFactorNeon(float32x4_t factor, float32x4_t dot)
+{
+  float32x4_t a = vmlaq_f32(vdupq_n_f32(PoseBlender::CORRECTION_A[2]), dot, vdupq_n_f32(PoseBlender::CORRECTION_A[3]));
+  a = vmlaq_f32(vdupq_n_f32(PoseBlender::CORRECTION_A[1]), dot, a);
+  a = vmlaq_f32(vdupq_n_f32(PoseBlender::CORRECTION_A[0]), dot, a);
+
+  float32x4_t b = vmlaq_f32(vdupq_n_f32(PoseBlender::CORRECTION_B[1]), dot, vdupq_n_f32(PoseBlender::CORRECTION_B[2]));
+  b = vmlaq_f32(vdupq_n_f32(PoseBlender::CORRECTION_B[0]), dot, b);
+
+  float32x4_t centered = vsubq_f32(factor, vdupq_n_f32(0.5f));
+  float32x4_t k = vmlaq_f32(b, vmulq_f32(a, centered), centered);
+
+  return vmlaq_f32(factor, vmulq_f32(vmulq_f32(factor, centered), vsubq_f32(factor, vdupq_n_f32(1.0f))), k);
+}
+
+// see PoseBlender::getMinimaxFactor
+static inline float32x4_t getMinimaxFactorNeon(float32x4_t factor, float32x4_t dotMinusOne)
+{
+  float32x4_t squaredFactor = vmulq_f32(factor, factor);
+  float32x4_t result = vdupq_n_f32(1.0f);
+
+  int i;
+  for(i = PoseBlender::MINIMAX_DEGREE - 1; i >= 0; i--)
+  {
+    float32x4_t term = vsubq_f32(vmulq_f32(vdupq_n_f32(PoseBlender::MINIMAX_U[i]), squaredFactor), vdupq_n_f32(PoseBlender::MINIMAX_V[i]));
+    result = vmlaq_f32(vdupq_n_f32(1.0f), vmulq_f32(term, dotMinusOne), result);
+  }
+
+  return vmulq_f32(factor, result);
+}
+
+//----------------------------------------------------------------------------//
+// NEON kernel of the approximated modes, one block of four bones per         //
+// iteration, see PoseBlender::blendSse                                       //
+//----------------------------------------------------------------------------//
+
+void blendPoseNeon(float *pPose, const float *pSourcePose, int blockCount, PoseBlender::Mode mode)
+{
+  const int blockSize = PoseBlender::BLOCK_SIZE;
+  const int rowCount = PoseBlender::ROW_COUNT;
+
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  const uint32x4_t signMask = vdupq_n_u32(0x80000000);
+
+  int blockId;
+  for(blockId = 0; blockId < blockCount; blockId++)
+  {
+    float *pBlock = &pPose[blockId * blockSize * rowCount];
+    const float *pSourceBlock = &pSourcePose[blockId * blockSize * rowCount];
+
+    float32x4_t sourceWeight = vld1q_f32(&pSourceBlock[PoseBlender::ROW_WEIGHT * blockSize]);
+    float32x4_t weight = vld1q_f32(&pBlock[PoseBlender::ROW_WEIGHT * blockSize]);
+
+    uint32x4_t active = vcgtq_f32(sourceWeight, zero);
+    uint32x2_t activeHalf = vorr_u32(vget_low_u32(active), vget_high_u32(active));
+    if((vget_lane_u32(activeHalf, 0) | vget_lane_u32(activeHalf, 1)) == 0) continue;
+
+    uint32x4_t first = vceqq_f32(weight, zero);
+    float32x4_t totalWeight = vaddq_f32(weight, sourceWeight);
+
+    // no division on NEON, two newton-raphson steps bring the reciprocal
+    // estimate to full float precision
+    float32x4_t invTotalWeight = vrecpeq_f32(totalWeight);
+    invTotalWeight = vmulq_f32(invTotalWeight, vrecpsq_f32(totalWeight, invTotalWeight));
+    invTotalWeight = vmulq_f32(invTotalWeight, vrecpsq_f32(totalWeight, invTotalWeight));
+    float32x4_t factor = vmulq_f32(sourceWeight, invTotalWeight);
+
+    float32x4_t value[PoseBlender::ROW_COUNT];
+    float32x4_t sourceValue[PoseBlender::ROW_COUNT];
+
+    int row;
+    for(row = 0; row < PoseBlender::ROW_WEIGHT; row++)
+    {
+      value[row] = vld1q_f32(&pBlock[row * blockSize]);
+      sourceValue[row] = vld1q_f32(&pSourceBlock[row * blockSize]);
+    }
+
+    float32x4_t blended[PoseBlender::ROW_COUNT];
+
+    for(row = PoseBlender::ROW_TRANSLATION_X; row <= PoseBlender::ROW_TRANSLATION_Z; row++)
+    {
+      blended[row] = vmlaq_f32(value[row], factor, vsubq_f32(sourceValue[row], value[row]));
+    }
+
+    // interpolate towards the closer of q and -q
+    float32x4_t dot = vmulq_f32(value[PoseBlender::ROW_ROTATION_X], sourceValue[PoseBlender::ROW_ROTATION_X]);
+    dot = vmlaq_f32(dot, value[PoseBlender::ROW_ROTATION_Y], sourceValue[PoseBlender::ROW_ROTATION_Y]);
+    dot = vmlaq_f32(dot, value[PoseBlender::ROW_ROTATION_Z], sourceValue[PoseBlender::ROW_ROTATION_Z]);
+    dot = vmlaq_f32(dot, value[PoseBlender::ROW_ROTATION_W], sourceValue[PoseBlender::ROW_ROTATION_W]);
+
+    float32x4_t absDot = vabsq_f32(dot);
+
+    float32x4_t inverseFactor, sourceFactor;
+    switch(mode)
+    {
+      case PoseBlender::MODE_CORRECTED_NLERP:
+        sourceFactor = getCorrectedFactorNeon(factor, absDot);
+        inverseFactor = vsubq_f32(one, sourceFactor);
+        break;
+      case PoseBlender::MODE_MINIMAX_SLERP:
+        inverseFactor = getMinimaxFactorNeon(vsubq_f32(one, factor), vsubq_f32(absDot, one));
+        sourceFactor = getMinimaxFactorNeon(factor, vsubq_f32(absDot, one));
+        break;
+      default:
+        inverseFactor = vsubq_f32(one, factor);
+        sourceFactor = factor;
+        break;
+    }
+
+    sourceFactor = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(sourceFactor), vandq_u32(vcltq_f32(dot, zero), signMask)));
+
+    float32x4_t length = zero;
+    for(row = PoseBlender::ROW_ROTATION_X; row <= PoseBlender::ROW_ROTATION_W; row++)
+    {
+      blended[row] = vmlaq_f32(vmulq_f32(inverseFactor, value[row]), sourceFactor, sourceValue[row]);
+      length = vmlaq_f32(length, blended[row], blended[row]);
+    }
+
+    // the minimax slerp stays on the unit sphere within its error
+    if(mode != PoseBlender::MODE_MINIMAX_SLERP)
+    {
+      length = vmaxq_f32(length, vdupq_n_f32(1e-30f));
+      float32x4_t invLength = vrsqrteq_f32(length);
+      invLength = vmulq_f32(invLength, vrsqrtsq_f32(vmulq_f32(length, invLength), invLength));
+      invLength = vmulq_f32(invLength, vrsqrtsq_f32(vmulq_f32(length, invLength), invLength));
+
+      for(row = PoseBlender::ROW_ROTATION_X; row <= PoseBlender::ROW_ROTATION_W; row++)
+      {
+        blended[row] = vmulq_f32(blended[row], invLength);
+      }
+    }
+
+    blended[PoseBlender::ROW_WEIGHT] = totalWeight;
+    value[PoseBlender::ROW_WEIGHT] = weight;
+    sourceValue[PoseBlender::ROW_WEIGHT] = sourceWeight;
+
+    for(row = 0; row < PoseBlender::ROW_COUNT; row++)
+    {
+      float32x4_t result = vbslq_f32(first, sourceValue[row], blended[row]);
+      vst1q_f32(&pBlock[row * blockSize], vbslq_f32(active, result, value[row]));
+    }
+  }
+}
+
+#endif
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,354 @@
+//----------------------------------------------------------------------------//
+// posecache.cpp                                                              //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "posecache.h"
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------//
+// Static member variables initialization                                     //
+//----------------------------------------------------------------------------//
+
+std::list<PoseCache::Entry> PoseCache::m_listEntry;
+std::map<PoseCache::Key, std::list<PoseCache::Entry>::iterator> PoseCache::m_mapEntry;
+pthread_mutex_t PoseCache::m_mutex = PTHREAD_MUTEX_INITIALIZER;
+bool PoseCache::m_bEnabled = false;
+float PoseCache::m_timeStep = 1.0f / 60.0f;
+int PoseCache::m_byteBudget = 1024 * 1024;
+int PoseCache::m_byteSize = 0;
+int PoseCache::m_hitCount = 0;
+int PoseCache::m_missCount = 0;
+int PoseCache::m_evictionCount = 0;
+
+//----------------------------------------------------------------------------//
+// Order the keys by core animation first, so all poses of a core animation   //
+// are next to each other in the map                                          //
+//----------------------------------------------------------------------------//
+
+bool PoseCache::Key::operator<(const Key& key) const
+{
+  if(pCoreAnimation != key.pCoreAnimation) return pCoreAnimation < key.pCoreAnimation;
+  if(timeKey != key.timeKey) return timeKey < key.timeKey;
+
+  return mode < key.mode;
+}
+
+//----------------------------------------------------------------------------//
+// Remove all poses                                                           //
+//----------------------------------------------------------------------------//
+
+void PoseCache::clear()
+{
+  pthread_mutex_lock(&m_mutex);
+
+  m_mapEntry.clear();
+  m_listEntry.clear();
+  m_byteSize = 0;
+
+  pthread_mutex_unlock(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Copy the cached pose of a core animation at a quantized time, false is     //
+// returned on a miss and the caller samples the pose and inserts it          //
+//----------------------------------------------------------------------------//
+
+bool PoseCache::get(CalCoreAnimation *pCoreAnimation, int timeKey, PoseBlender::Mode mode, float *pPose, int poseSize)
+{
+  Key key;
+  key.pCoreAnimation = pCoreAnimation;
+  key.timeKey = timeKey;
+  key.mode = mode;
+
+  pthread_mutex_lock(&m_mutex);
+
+  std::map<Key, std::list<Entry>::iterator>::iterator iteratorEntry;
+  iteratorEntry = m_mapEntry.find(key);
+
+  // a core animation shared by skeletons of different sizes never hits
+  if((iteratorEntry == m_mapEntry.end()) || ((int)iteratorEntry->second->vectorPose.size() != poseSize))
+  {
+    m_missCount++;
+    pthread_mutex_unlock(&m_mutex);
+    return false;
+  }
+
+  // move the entry to the front of the recently used list
+  m_listEntry.splice(m_listEntry.begin(), m_listEntry, iteratorEntry->second);
+
+  memcpy(pPose, &iteratorEntry->second->vectorPose[0], poseSize * sizeof(float));
+
+  m_hitCount++;
+
+  pthread_mutex_unlock(&m_mutex);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Get the maximum number of bytes of the cached poses                        //
+//----------------------------------------------------------------------------//
+
+int PoseCache::getByteBudget()
+{
+  return m_byteBudget;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bytes of the cached poses                                //
+//----------------------------------------------------------------------------//
+
+int PoseCache::getByteSize()
+{
+  return m_byteSize;
+}
+
+//----------------------------------------------------------------------------//
+// Estimate the memory of an entry, including the list and map nodes          //
+//----------------------------------------------------------------------------//
+
+int PoseCache::getEntryByteSize(int poseSize)
+{
+  return (int)(sizeof(Entry) + sizeof(Key) + sizeof(std::list<Entry>::iterator) + 4 * sizeof(void *) + poseSize * sizeof(float));
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of cached poses                                             //
+//----------------------------------------------------------------------------//
+
+int PoseCache::getEntryCount()
+{
+  return (int)m_mapEntry.size();
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of poses evicted to stay within the byte budget             //
+//----------------------------------------------------------------------------//
+
+int PoseCache::getEvictionCount()
+{
+  return m_evictionCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of lookups answered by a cached pose                        //
+//----------------------------------------------------------------------------//
+
+int PoseCache::getHitCount()
+{
+  return m_hitCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of lookups that had to sample the pose                      //
+//----------------------------------------------------------------------------//
+
+int PoseCache::getMissCount()
+{
+  return m_missCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the time a quantized time stands for, the time the pose is sampled at  //
+//----------------------------------------------------------------------------//
+
+float PoseCache::getTime(int timeKey)
+{
+  return timeKey * m_timeStep;
+}
+
+//----------------------------------------------------------------------------//
+// Quantize a time to the nearest multiple of the time step                   //
+//----------------------------------------------------------------------------//
+
+int PoseCache::getTimeKey(float time)
+{
+  return (int)floor(time / m_timeStep + 0.5f);
+}
+
+//----------------------------------------------------------------------------//
+// Get the time step the times are quantized to                               //
+//----------------------------------------------------------------------------//
+
+float PoseCache::getTimeStep()
+{
+  return m_timeStep;
+}
+
+//----------------------------------------------------------------------------//
+// Insert a sampled pose, the least recently used poses are evicted to make   //
+// room for it                                                                //
+//----------------------------------------------------------------------------//
+
+void PoseCache::insert(CalCoreAnimation *pCoreAnimation, int timeKey, PoseBlender::Mode mode, const float *pPose, int poseSize)
+{
+  Key key;
+  key.pCoreAnimation = pCoreAnimation;
+  key.timeKey = timeKey;
+  key.mode = mode;
+
+  pthread_mutex_lock(&m_mutex);
+
+  if(!m_bEnabled || (getEntryByteSize(poseSize) > m_byteBudget))
+  {
+    pthread_mutex_unlock(&m_mutex);
+    return;
+  }
+
+  // another instance may have inserted the same pose since its miss
+  std::map<Key, std::list<Entry>::iterator>::iterator iteratorEntry;
+  iteratorEntry = m_mapEntry.find(key);
+  if(iteratorEntry != m_mapEntry.end())
+  {
+    m_byteSize -= getEntryByteSize((int)iteratorEntry->second->vectorPose.size());
+    m_listEntry.erase(iteratorEntry->second);
+    m_mapEntry.erase(iteratorEntry);
+  }
+
+  m_listEntry.push_front(Entry());
+
+  Entry& entry = m_listEntry.front();
+  entry.key = key;
+  entry.vectorPose.assign(pPose, pPose + poseSize);
+
+  m_mapEntry[key] = m_listEntry.begin();
+  m_byteSize += getEntryByteSize(poseSize);
+
+  trim();
+
+  pthread_mutex_unlock(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Check if the models look up and insert their poses                         //
+//----------------------------------------------------------------------------//
+
+bool PoseCache::isEnabled()
+{
+  return m_bEnabled;
+}
+
+//----------------------------------------------------------------------------//
+// Remove all poses of a core animation, before it is destroyed               //
+//----------------------------------------------------------------------------//
+
+void PoseCache::remove(CalCoreAnimation *pCoreAnimation)
+{
+  Key key;
+  key.pCoreAnimation = pCoreAnimation;
+  key.timeKey = INT_MIN;
+  key.mode = 0;
+
+  pthread_mutex_lock(&m_mutex);
+
+  std::map<Key, std::list<Entry>::iterator>::iterator iteratorEntry;
+  iteratorEntry = m_mapEntry.lower_bound(key);
+
+  while((iteratorEntry != m_mapEntry.end()) && (iteratorEntry->first.pCoreAnimation == pCoreAnimation))
+  {
+    m_byteSize -= getEntryByteSize((int)iteratorEntry->second->vectorPose.size());
+    m_listEntry.erase(iteratorEntry->second);
+    m_mapEntry.erase(iteratorEntry++);
+  }
+
+  pthread_mutex_unlock(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Reset the hit, miss and eviction counters                                  //
+//----------------------------------------------------------------------------//
+
+void PoseCache::resetCounters()
+{
+  pthread_mutex_lock(&m_mutex);
+
+  m_hitCount = 0;
+  m_missCount = 0;
+  m_evictionCount = 0;
+
+  pthread_mutex_unlock(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Set the maximum number of bytes of the cached poses                        //
+//----------------------------------------------------------------------------//
+
+void PoseCache::setByteBudget(int byteBudget)
+{
+  pthread_mutex_lock(&m_mutex);
+
+  m_byteBudget = byteBudget;
+  trim();
+
+  pthread_mutex_unlock(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Enable or disable the cache, a disabled cache keeps no poses               //
+//----------------------------------------------------------------------------//
+
+void PoseCache::setEnabled(bool bEnabled)
+{
+  pthread_mutex_lock(&m_mutex);
+
+  m_bEnabled = bEnabled;
+
+  if(!m_bEnabled)
+  {
+    m_mapEntry.clear();
+    m_listEntry.clear();
+    m_byteSize = 0;
+  }
+
+  pthread_mutex_unlock(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Set the time step the times are quantized to, the cached poses belong to   //
+// the old step and are removed; not to be called during model updates        //
+//----------------------------------------------------------------------------//
+
+void PoseCache::setTimeStep(float timeStep)
+{
+  pthread_mutex_lock(&m_mutex);
+
+  m_timeStep = timeStep;
+
+  m_mapEntry.clear();
+  m_listEntry.clear();
+  m_byteSize = 0;
+
+  pthread_mutex_unlock(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Evict the least recently used poses until the cache fits its byte budget,  //
+// the mutex has to be locked                                                 //
+//----------------------------------------------------------------------------//
+
+void PoseCache::trim()
+{
+  while((m_byteSize > m_byteBudget) && !m_listEntry.empty())
+  {
+    Entry& entry = m_listEntry.back();
+
+    m_byteSize -= getEntryByteSize((int)entry.vectorPose.size());
+    m_mapEntry.erase(entry.key);
+    m_listEntry.pop_back();
+
+    m_evictionCount++;
+  }
+}
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,91 @@
+//----------------------------------------------------------------------------//
+// posecache.h                                                                //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef POSECACHE_H
+#define POSECACHE_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+#include "poseblender.h"
+#include <pthread.h>
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+// shares the sampled poses of the core animations between all model
+// instances, so instances playing the same animation at the same quantized
+// time sample it once; a pose is keyed by its core animation, the quantized
+// time and the interpolation mode, and the least recently used poses are
+// evicted when the cache grows over its byte budget
+class PoseCache
+{
+// misc
+protected:
+  struct Key
+  {
+    CalCoreAnimation *pCoreAnimation;
+    int timeKey;
+    int mode;
+
+    bool operator<(const Key& key) const;
+  };
+
+  struct Entry
+  {
+    Key key;
+    std::vector<float> vectorPose;
+  };
+
+// member variables
+protected:
+  // the most recently used entry comes first
+  static std::list<Entry> m_listEntry;
+  static std::map<Key, std::list<Entry>::iterator> m_mapEntry;
+  static pthread_mutex_t m_mutex;
+  static bool m_bEnabled;
+  static float m_timeStep;
+  static int m_byteBudget;
+  static int m_byteSize;
+  static int m_hitCount;
+  static int m_missCount;
+  static int m_evictionCount;
+
+// member functions
+public:
+  static void clear();
+  static bool get(CalCoreAnimation *pCoreAnimation, int timeKey, PoseBlender::Mode mode, float *pPose, int poseSize);
+  static int getByteBudget();
+  static int getByteSize();
+  static int getEntryCount();
+  static int getEvictionCount();
+  static int getHitCount();
+  static int getMissCount();
+  static float getTime(int timeKey);
+  static int getTimeKey(float time);
+  static float getTimeStep();
+  static void insert(CalCoreAnimation *pCoreAnimation, int timeKey, PoseBlender::Mode mode, const float *pPose, int poseSize);
+  static bool isEnabled();
+  static void remove(CalCoreAnimation *pCoreAnimation);
+  static void resetCounters();
+  static void setByteBudget(int byteBudget);
+  static void setEnabled(bool bEnabled);
+  static void setTimeStep(float timeStep);
+
+protected:
+  static int getEntryByteSize(int poseSize);
+  static void trim();
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,796 @@
+//----------------------------------------------------------------------------//
+// skinning.cpp                                                               //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "skinning.h"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#ifdef HAVE_NEON
+#include <cpu-features.h>
+#endif
+
+//----------------------------------------------------------------------------//
+// Static member variables initialization                                     //
+//----------------------------------------------------------------------------//
+
+const int Skinning::BONE_MATRIX_SIZE = 12;
+const int Skinning::DUAL_QUATERNION_SIZE = 8;
+
+// PATH_COUNT means "not selected yet", the best path is picked on first use
+Skinning::Path Skinning::m_path = Skinning::PATH_COUNT;
+
+//----------------------------------------------------------------------------//
+// Build the 3x4 bone matrices of all bones of a skeleton                     //
+//----------------------------------------------------------------------------//
+
+void Skinning::calculateBoneMatrices(CalSkeleton *pSkeleton, float *pBoneMatrixBuffer)
+{
+  std::vector<CalBone *>& vectorBone = pSkeleton->getVectorBone();
+
+  int boneId;
+  for(boneId = 0; boneId < (int)vectorBone.size(); boneId++)
+  {
+    // same transformation CalPhysique applies: matrix * position + translation
+    const CalMatrix& matrix = vectorBone[boneId]->getTransformMatrix();
+    const CalVector& translation = vectorBone[boneId]->getTranslationBoneSpace();
+
+    float *pMatrix = &pBoneMatrixBuffer[boneId * BONE_MATRIX_SIZE];
+    pMatrix[0] = matrix.dxdx; pMatrix[1] = matrix.dxdy; pMatrix[2] = matrix.dxdz; pMatrix[3] = translation.x;
+    pMatrix[4] = matrix.dydx; pMatrix[5] = matrix.dydy; pMatrix[6] = matrix.dydz; pMatrix[7] = translation.y;
+    pMatrix[8] = matrix.dzdx; pMatrix[9] = matrix.dzdy; pMatrix[10] = matrix.dzdz; pMatrix[11] = translation.z;
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Convert bone matrices into unit dual quaternions                           //
+//----------------------------------------------------------------------------//
+
+void Skinning::calculateDualQuaternions(const float *pBoneMatrix, int boneCount, float *pDualQuaternionBuffer)
+{
+  int boneId;
+  for(boneId = 0; boneId < boneCount; boneId++)
+  {
+    const float *m = &pBoneMatrix[boneId * BONE_MATRIX_SIZE];
+    float *pDualQuaternion = &pDualQuaternionBuffer[boneId * DUAL_QUATERNION_SIZE];
+
+    // the rotation of the matrix, taken from the largest diagonal element to
+    // stay accurate near 180 degrees; going through the matrix instead of the
+    // bone quaternion keeps the exact transform of the linear path
+    float x, y, z, w;
+
+    float trace;
+    trace = m[0] + m[5] + m[10];
+    if(trace > 0.0f)
+    {
+      float scale;
+      scale = 0.5f / (float)sqrt(trace + 1.0f);
+      w = 0.25f / scale;
+      x = (m[9] - m[6]) * scale;
+      y = (m[2] - m[8]) * scale;
+      z = (m[4] - m[1]) * scale;
+    }
+    else if((m[0] > m[5]) && (m[0] > m[10]))
+    {
+      float scale;
+      scale = 0.5f / (float)sqrt(1.0f + m[0] - m[5] - m[10]);
+      w = (m[9] - m[6]) * scale;
+      x = 0.25f / scale;
+      y = (m[1] + m[4]) * scale;
+      z = (m[2] + m[8]) * scale;
+    }
+    else if(m[5] > m[10])
+    {
+      float scale;
+      scale = 0.5f / (float)sqrt(1.0f + m[5] - m[0] - m[10]);
+      w = (m[2] - m[8]) * scale;
+      x = (m[1] + m[4]) * scale;
+      y = 0.25f / scale;
+      z = (m[6] + m[9]) * scale;
+    }
+    else
+    {
+      float scale;
+      scale = 0.5f / (float)sqrt(1.0f + m[10] - m[0] - m[5]);
+      w = (m[4] - m[1]) * scale;
+      x = (m[2] + m[8]) * scale;
+      y = (m[6] + m[9]) * scale;
+      z = 0.25f / scale;
+    }
+
+    float length;
+    length = (float)sqrt(x * x + y * y + z * z + w * w);
+    x /= length;
+    y /= length;
+    z /= length;
+    w /= length;
+
+    // the dual part is half the translation times the rotation
+    float tx, ty, tz;
+    tx = m[3];
+    ty = m[7];
+    tz = m[11];
+
+    pDualQuaternion[0] = x;
+    pDualQuaternion[1] = y;
+    pDualQuaternion[2] = z;
+    pDualQuaternion[3] = w;
+    pDualQuaternion[4] = 0.5f * (w * tx + ty * z - tz * y);
+    pDualQuaternion[5] = 0.5f * (w * ty + tz * x - tx * z);
+    pDualQuaternion[6] = 0.5f * (w * tz + tx * y - ty * x);
+    pDualQuaternion[7] = -0.5f * (tx * x + ty * y + tz * z);
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Skin the vertices and normals of a submesh with the selected kernel, the   //
+// bone transforms are bone matrices or dual quaternions depending on the     //
+// method                                                                     //
+//----------------------------------------------------------------------------//
+
+int Skinning::calculateVerticesAndNormals(CalSubmesh *pSubmesh, const SkinStream *pSkinStream, const float *pBoneTransform, float *pVertexBuffer, float *pNormalBuffer, int vertexStride, int normalStride, Method method)
+{
+  if(vertexStride <= 0) vertexStride = 3 * sizeof(float);
+  if(normalStride <= 0) normalStride = 3 * sizeof(float);
+
+  // the lod level limits the number of vertices, just like in CalPhysique
+  int vertexCount;
+  vertexCount = pSubmesh->getVertexCount();
+  if(vertexCount == 0) return 0;
+
+  // vertices without any influence keep their bind pose
+  const std::vector<unsigned short>& vectorStaticVertexId = pSkinStream->getStaticVertexIds();
+  if(!vectorStaticVertexId.empty())
+  {
+    std::vector<CalCoreSubmesh::Vertex>& vectorVertex = pSubmesh->getCoreSubmesh()->getVectorVertex();
+
+    unsigned int staticId;
+    for(staticId = 0; staticId < vectorStaticVertexId.size(); staticId++)
+    {
+      int vertexId;
+      vertexId = vectorStaticVertexId[staticId];
+      if(vertexId >= vertexCount) continue;
+
+      const CalCoreSubmesh::Vertex& vertex = vectorVertex[vertexId];
+
+      float *pVertexOut = (float *)((char *)pVertexBuffer + vertexId * vertexStride);
+      pVertexOut[0] = vertex.position.x;
+      pVertexOut[1] = vertex.position.y;
+      pVertexOut[2] = vertex.position.z;
+
+      CalVector normal(vertex.normal);
+      if(normal.length() > 0.0f) normal.normalize();
+
+      float *pNormalOut = (float *)((char *)pNormalBuffer + vertexId * normalStride);
+      pNormalOut[0] = normal.x;
+      pNormalOut[1] = normal.y;
+      pNormalOut[2] = normal.z;
+    }
+  }
+
+  Kernel kernel;
+  kernel = getKernel(getPath(), method);
+  kernel(*pSkinStream, vertexCount, pBoneTransform, pVertexBuffer, vertexStride, pNormalBuffer, normalStride);
+
+  return vertexCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the fastest path supported by the cpu we are running on                //
+//----------------------------------------------------------------------------//
+
+Skinning::Path Skinning::getBestPath()
+{
+  if(isPathSupported(PATH_NEON)) return PATH_NEON;
+  if(isPathSupported(PATH_SSE)) return PATH_SSE;
+  return PATH_SCALAR;
+}
+
+//----------------------------------------------------------------------------//
+// Get the kernel function of a path and a method                             //
+//----------------------------------------------------------------------------//
+
+Skinning::Kernel Skinning::getKernel(Path path, Method method)
+{
+  if(method == METHOD_DUAL_QUATERNION)
+  {
+#ifdef HAVE_NEON
+    if(path == PATH_NEON) return skinDualQuaternionNeon;
+#endif
+#if defined(__SSE__)
+    if(path == PATH_SSE) return skinDualQuaternionSse;
+#endif
+
+    // CalPhysique has no dual quaternion skinning, PATH_PHYSIQUE ends up here
+    return skinDualQuaternionScalar;
+  }
+
+#ifdef HAVE_NEON
+  if(path == PATH_NEON) return skinNeon;
+#endif
+#if defined(__SSE__)
+  if(path == PATH_SSE) return skinSse;
+#endif
+
+  // PATH_PHYSIQUE callers go through CalRenderer, anything else ends up here
+  return skinScalar;
+}
+
+//----------------------------------------------------------------------------//
+// Get a printable name of a method                                           //
+//----------------------------------------------------------------------------//
+
+const char *Skinning::getMethodName(Method method)
+{
+  switch(method)
+  {
+    case METHOD_LINEAR:
+      return "linear";
+    case METHOD_DUAL_QUATERNION:
+      return "dual quaternion";
+    default:
+      return "unknown";
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Get the currently selected path                                            //
+//----------------------------------------------------------------------------//
+
+Skinning::Path Skinning::getPath()
+{
+  if(m_path == PATH_COUNT) m_path = getBestPath();
+
+  return m_path;
+}
+
+//----------------------------------------------------------------------------//
+// Get a printable name of a path                                             //
+//----------------------------------------------------------------------------//
+
+const char *Skinning::getPathName(Path path)
+{
+  switch(path)
+  {
+    case PATH_PHYSIQUE:
+      return "physique";
+    case PATH_SCALAR:
+      return "scalar";
+    case PATH_SSE:
+      return "sse";
+    case PATH_NEON:
+      return "neon";
+    default:
+      return "unknown";
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Check if a path can be used on this cpu                                    //
+//----------------------------------------------------------------------------//
+
+bool Skinning::isPathSupported(Path path)
+{
+  switch(path)
+  {
+    case PATH_PHYSIQUE:
+    case PATH_SCALAR:
+      return true;
+    case PATH_SSE:
+#if defined(__SSE__)
+      return true;
+#else
+      return false;
+#endif
+    case PATH_NEON:
+#ifdef HAVE_NEON
+      // armeabi-v7a does not guarantee NEON (e.g. Tegra 2), so ask the cpu
+      return (android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM) && ((android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0);
+#else
+      return false;
+#endif
+    default:
+      return false;
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Check if a submesh can be skinned by the kernels                           //
+//----------------------------------------------------------------------------//
+
+bool Skinning::isSubmeshSupported(CalSubmesh *pSubmesh)
+{
+  // morph targets and spring simulated vertices are only handled by CalPhysique
+  if(pSubmesh->hasInternalData()) return false;
+  if(pSubmesh->getCoreSubmesh()->getCoreSubMorphTargetCount() > 0) return false;
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Select the path used by calculateVerticesAndNormals                        //
+//----------------------------------------------------------------------------//
+
+bool Skinning::setPath(Path path)
+{
+  if(!isPathSupported(path)) return false;
+
+  m_path = path;
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Scalar dual quaternion kernel, one vertex per iteration                    //
+//----------------------------------------------------------------------------//
+
+void Skinning::skinDualQuaternionScalar(const SkinStream& skinStream, int vertexCount, const float *pDualQuaternion, float *pVertexBuffer, int vertexStride, float *pNormalBuffer, int normalStride)
+{
+  const int blockSize = SkinStream::BLOCK_SIZE;
+
+  const unsigned char *pInfluenceCount = skinStream.getInfluenceCounts();
+
+  int blockId;
+  for(blockId = 0; blockId < skinStream.getBlockCount(); blockId++)
+  {
+    const unsigned short *pVertexId = skinStream.getVertexIds(blockId);
+    const unsigned short *pBoneId = skinStream.getBoneIds(blockId);
+    const float *pWeight = skinStream.getWeights(blockId);
+    const float *pPosition = skinStream.getPositions(blockId);
+    const float *pNormal = skinStream.getNormals(blockId);
+
+    int lane;
+    for(lane = 0; lane < blockSize; lane++)
+    {
+      // skip padded lanes and vertices removed by the lod level
+      int vertexId;
+      vertexId = pVertexId[lane];
+      if(vertexId >= vertexCount) continue;
+
+      // blend the dual quaternions of all influences together, q and -q are
+      // the same rotation, so each one is flipped into the hemisphere of the
+      // first influence
+      float q[8];
+      const float *pFirst = &pDualQuaternion[pBoneId[lane] * DUAL_QUATERNION_SIZE];
+      float weight;
+      weight = pWeight[lane];
+
+      int i;
+      for(i = 0; i < 8; i++) q[i] = weight * pFirst[i];
+
+      int influenceId;
+      for(influenceId = 1; influenceId < pInfluenceCount[blockId]; influenceId++)
+      {
+        const float *pQuaternion = &pDualQuaternion[pBoneId[influenceId * blockSize + lane] * DUAL_QUATERNION_SIZE];
+        weight = pWeight[influenceId * blockSize + lane];
+        if(pFirst[0] * pQuaternion[0] + pFirst[1] * pQuaternion[1] + pFirst[2] * pQuaternion[2] + pFirst[3] * pQuaternion[3] < 0.0f) weight = -weight;
+        for(i = 0; i < 8; i++) q[i] += weight * pQuaternion[i];
+      }
+
+      // back to a unit dual quaternion
+      float length;
+      length = (float)sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+      if(length > 0.0f)
+      {
+        for(i = 0; i < 8; i++) q[i] /= length;
+      }
+
+      float rx, ry, rz, rw;
+      rx = q[0]; ry = q[1]; rz = q[2]; rw = q[3];
+      float dx, dy, dz, dw;
+      dx = q[4]; dy = q[5]; dz = q[6]; dw = q[7];
+
+      // the translation of the blended transform
+      float tx, ty, tz;
+      tx = 2.0f * (rw * dx - dw * rx + ry * dz - rz * dy);
+      ty = 2.0f * (rw * dy - dw * ry + rz * dx - rx * dz);
+      tz = 2.0f * (rw * dz - dw * rz + rx * dy - ry * dx);
+
+      // rotate the position: p + 2 r x (r x p + w p)
+      float px, py, pz;
+      px = pPosition[lane];
+      py = pPosition[blockSize + lane];
+      pz = pPosition[2 * blockSize + lane];
+
+      float ax, ay, az;
+      ax = ry * pz - rz * py + rw * px;
+      ay = rz * px - rx * pz + rw * py;
+      az = rx * py - ry * px + rw * pz;
+
+      float *pVertexOut = (float *)((char *)pVertexBuffer + vertexId * vertexStride);
+      pVertexOut[0] = px + 2.0f * (ry * az - rz * ay) + tx;
+      pVertexOut[1] = py + 2.0f * (rz * ax - rx * az) + ty;
+      pVertexOut[2] = pz + 2.0f * (rx * ay - ry * ax) + tz;
+
+      // rotate and normalize the normal
+      float nx, ny, nz;
+      nx = pNormal[lane];
+      ny = pNormal[blockSize + lane];
+      nz = pNormal[2 * blockSize + lane];
+
+      ax = ry * nz - rz * ny + rw * nx;
+      ay = rz * nx - rx * nz + rw * ny;
+      az = rx * ny - ry * nx + rw * nz;
+
+      float ox, oy, oz;
+      ox = nx + 2.0f * (ry * az - rz * ay);
+      oy = ny + 2.0f * (rz * ax - rx * az);
+      oz = nz + 2.0f * (rx * ay - ry * ax);
+
+      length = (float)sqrt(ox * ox + oy * oy + oz * oz);
+      if(length > 0.0f)
+      {
+        ox /= length;
+        oy /= length;
+        oz /= length;
+      }
+
+      float *pNormalOut = (float *)((char *)pNormalBuffer + vertexId * normalStride);
+      pNormalOut[0] = ox;
+      pNormalOut[1] = oy;
+      pNormalOut[2] = oz;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------//
+// SSE dual quaternion kernel, four vertices per iteration                    //
+//----------------------------------------------------------------------------//
+
+#if defined(__SSE__)
+
+static inline void blendDualQuaternionSse(const unsigned short *pBoneId, const float *pWeight, int influenceCount, const float *pDualQuaternion, __m128& real, __m128& dual)
+{
+  const int blockSize = SkinStream::BLOCK_SIZE;
+
+  // padded influences have a zero weight, see blendRowsSse
+  const float *pFirst = &pDualQuaternion[pBoneId[0] * Skinning::DUAL_QUATERNION_SIZE];
+  __m128 weight = _mm_set1_ps(pWeight[0]);
+  real = _mm_mul_ps(weight, _mm_loadu_ps(&pFirst[0]));
+  dual = _mm_mul_ps(weight, _mm_loadu_ps(&pFirst[4]));
+
+  int influenceId;
+  for(influenceId = 1; influenceId < influenceCount; influenceId++)
+  {
+    const float *pQuaternion = &pDualQuaternion[pBoneId[influenceId * blockSize] * Skinning::DUAL_QUATERNION_SIZE];
+
+    // flip into the hemisphere of the first influence
+    float factor;
+    factor = pWeight[influenceId * blockSize];
+    if(pFirst[0] * pQuaternion[0] + pFirst[1] * pQuaternion[1] + pFirst[2] * pQuaternion[2] + pFirst[3] * pQuaternion[3] < 0.0f) factor = -factor;
+
+    weight = _mm_set1_ps(factor);
+    real = _mm_add_ps(real, _mm_mul_ps(weight, _mm_loadu_ps(&pQuaternion[0])));
+    dual = _mm_add_ps(dual, _mm_mul_ps(weight, _mm_loadu_ps(&pQuaternion[4])));
+  }
+}
+
+#endif
+
+void Skinning::skinDualQuaternionSse(const SkinStream& skinStream, int vertexCount, const float *pDualQuaternion, float *pVertexBuffer, int vertexStride, float *pNormalBuffer, int normalStride)
+{
+#if defined(__SSE__)
+  const int blockSize = SkinStream::BLOCK_SIZE;
+
+  const unsigned char *pInfluenceCount = skinStream.getInfluenceCounts();
+
+  const __m128 two = _mm_set1_ps(2.0f);
+
+  int blockId;
+  for(blockId = 0; blockId < skinStream.getBlockCount(); blockId++)
+  {
+    const unsigned short *pVertexId = skinStream.getVertexIds(blockId);
+    const unsigned short *pBoneId = skinStream.getBoneIds(blockId);
+    const float *pWeight = skinStream.getWeights(blockId);
+    const float *pPosition = skinStream.getPositions(blockId);
+    const float *pNormal = skinStream.getNormals(blockId);
+
+    // blend the dual quaternions of each lane
+    __m128 real[4];
+    __m128 dual[4];
+
+    int lane;
+    for(lane = 0; lane < blockSize; lane++)
+    {
+      blendDualQuaternionSse(&pBoneId[lane], &pWeight[lane], pInfluenceCount[blockId], pDualQuaternion, real[lane], dual[lane]);
+    }
+
+    // transpose, so every register holds one component for all lanes
+    __m128 rx = real[0], ry = real[1], rz = real[2], rw = real[3];
+    _MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+    __m128 dx = dual[0], dy = dual[1], dz = dual[2], dw = dual[3];
+    _MM_TRANSPOSE4_PS(dx, dy, dz, dw);
+
+    // back to unit dual quaternions
+    __m128 length = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), _mm_add_ps(_mm_mul_ps(rz, rz), _mm_mul_ps(rw, rw)));
+    __m128 invLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(length, _mm_set1_ps(1e-30f))));
+    rx = _mm_mul_ps(rx, invLength); ry = _mm_mul_ps(ry, invLength); rz = _mm_mul_ps(rz, invLength); rw = _mm_mul_ps(rw, invLength);
+    dx = _mm_mul_ps(dx, invLength); dy = _mm_mul_ps(dy, invLength); dz = _mm_mul_ps(dz, invLength); dw = _mm_mul_ps(dw, invLength);
+
+    // the translation of the blended transforms
+    __m128 tx = _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rw, dx), _mm_mul_ps(dw, rx)), _mm_sub_ps(_mm_mul_ps(ry, dz), _mm_mul_ps(rz, dy))));
+    __m128 ty = _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rw, dy), _mm_mul_ps(dw, ry)), _mm_sub_ps(_mm_mul_ps(rz, dx), _mm_mul_ps(rx, dz))));
+    __m128 tz = _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rw, dz), _mm_mul_ps(dw, rz)), _mm_sub_ps(_mm_mul_ps(rx, dy), _mm_mul_ps(ry, dx))));
+
+    // rotate positions and normals in SoA form: v + 2 r x (r x v + w v)
+    __m128 v[2][3];
+    v[0][0] = _mm_loadu_ps(&pPosition[0]);
+    v[0][1] = _mm_loadu_ps(&pPosition[blockSize]);
+    v[0][2] = _mm_loadu_ps(&pPosition[2 * blockSize]);
+    v[1][0] = _mm_loadu_ps(&pNormal[0]);
+    v[1][1] = _mm_loadu_ps(&pNormal[blockSize]);
+    v[1][2] = _mm_loadu_ps(&pNormal[2 * blockSize]);
+
+    __m128 out[2][3];
+
+    int vectorId;
+    for(vectorId = 0; vectorId < 2; vectorId++)
+    {
+      __m128 ax = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(ry, v[vectorId][2]), _mm_mul_ps(rz, v[vectorId][1])), _mm_mul_ps(rw, v[vectorId][0]));
+      __m128 ay = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rz, v[vectorId][0]), _mm_mul_ps(rx, v[vectorId][2])), _mm_mul_ps(rw, v[vectorId][1]));
+      __m128 az = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rx, v[vectorId][1]), _mm_mul_ps(ry, v[vectorId][0])), _mm_mul_ps(rw, v[vectorId][2]));
+
+      out[vectorId][0] = _mm_add_ps(v[vectorId][0], _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(ry, az), _mm_mul_ps(rz, ay))));
+      out[vectorId][1] = _mm_add_ps(v[vectorId][1], _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(rz, ax), _mm_mul_ps(rx, az))));
+      out[vectorId][2] = _mm_add_ps(v[vectorId][2], _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(rx, ay), _mm_mul_ps(ry, ax))));
+    }
+
+    out[0][0] = _mm_add_ps(out[0][0], tx);
+    out[0][1] = _mm_add_ps(out[0][1], ty);
+    out[0][2] = _mm_add_ps(out[0][2], tz);
+
+    // normalize the normals
+    length = _mm_add_ps(_mm_add_ps(_mm_mul_ps(out[1][0], out[1][0]), _mm_mul_ps(out[1][1], out[1][1])), _mm_mul_ps(out[1][2], out[1][2]));
+    length = _mm_sqrt_ps(_mm_max_ps(length, _mm_set1_ps(1e-30f)));
+    out[1][0] = _mm_div_ps(out[1][0], length);
+    out[1][1] = _mm_div_ps(out[1][1], length);
+    out[1][2] = _mm_div_ps(out[1][2], length);
+
+    // scatter the valid lanes to their original vertex ids
+    float position[3][4];
+    float normal[3][4];
+
+    int rowId;
+    for(rowId = 0; rowId < 3; rowId++)
+    {
+      _mm_storeu_ps(position[rowId], out[0][rowId]);
+      _mm_storeu_ps(normal[rowId], out[1][rowId]);
+    }
+
+    for(lane = 0; lane < blockSize; lane++)
+    {
+      int vertexId;
+      vertexId = pVertexId[lane];
+      if(vertexId >= vertexCount) continue;
+
+      float *pVertexOut = (float *)((char *)pVertexBuffer + vertexId * vertexStride);
+      pVertexOut[0] = position[0][lane];
+      pVertexOut[1] = position[1][lane];
+      pVertexOut[2] = position[2][lane];
+
+      float *pNormalOut = (float *)((char *)pNormalBuffer + vertexId * normalStride);
+      pNormalOut[0] = normal[0][lane];
+      pNormalOut[1] = normal[1][lane];
+      pNormalOut[2] = normal[2][lane];
+    }
+  }
+#else
+  skinDualQuaternionScalar(skinStream, vertexCount, pDualQuaternion, pVertexBuffer, vertexStride, pNormalBuffer, normalStride);
+#endif
+}
+
+//----------------------------------------------------------------------------//
+// Scalar kernel, one vertex per iteration                                    //
+//----------------------------------------------------------------------------//
+
+void Skinning::skinScalar(const SkinStream& skinStream, int vertexCount, const float *pBoneMatrix, float *pVertexBuffer, int vertexStride, float *pNormalBuffer, int normalStride)
+{
+  const int blockSize = SkinStream::BLOCK_SIZE;
+
+  const unsigned char *pInfluenceCount = skinStream.getInfluenceCounts();
+
+  int blockId;
+  for(blockId = 0; blockId < skinStream.getBlockCount(); blockId++)
+  {
+    const unsigned short *pVertexId = skinStream.getVertexIds(blockId);
+    const unsigned short *pBoneId = skinStream.getBoneIds(blockId);
+    const float *pWeight = skinStream.getWeights(blockId);
+    const float *pPosition = skinStream.getPositions(blockId);
+    const float *pNormal = skinStream.getNormals(blockId);
+
+    int lane;
+    for(lane = 0; lane < blockSize; lane++)
+    {
+      // skip padded lanes and vertices removed by the lod level
+      int vertexId;
+      vertexId = pVertexId[lane];
+      if(vertexId >= vertexCount) continue;
+
+      // blend the bone matrices of all influences together
+      float m[12];
+      const float *pMatrix = &pBoneMatrix[pBoneId[lane] * BONE_MATRIX_SIZE];
+      float weight;
+      weight = pWeight[lane];
+
+      int i;
+      for(i = 0; i < 12; i++) m[i] = weight * pMatrix[i];
+
+      int influenceId;
+      for(influenceId = 1; influenceId < pInfluenceCount[blockId]; influenceId++)
+      {
+        pMatrix = &pBoneMatrix[pBoneId[influenceId * blockSize + lane] * BONE_MATRIX_SIZE];
+        weight = pWeight[influenceId * blockSize + lane];
+        for(i = 0; i < 12; i++) m[i] += weight * pMatrix[i];
+      }
+
+      // transform the position
+      float px, py, pz;
+      px = pPosition[lane];
+      py = pPosition[blockSize + lane];
+      pz = pPosition[2 * blockSize + lane];
+
+      float *pVertexOut = (float *)((char *)pVertexBuffer + vertexId * vertexStride);
+      pVertexOut[0] = m[0] * px + m[1] * py + m[2] * pz + m[3];
+      pVertexOut[1] = m[4] * px + m[5] * py + m[6] * pz + m[7];
+      pVertexOut[2] = m[8] * px + m[9] * py + m[10] * pz + m[11];
+
+      // transform and normalize the normal
+      float nx, ny, nz;
+      nx = pNormal[lane];
+      ny = pNormal[blockSize + lane];
+      nz = pNormal[2 * blockSize + lane];
+
+      float tx, ty, tz;
+      tx = m[0] * nx + m[1] * ny + m[2] * nz;
+      ty = m[4] * nx + m[5] * ny + m[6] * nz;
+      tz = m[8] * nx + m[9] * ny + m[10] * nz;
+
+      float length;
+      length = (float)sqrt(tx * tx + ty * ty + tz * tz);
+      if(length > 0.0f)
+      {
+        tx /= length;
+        ty /= length;
+        tz /= length;
+      }
+
+      float *pNormalOut = (float *)((char *)pNormalBuffer + vertexId * normalStride);
+      pNormalOut[0] = tx;
+      pNormalOut[1] = ty;
+      pNormalOut[2] = tz;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------//
+// SSE kernel, four vertices per iteration                                    //
+//----------------------------------------------------------------------------//
+
+#if defined(__SSE__)
+
+static inline void blendRowsSse(const unsigned short *pBoneId, const float *pWeight, int influenceCount, const float *pBoneMatrix, __m128& row0, __m128& row1, __m128& row2)
+{
+  const int blockSize = SkinStream::BLOCK_SIZE;
+
+  // padded influences have a zero weight, so every lane can loop over the
+  // influence count of the whole block
+  const float *pMatrix = &pBoneMatrix[pBoneId[0] * Skinning::BONE_MATRIX_SIZE];
+  __m128 weight = _mm_set1_ps(pWeight[0]);
+  row0 = _mm_mul_ps(weight, _mm_loadu_ps(&pMatrix[0]));
+  row1 = _mm_mul_ps(weight, _mm_loadu_ps(&pMatrix[4]));
+  row2 = _mm_mul_ps(weight, _mm_loadu_ps(&pMatrix[8]));
+
+  int influenceId;
+  for(influenceId = 1; influenceId < influenceCount; influenceId++)
+  {
+    pMatrix = &pBoneMatrix[pBoneId[influenceId * blockSize] * Skinning::BONE_MATRIX_SIZE];
+    weight = _mm_set1_ps(pWeight[influenceId * blockSize]);
+    row0 = _mm_add_ps(row0, _mm_mul_ps(weight, _mm_loadu_ps(&pMatrix[0])));
+    row1 = _mm_add_ps(row1, _mm_mul_ps(weight, _mm_loadu_ps(&pMatrix[4])));
+    row2 = _mm_add_ps(row2, _mm_mul_ps(weight, _mm_loadu_ps(&pMatrix[8])));
+  }
+}
+
+#endif
+
+void Skinning::skinSse(const SkinStream& skinStream, int vertexCount, const float *pBoneMatrix, float *pVertexBuffer, int vertexStride, float *pNormalBuffer, int normalStride)
+{
+#if defined(__SSE__)
+  const int blockSize = SkinStream::BLOCK_SIZE;
+
+  const unsigned char *pInfluenceCount = skinStream.getInfluenceCounts();
+
+  int blockId;
+  for(blockId = 0; blockId < skinStream.getBlockCount(); blockId++)
+  {
+    const unsigned short *pVertexId = skinStream.getVertexIds(blockId);
+    const unsigned short *pBoneId = skinStream.getBoneIds(blockId);
+    const float *pWeight = skinStream.getWeights(blockId);
+    const float *pPosition = skinStream.getPositions(blockId);
+    const float *pNormal = skinStream.getNormals(blockId);
+
+    // blend the matrices of each lane
+    __m128 row[3][4];
+
+    int lane;
+    for(lane = 0; lane < blockSize; lane++)
+    {
+      blendRowsSse(&pBoneId[lane], &pWeight[lane], pInfluenceCount[blockId], pBoneMatrix, row[0][lane], row[1][lane], row[2][lane]);
+    }
+
+    // positions and normals are already stored in SoA form
+    __m128 px = _mm_loadu_ps(&pPosition[0]);
+    __m128 py = _mm_loadu_ps(&pPosition[blockSize]);
+    __m128 pz = _mm_loadu_ps(&pPosition[2 * blockSize]);
+    __m128 nx = _mm_loadu_ps(&pNormal[0]);
+    __m128 ny = _mm_loadu_ps(&pNormal[blockSize]);
+    __m128 nz = _mm_loadu_ps(&pNormal[2 * blockSize]);
+
+    // transpose each matrix row of the four lanes, so every register holds
+    // one matrix element for all lanes, and transform in SoA form
+    __m128 outPosition[3];
+    __m128 outNormal[3];
+
+    int rowId;
+    for(rowId = 0; rowId < 3; rowId++)
+    {
+      __m128 c0 = row[rowId][0];
+      __m128 c1 = row[rowId][1];
+      __m128 c2 = row[rowId][2];
+      __m128 c3 = row[rowId][3];
+      _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+      outPosition[rowId] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, px), _mm_mul_ps(c1, py)), _mm_add_ps(_mm_mul_ps(c2, pz), c3));
+      outNormal[rowId] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, nx), _mm_mul_ps(c1, ny)), _mm_mul_ps(c2, nz));
+    }
+
+    // normalize the normals
+    __m128 length = _mm_add_ps(_mm_add_ps(_mm_mul_ps(outNormal[0], outNormal[0]), _mm_mul_ps(outNormal[1], outNormal[1])), _mm_mul_ps(outNormal[2], outNormal[2]));
+    length = _mm_sqrt_ps(_mm_max_ps(length, _mm_set1_ps(1e-30f)));
+    outNormal[0] = _mm_div_ps(outNormal[0], length);
+    outNormal[1] = _mm_div_ps(outNormal[1], length);
+    outNormal[2] = _mm_div_ps(outNormal[2], length);
+
+    // scatter the valid lanes to their original vertex ids
+    float position[3][4];
+    float normal[3][4];
+    for(rowId = 0; rowId < 3; rowId++)
+    {
+      _mm_storeu_ps(position[rowId], outPosition[rowId]);
+      _mm_storeu_ps(normal[rowId], outNormal[rowId]);
+    }
+
+    for(lane = 0; lane < blockSize; lane++)
+    {
+      int vertexId;
+      vertexId = pVertexId[lane];
+      if(vertexId >= vertexCount) continue;
+
+      float *pVertexOut = (float *)((char *)pVertexBuffer + vertexId * vertexStride);
+      pVertexOut[0] = position[0][lane];
+      pVertexOut[1] = position[1][lane];
+      pVertexOut[2] = position[2][lane];
+
+      float *pNormalOut = (float *)((char *)pNormalBuffer + vertexId * normalStride);
+      pNormalOut[0] = normal[0][lane];
+      pNormalOut[1] = normal[1][lane];
+      pNormalOut[2] = normal[2][lane];
+    }
+  }
+#else
+  skinScalar(skinStream, vertexCount, pBoneMatrix, pVertexBuffer, vertexStride, pNormalBuffer, normalStride);
+#endif
+}
+
+//----------------------------------------------------------------------------//
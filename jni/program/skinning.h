@@ -0,0 +1,89 @@
+//----------------------------------------------------------------------------//
+// skinning.h                                                                 //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef SKINNING_H
+#define SKINNING_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+#include "skinstream.h"
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+class Skinning
+{
+// misc
+public:
+  enum Path
+  {
+    PATH_PHYSIQUE = 0,
+    PATH_SCALAR,
+    PATH_SSE,
+    PATH_NEON,
+    PATH_COUNT
+  };
+
+  // how the transforms of the influences of a vertex are blended, dual
+  // quaternions keep the volume of twisting joints
+  enum Method
+  {
+    METHOD_LINEAR = 0,
+    METHOD_DUAL_QUATERNION,
+    METHOD_COUNT
+  };
+
+  // a bone matrix is a row-major 3x4 matrix: rotation in the first three
+  // columns, bone space translation in the fourth one
+  static const int BONE_MATRIX_SIZE;
+
+  // a bone dual quaternion is the rotation x y z w followed by the dual part
+  // x y z w, built from the bone matrix of the same bone
+  static const int DUAL_QUATERNION_SIZE;
+
+  typedef void (*Kernel)(const SkinStream& skinStream, int vertexCount, const float *pBoneTransform, float *pVertexBuffer, int vertexStride, float *pNormalBuffer, int normalStride);
+
+// member variables
+protected:
+  static Path m_path;
+
+// member functions
+public:
+  static void calculateBoneMatrices(CalSkeleton *pSkeleton, float *pBoneMatrixBuffer);
+  static void calculateDualQuaternions(const float *pBoneMatrix, int boneCount, float *pDualQuaternionBuffer);
+  static int calculateVerticesAndNormals(CalSubmesh *pSubmesh, const SkinStream *pSkinStream, const float *pBoneTransform, float *pVertexBuffer, float *pNormalBuffer, int vertexStride = 0, int normalStride = 0, Method method = METHOD_LINEAR);
+  static Path getBestPath();
+  static const char *getMethodName(Method method);
+  static Path getPath();
+  static const char *getPathName(Path path);
+  static bool isPathSupported(Path path);
+  static bool isSubmeshSupported(CalSubmesh *pSubmesh);
+  static bool setPath(Path path);
+
+protected:
+  static Kernel getKernel(Path path, Method method);
+  static void skinDualQuaternionScalar(const SkinStream& skinStream, int vertexCount, const float *pDualQuaternion, float *pVertexBuffer, int vertexStride, float *pNormalBuffer, int normalStride);
+  static void skinDualQuaternionSse(const SkinStream& skinStream, int vertexCount, const float *pDualQuaternion, float *pVertexBuffer, int vertexStride, float *pNormalBuffer, int normalStride);
+  static void skinScalar(const SkinStream& skinStream, int vertexCount, const float *pBoneMatrix, float *pVertexBuffer, int vertexStride, float *pNormalBuffer, int normalStride);
+  static void skinSse(const SkinStream& skinStream, int vertexCount, const float *pBoneMatrix, float *pVertexBuffer, int vertexStride, float *pNormalBuffer, int normalStride);
+};
+
+#ifdef HAVE_NEON
+// implemented in skinning_neon.cpp, which is the only file built with -mfpu=neon
+void skinNeon(const SkinStream& skinStream, int vertexCount, const float *pBoneMatrix, float *pVertexBuffer, int vertexStride, float *pNormalBuffer, int normalStride);
+void skinDualQuaternionNeon(const SkinStream& skinStream, int vertexCount, const float *pDualQuaternion, float *pVertexBuffer, int vertexStride, float *pNormalBuffer, int normalStride);
+#endif
+
+#endif
+
+//----------------------------------------------------------------------------//
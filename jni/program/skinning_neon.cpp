@@ -0,0 +1,299 @@
+//----------------------------------------------------------------------------//
+// skinning_neon.cpp                                                          //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "skinning.h"
+
+#ifdef HAVE_NEON
+
+#include <arm_neon.h>
+
+//----------------------------------------------------------------------------//
+// Blend the bone matrices of all influences of a lane                        //
+//----------------------------------------------------------------------------//
+
+static inline void blendRowsNeon(const unsigned short *pBoneId, const float *pWeight, int influenceCount, const float *pBoneMatrix, float32x4_t& row0, float32x4_t& row1, float32x4_t& row2)
+{
+  const int blockSize = SkinStream::BLOCK_SIZE;
+
+  // padded influences have a zero weight, see blendRowsSse
+  const float *pMatrix = &pBoneMatrix[pBoneId[0] * Skinning::BONE_MATRIX_SIZE];
+  row0 = vmulq_n_f32(vld1q_f32(&pMatrix[0]), pWeight[0]);
+  row1 = vmulq_n_f32(vld1q_f32(&pMatrix[4]), pWeight[0]);
+  row2 = vmulq_n_f32(vld1q_f32(&pMatrix[8]), pWeight[0]);
+
+  int influenceId;
+  for(influenceId = 1; influenceId < influenceCount; influenceId++)
+  {
+    float weight;
+    weight = pWeight[influenceId * blockSize];
+    pMatrix = &pBoneMatrix[pBoneId[influenceId * blockSize] * Skinning::BONE_MATRIX_SIZE];
+    row0 = vmlaq_n_f32(row0, vld1q_f32(&pMatrix[0]), weight);
+    row1 = vmlaq_n_f32(row1, vld1q_f32(&pMatrix[4]), weight);
+    row2 = vmlaq_n_f32(row2, vld1q_f32(&pMatrix[8]), weight);
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Blend the dual quaternions of all influences of a lane                     //
+//----------------------------------------------------------------------------//
+
+static inline void blendDualQuaternionNeon(const unsigned short *pBoneId, const float *pWeight, int influenceCount, const float *pDualQuaternion, float32x4_t& real, float32x4_t& dual)
+{
+  const int blockSize = SkinStream::BLOCK_SIZE;
+
+  // padded influences have a zero weight, see blendRowsSse
+  const float *pFirst = &pDualQuaternion[pBoneId[0] * Skinning::DUAL_QUATERNION_SIZE];
+  real = vmulq_n_f32(vld1q_f32(&pFirst[0]), pWeight[0]);
+  dual = vmulq_n_f32(vld1q_f32(&pFirst[4]), pWeight[0]);
+
+  int influenceId;
+  for(influenceId = 1; influenceId < influenceCount; influenceId++)
+  {
+    const float *pQuaternion = &pDualQuaternion[pBoneId[influenceId * blockSize] * Skinning::DUAL_QUATERNION_SIZE];
+
+    // flip into the hemisphere of the first influence
+    float weight;
+    weight = pWeight[influenceId * blockSize];
+    if(pFirst[0] * pQuaternion[0] + pFirst[1] * pQuaternion[1] + pFirst[2] * pQuaternion[2] + pFirst[3] * pQuaternion[3] < 0.0f) weight = -weight;
+
+    real = vmlaq_n_f32(real, vld1q_f32(&pQuaternion[0]), weight);
+    dual = vmlaq_n_f32(dual, vld1q_f32(&pQuaternion[4]), weight);
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Transpose four matrix rows into four matrix columns                        //
+//----------------------------------------------------------------------------//
+
+static inline void transposeNeon(float32x4_t& c0, float32x4_t& c1, float32x4_t& c2, float32x4_t& c3)
+{
+  float32x4x2_t t01 = vtrnq_f32(c0, c1);
+  float32x4x2_t t23 = vtrnq_f32(c2, c3);
+
+  c0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+  c1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+  c2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+  c3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+
+//----------------------------------------------------------------------------//
+// NEON kernel, four vertices per iteration                                   //
+//----------------------------------------------------------------------------//
+
+void skinNeon(const SkinStream& skinStream, int vertexCount, const float *pBoneMatrix, float *pVertexBuffer, int vertexStride, float *pNormalBuffer, int normalStride)
+{
+  const int blockSize = SkinStream::BLOCK_SIZE;
+
+  const unsigned char *pInfluenceCount = skinStream.getInfluenceCounts();
+
+  int blockId;
+  for(blockId = 0; blockId < skinStream.getBlockCount(); blockId++)
+  {
+    const unsigned short *pVertexId = skinStream.getVertexIds(blockId);
+    const unsigned short *pBoneId = skinStream.getBoneIds(blockId);
+    const float *pWeight = skinStream.getWeights(blockId);
+    const float *pPosition = skinStream.getPositions(blockId);
+    const float *pNormal = skinStream.getNormals(blockId);
+
+    // blend the matrices of each lane
+    float32x4_t row[3][4];
+
+    int lane;
+    for(lane = 0; lane < blockSize; lane++)
+    {
+      blendRowsNeon(&pBoneId[lane], &pWeight[lane], pInfluenceCount[blockId], pBoneMatrix, row[0][lane], row[1][lane], row[2][lane]);
+    }
+
+    // positions and normals are already stored in SoA form
+    float32x4_t px = vld1q_f32(&pPosition[0]);
+    float32x4_t py = vld1q_f32(&pPosition[blockSize]);
+    float32x4_t pz = vld1q_f32(&pPosition[2 * blockSize]);
+    float32x4_t nx = vld1q_f32(&pNormal[0]);
+    float32x4_t ny = vld1q_f32(&pNormal[blockSize]);
+    float32x4_t nz = vld1q_f32(&pNormal[2 * blockSize]);
+
+    // transform in SoA form, see Skinning::skinSse
+    float32x4_t outPosition[3];
+    float32x4_t outNormal[3];
+
+    int rowId;
+    for(rowId = 0; rowId < 3; rowId++)
+    {
+      float32x4_t c0 = row[rowId][0];
+      float32x4_t c1 = row[rowId][1];
+      float32x4_t c2 = row[rowId][2];
+      float32x4_t c3 = row[rowId][3];
+      transposeNeon(c0, c1, c2, c3);
+
+      outPosition[rowId] = vmlaq_f32(vmlaq_f32(vmlaq_f32(c3, c0, px), c1, py), c2, pz);
+      outNormal[rowId] = vmlaq_f32(vmlaq_f32(vmulq_f32(c0, nx), c1, ny), c2, nz);
+    }
+
+    // normalize the normals, two newton-raphson steps bring the reciprocal
+    // square root estimate to full float precision
+    float32x4_t length = vmlaq_f32(vmlaq_f32(vmulq_f32(outNormal[0], outNormal[0]), outNormal[1], outNormal[1]), outNormal[2], outNormal[2]);
+    length = vmaxq_f32(length, vdupq_n_f32(1e-30f));
+    float32x4_t invLength = vrsqrteq_f32(length);
+    invLength = vmulq_f32(invLength, vrsqrtsq_f32(vmulq_f32(length, invLength), invLength));
+    invLength = vmulq_f32(invLength, vrsqrtsq_f32(vmulq_f32(length, invLength), invLength));
+    outNormal[0] = vmulq_f32(outNormal[0], invLength);
+    outNormal[1] = vmulq_f32(outNormal[1], invLength);
+    outNormal[2] = vmulq_f32(outNormal[2], invLength);
+
+    // scatter the valid lanes to their original vertex ids
+    float position[3][4];
+    float normal[3][4];
+    for(rowId = 0; rowId < 3; rowId++)
+    {
+      vst1q_f32(position[rowId], outPosition[rowId]);
+      vst1q_f32(normal[rowId], outNormal[rowId]);
+    }
+
+    for(lane = 0; lane < blockSize; lane++)
+    {
+      int vertexId;
+      vertexId = pVertexId[lane];
+      if(vertexId >= vertexCount) continue;
+
+      float *pVertexOut = (float *)((char *)pVertexBuffer + vertexId * vertexStride);
+      pVertexOut[0] = position[0][lane];
+      pVertexOut[1] = position[1][lane];
+      pVertexOut[2] = position[2][lane];
+
+      float *pNormalOut = (float *)((char *)pNormalBuffer + vertexId * normalStride);
+      pNormalOut[0] = normal[0][lane];
+      pNormalOut[1] = normal[1][lane];
+      pNormalOut[2] = normal[2][lane];
+    }
+  }
+}
+
+//----------------------------------------------------------------------------//
+// NEON dual quaternion kernel, four vertices per iteration                   //
+//----------------------------------------------------------------------------//
+
+void skinDualQuaternionNeon(const SkinStream& skinStream, int vertexCount, const float *pDualQuaternion, float *pVertexBuffer, int vertexStride, float *pNormalBuffer, int normalStride)
+{
+  const int blockSize = SkinStream::BLOCK_SIZE;
+
+  const unsigned char *pInfluenceCount = skinStream.getInfluenceCounts();
+
+  int blockId;
+  for(blockId = 0; blockId < skinStream.getBlockCount(); blockId++)
+  {
+    const unsigned short *pVertexId = skinStream.getVertexIds(blockId);
+    const unsigned short *pBoneId = skinStream.getBoneIds(blockId);
+    const float *pWeight = skinStream.getWeights(blockId);
+    const float *pPosition = skinStream.getPositions(blockId);
+    const float *pNormal = skinStream.getNormals(blockId);
+
+    // blend the dual quaternions of each lane
+    float32x4_t real[4];
+    float32x4_t dual[4];
+
+    int lane;
+    for(lane = 0; lane < blockSize; lane++)
+    {
+      blendDualQuaternionNeon(&pBoneId[lane], &pWeight[lane], pInfluenceCount[blockId], pDualQuaternion, real[lane], dual[lane]);
+    }
+
+    // transpose, so every register holds one component for all lanes
+    float32x4_t rx = real[0], ry = real[1], rz = real[2], rw = real[3];
+    transposeNeon(rx, ry, rz, rw);
+    float32x4_t dx = dual[0], dy = dual[1], dz = dual[2], dw = dual[3];
+    transposeNeon(dx, dy, dz, dw);
+
+    // back to unit dual quaternions, see skinNeon for the reciprocal square root
+    float32x4_t length = vmlaq_f32(vmlaq_f32(vmlaq_f32(vmulq_f32(rx, rx), ry, ry), rz, rz), rw, rw);
+    length = vmaxq_f32(length, vdupq_n_f32(1e-30f));
+    float32x4_t invLength = vrsqrteq_f32(length);
+    invLength = vmulq_f32(invLength, vrsqrtsq_f32(vmulq_f32(length, invLength), invLength));
+    invLength = vmulq_f32(invLength, vrsqrtsq_f32(vmulq_f32(length, invLength), invLength));
+    rx = vmulq_f32(rx, invLength); ry = vmulq_f32(ry, invLength); rz = vmulq_f32(rz, invLength); rw = vmulq_f32(rw, invLength);
+    dx = vmulq_f32(dx, invLength); dy = vmulq_f32(dy, invLength); dz = vmulq_f32(dz, invLength); dw = vmulq_f32(dw, invLength);
+
+    // the translation of the blended transforms
+    float32x4_t tx = vmulq_n_f32(vmlsq_f32(vmlaq_f32(vmlsq_f32(vmulq_f32(rw, dx), dw, rx), ry, dz), rz, dy), 2.0f);
+    float32x4_t ty = vmulq_n_f32(vmlsq_f32(vmlaq_f32(vmlsq_f32(vmulq_f32(rw, dy), dw, ry), rz, dx), rx, dz), 2.0f);
+    float32x4_t tz = vmulq_n_f32(vmlsq_f32(vmlaq_f32(vmlsq_f32(vmulq_f32(rw, dz), dw, rz), rx, dy), ry, dx), 2.0f);
+
+    // rotate positions and normals in SoA form: v + 2 r x (r x v + w v)
+    float32x4_t v[2][3];
+    v[0][0] = vld1q_f32(&pPosition[0]);
+    v[0][1] = vld1q_f32(&pPosition[blockSize]);
+    v[0][2] = vld1q_f32(&pPosition[2 * blockSize]);
+    v[1][0] = vld1q_f32(&pNormal[0]);
+    v[1][1] = vld1q_f32(&pNormal[blockSize]);
+    v[1][2] = vld1q_f32(&pNormal[2 * blockSize]);
+
+    float32x4_t out[2][3];
+
+    int vectorId;
+    for(vectorId = 0; vectorId < 2; vectorId++)
+    {
+      float32x4_t ax = vmlaq_f32(vmlsq_f32(vmulq_f32(ry, v[vectorId][2]), rz, v[vectorId][1]), rw, v[vectorId][0]);
+      float32x4_t ay = vmlaq_f32(vmlsq_f32(vmulq_f32(rz, v[vectorId][0]), rx, v[vectorId][2]), rw, v[vectorId][1]);
+      float32x4_t az = vmlaq_f32(vmlsq_f32(vmulq_f32(rx, v[vectorId][1]), ry, v[vectorId][0]), rw, v[vectorId][2]);
+
+      out[vectorId][0] = vmlaq_n_f32(v[vectorId][0], vmlsq_f32(vmulq_f32(ry, az), rz, ay), 2.0f);
+      out[vectorId][1] = vmlaq_n_f32(v[vectorId][1], vmlsq_f32(vmulq_f32(rz, ax), rx, az), 2.0f);
+      out[vectorId][2] = vmlaq_n_f32(v[vectorId][2], vmlsq_f32(vmulq_f32(rx, ay), ry, ax), 2.0f);
+    }
+
+    out[0][0] = vaddq_f32(out[0][0], tx);
+    out[0][1] = vaddq_f32(out[0][1], ty);
+    out[0][2] = vaddq_f32(out[0][2], tz);
+
+    // normalize the normals
+    length = vmlaq_f32(vmlaq_f32(vmulq_f32(out[1][0], out[1][0]), out[1][1], out[1][1]), out[1][2], out[1][2]);
+    length = vmaxq_f32(length, vdupq_n_f32(1e-30f));
+    invLength = vrsqrteq_f32(length);
+    invLength = vmulq_f32(invLength, vrsqrtsq_f32(vmulq_f32(length, invLength), invLength));
+    invLength = vmulq_f32(invLength, vrsqrtsq_f32(vmulq_f32(length, invLength), invLength));
+    out[1][0] = vmulq_f32(out[1][0], invLength);
+    out[1][1] = vmulq_f32(out[1][1], invLength);
+    out[1][2] = vmulq_f32(out[1][2], invLength);
+
+    // scatter the valid lanes to their original vertex ids
+    float position[3][4];
+    float normal[3][4];
+
+    int rowId;
+    for(rowId = 0; rowId < 3; rowId++)
+    {
+      vst1q_f32(position[rowId], out[0][rowId]);
+      vst1q_f32(normal[rowId], out[1][rowId]);
+    }
+
+    for(lane = 0; lane < blockSize; lane++)
+    {
+      int vertexId;
+      vertexId = pVertexId[lane];
+      if(vertexId >= vertexCount) continue;
+
+      float *pVertexOut = (float *)((char *)pVertexBuffer + vertexId * vertexStride);
+      pVertexOut[0] = position[0][lane];
+      pVertexOut[1] = position[1][lane];
+      pVertexOut[2] = position[2][lane];
+
+      float *pNormalOut = (float *)((char *)pNormalBuffer + vertexId * normalStride);
+      pNormalOut[0] = normal[0][lane];
+      pNormalOut[1] = normal[1][lane];
+      pNormalOut[2] = normal[2][lane];
+    }
+  }
+}
+
+#endif
+
+//----------------------------------------------------------------------------//
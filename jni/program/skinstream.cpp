@@ -0,0 +1,303 @@
+//----------------------------------------------------------------------------//
+// skinstream.cpp                                                             //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "skinstream.h"
+
+//----------------------------------------------------------------------------//
+// Static member variables initialization                                     //
+//----------------------------------------------------------------------------//
+
+const int SkinStream::BLOCK_SIZE;
+const int SkinStream::INFLUENCE_COUNT;
+const unsigned short SkinStream::INVALID_VERTEX_ID;
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+SkinStream::SkinStream()
+{
+  m_vertexCount = 0;
+  m_blockCount = 0;
+  m_truncatedVertexCount = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+SkinStream::~SkinStream()
+{
+}
+
+//----------------------------------------------------------------------------//
+// Bake the skin stream of a core submesh                                     //
+//----------------------------------------------------------------------------//
+
+bool SkinStream::create(CalCoreSubmesh *pCoreSubmesh)
+{
+  std::vector<CalCoreSubmesh::Vertex>& vectorVertex = pCoreSubmesh->getVectorVertex();
+
+  m_vertexCount = (int)vectorVertex.size();
+  if(m_vertexCount > INVALID_VERTEX_ID) return false;
+
+  // sort the skinned vertices by their influence count, so every block
+  // loops over as few padded influences as possible; vertices without any
+  // influence are not skinned at all and just copied
+  std::vector<unsigned short> vectorSortedVertexId;
+  vectorSortedVertexId.reserve(m_vertexCount);
+  m_vectorStaticVertexId.clear();
+
+  int influenceCount;
+  for(influenceCount = 0; ; influenceCount++)
+  {
+    bool bMore;
+    bMore = false;
+
+    int vertexId;
+    for(vertexId = 0; vertexId < m_vertexCount; vertexId++)
+    {
+      int vertexInfluenceCount;
+      vertexInfluenceCount = (int)vectorVertex[vertexId].vectorInfluence.size();
+      if(vertexInfluenceCount > INFLUENCE_COUNT) vertexInfluenceCount = INFLUENCE_COUNT;
+
+      if(vertexInfluenceCount > influenceCount) bMore = true;
+      if(vertexInfluenceCount != influenceCount) continue;
+
+      if(influenceCount == 0)
+      {
+        m_vectorStaticVertexId.push_back((unsigned short)vertexId);
+      }
+      else
+      {
+        vectorSortedVertexId.push_back((unsigned short)vertexId);
+      }
+    }
+
+    if(!bMore) break;
+  }
+
+  // allocate all streams, padded lanes get an invalid vertex id and zero weights
+  m_blockCount = ((int)vectorSortedVertexId.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+  m_vectorPosition.assign(m_blockCount * BLOCK_SIZE * 3, 0.0f);
+  m_vectorNormal.assign(m_blockCount * BLOCK_SIZE * 3, 0.0f);
+  m_vectorBoneId.assign(m_blockCount * BLOCK_SIZE * INFLUENCE_COUNT, 0);
+  m_vectorWeight.assign(m_blockCount * BLOCK_SIZE * INFLUENCE_COUNT, 0.0f);
+  m_vectorInfluenceCount.assign(m_blockCount, 0);
+  m_vectorVertexId.assign(m_blockCount * BLOCK_SIZE, INVALID_VERTEX_ID);
+  m_truncatedVertexCount = 0;
+
+  int sortedId;
+  for(sortedId = 0; sortedId < (int)vectorSortedVertexId.size(); sortedId++)
+  {
+    int blockId;
+    blockId = sortedId / BLOCK_SIZE;
+    int lane;
+    lane = sortedId % BLOCK_SIZE;
+
+    int vertexId;
+    vertexId = vectorSortedVertexId[sortedId];
+    const CalCoreSubmesh::Vertex& vertex = vectorVertex[vertexId];
+
+    m_vectorVertexId[blockId * BLOCK_SIZE + lane] = (unsigned short)vertexId;
+
+    float *pPosition = &m_vectorPosition[blockId * BLOCK_SIZE * 3];
+    pPosition[lane] = vertex.position.x;
+    pPosition[BLOCK_SIZE + lane] = vertex.position.y;
+    pPosition[2 * BLOCK_SIZE + lane] = vertex.position.z;
+
+    float *pNormal = &m_vectorNormal[blockId * BLOCK_SIZE * 3];
+    pNormal[lane] = vertex.normal.x;
+    pNormal[BLOCK_SIZE + lane] = vertex.normal.y;
+    pNormal[2 * BLOCK_SIZE + lane] = vertex.normal.z;
+
+    // keep the heaviest influences first; if there are too many of them,
+    // drop the lightest ones and renormalize to the original total weight
+    std::vector<CalCoreSubmesh::Influence> vectorInfluence(vertex.vectorInfluence);
+    float totalWeight;
+    totalWeight = 0.0f;
+
+    int i;
+    for(i = 0; i < (int)vectorInfluence.size(); i++)
+    {
+      totalWeight += vectorInfluence[i].weight;
+
+      int j;
+      for(j = i; (j > 0) && (vectorInfluence[j].weight > vectorInfluence[j - 1].weight); j--)
+      {
+        std::swap(vectorInfluence[j], vectorInfluence[j - 1]);
+      }
+    }
+
+    int vertexInfluenceCount;
+    vertexInfluenceCount = (int)vectorInfluence.size();
+
+    float scale;
+    scale = 1.0f;
+    if(vertexInfluenceCount > INFLUENCE_COUNT)
+    {
+      vertexInfluenceCount = INFLUENCE_COUNT;
+      m_truncatedVertexCount++;
+
+      float keptWeight;
+      keptWeight = 0.0f;
+      for(i = 0; i < vertexInfluenceCount; i++) keptWeight += vectorInfluence[i].weight;
+      if(keptWeight > 0.0f) scale = totalWeight / keptWeight;
+    }
+
+    for(i = 0; i < vertexInfluenceCount; i++)
+    {
+      m_vectorBoneId[(blockId * INFLUENCE_COUNT + i) * BLOCK_SIZE + lane] = (unsigned short)vectorInfluence[i].boneId;
+      m_vectorWeight[(blockId * INFLUENCE_COUNT + i) * BLOCK_SIZE + lane] = vectorInfluence[i].weight * scale;
+    }
+
+    if(vertexInfluenceCount > m_vectorInfluenceCount[blockId]) m_vectorInfluenceCount[blockId] = (unsigned char)vertexInfluenceCount;
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of vertex blocks                                            //
+//----------------------------------------------------------------------------//
+
+int SkinStream::getBlockCount() const
+{
+  return m_blockCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the bone ids of a block                                                //
+//----------------------------------------------------------------------------//
+
+const unsigned short *SkinStream::getBoneIds(int blockId) const
+{
+  return &m_vectorBoneId[blockId * BLOCK_SIZE * INFLUENCE_COUNT];
+}
+
+//----------------------------------------------------------------------------//
+// Get the influence counts of all blocks                                     //
+//----------------------------------------------------------------------------//
+
+const unsigned char *SkinStream::getInfluenceCounts() const
+{
+  return m_vectorInfluenceCount.empty() ? 0 : &m_vectorInfluenceCount[0];
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bytes used by the skin stream                            //
+//----------------------------------------------------------------------------//
+
+int SkinStream::getMemorySize() const
+{
+  return sizeof(SkinStream)
+    + m_vectorPosition.capacity() * sizeof(float)
+    + m_vectorNormal.capacity() * sizeof(float)
+    + m_vectorBoneId.capacity() * sizeof(unsigned short)
+    + m_vectorWeight.capacity() * sizeof(float)
+    + m_vectorInfluenceCount.capacity() * sizeof(unsigned char)
+    + m_vectorVertexId.capacity() * sizeof(unsigned short)
+    + m_vectorStaticVertexId.capacity() * sizeof(unsigned short);
+}
+
+//----------------------------------------------------------------------------//
+// Get the normals of a block                                                 //
+//----------------------------------------------------------------------------//
+
+const float *SkinStream::getNormals(int blockId) const
+{
+  return &m_vectorNormal[blockId * BLOCK_SIZE * 3];
+}
+
+//----------------------------------------------------------------------------//
+// Get the positions of a block                                               //
+//----------------------------------------------------------------------------//
+
+const float *SkinStream::getPositions(int blockId) const
+{
+  return &m_vectorPosition[blockId * BLOCK_SIZE * 3];
+}
+
+//----------------------------------------------------------------------------//
+// Get the ids of all vertices without influences                             //
+//----------------------------------------------------------------------------//
+
+const std::vector<unsigned short>& SkinStream::getStaticVertexIds() const
+{
+  return m_vectorStaticVertexId;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of vertices that lost influences while baking               //
+//----------------------------------------------------------------------------//
+
+int SkinStream::getTruncatedVertexCount() const
+{
+  return m_truncatedVertexCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of vertices of the core submesh                             //
+//----------------------------------------------------------------------------//
+
+int SkinStream::getVertexCount() const
+{
+  return m_vertexCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the original vertex ids of a block                                     //
+//----------------------------------------------------------------------------//
+
+const unsigned short *SkinStream::getVertexIds(int blockId) const
+{
+  return &m_vectorVertexId[blockId * BLOCK_SIZE];
+}
+
+//----------------------------------------------------------------------------//
+// Get the weights of a block                                                 //
+//----------------------------------------------------------------------------//
+
+const float *SkinStream::getWeights(int blockId) const
+{
+  return &m_vectorWeight[blockId * BLOCK_SIZE * INFLUENCE_COUNT];
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of bytes the skinning data of a core submesh uses           //
+//----------------------------------------------------------------------------//
+
+int SkinStream::getCoreSubmeshMemorySize(CalCoreSubmesh *pCoreSubmesh)
+{
+  // every influence vector is a separate heap block; count the usual 8 bytes
+  // of allocator bookkeeping for each of them
+  const int allocationOverhead = 8;
+
+  std::vector<CalCoreSubmesh::Vertex>& vectorVertex = pCoreSubmesh->getVectorVertex();
+
+  int size;
+  size = vectorVertex.capacity() * sizeof(CalCoreSubmesh::Vertex);
+
+  unsigned int vertexId;
+  for(vertexId = 0; vertexId < vectorVertex.size(); vertexId++)
+  {
+    int capacity;
+    capacity = vectorVertex[vertexId].vectorInfluence.capacity();
+    if(capacity > 0) size += capacity * sizeof(CalCoreSubmesh::Influence) + allocationOverhead;
+  }
+
+  return size;
+}
+
+//----------------------------------------------------------------------------//
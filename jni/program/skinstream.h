@@ -0,0 +1,73 @@
+//----------------------------------------------------------------------------//
+// skinstream.h                                                               //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef SKINSTREAM_H
+#define SKINSTREAM_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+class SkinStream
+{
+// misc
+public:
+  // vertices are stored in blocks of BLOCK_SIZE lanes, each lane has up to
+  // INFLUENCE_COUNT influences; a block is laid out as
+  //   position/normal: x[4] y[4] z[4]
+  //   bone id/weight:  influence 0 lanes[4], influence 1 lanes[4], ...
+  static const int BLOCK_SIZE = 4;
+  static const int INFLUENCE_COUNT = 4;
+  static const unsigned short INVALID_VERTEX_ID = 0xffff;
+
+// member variables
+protected:
+  int m_vertexCount;
+  int m_blockCount;
+  int m_truncatedVertexCount;
+  std::vector<float> m_vectorPosition;
+  std::vector<float> m_vectorNormal;
+  std::vector<unsigned short> m_vectorBoneId;
+  std::vector<float> m_vectorWeight;
+  std::vector<unsigned char> m_vectorInfluenceCount;
+  std::vector<unsigned short> m_vectorVertexId;
+  std::vector<unsigned short> m_vectorStaticVertexId;
+
+// constructors/destructor
+public:
+  SkinStream();
+  virtual ~SkinStream();
+
+// member functions
+public:
+  bool create(CalCoreSubmesh *pCoreSubmesh);
+  int getBlockCount() const;
+  const unsigned short *getBoneIds(int blockId) const;
+  const unsigned char *getInfluenceCounts() const;
+  int getMemorySize() const;
+  const float *getNormals(int blockId) const;
+  const float *getPositions(int blockId) const;
+  const std::vector<unsigned short>& getStaticVertexIds() const;
+  int getTruncatedVertexCount() const;
+  int getVertexCount() const;
+  const unsigned short *getVertexIds(int blockId) const;
+  const float *getWeights(int blockId) const;
+
+  static int getCoreSubmeshMemorySize(CalCoreSubmesh *pCoreSubmesh);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
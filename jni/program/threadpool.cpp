@@ -0,0 +1,348 @@
+//----------------------------------------------------------------------------//
+// threadpool.cpp                                                             //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "threadpool.h"
+#include "Utils.h"
+#include <unistd.h>
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+ThreadPool::ThreadPool()
+{
+  pthread_mutex_init(&m_mutex, 0);
+  pthread_cond_init(&m_conditionStart, 0);
+  pthread_cond_init(&m_conditionDone, 0);
+  m_generation = 0;
+  m_busyCount = 0;
+  m_bShutdown = false;
+  m_itemFunction = 0;
+  m_pUserData = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+ThreadPool::~ThreadPool()
+{
+  onShutdown();
+
+  pthread_cond_destroy(&m_conditionDone);
+  pthread_cond_destroy(&m_conditionStart);
+  pthread_mutex_destroy(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of online cpu cores                                         //
+//----------------------------------------------------------------------------//
+
+int ThreadPool::getCpuCount()
+{
+  long cpuCount;
+  cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+  return (cpuCount < 1) ? 1 : (int)cpuCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of ranges stolen from other threads so far                  //
+//----------------------------------------------------------------------------//
+
+int ThreadPool::getStealCount()
+{
+  int stealCount;
+  stealCount = 0;
+
+  int workerId;
+  for(workerId = 0; workerId < (int)m_vectorWorker.size(); workerId++)
+  {
+    stealCount += m_vectorWorker[workerId]->stealCount;
+  }
+
+  return stealCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of threads working on a run, including the calling thread   //
+//----------------------------------------------------------------------------//
+
+int ThreadPool::getThreadCount()
+{
+  return (int)m_vectorWorker.size();
+}
+
+//----------------------------------------------------------------------------//
+// Start the worker threads, the calling thread counts as the first one       //
+//----------------------------------------------------------------------------//
+
+bool ThreadPool::onInit(int threadCount)
+{
+  onShutdown();
+
+  if(threadCount < 1) threadCount = 1;
+
+  int workerId;
+  for(workerId = 0; workerId < threadCount; workerId++)
+  {
+    Worker *pWorker;
+    pWorker = new Worker();
+    pWorker->pThreadPool = this;
+    pWorker->workerId = workerId;
+    pWorker->stealCount = 0;
+    pthread_mutex_init(&pWorker->mutex, 0);
+
+    m_vectorWorker.push_back(pWorker);
+  }
+
+  for(workerId = 1; workerId < threadCount; workerId++)
+  {
+    if(pthread_create(&m_vectorWorker[workerId]->thread, 0, runThread, m_vectorWorker[workerId]) != 0)
+    {
+      LOG("Failed to create worker thread #%d.", workerId);
+
+      // only the threads that are running get joined
+      pthread_mutex_destroy(&m_vectorWorker[workerId]->mutex);
+      delete m_vectorWorker[workerId];
+      m_vectorWorker.resize(workerId);
+
+      onShutdown();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Stop and join the worker threads                                           //
+//----------------------------------------------------------------------------//
+
+void ThreadPool::onShutdown()
+{
+  if(m_vectorWorker.empty()) return;
+
+  pthread_mutex_lock(&m_mutex);
+  m_bShutdown = true;
+  pthread_cond_broadcast(&m_conditionStart);
+  pthread_mutex_unlock(&m_mutex);
+
+  int workerId;
+  for(workerId = 1; workerId < (int)m_vectorWorker.size(); workerId++)
+  {
+    pthread_join(m_vectorWorker[workerId]->thread, 0);
+  }
+
+  for(workerId = 0; workerId < (int)m_vectorWorker.size(); workerId++)
+  {
+    pthread_mutex_destroy(&m_vectorWorker[workerId]->mutex);
+    delete m_vectorWorker[workerId];
+  }
+
+  // the workers of the next init start waiting at generation 0 again
+  m_vectorWorker.clear();
+  m_generation = 0;
+  m_bShutdown = false;
+}
+
+//----------------------------------------------------------------------------//
+// Take the last range of the own queue                                       //
+//----------------------------------------------------------------------------//
+
+bool ThreadPool::popRange(Worker *pWorker, Range& range)
+{
+  bool bFound;
+  bFound = false;
+
+  pthread_mutex_lock(&pWorker->mutex);
+  if(!pWorker->dequeRange.empty())
+  {
+    range = pWorker->dequeRange.back();
+    pWorker->dequeRange.pop_back();
+    bFound = true;
+  }
+  pthread_mutex_unlock(&pWorker->mutex);
+
+  return bFound;
+}
+
+//----------------------------------------------------------------------------//
+// Run a function over all items and wait until every item is done, the items //
+// are handed out in ranges of grainSize items                                //
+//----------------------------------------------------------------------------//
+
+void ThreadPool::run(ItemFunction itemFunction, void *pUserData, int itemCount, int grainSize)
+{
+  if(itemCount <= 0) return;
+  if(grainSize < 1) grainSize = 1;
+
+  // without workers everything runs right here
+  if(m_vectorWorker.size() <= 1)
+  {
+    int itemId;
+    for(itemId = 0; itemId < itemCount; itemId++)
+    {
+      itemFunction(pUserData, itemId);
+    }
+
+    return;
+  }
+
+  int workerCount;
+  workerCount = (int)m_vectorWorker.size();
+
+  int rangeCount;
+  rangeCount = (itemCount + grainSize - 1) / grainSize;
+
+  // the function is published before the first range is queued, so every
+  // thread that finds a range also finds the function it belongs to
+  pthread_mutex_lock(&m_mutex);
+  m_itemFunction = itemFunction;
+  m_pUserData = pUserData;
+  pthread_mutex_unlock(&m_mutex);
+
+  // every thread starts with a contiguous block of ranges, pushed in reverse
+  // so the owner works through its block front to back
+  int rangeId;
+  for(rangeId = rangeCount - 1; rangeId >= 0; rangeId--)
+  {
+    Range range;
+    range.beginId = rangeId * grainSize;
+    range.endId = (range.beginId + grainSize < itemCount) ? range.beginId + grainSize : itemCount;
+
+    Worker *pWorker;
+    pWorker = m_vectorWorker[(int)((long long)rangeId * workerCount / rangeCount)];
+
+    pthread_mutex_lock(&pWorker->mutex);
+    pWorker->dequeRange.push_back(range);
+    pthread_mutex_unlock(&pWorker->mutex);
+  }
+
+  pthread_mutex_lock(&m_mutex);
+  m_busyCount = workerCount - 1;
+  m_generation++;
+  pthread_cond_broadcast(&m_conditionStart);
+  pthread_mutex_unlock(&m_mutex);
+
+  runRanges(m_vectorWorker[0]);
+
+  pthread_mutex_lock(&m_mutex);
+  while(m_busyCount > 0)
+  {
+    pthread_cond_wait(&m_conditionDone, &m_mutex);
+  }
+  pthread_mutex_unlock(&m_mutex);
+}
+
+//----------------------------------------------------------------------------//
+// Run ranges until no thread has any left                                    //
+//----------------------------------------------------------------------------//
+
+void ThreadPool::runRanges(Worker *pWorker)
+{
+  Range range;
+  while(popRange(pWorker, range) || stealRange(pWorker, range))
+  {
+    int itemId;
+    for(itemId = range.beginId; itemId < range.endId; itemId++)
+    {
+      m_itemFunction(m_pUserData, itemId);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Thread entry point                                                         //
+//----------------------------------------------------------------------------//
+
+void *ThreadPool::runThread(void *pWorker)
+{
+  ((Worker *)pWorker)->pThreadPool->runWorker((Worker *)pWorker);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------//
+// Wait for runs and work on them until the pool shuts down                   //
+//----------------------------------------------------------------------------//
+
+void ThreadPool::runWorker(Worker *pWorker)
+{
+  int generation;
+  generation = 0;
+
+  while(true)
+  {
+    pthread_mutex_lock(&m_mutex);
+    while(!m_bShutdown && (m_generation == generation))
+    {
+      pthread_cond_wait(&m_conditionStart, &m_mutex);
+    }
+
+    if(m_bShutdown)
+    {
+      pthread_mutex_unlock(&m_mutex);
+      break;
+    }
+
+    generation = m_generation;
+    pthread_mutex_unlock(&m_mutex);
+
+    runRanges(pWorker);
+
+    pthread_mutex_lock(&m_mutex);
+    m_busyCount--;
+    if(m_busyCount == 0) pthread_cond_signal(&m_conditionDone);
+    pthread_mutex_unlock(&m_mutex);
+  }
+}
+
+//----------------------------------------------------------------------------//
+// Take the first range of the queue of another thread                        //
+//----------------------------------------------------------------------------//
+
+bool ThreadPool::stealRange(Worker *pWorker, Range& range)
+{
+  int workerCount;
+  workerCount = (int)m_vectorWorker.size();
+
+  int offset;
+  for(offset = 1; offset < workerCount; offset++)
+  {
+    Worker *pVictim;
+    pVictim = m_vectorWorker[(pWorker->workerId + offset) % workerCount];
+
+    bool bFound;
+    bFound = false;
+
+    pthread_mutex_lock(&pVictim->mutex);
+    if(!pVictim->dequeRange.empty())
+    {
+      range = pVictim->dequeRange.front();
+      pVictim->dequeRange.pop_front();
+      bFound = true;
+    }
+    pthread_mutex_unlock(&pVictim->mutex);
+
+    if(bFound)
+    {
+      pWorker->stealCount++;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//----------------------------------------------------------------------------//
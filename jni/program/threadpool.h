@@ -0,0 +1,89 @@
+//----------------------------------------------------------------------------//
+// threadpool.h                                                               //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+#include <deque>
+#include <pthread.h>
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+// runs a function over a range of items on a fixed set of threads, every
+// thread owns a queue of item ranges and steals from the others once its own
+// queue is empty, the calling thread takes part in the work
+class ThreadPool
+{
+// misc
+public:
+  typedef void (*ItemFunction)(void *pUserData, int itemId);
+
+protected:
+  struct Range
+  {
+    int beginId;
+    int endId;
+  };
+
+  struct Worker
+  {
+    ThreadPool *pThreadPool;
+    int workerId;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    std::deque<Range> dequeRange;
+    int stealCount;
+  };
+
+// member variables
+protected:
+  std::vector<Worker *> m_vectorWorker;
+  pthread_mutex_t m_mutex;
+  pthread_cond_t m_conditionStart;
+  pthread_cond_t m_conditionDone;
+  int m_generation;
+  int m_busyCount;
+  bool m_bShutdown;
+  ItemFunction m_itemFunction;
+  void *m_pUserData;
+
+// constructors/destructor
+public:
+  ThreadPool();
+  virtual ~ThreadPool();
+
+// member functions
+public:
+  int getStealCount();
+  int getThreadCount();
+  bool onInit(int threadCount);
+  void onShutdown();
+  void run(ItemFunction itemFunction, void *pUserData, int itemCount, int grainSize);
+
+  static int getCpuCount();
+
+protected:
+  bool popRange(Worker *pWorker, Range& range);
+  void runRanges(Worker *pWorker);
+  void runWorker(Worker *pWorker);
+  bool stealRange(Worker *pWorker, Range& range);
+
+  static void *runThread(void *pWorker);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//
@@ -0,0 +1,267 @@
+//----------------------------------------------------------------------------//
+// tracksampler.cpp                                                           //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "tracksampler.h"
+#include "packedanimation.h"
+#include "compressedanimation.h"
+
+//----------------------------------------------------------------------------//
+// Static member variables initialization                                     //
+//----------------------------------------------------------------------------//
+
+int TrackSampler::m_lookupCount = 0;
+int TrackSampler::m_cursorHitCount = 0;
+int TrackSampler::m_neighbourHitCount = 0;
+int TrackSampler::m_searchCount = 0;
+
+//----------------------------------------------------------------------------//
+// Constructors                                                               //
+//----------------------------------------------------------------------------//
+
+TrackSampler::TrackSampler()
+{
+  m_keyframeId = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Destructor                                                                 //
+//----------------------------------------------------------------------------//
+
+TrackSampler::~TrackSampler()
+{
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of lookups answered by the cached keyframe                  //
+//----------------------------------------------------------------------------//
+
+int TrackSampler::getCursorHitCount()
+{
+  return m_cursorHitCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the keyframe after the given time, starting at the cached keyframe     //
+//----------------------------------------------------------------------------//
+
+int TrackSampler::getKeyframeId(const float *pTime, int keyframeCount, float time)
+{
+  if(keyframeCount <= 1) return 0;
+
+  m_lookupCount++;
+
+  // animation time almost always moves forward by a fraction of a keyframe,
+  // so the last keyframe or its successor is the answer most of the time
+  if(isKeyframeId(pTime, keyframeCount, m_keyframeId, time))
+  {
+    m_cursorHitCount++;
+    return m_keyframeId;
+  }
+
+  // check the neighbours, including the wrap back to the start of a cycle
+  int candidateId[3];
+  candidateId[0] = m_keyframeId + 1;
+  candidateId[1] = m_keyframeId - 1;
+  candidateId[2] = 1;
+
+  int i;
+  for(i = 0; i < 3; i++)
+  {
+    if(isKeyframeId(pTime, keyframeCount, candidateId[i], time))
+    {
+      m_neighbourHitCount++;
+      m_keyframeId = candidateId[i];
+      return m_keyframeId;
+    }
+  }
+
+  // the time jumped, fall back to the binary search
+  m_searchCount++;
+  m_keyframeId = searchKeyframeId(pTime, keyframeCount, time);
+
+  return m_keyframeId;
+}
+
+//----------------------------------------------------------------------------//
+// Get the total number of lookups                                            //
+//----------------------------------------------------------------------------//
+
+int TrackSampler::getLookupCount()
+{
+  return m_lookupCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of lookups answered by a neighbour of the cached keyframe   //
+//----------------------------------------------------------------------------//
+
+int TrackSampler::getNeighbourHitCount()
+{
+  return m_neighbourHitCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the number of lookups that needed a binary search                      //
+//----------------------------------------------------------------------------//
+
+int TrackSampler::getSearchCount()
+{
+  return m_searchCount;
+}
+
+//----------------------------------------------------------------------------//
+// Get the state of a compressed track at a given time, only the two          //
+// keyframes around the time get decoded; the rotations are interpolated with //
+// the given mode                                                             //
+//----------------------------------------------------------------------------//
+
+bool TrackSampler::getState(const CompressedAnimation& compressedAnimation, int trackId, float time, CalVector& translation, CalQuaternion& rotation, PoseBlender::Mode mode)
+{
+  int keyframeCount;
+  keyframeCount = compressedAnimation.getKeyframeCount(trackId);
+  if(keyframeCount == 0) return false;
+
+  if(keyframeCount == 1)
+  {
+    compressedAnimation.getTranslation(trackId, 0, translation);
+    compressedAnimation.getRotation(trackId, 0, rotation);
+    return true;
+  }
+
+  const float *pTime = compressedAnimation.getTimes(trackId);
+
+  int keyframeId;
+  keyframeId = getKeyframeId(pTime, keyframeCount, time);
+
+  float blendFactor;
+  blendFactor = (time - pTime[keyframeId - 1]) / (pTime[keyframeId] - pTime[keyframeId - 1]);
+
+  CalVector translationAfter;
+  compressedAnimation.getTranslation(trackId, keyframeId - 1, translation);
+  compressedAnimation.getTranslation(trackId, keyframeId, translationAfter);
+  translation.blend(blendFactor, translationAfter);
+
+  CalQuaternion rotationAfter;
+  compressedAnimation.getRotation(trackId, keyframeId - 1, rotation);
+  compressedAnimation.getRotation(trackId, keyframeId, rotationAfter);
+  PoseBlender::blendRotation(rotation, blendFactor, rotationAfter, mode);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Get the state of a packed track at a given time, same result as            //
+// CalCoreTrack::getState with the slerp mode                                 //
+//----------------------------------------------------------------------------//
+
+bool TrackSampler::getState(const PackedAnimation& packedAnimation, int trackId, float time, CalVector& translation, CalQuaternion& rotation, PoseBlender::Mode mode)
+{
+  int keyframeCount;
+  keyframeCount = packedAnimation.getKeyframeCount(trackId);
+  if(keyframeCount == 0) return false;
+
+  const CalVector *pTranslation = packedAnimation.getTranslations(trackId);
+  const CalQuaternion *pRotation = packedAnimation.getRotations(trackId);
+
+  // a single keyframe holds the state for all times
+  if(keyframeCount == 1)
+  {
+    translation = pTranslation[0];
+    rotation = pRotation[0];
+    return true;
+  }
+
+  const float *pTime = packedAnimation.getTimes(trackId);
+
+  int keyframeId;
+  keyframeId = getKeyframeId(pTime, keyframeCount, time);
+
+  // times outside of the keyframes extrapolate, just like cal3d does
+  float blendFactor;
+  blendFactor = (time - pTime[keyframeId - 1]) / (pTime[keyframeId] - pTime[keyframeId - 1]);
+
+  translation = pTranslation[keyframeId - 1];
+  translation.blend(blendFactor, pTranslation[keyframeId]);
+
+  rotation = pRotation[keyframeId - 1];
+  PoseBlender::blendRotation(rotation, blendFactor, pRotation[keyframeId], mode);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Check if a keyframe is the one after the given time                        //
+//----------------------------------------------------------------------------//
+
+bool TrackSampler::isKeyframeId(const float *pTime, int keyframeCount, int keyframeId, float time)
+{
+  // the first and last keyframe pairs also cover the times outside the track
+  if((keyframeId < 1) || (keyframeId >= keyframeCount)) return false;
+  if((keyframeId > 1) && (time < pTime[keyframeId - 1])) return false;
+  if((keyframeId < keyframeCount - 1) && (time >= pTime[keyframeId])) return false;
+
+  return true;
+}
+
+//----------------------------------------------------------------------------//
+// Forget the cached keyframe                                                 //
+//----------------------------------------------------------------------------//
+
+void TrackSampler::reset()
+{
+  m_keyframeId = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Reset the lookup counters                                                  //
+//----------------------------------------------------------------------------//
+
+void TrackSampler::resetCounters()
+{
+  m_lookupCount = 0;
+  m_cursorHitCount = 0;
+  m_neighbourHitCount = 0;
+  m_searchCount = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Binary search for the keyframe after the given time, same as               //
+// CalCoreTrack::getUpperBound                                                //
+//----------------------------------------------------------------------------//
+
+int TrackSampler::searchKeyframeId(const float *pTime, int keyframeCount, float time)
+{
+  int lowerBound;
+  lowerBound = 0;
+  int upperBound;
+  upperBound = keyframeCount - 1;
+
+  while(lowerBound < upperBound - 1)
+  {
+    int middle;
+    middle = (lowerBound + upperBound) / 2;
+
+    if(time >= pTime[middle])
+    {
+      lowerBound = middle;
+    }
+    else
+    {
+      upperBound = middle;
+    }
+  }
+
+  return upperBound;
+}
+
+//----------------------------------------------------------------------------//
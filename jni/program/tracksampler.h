@@ -0,0 +1,69 @@
+//----------------------------------------------------------------------------//
+// tracksampler.h                                                             //
+//----------------------------------------------------------------------------//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//----------------------------------------------------------------------------//
+
+#ifndef TRACKSAMPLER_H
+#define TRACKSAMPLER_H
+
+//----------------------------------------------------------------------------//
+// Includes                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "global.h"
+#include "poseblender.h"
+
+//----------------------------------------------------------------------------//
+// Forward declarations                                                       //
+//----------------------------------------------------------------------------//
+
+class CompressedAnimation;
+class PackedAnimation;
+
+//----------------------------------------------------------------------------//
+// Class declaration                                                          //
+//----------------------------------------------------------------------------//
+
+class TrackSampler
+{
+// member variables
+protected:
+  // cached result of the last keyframe lookup, the keyframe after the sample time
+  int m_keyframeId;
+
+  // statistics only, updates running on several threads may lose counts
+  static int m_lookupCount;
+  static int m_cursorHitCount;
+  static int m_neighbourHitCount;
+  static int m_searchCount;
+
+// constructors/destructor
+public:
+  TrackSampler();
+  virtual ~TrackSampler();
+
+// member functions
+public:
+  int getKeyframeId(const float *pTime, int keyframeCount, float time);
+  bool getState(const CompressedAnimation& compressedAnimation, int trackId, float time, CalVector& translation, CalQuaternion& rotation, PoseBlender::Mode mode = PoseBlender::MODE_SLERP);
+  bool getState(const PackedAnimation& packedAnimation, int trackId, float time, CalVector& translation, CalQuaternion& rotation, PoseBlender::Mode mode = PoseBlender::MODE_SLERP);
+  void reset();
+
+  static int getCursorHitCount();
+  static int getLookupCount();
+  static int getNeighbourHitCount();
+  static int getSearchCount();
+  static void resetCounters();
+  static int searchKeyframeId(const float *pTime, int keyframeCount, float time);
+
+protected:
+  static bool isKeyframeId(const float *pTime, int keyframeCount, int keyframeId, float time);
+};
+
+#endif
+
+//----------------------------------------------------------------------------//